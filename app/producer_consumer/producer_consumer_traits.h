@@ -59,6 +59,23 @@ template<> struct Traits<Observers>: public Traits<Build>
     static const bool debugged = false;
 };
 
+template<> struct Traits<Tracer>: public Traits<Build>
+{
+    static const bool enabled = false;
+    static const unsigned int BUFFER_SIZE = 1024; // records per CPU (must be a power of 2)
+};
+
+template<> struct Traits<Profiler>: public Traits<Build>
+{
+    static const bool enabled = false;
+    static const unsigned int EVENT0 = CONDITIONAL_BRANCHES;     // PMU events counted for each thread (LAST_EVENT = unused)
+    static const unsigned int EVENT1 = BRANCH_MISPREDICTIONS;
+    static const unsigned int EVENT2 = INSTRUCTION_CACHE_MISSES;
+    static const unsigned int EVENT3 = LAST_EVENT;
+    static const unsigned int HISTOGRAM_SIZE = 1024;             // distinct sampled PCs per CPU (must be a power of 2)
+    static const unsigned int THREADS = 32;                      // exited threads whose counters are kept for the report
+};
+
 
 // System Parts (mostly to fine control debugging)
 template<> struct Traits<Boot>: public Traits<Build>
@@ -75,6 +92,7 @@ template<> struct Traits<Init>: public Traits<Build>
 
 template<> struct Traits<Framework>: public Traits<Build>
 {
+    static const unsigned int CACHE_SIZE = 64; // handles and proxies of objects created by SETUP (a power of two)
 };
 
 template<> struct Traits<Aspect>: public Traits<Build>
@@ -106,6 +124,7 @@ template<> struct Traits<System>: public Traits<Build>
     static const bool multithread = (Traits<Build>::CPUS > 1) || (Traits<Application>::MAX_THREADS > 1);
     static const bool multitask = (mode != Traits<Build>::LIBRARY);
     static const bool multiheap = multitask || Traits<Scratchpad>::enabled;
+    static const bool bounce = multitask; // DMA-capable devices stage data through buffers of their own
 
     static const unsigned long LIFE_SPAN = 1 * YEAR; // s
     static const unsigned int DUTY_CYCLE = 1000000; // ppm
@@ -126,6 +145,7 @@ template<> struct Traits<Thread>: public Traits<Build>
     static const bool enabled = Traits<System>::multithread;
     static const bool trace_idle = hysterically_debugged;
     static const bool simulate_capacity = false;
+    static const bool collect_statistics = false; // run time, scheduling latency, context switches and wakeups (see Thread::statistics())
     static const unsigned int QUANTUM = 10000; // us
 
     typedef FCFS Criterion;
@@ -144,6 +164,9 @@ template<> struct Traits<Synchronizer>: public Traits<Build>
 template<> struct Traits<Alarm>: public Traits<Build>
 {
     static const bool visible = hysterically_debugged;
+
+    // Run handlers as Tasklets, after the timer interrupt (see interrupt.h)
+    static const bool deferred = false;
 };
 
 template<> struct Traits<Address_Space>: public Traits<Build> {};
@@ -434,7 +434,7 @@ public:
 
     static Phy_Addr calloc(unsigned long frames = 1, Color color = WHITE) {
         Phy_Addr phy = alloc(frames, color);
-        memset(phy2log(phy), 0, sizeof(Frame) * frames);
+        memzero(phy2log(phy), sizeof(Frame) * frames);
         return phy;
     }
 
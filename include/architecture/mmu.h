@@ -88,6 +88,15 @@ public:
     // Page types
     enum Page_Type {PG, PT, AT, PD};
 
+    // Scoped batch of TLB shootdowns, for a sequence of detach()es to cost a single flush; MMUs that only flush the
+    // local TLB have nothing to batch
+    class Shootdown
+    {
+    public:
+        Shootdown() {}
+        ~Shootdown() {}
+    };
+
 public:
     // Functions to calculate quantities
     constexpr static unsigned int pds(unsigned int ats) { return 1; }
@@ -43,7 +43,7 @@ public:
             CT   = 1 << 8, // Contiguous (reserved for use by supervisor RSW)
             MIO  = 1 << 9, // I/O (reserved for use by supervisor RSW)
 
-            IAD  = (Traits<Build>::MODEL == Traits<Build>::SiFive_U) ? A | D : 0, // SiFive-U RV64 MMU can´t handle A and D and requires it to be set
+            IAD  = ((Traits<Build>::MODEL == Traits<Build>::SiFive_U) || (Traits<Build>::MODEL == Traits<Build>::Virt)) ? A | D : 0, // SiFive-U (and QEMU virt) RV64 MMU can´t handle A and D and requires it to be set
 
             APP  = (V | R | W | X | U | IAD),
             APPC = (V | R |     X | U | IAD),
@@ -393,7 +393,7 @@ public:
 
     static Phy_Addr calloc(unsigned long frames = 1, Color color = WHITE) {
         Phy_Addr phy = alloc(frames, color);
-        memset(phy2log(phy), 0, sizeof(Frame) * frames);
+        memzero(phy2log(phy), sizeof(Frame) * frames);
         return phy;
     }
 
@@ -69,6 +69,14 @@ public:
         MEI             = 1 << 11       // Machine External Interrupt
     };
 
+    // Environment Configuration and Counter-Enable Registers (menvcfg and [m|s]counteren)
+    enum : unsigned long {
+        STCE            = 1UL << 63,    // Supervisor Timer Compare Enable (Sstc's stimecmp)
+        CY              = 1 << 0,       // Cycle counter access for less privileged modes
+        TM              = 1 << 1,       // Time counter (and stimecmp) access for less privileged modes
+        IR              = 1 << 2        // Instructions-retired counter access for less privileged modes
+    };
+
     // Exceptions ([m|s]cause with interrupt = 0)
     static const unsigned int EXCEPTIONS = 16;
     enum {
@@ -306,6 +314,8 @@ public:
         return old;
     }
 
+    static void fence() {             ASM("fence"         : :           : "memory"); } // orders memory accesses, including those seen by devices
+
     static void flush_tlb() {         ASM("sfence.vma"    : :           : "memory"); }
     static void flush_tlb(Reg addr) { ASM("sfence.vma %0" : : "r"(addr) : "memory"); }
 
@@ -422,6 +432,20 @@ public:
     static void pmpaddr0(Reg r)   { ASM("csrw pmpaddr0, %0" : : "r"(r) : "cc"); }
     static Reg  pmpaddr0() { Reg r; ASM("csrr %0, pmpaddr0" :  "=r"(r) : : ); return r; }
 
+    static void mcounterens(Reg r)  { ASM("csrs mcounteren, %0" : : "r"(r) : "cc"); }
+
+    // Sstc lets supervisor mode program its own timer through stimecmp once menvcfg.STCE and mcounteren.TM are set.
+    // menvcfg came with privileged spec 1.12 and older harts trap on it, so this must run with an mtvec that skips the
+    // offending instruction (as SETUP does), in which case STCE reads as zero and false is returned.
+    static bool sstc_enable() {
+        Reg r = 0;
+        ASM("csrs 0x30a, %1 \n csrr %0, 0x30a" : "+r"(r) : "r"(Reg(STCE)) : "cc");
+        if(!(r & STCE))
+            return false;
+        mcounterens(TM);
+        return true;
+    }
+
     // Supervisor mode
     static void sint_enable()  { ASM("csrsi sstatus, %0" : : "i"(SIE) : "cc"); }
     static void sint_disable() { ASM("csrci sstatus, %0" : : "i"(SIE) : "cc"); }
@@ -450,6 +474,8 @@ public:
     static void sepc(Reg r)   { ASM("csrw sepc, %0" : : "r"(r) : "cc"); }
     static Reg  sepc() { Reg r; ASM("csrr %0, sepc" :  "=r"(r) : : ); return r; }
 
+    static void stimecmp(Reg64 r) { ASM("csrw 0x14d, %0" : : "r"(r) : "cc"); }
+
     static void sret() { ASM("sret"); }
 
     static void satp(Reg r) { ASM("csrw satp, %0" : : "r"(r) : "cc"); }
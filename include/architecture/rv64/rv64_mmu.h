@@ -43,7 +43,7 @@ public:
             CT   = 1 << 8, // Contiguous (reserved for use by supervisor RSW)
             MIO  = 1 << 9, // I/O (reserved for use by supervisor RSW)
 
-            IAD  = (Traits<Build>::MODEL == Traits<Build>::SiFive_U) ? A | D : 0, // SiFive-U RV64 MMU can´t handle A and D and requires it to be set
+            IAD  = ((Traits<Build>::MODEL == Traits<Build>::SiFive_U) || (Traits<Build>::MODEL == Traits<Build>::Virt)) ? A | D : 0, // SiFive-U (and QEMU virt) RV64 MMU can´t handle A and D and requires it to be set
 
             APP  = (V | R | W | X | U | IAD),
             APPC = (V | R |     X | U | IAD),
@@ -362,7 +362,7 @@ public:
                             return Log_Addr(false);
                 }
             }
-            flush_tlb();
+            shootdown();
             return addr;
         }
 
@@ -450,7 +450,7 @@ public:
 
     static Phy_Addr calloc(unsigned long frames = 1, Color color = WHITE) {
         Phy_Addr phy = alloc(frames, color);
-        memset(phy2log(phy), 0, sizeof(Frame) * frames);
+        memzero(phy2log(phy), sizeof(Frame) * frames);
         return phy;
     }
 
@@ -510,6 +510,15 @@ public:
     static Phy_Addr log2phy(Log_Addr log) { return Phy_Addr((RAM_BASE == PHY_MEM) ? log : (RAM_BASE > PHY_MEM) ? log + (RAM_BASE - PHY_MEM) : log - (PHY_MEM - RAM_BASE)); }
 #endif
 
+    // While a batch is open on this hart (interrupts are disabled meanwhile), the TLB flushes detach()es need are only
+    // recorded, and get done at once here and on the other harts running EPOS (one IPI each) when the outermost closes
+    class Shootdown
+    {
+    public:
+        Shootdown();
+        ~Shootdown();
+    };
+
     static Color phy2color(Phy_Addr phy) { return static_cast<Color>(colorful ? ((phy >> PT_SHIFT) & 0x7f) % COLORS : WHITE); } // TODO: what is 0x7f
 
     static Color log2color(Log_Addr log) {
@@ -528,6 +537,7 @@ private:
 
     static void flush_tlb() { CPU::flush_tlb(); }
     static void flush_tlb(Log_Addr addr) { CPU::flush_tlb(addr); }
+    static void shootdown();
 
     static void init();
 
@@ -259,6 +259,7 @@ private:
         }
     }
 
+    // Counters are read through their user-level shadows (hpmcounterN), which also work in supervisor mode once enabled in mcounteren
     static Count mhpmcounter(Reg counter) {
         assert(counter < COUNTERS);
 
@@ -269,7 +270,7 @@ private:
         case 0:
             ASM("rdcycle  %0" : "=r"(reg) : );
             break;
-#ifndef __sifive_u__
+#if !defined(__sifive_u__) && !defined(__virt__)
         case 1:
             ASM("rdtime  %0" : "=r"(reg) : );
             break;
@@ -278,91 +279,91 @@ private:
             ASM("rdinstret  %0" : "=r"(reg) : );
             break;
         case 3:
-            ASM("csrr %0, mhpmcounter3"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter3"  : "=r"(reg) : );
             break;
         case 4:
-            ASM("csrr %0, mhpmcounter4"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter4"  : "=r"(reg) : );
             break;
         case 5:
-            ASM("csrr %0, mhpmcounter5"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter5"  : "=r"(reg) : );
             break;
         case 6:
-            ASM("csrr %0, mhpmcounter6"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter6"  : "=r"(reg) : );
             break;
         case 7:
-            ASM("csrr %0, mhpmcounter7"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter7"  : "=r"(reg) : );
             break;
         case 8:
-            ASM("csrr %0, mhpmcounter8"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter8"  : "=r"(reg) : );
             break;
         case 9:
-            ASM("csrr %0, mhpmcounter9"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter9"  : "=r"(reg) : );
             break;
         case 10:
-            ASM("csrr %0, mhpmcounter10"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter10"  : "=r"(reg) : );
             break;
         case 11:
-            ASM("csrr %0, mhpmcounter11"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter11"  : "=r"(reg) : );
             break;
         case 12:
-            ASM("csrr %0, mhpmcounter12"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter12"  : "=r"(reg) : );
             break;
         case 13:
-            ASM("csrr %0, mhpmcounter13"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter13"  : "=r"(reg) : );
             break;
         case 14:
-            ASM("csrr %0, mhpmcounter14"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter14"  : "=r"(reg) : );
             break;
         case 15:
-            ASM("csrr %0, mhpmcounter15"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter15"  : "=r"(reg) : );
             break;
         case 16:
-            ASM("csrr %0, mhpmcounter16"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter16"  : "=r"(reg) : );
             break;
         case 17:
-            ASM("csrr %0, mhpmcounter17"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter17"  : "=r"(reg) : );
             break;
         case 18:
-            ASM("csrr %0, mhpmcounter18"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter18"  : "=r"(reg) : );
             break;
         case 19:
-            ASM("csrr %0, mhpmcounter19"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter19"  : "=r"(reg) : );
             break;
         case 20:
-            ASM("csrr %0, mhpmcounter20"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter20"  : "=r"(reg) : );
             break;
         case 21:
-            ASM("csrr %0, mhpmcounter21"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter21"  : "=r"(reg) : );
             break;
         case 22:
-            ASM("csrr %0, mhpmcounter22"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter22"  : "=r"(reg) : );
             break;
         case 23:
-            ASM("csrr %0, mhpmcounter23"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter23"  : "=r"(reg) : );
             break;
         case 24:
-            ASM("csrr %0, mhpmcounter24"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter24"  : "=r"(reg) : );
             break;
         case 25:
-            ASM("csrr %0, mhpmcounter25"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter25"  : "=r"(reg) : );
             break;
         case 26:
-            ASM("csrr %0, mhpmcounter26"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter26"  : "=r"(reg) : );
             break;
         case 27:
-            ASM("csrr %0, mhpmcounter27"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter27"  : "=r"(reg) : );
             break;
         case 28:
-            ASM("csrr %0, mhpmcounter28"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter28"  : "=r"(reg) : );
             break;
         case 29:
-            ASM("csrr %0, mhpmcounter29"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter29"  : "=r"(reg) : );
             break;
         case 30:
-            ASM("csrr %0, mhpmcounter30"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter30"  : "=r"(reg) : );
             break;
         case 31:
-            ASM("csrr %0, mhpmcounter31"  : "=r"(reg) : );
+            ASM("csrr %0, hpmcounter31"  : "=r"(reg) : );
             break;
         }
         return reg;
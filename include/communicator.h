@@ -0,0 +1,130 @@
+// EPOS Communicator Declarations
+
+#ifndef __communicator_h
+#define __communicator_h
+
+#include <synchronizer.h>
+#include <utility/spin.h>
+#include <network/udp.h>
+
+__BEGIN_SYS
+
+// Port for connectionless channels (e.g. UDP)
+// Received datagrams stay in the NIC's buffers until the application takes them, so at most
+// Traits<Channel>::RECEIVE_QUEUE of them are held per Port (the oldest are dropped first) and the NIC keeps enough
+// receive buffers for the rest of the system. The copying interface verifies checksums while it copies; the
+// zero-copy one hands out Buffers that have been checked in place and must be given back with free().
+template<typename Channel>
+class Port<Channel, true>: private Channel::Observer
+{
+private:
+    static const unsigned int QUEUE = Traits<Channel>::RECEIVE_QUEUE;
+
+public:
+    typedef typename Channel::Buffer Buffer;
+    typedef typename Channel::Address Address;
+    typedef typename Channel::Port_Id Port_Id;
+    typedef typename Channel::Observed Observed;
+
+public:
+    Port(const Port_Id & port): _channel(Channel::get()), _port(port), _ready(0) {
+        db<Port>(TRC) << "Port(p=" << port << ") => " << this << endl;
+
+        _channel->attach(this, _port);
+    }
+
+    ~Port() {
+        db<Port>(TRC) << "~Port(this=" << this << ")" << endl;
+
+        _channel->detach(this, _port);
+
+        bool disabled = lock();
+        while(typename Buffer::Element * e = _queue.remove())
+            _channel->free(e->object());
+        unlock(disabled);
+    }
+
+    const Port_Id & port() const { return _port; }
+
+    int send(const Address & to, const void * data, unsigned int size) { return _channel->send(_port, to, data, size); }
+
+    int receive(Address * from, void * data, unsigned int size) {
+        int r;
+        do {
+            Buffer * buf = take();
+            r = Channel::copy(buf, from, data, size);
+            _channel->free(buf);
+            if(r < 0)
+                db<Port>(WRN) << "Port::receive: bad checksum!" << endl;
+        } while(r < 0);
+
+        return r;
+    }
+
+    // Zero-copy
+    Buffer * alloc(const Address & to, unsigned int size) { return _channel->alloc(_port, to, size); }
+    int send(Buffer * buf) { return _channel->send(buf); }
+    Buffer * receive() {
+        for(;;) {
+            Buffer * buf = take();
+            if(Channel::check(buf))
+                return buf;
+            db<Port>(WRN) << "Port::receive: bad checksum!" << endl;
+            _channel->free(buf);
+        }
+    }
+    void free(Buffer * buf) { _channel->free(buf); }
+
+private:
+    // Runs in the NIC's receive Tasklet
+    void update(Observed * obs, const Port_Id & port, Buffer * buf) {
+        db<Port>(TRC) << "Port::update(buf=" << buf << ")" << endl;
+
+        Buffer * dropped = 0;
+        bool disabled = lock();
+        if(_queue.size() >= QUEUE)
+            dropped = _queue.remove()->object();
+        _queue.insert(buf->link2());
+        unlock(disabled);
+
+        if(dropped) {
+            db<Port>(WRN) << "Port::update: queue full, dropping oldest datagram!" << endl;
+            _channel->free(dropped);
+        } else
+            _ready.v();
+    }
+
+    Buffer * take() {
+        _ready.p();
+
+        bool disabled = lock();
+        Buffer * buf = _queue.remove()->object();
+        unlock(disabled);
+
+        return buf;
+    }
+
+    // The queue is shared by threads and the NIC's receive Tasklet, on any CPU; the interrupt state is the caller's
+    bool lock() {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        _lock.acquire();
+        return disabled;
+    }
+    void unlock(bool disabled) {
+        _lock.release();
+        if(!disabled)
+            CPU::int_enable();
+    }
+
+private:
+    Channel * _channel;
+    Port_Id _port;
+    Semaphore _ready;
+    typename Buffer::List _queue;
+    Simple_Spin _lock;
+};
+
+__END_SYS
+
+#endif
@@ -145,6 +145,9 @@ void Agent::handle_thread()
     case THREAD_WAIT_NEXT:
         //            Periodic_Thread::wait_next();
         break;
+    case THREAD_STATISTICS:
+        out(thread->statistics());
+        break;
     case THREAD_EXIT: {
         int r;
         in(r);
@@ -25,15 +25,16 @@ public:
 
     void * operator new(size_t s, void * stub) {
         db<Framework>(TRC) << "Handled::new(stub=" << stub << ")" << endl;
-        Framework::Element * el= Framework::_cache.search_key(reinterpret_cast<unsigned long>(stub));
+        void ** cached = Framework::_cache.search_key(reinterpret_cast<unsigned long>(stub));
         void * handle;
-        if(el) {
-            handle = el->object();
+        if(cached) {
+            handle = *cached;
             db<Framework>(INF) << "Handled::new(stub=" << stub << ") => " << handle << " (CACHED)" << endl;
         } else {
             handle = new Handle<Component>(reinterpret_cast<typename Handle<Component>::_Stub *>(stub));
-            el = new Framework::Element(handle, reinterpret_cast<unsigned long>(stub));  // the handled cache is insert-only; object are intentionally never deleted, since they have been created by SETUP!
-            Framework::_cache.insert(el);
+            // the handled cache is insert-only; object are intentionally never deleted, since they have been created by SETUP!
+            if(!Framework::_cache.insert(reinterpret_cast<unsigned long>(stub), handle))
+                db<Framework>(WRN) << "Handled::new(stub=" << stub << "): cache is full!" << endl;
         }
         return handle;
     }
@@ -84,6 +85,7 @@ public:
     static void yield() { _Stub::yield(); }
     static void exit(int r = 0) { _Stub::exit(r); }
     static volatile bool wait_next() { return _Stub::wait_next(); }
+    Thread::Criterion::Statistics statistics() { return _stub->statistics(); }
 
     Handle<Address_Space> * address_space() const { return new (_stub->address_space()) Handled<Address_Space>; }
     Handle<Segment> * code_segment() const { return new (_stub->code_segment()) Handled<Segment>; }
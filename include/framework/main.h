@@ -13,8 +13,7 @@ class Framework
     template<typename> friend class Proxied;
 
 private:
-    typedef Simple_Hash<void, 5, unsigned int> Cache; // TODO: a real cache, with operator >> instead of % would improve performance
-    typedef Cache::Element Element;
+    typedef Hash_Map<unsigned long, void *, Traits<Framework>::CACHE_SIZE> Cache; // stub or adapter address => handle or proxy
 
 public:
     Framework() {}
@@ -44,6 +44,7 @@ public:
         THREAD_YIELD,
         THREAD_EXIT,
         THREAD_WAIT_NEXT,
+        THREAD_STATISTICS,
         THREAD_JOIN = JOIN,
 
         TASK_ADDRESS_SPACE = COMPONENT,
@@ -23,15 +23,16 @@ public:
 
     void * operator new(size_t s, void * adapter) {
         db<Framework>(TRC) << "Proxied::new(adapter=" << adapter << ")" << endl;
-        Framework::Element * el= Framework::_cache.search_key(reinterpret_cast<unsigned long>(adapter));
+        void ** cached = Framework::_cache.search_key(reinterpret_cast<unsigned long>(adapter));
         void * proxy;
-        if(el) {
-            proxy = el->object();
+        if(cached) {
+            proxy = *cached;
             db<Framework>(INF) << "Proxied::new(adapter=" << adapter << ") => " << proxy << " (CACHED)" << endl;
         } else {
             proxy = new Proxy<Component>(Id(Type<Component>::ID, reinterpret_cast<Id::Unit_Id>(adapter)));
-            el = new Framework::Element(proxy, reinterpret_cast<unsigned long>(adapter));  // the proxied cache is insert-only; object are intentionally never deleted, since they have been created by SETUP!
-            Framework::_cache.insert(el);
+            // the proxied cache is insert-only; object are intentionally never deleted, since they have been created by SETUP!
+            if(!Framework::_cache.insert(reinterpret_cast<unsigned long>(adapter), proxy))
+                db<Framework>(WRN) << "Proxied::new(adapter=" << adapter << "): cache is full!" << endl;
         }
         return proxy;
     }
@@ -73,6 +74,7 @@ public:
     static int yield() { return static_invoke(THREAD_YIELD); }
     static void exit(int r) { static_invoke(THREAD_EXIT, r); }
     static volatile bool wait_next() { return static_invoke(THREAD_WAIT_NEXT); }
+    Thread::Criterion::Statistics statistics() { Thread::Criterion::Statistics s; invoke(THREAD_STATISTICS); in(s); return s; }
 
     Proxy<Address_Space> * address_space() { return new (reinterpret_cast<Adapter<Address_Space> *>(invoke(TASK_ADDRESS_SPACE))) Proxied<Address_Space>; }
     Proxy<Segment> * code_segment() { return new (reinterpret_cast<Adapter<Segment> *>(invoke(TASK_CODE_SEGMENT))) Proxied<Segment>; }
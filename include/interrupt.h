@@ -0,0 +1,90 @@
+// EPOS Deferred Interrupt Processing Declarations
+
+#ifndef __interrupt_h
+#define __interrupt_h
+
+#include <machine/ic.h>
+#include <utility/handler.h>
+#include <process.h>
+#include <synchronizer.h>
+
+__BEGIN_SYS
+
+// Interrupt handlers (top halves) should do little more than acknowledging their devices, deferring the actual work to
+// either a Tasklet or an Interrupt_Thread, so the time spent with interrupts disabled stays bounded.
+
+// Tasklets (bottom halves) run at the end of the interrupt that scheduled them, with interrupts enabled
+// Scheduling a Tasklet that is already pending doesn't queue it twice: its handler runs once for all the schedule() calls
+// made since it last ran. Calls made while the handler is running (including from the handler itself) make it run once
+// more at the next interrupt exit. Since interrupts are enabled, handlers may be preempted (and even rescheduled away
+// from), but never run concurrently with themselves. A Tasklet can only be destroyed once it is neither pending nor
+// running.
+class Tasklet
+{
+public:
+    Tasklet(Handler * h): _handler(h), _next(0), _posts(0) {}
+    ~Tasklet();
+
+    bool schedule();
+
+    unsigned long pending() const { return _posts; }
+
+    static bool scheduled() { return _scheduled; }
+    static void run();
+
+private:
+    void link();
+
+private:
+    Handler * _handler;
+    Tasklet * volatile _next;
+    volatile unsigned long _posts;
+
+    static Tasklet * volatile _scheduled;
+};
+
+
+// Threaded interrupt handlers
+// The top half installed at the interrupt vector masks the interrupt and wakes up the thread, which runs the handler at
+// its own priority and then unmasks the interrupt. Meant for external (device) interrupts, which are masked individually.
+class Interrupt_Thread: public Thread
+{
+public:
+    typedef IC::Interrupt_Id Interrupt_Id;
+
+public:
+    Interrupt_Thread(const Interrupt_Id & id, Handler * handler, const Criterion & c = HIGH);
+    ~Interrupt_Thread();
+
+    Interrupt_Id interrupt() const { return _id; }
+
+private:
+    static void top_half(Interrupt_Id id);
+    static int bottom_half(Interrupt_Thread * t);
+
+private:
+    Interrupt_Id _id;
+    Handler * _handler;
+    Semaphore _semaphore;
+    volatile bool _finishing;
+
+    static Interrupt_Thread * _threads[IC::INTS];
+};
+
+
+// An event handler that schedules a Tasklet (see handler.h)
+class Tasklet_Handler: public Handler
+{
+public:
+    Tasklet_Handler(Tasklet * h) : _handler(h) {}
+    ~Tasklet_Handler() {}
+
+    void operator()() { _handler->schedule(); }
+
+private:
+    Tasklet * _handler;
+};
+
+__END_SYS
+
+#endif
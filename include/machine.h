@@ -34,6 +34,12 @@
 #ifdef __USB_H
 #include <machine/usb.h>
 #endif
+#ifdef __NIC_H
+#include <machine/nic.h>
+#endif
+#ifdef __BLOCK_H
+#include <machine/block.h>
+#endif
 #ifdef __GPIO_H
 #include <machine/gpio.h>
 #endif
@@ -13,6 +13,8 @@ public:
     enum Mode {
         ECB,
         CBC,
+        CTR,
+        GCM
     };
 
 protected:
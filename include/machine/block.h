@@ -0,0 +1,77 @@
+// EPOS Block Device Mediator Common Package
+
+#ifndef __block_h
+#define __block_h
+
+#include <system/config.h>
+#include <machine/io_request.h>
+
+__BEGIN_SYS
+
+class Block_Common
+{
+public:
+    // Devices are addressed in sectors of SECTOR_SIZE bytes, whatever their physical block size
+    static const unsigned int SECTOR_SIZE = 512;
+
+    typedef unsigned long long Sector;
+
+    // Statistics
+    struct Statistics
+    {
+        Statistics(): reads(0), writes(0), flushes(0), read_bytes(0), written_bytes(0), requests(0), notifications(0), errors(0) {}
+
+        friend OStream & operator<<(OStream & os, const Statistics & s) {
+            os << "{rd=" << s.reads << "/" << s.read_bytes << "B,wr=" << s.writes << "/" << s.written_bytes << "B,fl=" << s.flushes
+               << ",req=" << s.requests << ",ntf=" << s.notifications << ",err=" << s.errors << "}";
+            return os;
+        }
+
+        unsigned int reads;
+        unsigned int writes;
+        unsigned int flushes;
+        unsigned long long read_bytes;
+        unsigned long long written_bytes;
+        unsigned int requests;      // requests actually submitted to the device (large transfers are split)
+        unsigned int notifications; // times the device had to be told about them (batched submissions need one)
+        unsigned int errors;
+    };
+
+protected:
+    Block_Common() {}
+};
+
+// read(), write() and flush() are synchronous for the caller, which sleeps until its data have been moved, while
+// submit() takes IO_Requests (positioned in sectors, sized in bytes) and returns at once. Either way, a device can have
+// many transfers in flight, from as many threads. Data are moved straight to and from the caller's memory where possible.
+class Block: public Block_Common
+{
+protected:
+    Block() {}
+
+public:
+    virtual ~Block() {}
+
+    // Returns false, without ever finishing the request, if it can't be taken (e.g. a WRITE to a read-only device)
+    virtual bool submit(IO_Request * request) = 0;
+
+    // Return the number of sectors transferred, or -1 on errors
+    virtual int read(const Sector & from, void * data, unsigned int sectors) = 0;
+    virtual int write(const Sector & to, const void * data, unsigned int sectors) = 0;
+
+    // Returns once everything written so far is on stable storage (0), or -1 on errors
+    virtual int flush() = 0;
+
+    virtual Sector sectors() = 0;
+    virtual bool read_only() = 0;
+
+    virtual const Statistics & statistics() = 0;
+};
+
+__END_SYS
+
+#endif
+
+#if defined(__BLOCK_H) && !defined(__block_common_only__)
+#include __BLOCK_H
+#endif
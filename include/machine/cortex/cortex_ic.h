@@ -24,6 +24,7 @@ public:
 
     using Engine::Interrupt_Id;
     using Engine::Interrupt_Handler;
+    using Engine::level;
 
     using Engine::INT_SYS_TIMER;
     using Engine::INT_USR_TIMER;
@@ -26,6 +26,8 @@ public:
     using Engine::put;
     using Engine::try_put;
 
+    using Engine::submit;
+
     using Engine::flush;
     using Engine::ready_to_get;
     using Engine::ready_to_put;
@@ -35,6 +35,8 @@ public:
         INT_NIC0_TX     = EXCS + NVIC::IRQ_RFTXRX,
         INT_NIC0_ERR    = EXCS + NVIC::IRQ_RFERR,
         INT_NIC0_TIMER  = EXCS + NVIC::IRQ_MACTIMER,
+        INT_SPI0        = EXCS + NVIC::IRQ_SSI0,
+        INT_SPI1        = EXCS + NVIC::IRQ_SSI1,
         INT_USB0        = EXCS + NVIC::IRQ_USB
     };
 
@@ -4,6 +4,7 @@
 #define __emote3_spi_h
 
 #include <architecture/cpu.h>
+#include <machine/ic.h>
 #include <machine/spi.h>
 #include <machine/cortex/engine/pl022.h>
 #include <machine/cortex/engine/pl061.h>
@@ -13,18 +14,35 @@
 
 __BEGIN_SYS
 
+// Besides the polled get() and put(), transfers can be submitted as IO_Requests (one byte per frame), which are taken
+// in order by the SSI's interrupt handler: frames are put in the TX FIFO only as fast as the RX FIFO is drained, so the
+// latter never overruns, with RX FIFO half-full and time-out interrupts signaling progress. READs send FILLER frames,
+// WRITEs discard what is received and TRANSFERs overwrite what was sent with what was received. The polled interface
+// must not be used while requests are pending.
 class SPI_Engine: public SPI_Common
 {
 private:
     static const unsigned int UNITS = Traits<SPI>::UNITS;
+    static const unsigned int FIFO_DEPTH = 8;
+    static const unsigned char FILLER = 0xff;
 
     typedef CPU::Reg32 Reg32;
 
 public:
-    SPI_Engine(unsigned int unit, unsigned int clock, const Protocol & protocol, const Mode & mode, unsigned int bit_rate, unsigned int data_bits): _unit(unit) {
+    SPI_Engine(unsigned int unit, unsigned int clock, const Protocol & protocol, const Mode & mode, unsigned int bit_rate, unsigned int data_bits)
+    : _unit(unit), _interrupt((unit == 0) ? IC_Engine::INT_SPI0 : IC_Engine::INT_SPI1) {
         assert(unit < UNITS);
         _pl022 = new(reinterpret_cast<void *>(Memory_Map::SSI0_BASE + 0x1000 * unit)) PL022;
         config(clock, protocol, mode, bit_rate, data_bits);
+
+        _engines[unit] = this;
+        IC::int_vector(_interrupt, &int_handler);
+        IC::enable(_interrupt);
+    }
+    ~SPI_Engine() {
+        IC::disable(_interrupt);
+        _pl022->int_disable(PL022::RXIM | PL022::RTIM | PL022::RORIM);
+        _engines[_unit] = 0;
     }
 
     void config(unsigned int clock, const Protocol & protocol, const Mode & mode, unsigned int bit_rate, unsigned int data_bits) {
@@ -47,6 +65,8 @@ public:
     void put(int data) { _pl022->put(data); }
     bool try_put(int data) { return _pl022->try_put(data); }
 
+    bool submit(IO_Request * request);
+
     void flush() { while(_pl022->busy()); }
     bool ready_to_get() { return _pl022->ready_to_get(); }
     bool ready_to_put() { return _pl022->ready_to_put(); }
@@ -82,12 +102,20 @@ public:
     static void init() {}
 
 private:
+    void pump(IO_Request::List * finished);
+
+    static void int_handler(IC::Interrupt_Id interrupt);
+
     static SysCtrl * scr() { return reinterpret_cast<SysCtrl *>(Memory_Map::SCR_BASE); }
     static IOCtrl * ioc() { return reinterpret_cast<IOCtrl *>(Memory_Map::IOC_BASE); }
 
 private:
     unsigned int _unit;
+    IC::Interrupt_Id _interrupt;
     PL022 * _pl022;
+    IO_Request::List _requests;
+
+    static SPI_Engine * _engines[UNITS];
 };
 
 __END_SYS
@@ -256,7 +256,7 @@ public:
         ssi(DR) = data;
     }
 
-    bool tyr_put(Reg32 data) {
+    bool try_put(Reg32 data) {
         // Return true if the data has been written and false otherwise
         // Check for space to write.
         if(ssi(SR) & TNF) {
@@ -278,6 +278,15 @@ public:
         ssi(IM) &= ~flag;
     }
 
+    // Clears the time-out and overrun interrupts (ICR bits match IM's), the others being cleared by the FIFOs
+    void int_clear(Reg32 flag) {
+        ssi(ICR) = flag & (RTIM | RORIM);
+    }
+
+    Reg32 int_status() {
+        return ssi(MIS);
+    }
+
     void enable() {
         // Read-modify-write the enable bit
         ssi(CR1) |= SSE;
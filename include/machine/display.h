@@ -4,6 +4,7 @@
 #define __display_h
 
 #include <system/config.h>
+#include <utility/buffer.h>
 
 #if defined(__UART_H) && !defined(__uart_common_only__)
 #include __UART_H
@@ -23,6 +24,7 @@ protected:
 public:
     static void putc(char c);
     static void puts(const char * s);
+    static void flush(bool panicking = false) {} // unbuffered displays have nothing to flush
 
     static void clear();
 
@@ -36,6 +38,7 @@ class Serial_Display: public Display_Common
     friend class Setup;
     friend class Serial_Keyboard;
     friend class Machine;
+    friend class UART; // shares the UART's interrupt
 
 private:
     typedef IF<Traits<Serial_Display>::ENGINE == Traits<Serial_Display>::UART, UART, USB>::Result Engine;
@@ -43,6 +46,11 @@ private:
     static const int LINES = Traits<Serial_Display>::LINES;
     static const int COLUMNS = Traits<Serial_Display>::COLUMNS;
     static const int TAB_SIZE = Traits<Serial_Display>::TAB_SIZE;
+    static const bool buffered = Traits<Serial_Display>::buffered;
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+
+    // Per-CPU output rings, filled by puts() and drained by the UART's TX interrupt
+    typedef Ring_Buffer<char, Traits<Serial_Display>::BUFFER_SIZE> Ring;
 
     // Special characters
     enum {
@@ -81,10 +89,16 @@ public:
     };
 
     static void puts(const char * s) {
-        while(*s != '\0')
-            putc(*s++);
+        if(buffered && _buffering)
+            enqueue(s);
+        else
+            while(*s != '\0')
+                putc(*s++);
     }
 
+    // Drains the rings synchronously; on panics, a drainer that might never resume is not waited for
+    static void flush(bool panicking = false);
+
     static void geometry(int * lines, int * columns) {
         *lines = LINES;
         *columns = COLUMNS;
@@ -147,10 +161,20 @@ private:
         _column = 0;
     }
 
+    static void buffering(bool b) { _buffering = b; }
+
+    static void enqueue(const char * s);
+    static bool drain(bool synchronous);
+    static void int_handler(unsigned int i);
+
 private:
     static Engine _engine;
     static int _line;
     static int _column;
+    static volatile bool _buffering;
+    static volatile bool _draining;
+    static unsigned int _current;
+    static Ring _ring[];
 };
 
 __END_SYS
@@ -0,0 +1,551 @@
+// EPOS VirtIO over MMIO Engine Declarations
+
+#ifndef __virtio_h
+#define __virtio_h
+
+#include <architecture/cpu.h>
+#include <utility/string.h>
+#include <system/memory_map.h>
+
+__BEGIN_SYS
+
+// VirtIO 1.1 (OASIS), memory-mapped transport (modern, i.e. version 2, devices only)
+// Virtqueues come in two layouts, which share the interface below, so drivers pick one at compile time through
+// Traits<VirtIO>::packed. Descriptor chains are only made available to the device with kick(), so a driver can add
+// many chains and then notify the device once. With VIRTIO_F_EVENT_IDX, both sides tell each other exactly which
+// ring index they want to hear about next, so most notifications (and interrupts) are never sent at all.
+class VirtIO
+{
+public:
+    typedef CPU::Reg8 Reg8;
+    typedef CPU::Reg16 Reg16;
+    typedef CPU::Reg32 Reg32;
+    typedef CPU::Reg64 Reg64;
+    typedef CPU::Reg Phy_Addr;
+    typedef CPU::Reg Log_Addr;
+    typedef Reg64 Features;
+
+    static const unsigned int TRANSPORTS = Traits<VirtIO>::TRANSPORTS;
+
+    // Device types
+    enum Device_Id {
+        NONE            = 0,    // empty transport
+        NET             = 1,
+        BLOCK           = 2,
+        CONSOLE         = 3,
+        ENTROPY         = 4
+    };
+
+    // Register offsets from a transport's base
+    enum {                          // Description
+        MAGIC               = 0x000, // "virt"
+        VERSION             = 0x004, // 2 for modern devices
+        DEVICE_ID           = 0x008, // Device type (0 if the transport is empty)
+        VENDOR_ID           = 0x00c,
+        DEVICE_FEATURES     = 0x010, // Features offered by the device, 32 bits at a time
+        DEVICE_FEATURES_SEL = 0x014,
+        DRIVER_FEATURES     = 0x020, // Features accepted by the driver, 32 bits at a time
+        DRIVER_FEATURES_SEL = 0x024,
+        QUEUE_SEL           = 0x030, // Queue the following registers refer to
+        QUEUE_NUM_MAX       = 0x034,
+        QUEUE_NUM           = 0x038,
+        QUEUE_READY         = 0x044,
+        QUEUE_NOTIFY        = 0x050, // Queue notification (write only)
+        INTERRUPT_STATUS    = 0x060,
+        INTERRUPT_ACK       = 0x064,
+        STATUS              = 0x070, // Device status
+        QUEUE_DESC          = 0x080, // Descriptor area (64 bits, low first)
+        QUEUE_DRIVER        = 0x090, // Driver area (avail ring or driver event suppression)
+        QUEUE_DEVICE        = 0x0a0, // Device area (used ring or device event suppression)
+        CONFIG_GENERATION   = 0x0fc,
+        CONFIG              = 0x100  // Device-specific configuration
+    };
+
+    // Useful bits and values from multiple registers
+    enum {
+        MAGIC_VALUE     = 0x74726976,   // MAGIC, "virt"
+        MODERN          = 2,            // VERSION
+        ACKNOWLEDGE     = 1 << 0,       // STATUS, the device has been noticed
+        DRIVER          = 1 << 1,       // STATUS, and there is a driver for it
+        DRIVER_OK       = 1 << 2,       // STATUS, which is ready to go
+        FEATURES_OK     = 1 << 3,       // STATUS, after a successful negotiation
+        NEEDS_RESET     = 1 << 6,       // STATUS
+        FAILED          = 1 << 7,       // STATUS
+        USED_BUFFER     = 1 << 0,       // INTERRUPT_STATUS/ACK, a queue has new used buffers
+        CONFIG_CHANGE   = 1 << 1        // INTERRUPT_STATUS/ACK
+    };
+
+    // Device-independent features
+    enum : Features {
+        F_INDIRECT_DESC = 1ULL << 28,
+        F_EVENT_IDX     = 1ULL << 29,
+        F_VERSION_1     = 1ULL << 32,
+        F_RING_PACKED   = 1ULL << 34
+    };
+
+    // A piece of a descriptor chain: chains list the segments the device reads (OUT) before those it writes (IN)
+    struct Segment
+    {
+        enum Direction { OUT, IN };
+
+        Segment() {}
+        Segment(Phy_Addr a, unsigned int s, Direction d): addr(a), size(s), dir(d) {}
+
+        Phy_Addr addr;
+        unsigned int size;
+        Direction dir;
+    };
+
+    // Split Virtqueue (VirtIO 1.0): a descriptor table plus rings of descriptor indexes going each way
+    template<unsigned int SIZE>
+    class Split_Queue
+    {
+    private:
+        struct Desc
+        {
+            enum { NEXT = 1 << 0, WRITE = 1 << 1 };
+
+            volatile Reg64 addr;
+            volatile Reg32 len;
+            volatile Reg16 flags;
+            volatile Reg16 next;
+        };
+
+        struct Avail
+        {
+            enum { NO_INTERRUPT = 1 << 0 };
+
+            volatile Reg16 flags;
+            volatile Reg16 idx;
+            volatile Reg16 ring[SIZE];
+            volatile Reg16 used_event;  // with EVENT_IDX, interrupt once the used index goes past this
+        };
+
+        struct Used
+        {
+            enum { NO_NOTIFY = 1 << 0 };
+
+            volatile Reg16 flags;
+            volatile Reg16 idx;
+            struct { volatile Reg32 id; volatile Reg32 len; } ring[SIZE];
+            volatile Reg16 avail_event; // with EVENT_IDX, notify once the avail index goes past this
+        };
+
+        static const unsigned int AVAIL = SIZE * sizeof(Desc);
+        static const unsigned int USED = (AVAIL + sizeof(Avail) + 3) & ~3U;
+
+    public:
+        static const unsigned int MEMORY = USED + sizeof(Used);
+
+    public:
+        Split_Queue(Log_Addr log, Phy_Addr phy, bool event_idx): _log(log), _phy(phy), _event_idx(event_idx), _enabled(true),
+        _free(0), _room(SIZE), _avail(0), _added(0), _used(0) {
+            static_assert(!(SIZE & (SIZE - 1)), "split virtqueues must have a power of 2 size");
+
+            memset(reinterpret_cast<void *>(log), 0, MEMORY);
+            _desc = reinterpret_cast<Desc *>(log);
+            _avail_ring = reinterpret_cast<Avail *>(log + AVAIL);
+            _used_ring = reinterpret_cast<Used *>(log + USED);
+            for(unsigned int i = 0; i < SIZE; i++)
+                _desc[i].next = i + 1;
+        }
+
+        Phy_Addr desc() const { return _phy; }
+        Phy_Addr driver() const { return _phy + AVAIL; }
+        Phy_Addr device() const { return _phy + USED; }
+
+        unsigned int room() const { return _room; }
+
+        bool add(const Segment * seg, unsigned int n, void * cookie) {
+            if(n > _room)
+                return false;
+
+            unsigned int head = _free;
+            unsigned int i = head;
+            for(unsigned int j = 0; j < n; j++) {
+                Desc * d = &_desc[i];
+                d->addr = seg[j].addr;
+                d->len = seg[j].size;
+                d->flags = ((seg[j].dir == Segment::IN) ? Desc::WRITE : 0) | ((j < n - 1) ? Desc::NEXT : 0);
+                if(j < n - 1)
+                    i = d->next;
+            }
+            _free = _desc[i].next;
+            _room -= n;
+            _cookie[head] = cookie;
+
+            _avail_ring->ring[_avail++ % SIZE] = head;
+            _added++;
+
+            return true;
+        }
+
+        // Makes the chains added so far available, returning whether the device must be notified
+        bool kick() {
+            Reg16 old = _avail - _added;
+            _added = 0;
+
+            CPU::fence(); // descriptors before the index
+            _avail_ring->idx = _avail;
+            CPU::fence(); // the index before the device's wishes
+
+            if(_event_idx)
+                return need_event(_used_ring->avail_event, _avail, old);
+            return !(_used_ring->flags & Used::NO_NOTIFY);
+        }
+
+        // Returns the cookie of the next chain the device is done with, and how much it wrote into it
+        void * get(unsigned int * len = 0) {
+            if(_used == _used_ring->idx)
+                return 0;
+            CPU::fence(); // the index before the element
+
+            unsigned int head = _used_ring->ring[_used % SIZE].id;
+            if(len)
+                *len = _used_ring->ring[_used % SIZE].len;
+            _used++;
+
+            unsigned int i = head;
+            unsigned int n = 1;
+            while(_desc[i].flags & Desc::NEXT) {
+                i = _desc[i].next;
+                n++;
+            }
+            _desc[i].next = _free;
+            _free = head;
+            _room += n;
+
+            // Asking for the next one before looking for it again won't let it go unnoticed
+            if(_event_idx && _enabled) {
+                _avail_ring->used_event = _used;
+                CPU::fence();
+            }
+
+            return _cookie[head];
+        }
+
+        // Interrupt suppression: returns whether used chains arrived while interrupts were off, which might have gone
+        // unnoticed and must be collected with get()
+        bool enable() {
+            _enabled = true;
+            if(_event_idx)
+                _avail_ring->used_event = _used;
+            else
+                _avail_ring->flags = 0;
+            CPU::fence();
+            return _used != _used_ring->idx;
+        }
+
+        void disable() {
+            _enabled = false;
+            if(_event_idx)
+                _avail_ring->used_event = _used - 1; // only reachable after wrapping around
+            else
+                _avail_ring->flags = Avail::NO_INTERRUPT;
+        }
+
+    private:
+        Log_Addr _log;
+        Phy_Addr _phy;
+        bool _event_idx;
+        bool _enabled;
+        Desc * _desc;
+        Avail * _avail_ring;
+        Used * _used_ring;
+        unsigned int _free;     // head of the list of free descriptors
+        unsigned int _room;
+        Reg16 _avail;           // next avail index (not yet published by kick())
+        Reg16 _added;
+        Reg16 _used;            // next used index to get()
+        void * _cookie[SIZE];
+    };
+
+    // Packed Virtqueue (VirtIO 1.1): a single ring of descriptors that the device writes back once it is done with
+    // them, with availability and use flagged by wrap counters, so each chain costs one cache line less to pass around
+    template<unsigned int SIZE>
+    class Packed_Queue
+    {
+    private:
+        struct Desc
+        {
+            enum { NEXT = 1 << 0, WRITE = 1 << 1, AVAIL = 1 << 7, USED = 1 << 15 };
+
+            volatile Reg64 addr;
+            volatile Reg32 len;
+            volatile Reg16 id;
+            volatile Reg16 flags;
+        };
+
+        struct Event
+        {
+            enum { ENABLE = 0, DISABLE = 1, DESC = 2 }; // DESC needs EVENT_IDX
+            enum { WRAP = 1 << 15 };
+
+            volatile Reg16 off_wrap;
+            volatile Reg16 flags;
+        };
+
+        static const unsigned int DRIVER = SIZE * sizeof(Desc);
+        static const unsigned int DEVICE = DRIVER + sizeof(Event);
+
+    public:
+        static const unsigned int MEMORY = DEVICE + sizeof(Event);
+
+    public:
+        Packed_Queue(Log_Addr log, Phy_Addr phy, bool event_idx): _log(log), _phy(phy), _event_idx(event_idx), _enabled(true),
+        _room(SIZE), _free_id(0), _avail(0), _avail_wrap(true), _added(0), _added_descs(0), _used(0), _used_wrap(true) {
+            memset(reinterpret_cast<void *>(log), 0, MEMORY);
+            _desc = reinterpret_cast<Desc *>(log);
+            _driver = reinterpret_cast<Event *>(log + DRIVER);
+            _device = reinterpret_cast<Event *>(log + DEVICE);
+            for(unsigned int i = 0; i < SIZE; i++)
+                _next_id[i] = i + 1;
+        }
+
+        Phy_Addr desc() const { return _phy; }
+        Phy_Addr driver() const { return _phy + DRIVER; }
+        Phy_Addr device() const { return _phy + DEVICE; }
+
+        unsigned int room() const { return _room; }
+
+        bool add(const Segment * seg, unsigned int n, void * cookie) {
+            if(n > _room)
+                return false;
+
+            Reg16 id = _free_id;
+            _free_id = _next_id[id];
+            _cookie[id] = cookie;
+            _length[id] = n;
+            _room -= n;
+
+            // The head goes last, so the device never sees a partial chain
+            unsigned int head = _avail;
+            Reg16 head_flags = 0;
+            for(unsigned int j = 0; j < n; j++) {
+                Desc * d = &_desc[_avail];
+                Reg16 flags = ((seg[j].dir == Segment::IN) ? Desc::WRITE : 0) | ((j < n - 1) ? Desc::NEXT : 0) | (_avail_wrap ? Desc::AVAIL : Desc::USED);
+                d->addr = seg[j].addr;
+                d->len = seg[j].size;
+                d->id = id;
+                if(j)
+                    d->flags = flags;
+                else
+                    head_flags = flags;
+
+                if(++_avail == SIZE) {
+                    _avail = 0;
+                    _avail_wrap = !_avail_wrap;
+                }
+            }
+            _pending[_added++] = head;
+            _pending_flags[head] = head_flags;
+            _added_descs += n;
+
+            return true;
+        }
+
+        bool kick() {
+            if(!_added)
+                return false;
+
+            CPU::fence(); // the rest of the chains before their heads
+            for(unsigned int i = 0; i < _added; i++)
+                _desc[_pending[i]].flags = _pending_flags[_pending[i]];
+            CPU::fence(); // the heads before the device's wishes
+
+            // Ring positions, unlike split indexes, don't run freely, so an event set in the previous lap is moved back
+            // by a ring's length before comparing
+            Reg16 old = _avail - _added_descs;
+            _added = 0;
+            _added_descs = 0;
+
+            Reg16 flags = _device->flags;
+            if(!_event_idx || (flags != Event::DESC))
+                return flags != Event::DISABLE;
+
+            Reg16 off_wrap = _device->off_wrap;
+            Reg16 event = off_wrap & ~Event::WRAP;
+            if(bool(off_wrap & Event::WRAP) != _avail_wrap)
+                event -= SIZE;
+            return need_event(event, _avail, old);
+        }
+
+        void * get(unsigned int * len = 0) {
+            Desc * d = &_desc[_used];
+            Reg16 flags = d->flags;
+            if((bool(flags & Desc::AVAIL) != bool(flags & Desc::USED)) || (bool(flags & Desc::USED) != _used_wrap))
+                return 0;
+            CPU::fence(); // the flags before the rest of the descriptor
+
+            Reg16 id = d->id;
+            if(len)
+                *len = d->len;
+
+            _used += _length[id];
+            if(_used >= SIZE) {
+                _used -= SIZE;
+                _used_wrap = !_used_wrap;
+            }
+            _room += _length[id];
+            _next_id[id] = _free_id;
+            _free_id = id;
+
+            if(_event_idx && _enabled) {
+                _driver->off_wrap = _used | (_used_wrap ? Event::WRAP : 0);
+                CPU::fence();
+            }
+
+            return _cookie[id];
+        }
+
+        bool enable() {
+            _enabled = true;
+            if(_event_idx) {
+                _driver->off_wrap = _used | (_used_wrap ? Event::WRAP : 0);
+                CPU::fence();
+                _driver->flags = Event::DESC;
+            } else
+                _driver->flags = Event::ENABLE;
+            CPU::fence();
+
+            Reg16 flags = _desc[_used].flags;
+            return (bool(flags & Desc::AVAIL) == bool(flags & Desc::USED)) && (bool(flags & Desc::USED) == _used_wrap);
+        }
+
+        void disable() {
+            _enabled = false;
+            _driver->flags = Event::DISABLE;
+        }
+
+    private:
+        Log_Addr _log;
+        Phy_Addr _phy;
+        bool _event_idx;
+        bool _enabled;
+        Desc * _desc;
+        Event * _driver;        // driver event suppression (i.e. written by the driver)
+        Event * _device;        // device event suppression
+        unsigned int _room;
+        Reg16 _free_id;         // head of the list of free buffer ids
+        Reg16 _avail;           // next ring position to fill
+        bool _avail_wrap;
+        unsigned int _added;    // chains added since the last kick()
+        unsigned int _added_descs;
+        Reg16 _used;            // next ring position to get()
+        bool _used_wrap;
+        Reg16 _next_id[SIZE];
+        Reg16 _length[SIZE];    // descriptors in each buffer id's chain
+        Reg16 _pending[SIZE];   // their heads
+        Reg16 _pending_flags[SIZE];
+        void * _cookie[SIZE];
+    };
+
+    template<unsigned int SIZE>
+    using Queue = typename IF<Traits<VirtIO>::packed, Packed_Queue<SIZE>, Split_Queue<SIZE>>::Result;
+
+public:
+    VirtIO(unsigned int transport): _transport(transport) { assert(transport < TRANSPORTS); }
+
+    unsigned int transport() const { return _transport; }
+    Device_Id device_id() { return static_cast<Device_Id>(reg(DEVICE_ID)); }
+
+    // Resets the device and agrees on the features both sides support, which must include all of the required ones;
+    // returns the features accepted (or 0 if the device won't do)
+    Features negotiate(Features wanted, Features required) {
+        reset();
+        reg(STATUS) = ACKNOWLEDGE;
+        reg(STATUS) = ACKNOWLEDGE | DRIVER;
+
+        reg(DEVICE_FEATURES_SEL) = 0;
+        Features offered = reg(DEVICE_FEATURES);
+        reg(DEVICE_FEATURES_SEL) = 1;
+        offered |= Features(reg(DEVICE_FEATURES)) << 32;
+
+        Features accepted = offered & (wanted | required);
+        if((accepted & required) != required) {
+            db<VirtIO>(WRN) << "VirtIO::negotiate: device " << _transport << " lacks features " << hex << (required & ~offered) << dec << "!" << endl;
+            reg(STATUS) = reg(STATUS) | FAILED;
+            return 0;
+        }
+
+        reg(DRIVER_FEATURES_SEL) = 0;
+        reg(DRIVER_FEATURES) = accepted;
+        reg(DRIVER_FEATURES_SEL) = 1;
+        reg(DRIVER_FEATURES) = accepted >> 32;
+        reg(STATUS) = ACKNOWLEDGE | DRIVER | FEATURES_OK;
+        if(!(reg(STATUS) & FEATURES_OK)) {
+            reg(STATUS) = reg(STATUS) | FAILED;
+            return 0;
+        }
+
+        db<VirtIO>(INF) << "VirtIO::negotiate: device " << _transport << " offered " << hex << offered << ", accepted " << accepted << dec << endl;
+
+        return accepted;
+    }
+
+    template<typename Q>
+    bool queue(unsigned int index, Q * q, unsigned int size) {
+        reg(QUEUE_SEL) = index;
+        if(reg(QUEUE_READY) || (reg(QUEUE_NUM_MAX) < size))
+            return false;
+
+        reg(QUEUE_NUM) = size;
+        reg(QUEUE_DESC) = q->desc();
+        reg(QUEUE_DESC + 4) = Reg64(q->desc()) >> 32;
+        reg(QUEUE_DRIVER) = q->driver();
+        reg(QUEUE_DRIVER + 4) = Reg64(q->driver()) >> 32;
+        reg(QUEUE_DEVICE) = q->device();
+        reg(QUEUE_DEVICE + 4) = Reg64(q->device()) >> 32;
+        reg(QUEUE_READY) = 1;
+
+        return true;
+    }
+
+    void ready() { reg(STATUS) = reg(STATUS) | DRIVER_OK; }
+    void reset() { reg(STATUS) = 0; while(reg(STATUS)); }
+
+    void notify(unsigned int index) { reg(QUEUE_NOTIFY) = index; }
+
+    // Acknowledges (and returns) the causes of the interrupt
+    Reg32 ack() {
+        Reg32 status = reg(INTERRUPT_STATUS);
+        reg(INTERRUPT_ACK) = status;
+        return status;
+    }
+
+    template<typename T>
+    T config(unsigned int offset) {
+        T value;
+        Reg32 generation;
+        do {
+            generation = reg(CONFIG_GENERATION);
+            for(unsigned int i = 0; i < sizeof(T); i++)
+                reinterpret_cast<Reg8 *>(&value)[i] = reinterpret_cast<volatile Reg8 *>(base() + CONFIG)[offset + i];
+        } while(generation != reg(CONFIG_GENERATION));
+        return value;
+    }
+
+    // Finds the n-th transport holding a device of the given type (or returns -1)
+    static int find(const Device_Id & id, unsigned int n = 0) {
+        for(unsigned int i = 0; i < TRANSPORTS; i++) {
+            VirtIO dev(i);
+            if((dev.reg(MAGIC) == MAGIC_VALUE) && (dev.reg(VERSION) == MODERN) && (dev.device_id() == id) && !n--)
+                return i;
+        }
+        return -1;
+    }
+
+private:
+    // Whether an index moving from old to now has just gone past event
+    static bool need_event(Reg16 event, Reg16 now, Reg16 old) { return Reg16(now - event - 1) < Reg16(now - old); }
+
+    Log_Addr base() const { return Memory_Map::VIRTIO_BASE + _transport * Memory_Map::VIRTIO_STRIDE; }
+    volatile Reg32 & reg(unsigned int o) { return reinterpret_cast<volatile Reg32 *>(base())[o / sizeof(Reg32)]; }
+
+private:
+    unsigned int _transport;
+};
+
+__END_SYS
+
+#endif
@@ -65,6 +65,10 @@ public:
     static Interrupt_Id int2irq(Interrupt_Id i);       // Offset INTs as seen by the CPU to IRQs seen by the bus (if needed)
 
     static void ipi(unsigned int cpu, Interrupt_Id i); // Inter-processor Interrupt
+
+    // Masking level left raised by a nested handler that rescheduled (none unless the IC supports nesting)
+    static unsigned int level() { return 0; }
+    static void level(unsigned int l) {}
 };
 
 __END_SYS
@@ -0,0 +1,105 @@
+// EPOS Asynchronous I/O Request Common Declarations
+
+#ifndef __io_request_h
+#define __io_request_h
+
+#include <system/config.h>
+#include <utility/handler.h>
+#include <utility/list.h>
+
+__BEGIN_SYS
+
+// Descriptor of an asynchronous transfer, submitted to a device mediator with submit(), which returns right away.
+// The device owns the request (and its data) until the request is finished, when the device invokes its handler (if
+// any), from the context of its interrupt handler. Threads willing to sleep until then give a Semaphore_Handler.
+// Devices queue requests in submission order and have as many of them in flight as they can, so a single thread can
+// keep several devices (or a deep device queue) busy at once. Requests in flight finish as the device completes them,
+// which may not be the order they were submitted in (e.g. on block devices); FLUSHes are there to order them.
+class IO_Request
+{
+public:
+    enum Operation {
+        READ,           // fill data with size bytes from the device
+        WRITE,          // move size bytes from data to the device
+        TRANSFER,       // full-duplex (e.g. SPI): send data and overwrite it with what is received meanwhile
+        FLUSH           // finish after every request submitted before it has reached the device (or stable storage)
+    };
+
+    enum Status {
+        IDLE,
+        PENDING,
+        DONE,
+        FAILED
+    };
+
+    // Position on the device, for the ones that have one (e.g. the first sector for block devices)
+    typedef unsigned long long Position;
+
+    typedef Simple_List<IO_Request> List;
+    typedef List::Element Element;
+
+public:
+    IO_Request(const Operation & operation, void * data, unsigned int size, Handler * handler = 0, const Position & position = 0)
+    : _operation(operation), _data(data), _size(size), _position(position), _handler(handler), _status(IDLE), _count(0), _issued(0), _outstanding(0), _link(this) {}
+
+    const Operation & operation() const { return _operation; }
+    unsigned char * data() const { return reinterpret_cast<unsigned char *>(_data); }
+    unsigned int size() const { return _size; }
+    const Position & position() const { return _position; }
+
+    Handler * handler() const { return _handler; }
+    void handler(Handler * h) { _handler = h; }
+
+    Status status() const { return _status; }
+    bool finished() const { return (_status == DONE) || (_status == FAILED); }
+
+    // Bytes actually transferred (once finished, short of size only if the request failed)
+    unsigned int count() const { return _count; }
+
+    // Bookkeeping for the device, which can take a request in several pieces, each going through the device on its own
+    void start() { _status = PENDING; _count = 0; _issued = 0; _outstanding = 0; }
+    void progress(unsigned int n) { _count += n; }
+    void fail() { _status = FAILED; }
+
+    unsigned int issued() const { return _issued; }
+    void issue(unsigned int n) { _issued += n; _outstanding++; }
+    bool retire() { return --_outstanding == 0; }
+    bool outstanding() const { return _outstanding; }
+
+    // Marks the request as finished (unless it has already failed) and notifies whoever is waiting for it
+    void finish() {
+        if(_status != FAILED)
+            _status = DONE;
+        if(_handler)
+            (*_handler)();
+    }
+
+    // Finishes all requests in a list, collected by a device while its interrupts were disabled
+    static void finish(List * list) {
+        while(Element * e = list->remove())
+            e->object()->finish();
+    }
+
+    Element * link() { return &_link; }
+
+    friend Debug & operator<<(Debug & db, const IO_Request & r) {
+        db << "{op=" << r._operation << ",d=" << r._data << ",s=" << r._size << ",p=" << r._position << ",st=" << r._status << ",c=" << r._count << "}";
+        return db;
+    }
+
+private:
+    Operation _operation;
+    void * _data;
+    unsigned int _size;
+    Position _position;
+    Handler * _handler;
+    volatile Status _status;
+    volatile unsigned int _count;
+    unsigned int _issued;
+    unsigned int _outstanding;
+    Element _link;
+};
+
+__END_SYS
+
+#endif
@@ -0,0 +1,138 @@
+// EPOS Network Interface Card Mediator Common Package
+
+#ifndef __nic_h
+#define __nic_h
+
+#include <architecture/cpu.h>
+#include <utility/string.h>
+#include <utility/list.h>
+#include <utility/buffer.h>
+#include <utility/observer.h>
+
+__BEGIN_SYS
+
+class NIC_Common
+{
+protected:
+    NIC_Common() {}
+
+public:
+    // NIC physical address (e.g. MAC)
+    template<unsigned int LENGTH>
+    class Address
+    {
+    public:
+        enum Null { NULL = 0 };
+        enum Broadcast { BROADCAST = 0xff };
+
+    public:
+        Address() {}
+        Address(const Null &) { memset(_address, NULL, LENGTH); }
+        Address(const Broadcast &) { memset(_address, BROADCAST, LENGTH); }
+
+        // String formated as A:B:C:D:E:F (hexadecimal bytes)
+        Address(const char * str) {
+            for(unsigned int i = 0; i < LENGTH; i++) {
+                unsigned char b = 0;
+                for(; *str && (*str != ':'); str++)
+                    b = (b << 4) | ((*str <= '9') ? (*str - '0') : ((*str | 0x20) - 'a' + 10));
+                _address[i] = b;
+                if(*str)
+                    str++;
+            }
+        }
+
+        operator bool() const {
+            for(unsigned int i = 0; i < LENGTH; i++)
+                if(_address[i])
+                    return true;
+            return false;
+        }
+
+        bool operator==(const Address & a) const { return !memcmp(_address, a._address, LENGTH); }
+        bool operator!=(const Address & a) const { return !(*this == a); }
+
+        const unsigned char & operator[](unsigned int i) const { return _address[i]; }
+        unsigned char & operator[](unsigned int i) { return _address[i]; }
+
+        friend OStream & operator<<(OStream & os, const Address & a) {
+            os << hex;
+            for(unsigned int i = 0; i < LENGTH; i++) {
+                os << static_cast<unsigned int>(a._address[i]);
+                if(i < LENGTH - 1)
+                    os << ":";
+            }
+            os << dec;
+            return os;
+        }
+
+    private:
+        unsigned char _address[LENGTH];
+    } __attribute__((packed));
+
+    // NIC protocol id
+    typedef unsigned short Protocol;
+
+    // NIC CRCs
+    typedef unsigned short CRC16;
+    typedef unsigned int CRC32;
+
+    // Statistics
+    struct Statistics
+    {
+        Statistics(): rx_packets(0), tx_packets(0), rx_bytes(0), tx_bytes(0), rx_drops(0), rx_overruns(0) {}
+
+        friend OStream & operator<<(OStream & os, const Statistics & s) {
+            os << "{rx=" << s.rx_packets << "/" << s.rx_bytes << "B,tx=" << s.tx_packets << "/" << s.tx_bytes << "B,drops=" << s.rx_drops << ",overruns=" << s.rx_overruns << "}";
+            return os;
+        }
+
+        unsigned int rx_packets;
+        unsigned int tx_packets;
+        unsigned long rx_bytes;
+        unsigned long tx_bytes;
+        unsigned int rx_drops;      // frames no one claimed in time
+        unsigned int rx_overruns;   // frames lost because the receive ring was full
+    };
+};
+
+// Frames are handed to observers (attached with the protocol they handle) in the NIC's own DMA buffers, so no copies
+// are made on the way up. Observers must give buffers back with free() once they are done with them, since they are
+// also the NIC's receive ring. Buffers obtained with alloc() are filled in place and then either sent or freed.
+template<typename Family>
+class NIC: public Family, public Family::Observed
+{
+public:
+    typedef typename Family::Address Address;
+    typedef typename Family::Protocol Protocol;
+    typedef typename Family::Buffer Buffer;
+    typedef typename Family::Statistics Statistics;
+
+protected:
+    NIC() {}
+
+public:
+    virtual ~NIC() {}
+
+    // Copying interface
+    virtual int send(const Address & dst, const Protocol & prot, const void * data, unsigned int size) = 0;
+    virtual int receive(Address * src, Protocol * prot, void * data, unsigned int size) = 0;
+
+    // Zero-copy interface
+    virtual Buffer * alloc(const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload) = 0;
+    virtual int send(Buffer * buf) = 0;
+    virtual void free(Buffer * buf) = 0;
+
+    virtual const Address & address() = 0;
+    virtual void address(const Address &) = 0;
+
+    virtual const Statistics & statistics() = 0;
+};
+
+__END_SYS
+
+#endif
+
+#if defined(__NIC_H) && !defined(__nic_common_only__)
+#include __NIC_H
+#endif
@@ -104,6 +104,8 @@ template<> struct Traits<Serial_Display>: public Traits<Machine_Common>
     static const int COLUMNS = 80;
     static const int LINES = 24;
     static const int TAB_SIZE = 8;
+    static const bool buffered = false;
+    static const unsigned int BUFFER_SIZE = 0;
 };
 
 template<> struct Traits<Serial_Keyboard>: public Traits<Machine_Common>
@@ -474,6 +474,7 @@ private:
 public:
     using IC_Common::Interrupt_Id;
     using IC_Common::Interrupt_Handler;
+    using IC_Common::level;
 
     enum {
         INT_FIRST_HARD  = Engine::INT_FIRST_HARD,
@@ -53,6 +53,11 @@ public:
     };
 
 public:
+    // Software interrupts (IPIs) are raised and cleared through the target hart's MSIP
+    static void msip(unsigned int hart, bool raise) {
+        reinterpret_cast<volatile CPU::Reg32 *>(Memory_Map::CLINT_BASE + MSIP + hart * MSIP_CORE_OFFSET)[0] = raise;
+    }
+
     static void mtvec(Mode mode, Phy_Addr base) {
     	Reg tmp = (base & -4UL) | (Reg(mode) & 0x3);
         ASM("csrw mtvec, %0" : : "r"(tmp) : "cc");
@@ -76,6 +81,96 @@ public:
     }
 };
 
+// Platform-Level Interrupt Controller (PLIC)
+class PLIC
+{
+private:
+    typedef CPU::Reg32 Reg32;
+
+    static const bool multitask = Traits<System>::multitask;
+    static const bool sifive_e = (Traits<Build>::MODEL == Traits<Build>::SiFive_E);
+    static const bool virt = (Traits<Build>::MODEL == Traits<Build>::Virt);
+
+public:
+    static const unsigned int IRQS = sifive_e ? 53 : virt ? 96 : 54; // source 0 means "no interrupt"
+
+    // Source priorities (0 never interrupts); a context only takes sources with priorities above its threshold
+    static const unsigned int MAX_PRIORITY = 7;
+    static const unsigned int DEFAULT_PRIORITY = 1;
+
+    // Interrupt sources
+    // Sources a model doesn't have are UNSUPPORTED (instead of 0, which is IRQ_NONE), which IC maps into
+    // IC_Common::UNSUPPORTED_INTERRUPT, so using them trips the range assertions instead of aliasing "no interrupt"
+    static const unsigned int UNSUPPORTED = ~0U;
+    enum : unsigned int {
+        IRQ_NONE        = 0,
+        IRQ_UART0       = sifive_e ? 3 : virt ? 10 : 4,
+        IRQ_UART1       = sifive_e ? 4 : virt ? UNSUPPORTED : 5,    // Virt has a single UART
+        IRQ_QSPI0       = sifive_e ? 5 : virt ? UNSUPPORTED : 51,   // and no QSPI,
+        IRQ_QSPI1       = sifive_e ? 6 : virt ? UNSUPPORTED : 52,
+        IRQ_QSPI2       = sifive_e ? 7 : virt ? UNSUPPORTED : 6,
+        IRQ_GPIO0       = sifive_e ? 8 : virt ? UNSUPPORTED : 7,    // one source per pin, from GPIO0 on
+        IRQ_ETH         = (sifive_e || virt) ? UNSUPPORTED : 53,    // SiFive-E has no Ethernet (and Virt's NIC is a virtio device)
+        IRQ_PDMA0       = (sifive_e || virt) ? UNSUPPORTED : 23,    // SiFive-U only, a done and an error source per channel, from PDMA0 on
+        IRQ_VIRTIO0     = virt ? 1 : UNSUPPORTED                    // one source per virtio-mmio transport, from VIRTIO0 on
+    };
+
+    // Interrupt id of a source, given where PLIC's sources start among the CPU's interrupts
+    static constexpr unsigned int source2int(unsigned int irq, unsigned int base) {
+        return (irq == UNSUPPORTED) ? IC_Common::UNSUPPORTED_INTERRUPT : base + irq;
+    }
+
+    // Registers offsets from PLIIC_CPU_BASE
+    enum {                                // Description
+        PRIORITY                = 0x000000, // Source priority (32-bit, one per source)
+        PENDING                 = 0x001000, // Pending bits (one per source)
+        ENABLE                  = 0x002000, // Enable bits (one per source), per context
+        THRESHOLD               = 0x200000, // Priority threshold, per context
+        CLAIM                   = 0x200004, // Claim/complete, per context
+        ENABLE_CONTEXT_OFFSET   = 0x80,     // Offset in bytes from ENABLE for each context
+        CONTEXT_OFFSET          = 0x1000    // Offset in bytes from THRESHOLD and CLAIM for each context
+    };
+
+public:
+    static void enable(unsigned int irq) {
+        assert(irq && (irq < IRQS));
+        if(!priority(irq))
+            priority(irq, DEFAULT_PRIORITY);
+        enables()[irq / 32] = enables()[irq / 32] | (1 << (irq % 32));
+    }
+
+    static void disable(unsigned int irq) {
+        assert(irq && (irq < IRQS));
+        enables()[irq / 32] = enables()[irq / 32] & ~(1 << (irq % 32));
+    }
+
+    static unsigned int priority(unsigned int irq) { return reg(PRIORITY + irq * sizeof(Reg32)); }
+    static void priority(unsigned int irq, unsigned int p) {
+        assert(irq && (irq < IRQS) && (p <= MAX_PRIORITY));
+        reg(PRIORITY + irq * sizeof(Reg32)) = p;
+    }
+
+    static unsigned int threshold() { return reg(THRESHOLD + context() * CONTEXT_OFFSET); }
+    static void threshold(unsigned int t) { reg(THRESHOLD + context() * CONTEXT_OFFSET) = t; }
+
+    static unsigned int claim() { return reg(CLAIM + context() * CONTEXT_OFFSET); }
+    static void complete(unsigned int irq) { reg(CLAIM + context() * CONTEXT_OFFSET) = irq; }
+
+private:
+    // SiFive-E has a single hart with an M-mode context only. On SiFive-U, hart 0 (E51) has an M-mode context only,
+    // while harts 1-4 (U54) have a pair of contexts (M and S) each. On Virt, every hart has a pair of contexts
+    static unsigned int context() {
+        unsigned int hart = CPU::id();
+        if(virt)
+            return multitask ? hart * 2 + 1 : hart * 2;
+        return (sifive_e || (hart == 0)) ? 0 : (multitask ? hart * 2 : hart * 2 - 1);
+    }
+
+    static volatile Reg32 * enables() { return &reg(ENABLE + context() * ENABLE_CONTEXT_OFFSET); }
+
+    static volatile Reg32 & reg(unsigned int o) { return reinterpret_cast<volatile Reg32 *>(Memory_Map::PLIIC_CPU_BASE)[o / sizeof(Reg32)]; }
+};
+
 class IC: private IC_Common, private CLINT
 {
     friend class Setup;
@@ -88,15 +183,27 @@ private:
 
 public:
     static const unsigned int EXCS = CPU::EXCEPTIONS;
-    static const unsigned int IRQS = CLINT::IRQS;
+    static const unsigned int IRQS = CLINT::IRQS + PLIC::IRQS;
     static const unsigned int INTS = EXCS + IRQS;
+    static const unsigned int PLIC_INTS = EXCS + CLINT::IRQS; // PLIC sources are mapped after CLINT's interrupts
 
     using IC_Common::Interrupt_Id;
     using IC_Common::Interrupt_Handler;
 
     enum {
         INT_SYSCALL     = CPU::EXC_ENVU,
-        INT_SYS_TIMER   = EXCS + (multitask ? IRQ_SUP_TIMER : IRQ_MAC_TIMER)
+        INT_SYS_TIMER   = EXCS + (multitask ? IRQ_SUP_TIMER : IRQ_MAC_TIMER),
+        INT_IPI         = EXCS + (multitask ? IRQ_SUP_SOFT : IRQ_MAC_SOFT), // MSI is forwarded as SSI in multitask mode
+        INT_PLIC        = EXCS + (multitask ? IRQ_SUP_EXT : IRQ_MAC_EXT),
+        INT_UART0       = PLIC::source2int(PLIC::IRQ_UART0, PLIC_INTS),
+        INT_UART1       = PLIC::source2int(PLIC::IRQ_UART1, PLIC_INTS),
+        INT_QSPI0       = PLIC::source2int(PLIC::IRQ_QSPI0, PLIC_INTS),
+        INT_QSPI1       = PLIC::source2int(PLIC::IRQ_QSPI1, PLIC_INTS),
+        INT_QSPI2       = PLIC::source2int(PLIC::IRQ_QSPI2, PLIC_INTS),
+        INT_GPIO0       = PLIC::source2int(PLIC::IRQ_GPIO0, PLIC_INTS),
+        INT_ETH         = PLIC::source2int(PLIC::IRQ_ETH, PLIC_INTS),
+        INT_PDMA0       = PLIC::source2int(PLIC::IRQ_PDMA0, PLIC_INTS),
+        INT_VIRTIO0     = PLIC::source2int(PLIC::IRQ_VIRTIO0, PLIC_INTS)
     };
 
 public:
@@ -124,8 +231,10 @@ public:
     static void enable(Interrupt_Id i) {
         db<IC>(TRC) << "IC::enable(int=" << i << ")" << endl;
         assert(i < INTS);
+        if(i >= PLIC_INTS)
+            PLIC::enable(i - PLIC_INTS);
         enable();
-        // TODO: this should handle individual INTs and also be done at PLIC
+        // TODO: this should handle individual CLINT INTs
     }
 
     static void disable() {
@@ -136,11 +245,44 @@ public:
             CPU::miec(CPU::MSI | CPU::MTI | CPU::MEI);
 }
 
+    // External (PLIC) interrupts only; with Traits<IC>::nesting, a handler can only be preempted by higher priorities
+    static void priority(Interrupt_Id i, unsigned int p) {
+        db<IC>(TRC) << "IC::priority(int=" << i << ",p=" << p << ")" << endl;
+        assert((i >= PLIC_INTS) && (i < INTS));
+        PLIC::priority(i - PLIC_INTS, p);
+    }
+
     static void disable(Interrupt_Id i) {
         db<IC>(TRC) << "IC::disable(int=" << i << ")" << endl;
         assert(i < INTS);
-        disable();
-        // TODO: this should handle individual INTs and also be done at PLIC
+        if(i >= PLIC_INTS)
+            PLIC::disable(i - PLIC_INTS);
+        else
+            disable();
+        // TODO: this should handle individual CLINT INTs
+    }
+
+    // PLIC threshold, which a nested handler raises (see dispatch()) and Thread::dispatch() keeps with the preempted thread
+    static unsigned int level() { return Traits<IC>::nesting ? PLIC::threshold() : 0; }
+    static void level(unsigned int l) {
+        if(Traits<IC>::nesting)
+            PLIC::threshold(l);
+    }
+
+    // Raises the software interrupt of hart cpu, which is the only inter-processor interrupt CLINT can send
+    static void ipi(unsigned int cpu, Interrupt_Id i) {
+        db<IC>(TRC) << "IC::ipi(cpu=" << cpu << ",int=" << i << ")" << endl;
+        assert(i == INT_IPI);
+        msip(cpu, true);
+    }
+
+    // MSIP stays up until cleared, while in multitask mode int_m2s has already cleared it and raised SSIP instead
+    static void ipi_eoi(Interrupt_Id i) {
+        assert(i == INT_IPI);
+        if(multitask)
+            CPU::sipc(CPU::SSI);
+        else
+            msip(CPU::id(), false);
     }
 
     static Interrupt_Id int_id() {
@@ -174,6 +316,134 @@ private:
     static Interrupt_Handler _int_vector[INTS];
 };
 
+// Inter-processor messages, carried by CLINT software interrupts (INT_IPI)
+// Each hart has a mailbox other harts post messages to before raising its MSIP. Messages that pile up before the target
+// gets to them are merged: reschedules collapse into one, TLB shootdown ranges accumulate (becoming a full flush once
+// RANGES are taken) and function calls queue up (up to CALLS). Senders of shootdowns and calls wait for the targets to
+// handle them, serving their own mailboxes meanwhile, so harts shooting at each other don't deadlock.
+// Shootdowns go to every hart running EPOS and can be batched (see MMU::Shootdown): while a batch is open on a hart, the
+// ranges it unmaps are only recorded, to be flushed all at once (with a single IPI per hart) when the batch is closed.
+class IPI
+{
+    friend class IC;
+
+private:
+    typedef CPU::Log_Addr Log_Addr;
+
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+    static const unsigned int HARTS = sizeof(unsigned long) * 8;
+    static const unsigned int RANGES = 8;
+    static const unsigned int CALLS = 4;
+    static const unsigned int PAGE_SHIFT = 12;          // Sv32 and Sv39 base pages
+    static const unsigned long MAX_PAGES = 64;          // flushed one by one, while larger ranges get a full flush
+
+public:
+    enum Message {
+        RESCHEDULE      = 1 << 0,
+        SHOOTDOWN       = 1 << 1,
+        CALL            = 1 << 2
+    };
+
+    typedef void (Function)(void *);
+
+    // Statistics (of each hart)
+    struct Statistics
+    {
+        Statistics(): broadcasts(0), full_flushes(0), page_flushes(0) {}
+
+        friend OStream & operator<<(OStream & os, const Statistics & s) {
+            os << "{bc=" << s.broadcasts << ",ff=" << s.full_flushes << ",pf=" << s.page_flushes << "}";
+            return os;
+        }
+
+        unsigned int broadcasts;    // shootdowns sent (each batch takes one)
+        unsigned int full_flushes;  // whole TLB flushes, sent or received
+        unsigned int page_flushes;  // pages flushed one by one, sent or received
+    };
+
+private:
+    // Address ranges to be flushed from TLBs
+    struct Ranges
+    {
+        Ranges(): count(0), full(false) {}
+
+        void add(Log_Addr addr, unsigned long size);
+        void add(const Ranges & ranges);
+        void flush(Statistics & statistics) const;
+        void clear() { count = 0; full = false; }
+        bool empty() const { return !count && !full; }
+
+        unsigned int count;
+        bool full;
+        Log_Addr addr[RANGES];
+        unsigned long size[RANGES];
+    };
+
+    struct Call
+    {
+        Function * function;
+        void * argument;
+    };
+
+    struct Mailbox
+    {
+        volatile bool lock;
+        volatile unsigned int messages;
+        Ranges ranges;
+        Call calls[CALLS];
+        unsigned int count;             // calls
+        volatile unsigned long posted;  // messages posted so far
+        volatile unsigned long served;  // up to which the target has handled
+        Statistics statistics;          // updated by the owner only
+    };
+
+public:
+    IPI() {}
+
+    // Makes hart cpu choose its next thread again (e.g. after a wakeup of a thread of higher priority); Thread doesn't
+    // send these yet, since it has a single ready queue and EPOS brings up a single hart, so this is there for SMP
+    // schedulers to build on
+    static void reschedule(unsigned int cpu);
+
+    // Runs function(argument) on hart cpu, with interrupts disabled, and returns once it has been run
+    static bool call(unsigned int cpu, Function * function, void * argument);
+
+    // Flushes the range (leaf mappings only) or the whole TLB of all harts running EPOS, or adds it to this hart's batch
+    static void shootdown(Log_Addr addr, unsigned long size);
+    static void shootdown();
+
+    // Batches nest, and interrupts stay disabled while they are open
+    static void begin_batch();
+    static void end_batch();
+
+    static bool online(unsigned int cpu) { return (cpu < HARTS) && (_online & (1UL << cpu)); }
+
+    static const Statistics & statistics(unsigned int cpu) { return mailbox(cpu).statistics; }
+
+private:
+    static Mailbox & mailbox(unsigned int cpu) { return _mailboxes[cpu % CPUS]; } // hart ids are not zero-based on every machine
+
+    static unsigned long post(unsigned int cpu, Message message, const Ranges * ranges = 0, Function * function = 0, void * argument = 0);
+    static unsigned int serve(unsigned int messages);
+    static void wait(unsigned int cpu, unsigned long ticket);
+    static void shootdown(const Ranges & ranges);
+    static void broadcast(const Ranges & ranges);
+
+    static void acquire(Mailbox & box) { while(CPU::tsl(box.lock)); }
+    static void release(Mailbox & box) { box.lock = false; }
+
+    static void int_handler(IC::Interrupt_Id i);
+
+    static void init();
+
+private:
+    static Mailbox _mailboxes[CPUS];
+    static Ranges _batches[CPUS];
+    static unsigned int _batching[CPUS];
+    static bool _batch_disabled[CPUS];
+    static volatile unsigned long _online;
+};
+
 __END_SYS
 
 #endif
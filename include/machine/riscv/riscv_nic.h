@@ -0,0 +1,190 @@
+// EPOS RISC-V Cadence GEM Ethernet NIC Mediator Declarations
+
+#ifndef __riscv_nic_h
+#define __riscv_nic_h
+
+#include <architecture/cpu.h>
+#include <architecture/mmu.h>
+#include <machine/ic.h>
+#include <utility/handler.h>
+#include <utility/spin.h>
+#include <network/ethernet.h>
+#include <system/memory_map.h>
+
+__BEGIN_SYS
+
+class Tasklet;
+
+// Cadence Gigabit Ethernet MAC (GEM), as found in the FU540 and emulated by QEMU's sifive_u
+// Descriptor rings and frame buffers share a single DMA_Buffer. Each descriptor points straight at the Frame inside
+// an Ethernet::Buffer, so received frames go up, and frames to be sent come down, without being copied. The receive
+// interrupt is only used to wake up a Tasklet that drains the ring with the interrupt masked, in batches of at most
+// RX_BUDGET frames, much like NAPI: under load, the NIC raises one interrupt per batch instead of one per frame.
+class GEM: public NIC<Ethernet>
+{
+    friend class Machine_Common;
+
+private:
+    typedef CPU::Reg32 Reg32;
+    typedef CPU::Reg Reg;
+    typedef MMU::DMA_Buffer DMA_Buffer;
+
+    static const unsigned int UNITS = Traits<GEM>::UNITS;
+    static const unsigned int TX_BUFS = Traits<GEM>::SEND_BUFFERS;
+    static const unsigned int RX_BUFS = Traits<GEM>::RECEIVE_BUFFERS;
+    static const unsigned int RX_BUDGET = Traits<GEM>::RECEIVE_BUDGET;
+    static const unsigned int RX_UNCLAIMED = RX_BUFS / 2; // frames kept for receive() before the oldest gets dropped
+
+    // Size of the buffers as programmed into DMACFG (in 64-byte units)
+    // With the FCS stripped and neither jumbo nor 1536-byte frames enabled, the MAC never writes more than a Frame.
+    static const unsigned int RX_BUFFER_SIZE = (sizeof(Frame) + 63) & ~63U;
+
+    // Buffers are cache-line aligned inside the DMA_Buffer, after the rings
+    static const unsigned int BUFFER_STRIDE = (sizeof(Buffer) + 63) & ~63U;
+
+public:
+    // Register offsets from ETH_BASE
+    enum {                      // Description
+        NWCTRL          = 0x000, // Network control
+        NWCFG           = 0x004, // Network configuration
+        NWSR            = 0x008, // Network status
+        DMACFG          = 0x010, // DMA configuration
+        TXSR            = 0x014, // Transmit status
+        RXQBASE         = 0x018, // Receive descriptor queue base address
+        TXQBASE         = 0x01c, // Transmit descriptor queue base address
+        RXSR            = 0x020, // Receive status
+        ISR             = 0x024, // Interrupt status (clear on read)
+        IER             = 0x028, // Interrupt enable
+        IDR             = 0x02c, // Interrupt disable
+        IMR             = 0x030, // Interrupt mask
+        MODERATION      = 0x05c, // Interrupt moderation (GXL only)
+        HASHLO          = 0x080, // Multicast hash (bottom)
+        HASHHI          = 0x084, // Multicast hash (top)
+        SPADDR1LO       = 0x088, // Specific address 1 (bottom)
+        SPADDR1HI       = 0x08c  // Specific address 1 (top)
+    };
+
+    // Useful bits from multiple registers
+    enum {
+        RXEN            = 1 <<  2,  // NWCTRL, receive enable
+        TXEN            = 1 <<  3,  // NWCTRL, transmit enable
+        STATCLR         = 1 <<  5,  // NWCTRL, clear statistics registers
+        TXSTART         = 1 <<  9,  // NWCTRL, start transmission (self-clearing)
+        FDUP            = 1 <<  1,  // NWCFG, full duplex
+        CAF             = 1 <<  4,  // NWCFG, copy all frames (promiscuous)
+        GIGE            = 1 << 10,  // NWCFG, gigabit mode
+        FCSREM          = 1 << 17,  // NWCFG, strip the FCS from received frames
+        MDCDIV          = 7 << 18,  // NWCFG, MDC clock divisor (pclk / 224)
+        BLENGTH         = 0x10,     // DMACFG, INCR16 AHB bursts
+        RXBUF           = 16,       // DMACFG, receive buffer size shift (in 64-byte units)
+        RX_USED         = 1 <<  0,  // RXSR, a descriptor owned by software was hit (ring full)
+        RX_DONE         = 1 <<  1,  // RXSR, frame received
+        RX_OVR          = 1 <<  2,  // RXSR, receive overrun
+        TX_USED         = 1 <<  0,  // TXSR, a descriptor owned by software was hit (nothing else to send)
+        TX_DONE         = 1 <<  5,  // TXSR, frame transmitted
+        INT_RXCMPL      = 1 <<  1,  // ISR/IER/IDR/IMR, frame received
+        INT_RXUSED      = 1 <<  2,  // ISR/IER/IDR/IMR, receive used bit read
+        INT_TXUSED      = 1 <<  3,  // ISR/IER/IDR/IMR, transmit used bit read
+        INT_TXCMPL      = 1 <<  7,  // ISR/IER/IDR/IMR, transmit complete
+        INT_RXOVR       = 1 << 10,  // ISR/IER/IDR/IMR, receive overrun
+        INT_HRESP       = 1 << 11,  // ISR/IER/IDR/IMR, DMA bus error
+        INT_RX          = INT_RXCMPL | INT_RXUSED | INT_RXOVR
+    };
+
+    // Receive Descriptor (32-bit addressing)
+    struct Rx_Desc
+    {
+        enum {
+            OWN     = 1 <<  0,  // addr, set by the MAC once the buffer holds a frame
+            WRAP    = 1 <<  1,  // addr, last descriptor in the ring
+            ADDR    = ~3U,      // addr, buffer address
+            SIZE    = 0x1fff,   // ctrl, frame length
+            SOF     = 1 << 14,  // ctrl, start of frame
+            EOF     = 1 << 15   // ctrl, end of frame
+        };
+
+        volatile Reg32 addr;
+        volatile Reg32 ctrl;
+    };
+
+    // Transmit Descriptor (32-bit addressing)
+    struct Tx_Desc
+    {
+        enum {
+            SIZE    = 0x3fff,   // ctrl, frame length
+            LAST    = 1 << 15,  // ctrl, last buffer of the frame
+            WRAP    = 1 << 30,  // ctrl, last descriptor in the ring
+            USED    = 1U << 31  // ctrl, owned by software (set by the MAC once the frame is sent)
+        };
+
+        volatile Reg32 addr;
+        volatile Reg32 ctrl;
+    };
+
+protected:
+    GEM(unsigned int unit, DMA_Buffer * dma);
+
+public:
+    ~GEM();
+
+    int send(const Address & dst, const Protocol & prot, const void * data, unsigned int size);
+    int receive(Address * src, Protocol * prot, void * data, unsigned int size);
+
+    Buffer * alloc(const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload);
+    int send(Buffer * buf);
+    void free(Buffer * buf);
+
+    const Address & address() { return _address; }
+    void address(const Address & address);
+
+    const Statistics & statistics() { return _statistics; }
+
+    static GEM * get(unsigned int unit = 0) { return _devices[unit]; }
+
+private:
+    void reset();
+
+    Reg phy(const volatile void * log) const { return _dma_phy + (reinterpret_cast<Reg>(log) - _dma_log); }
+
+    bool rx_mine(Buffer * buf) const { return (buf >= _rx_buffer[0]) && (buf <= _rx_buffer[RX_BUFS - 1]); }
+    void rx_rearm(Buffer * buf);
+
+    Buffer * take();
+
+    static void poll(GEM * nic);
+    static void int_handler(IC::Interrupt_Id interrupt);
+
+    static volatile Reg32 & reg(unsigned int o) { return reinterpret_cast<volatile Reg32 *>(Memory_Map::ETH_BASE)[o / sizeof(Reg32)]; }
+
+    static void init(unsigned int unit);
+
+private:
+    unsigned int _unit;
+    Address _address;
+    Statistics _statistics;
+
+    DMA_Buffer * _dma;
+    Reg _dma_phy;
+    Reg _dma_log;
+
+    Rx_Desc * _rx_ring;
+    Buffer * _rx_buffer[RX_BUFS];
+    volatile bool _rx_held[RX_BUFS];    // handed up (still OWN, but not to be taken again until rx_rearm())
+    unsigned int _rx_cur;
+    Buffer::List _rx_unclaimed;
+    Simple_Spin _rx_lock;               // for _rx_unclaimed, shared by threads and the Tasklet on any CPU
+    Semaphore * _rx_ready;
+    Functor_Handler<GEM> * _rx_handler;
+    Tasklet * _rx_tasklet;
+
+    Tx_Desc * _tx_ring;
+    Buffer * _tx_buffer[TX_BUFS];
+    volatile unsigned long _tx_cur;
+    Simple_Spin _tx_lock;               // for handing over sent buffers to a single waiting alloc()
+
+    static GEM * _devices[UNITS];
+};
+
+__END_SYS
+
+#endif
@@ -0,0 +1,83 @@
+// EPOS RISC-V SiFive-U Platform DMA Engine (PDMA) Mediator Declarations
+
+#ifndef __riscv_pdma_h
+#define __riscv_pdma_h
+
+#include <architecture/cpu.h>
+#include <machine/ic.h>
+#include <machine/io_request.h>
+#include <system/memory_map.h>
+
+__BEGIN_SYS
+
+// Memory-to-memory copies, one channel each, with completions signaled by interrupts. Each channel takes READ
+// requests, whose positions are offsets from the channel's window (e.g. a memory-mapped flash) and whose data are
+// physical addresses, and runs them one at a time, in submission order.
+class PDMA
+{
+private:
+    typedef CPU::Reg Reg;
+    typedef CPU::Reg32 Reg32;
+    typedef CPU::Reg64 Reg64;
+    typedef CPU::Phy_Addr Phy_Addr;
+
+    static const unsigned int CHANNELS = Traits<PDMA>::CHANNELS;
+
+public:
+    // Channel registers offsets from PDMA_BASE + CHANNEL_BASE + channel * CHANNEL_OFFSET
+    enum {
+        CHANNEL_BASE            = 0x80000,
+        CHANNEL_OFFSET          = 0x1000,
+        CONTROL                 = 0x000,
+        NEXT_CONFIG             = 0x004,
+        NEXT_BYTES              = 0x008,    // 64 bits
+        NEXT_DESTINATION        = 0x010,    // 64 bits
+        NEXT_SOURCE             = 0x018,    // 64 bits
+        EXEC_CONFIG             = 0x104,
+        EXEC_BYTES              = 0x108,    // 64 bits, bytes yet to be moved
+        EXEC_DESTINATION        = 0x110,
+        EXEC_SOURCE             = 0x118
+    };
+
+    // Useful bits from multiple registers
+    enum {
+        CLAIM           = 1 <<  0,          // CONTROL, channel is in use (clearing it resets the NEXT registers)
+        RUN             = 1 <<  1,          // CONTROL, start a transfer with the NEXT registers
+        DONE_IE         = 1 << 14,          // CONTROL, interrupt when done
+        ERROR_IE        = 1 << 15,          // CONTROL, interrupt on errors
+        DONE            = 1 << 30,          // CONTROL, the last transfer has finished
+        ERROR           = 1U << 31,         // CONTROL, the last transfer has failed
+        REPEAT          = 1 <<  2,          // NEXT_CONFIG, reload the EXEC registers when done
+        ORDER           = 1 <<  3,          // NEXT_CONFIG, enforce strict ordering
+        WSIZE           = 24,               // NEXT_CONFIG, log2 of the write transaction size
+        RSIZE           = 28                // NEXT_CONFIG, log2 of the read transaction size
+    };
+
+    static const unsigned int MAX_TRANSACTION = 6; // 64 bytes
+
+public:
+    PDMA(unsigned int channel, Phy_Addr window = 0);
+    ~PDMA();
+
+    bool submit(IO_Request * request);
+
+private:
+    void start(IO_Request * request);
+
+    volatile Reg32 & reg(unsigned int o) { return reinterpret_cast<volatile Reg32 *>(Memory_Map::PDMA_BASE + CHANNEL_BASE + _channel * CHANNEL_OFFSET)[o / sizeof(Reg32)]; }
+    volatile Reg64 & reg64(unsigned int o) { return reinterpret_cast<volatile Reg64 *>(Memory_Map::PDMA_BASE + CHANNEL_BASE + _channel * CHANNEL_OFFSET)[o / sizeof(Reg64)]; }
+
+    static void int_handler(IC::Interrupt_Id interrupt);
+
+private:
+    unsigned int _channel;
+    Phy_Addr _window;
+    IC::Interrupt_Id _interrupt;
+    IO_Request::List _requests;
+
+    static PDMA * _channels[CHANNELS];
+};
+
+__END_SYS
+
+#endif
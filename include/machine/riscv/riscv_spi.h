@@ -0,0 +1,180 @@
+// EPOS RISC-V SPI Mediator Declarations
+
+#ifndef __riscv_spi_h
+#define __riscv_spi_h
+
+#include <architecture/cpu.h>
+#include <machine/ic.h>
+#include <machine/spi.h>
+#include <machine/riscv/riscv_pdma.h>
+#include <system/memory_map.h>
+
+__BEGIN_SYS
+
+// SiFive SPI controller (QSPI0-2 on SiFive-U), master only, with 8-frame FIFOs and frames of up to 8 bits
+// Besides the polled get() and put(), transfers can be submitted as IO_Requests (one byte per frame), each of them a
+// transaction with the slave selected throughout, which are taken in order by the interrupt handler. Requests keep no
+// more frames in the TX FIFO than the RX FIFO can take, with the RX watermark set to go off once they all are in, so
+// the slave is only deselected after the last frame has been received (and thus sent), and there is an interrupt per
+// FIFO_DEPTH frames or so. WRITEs discard what they receive, except on dual and quad lanes, which only go one way: these
+// leave the RX FIFO alone, refill the TX FIFO whenever it drops below its watermark and, once it is empty, wait for the
+// time the last frame takes to shift out. READs send FILLER frames, while TRANSFERs (single protocol only) overwrite what
+// was sent with what was received. The polled interface must not be used while requests are pending.
+// QSPI0 can also map its flash into memory (XIP), turning loads from FLASH_BASE into flash read commands. While it
+// does, programmed I/O is off and large flash reads go to xip_read(), which has the PDMA copy them in library mode.
+class SPI: public SPI_Common
+{
+private:
+    typedef CPU::Reg32 Reg32;
+
+    static const unsigned int UNITS = Traits<SPI>::UNITS;
+    static const unsigned int CLOCK = Traits<SPI>::CLOCK;
+    static const unsigned int UNIT = Traits<SPI>::DEF_UNIT;
+    static const unsigned int PROTOCOL = Traits<SPI>::DEF_PROTOCOL;
+    static const unsigned int MODE = Traits<SPI>::DEF_MODE;
+    static const unsigned int BIT_RATE = Traits<SPI>::DEF_BIT_RATE;
+    static const unsigned int DATA_BITS = Traits<SPI>::DEF_DATA_BITS;
+
+    static const unsigned int FIFO_DEPTH = 8;
+    static const unsigned char FILLER = 0xff;
+
+    // The flash window is only mapped (and buffers' logical addresses only are physical) without multitasking
+    static const bool xip_mapped = !Traits<System>::multitask;
+    static const bool dma = Traits<PDMA>::enabled && xip_mapped;
+
+public:
+    // Registers offsets from SPIx_BASE
+    enum {
+        SCKDIV  = 0x00, // f(sck) = f(in) / (2 * (DIV + 1))
+        SCKMODE = 0x04,
+        CSID    = 0x10,
+        CSDEF   = 0x14,
+        CSMODE  = 0x18,
+        DELAY0  = 0x28,
+        DELAY1  = 0x2c,
+        FMT     = 0x40,
+        TXDATA  = 0x48,
+        RXDATA  = 0x4c,
+        TXMARK  = 0x50,
+        RXMARK  = 0x54,
+        FCTRL   = 0x60, // QSPI0 and QSPI1 only
+        FFMT    = 0x64, // QSPI0 and QSPI1 only
+        IE      = 0x70,
+        IP      = 0x74
+    };
+
+    // Useful bits from multiple registers
+    enum {
+        PHA             =    1 <<  0,   // SCKMODE, clock phase
+        POL             =    1 <<  1,   // SCKMODE, clock polarity
+        CS_AUTO         =    0,         // CSMODE, select the slave for each frame
+        CS_HOLD         =    2,         // CSMODE, keep the slave selected after the first frame
+        CS_OFF          =    3,         // CSMODE, leave the slave alone
+        PROTO           =    3 <<  0,   // FMT, single, dual or quad
+        ENDIAN          =    1 <<  2,   // FMT, LSB first
+        DIR             =    1 <<  3,   // FMT, TX only (the RX FIFO isn't populated and dual/quad lanes are driven)
+        LEN             =   15 << 16,   // FMT, bits per frame
+        FULL            =   1U << 31,   // TXDATA, TX FIFO full
+        EMPTY           =   1U << 31,   // RXDATA, RX FIFO empty
+        DATA            = 0xff <<  0,
+        FCTRL_EN        =    1 <<  0,   // FCTRL, memory-mapped flash
+        CMD_EN          =    1 <<  0,   // FFMT, send a command (CMD_CODE) before the address
+        ADDR_LEN        =    1,         // FFMT, address bytes (shift)
+        PAD_CNT         =    4,         // FFMT, dummy cycles after the address (shift)
+        CMD_PROTO       =    8,         // FFMT (shift)
+        ADDR_PROTO      =   10,         // FFMT (shift)
+        DATA_PROTO      =   12,         // FFMT (shift)
+        CMD_CODE        =   16,         // FFMT (shift)
+        PAD_CODE        =   24,         // FFMT (shift)
+        TXWM            =    1 <<  0,   // IE/IP, TX FIFO below TXMARK
+        RXWM            =    1 <<  1    // IE/IP, RX FIFO above RXMARK
+    };
+
+    // Common flash read commands, for xip()
+    enum {
+        FLASH_READ              = 0x03, // single, no dummy cycles, up to 50 MHz or so
+        FLASH_FAST_READ         = 0x0b, // single, 8 dummy cycles
+        FLASH_QUAD_OUTPUT_READ  = 0x6b  // quad data, 8 dummy cycles
+    };
+
+public:
+    SPI(unsigned int unit = UNIT, const Protocol & protocol = Protocol(PROTOCOL), const Mode & mode = Mode(MODE), unsigned int bit_rate = BIT_RATE, unsigned int data_bits = DATA_BITS);
+    ~SPI();
+
+    void config(const Protocol & protocol, const Mode & mode, unsigned int bit_rate, unsigned int data_bits);
+    void config(Protocol * protocol, Mode * mode, unsigned int * bit_rate, unsigned int * data_bits);
+
+    int get() {
+        int data;
+        while(!try_get(&data));
+        return data;
+    }
+    bool try_get(int * data) {
+        Reg32 rx = reg(RXDATA); // reading pops the RX FIFO, so it is only done once
+        if(rx & EMPTY)
+            return false;
+        *data = rx & DATA;
+        return true;
+    }
+    void put(int data) { while(!try_put(data)); }
+    bool try_put(int data) {
+        if(reg(TXDATA) & FULL)
+            return false;
+        reg(TXDATA) = data & DATA;
+        return true;
+    }
+
+    int read(char * data, unsigned int max_size);
+    int write(const char * data, unsigned int size);
+
+    bool submit(IO_Request * request);
+
+    // With TXMARK = 1 and RXMARK = 0 (except while requests are pending), the watermarks tell whether the TX FIFO has
+    // been drained and whether the RX FIFO has anything, without popping it
+    void flush() { while(!(reg(IP) & TXWM)); }
+    bool ready_to_get() { return reg(IP) & RXWM; }
+    bool ready_to_put() { return !(reg(TXDATA) & FULL); }
+
+    void int_enable(bool receive = true, bool transmit = true, bool time_out = true, bool overrun = true) {
+        reg(IE) = reg(IE) | (receive ? RXWM : 0) | (transmit ? TXWM : 0);
+    }
+    void int_disable(bool receive = true, bool transmit = true, bool time_out = true, bool overrun = true) {
+        reg(IE) = reg(IE) & ~((receive ? RXWM : 0) | (transmit ? TXWM : 0));
+    }
+
+    // Memory-mapped flash (QSPI0 only, and not while requests are pending); the command and the address always go
+    // on a single lane, while data come on as many as the given protocol says
+    bool xip(bool enable, unsigned char command = FLASH_READ, unsigned int address_bytes = 3, unsigned int dummy_cycles = 0, const Protocol & data = Si5_SINGLE);
+    bool xip() const { return _xip; }
+    static void * xip_base() { return reinterpret_cast<void *>(Memory_Map::FLASH_BASE); }
+
+    // READ size bytes from the flash at position (an offset from xip_base()) into data, while XIP is on
+    bool xip_read(IO_Request * request);
+
+private:
+    void pump(IO_Request::List * finished);
+    void begin(IO_Request * request);
+    void end();
+
+    bool simplex(IO_Request * request) { return (request->operation() == IO_Request::WRITE) && ((reg(FMT) & PROTO) != Si5_SINGLE); }
+    unsigned int frame_time();
+
+    volatile Reg32 & reg(unsigned int o) { return reinterpret_cast<volatile Reg32 *>(_base)[o / sizeof(Reg32)]; }
+
+    static void int_handler(IC::Interrupt_Id interrupt);
+
+private:
+    unsigned int _unit;
+    unsigned long _base;
+    IC::Interrupt_Id _interrupt;
+    IO_Request::List _requests;
+    IO_Request * _current;              // the request whose transaction is on
+    bool _xip;
+    PDMA * _pdma;
+
+    static SPI * _units[UNITS];
+};
+
+__END_SYS
+
+#endif
@@ -72,17 +72,27 @@ public:
     static void disable() {}
 
     Hertz frequency() const { return (FREQUENCY / _initial); }
-    void frequency(Hertz f) { _initial = FREQUENCY / f; reset(); }
+    void frequency(Hertz f) { _initial = FREQUENCY / f; rearm(); }
 
     void handler(const Handler & handler) { _handler = handler; }
 
 private:
     static volatile CPU::Reg64 & reg64(unsigned int o) { return reinterpret_cast<volatile CPU::Reg64 *>(Memory_Map::CLINT_BASE)[o / sizeof(CPU::Reg64)]; }
 
+    // Also used by the machine mode forwarder (_int_m2s), which runs from a copy of its code and therefore can't touch _sstc
     static void config(const Hertz & frequency) {
         reg64(MTIMECMP + MTIMECMP_CORE_OFFSET * CPU::id()) = reg64(MTIME) + (CLOCK / frequency);
     }
 
+    // With Sstc, supervisor mode sets its own deadline, which also clears a pending STI, so ticks don't trap into
+    // machine mode at all. Otherwise, MTIMECMP is reprogrammed by the forwarder (see IC::dispatch())
+    static void rearm() {
+        if(_sstc)
+            CPU::stimecmp(reg64(MTIME) + (CLOCK / FREQUENCY));
+        else
+            reset();
+    }
+
     static void int_handler(Interrupt_Id i);
 
     static void init();
@@ -95,6 +105,7 @@ protected:
     Handler _handler;
 
     static Timer * _channels[CHANNELS];
+    static bool _sstc;
 };
 
 // Timer used by Thread::Scheduler
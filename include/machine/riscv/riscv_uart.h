@@ -5,6 +5,9 @@
 
 #include <architecture/cpu.h>
 #include <machine/uart.h>
+#include <machine/ic.h>
+#include <machine/io_request.h>
+#include <utility/buffer.h>
 #include <system/memory_map.h>
 
 __BEGIN_SYS
@@ -52,7 +55,7 @@ public:
 
     void config(unsigned int baud_rate, unsigned int data_bits, unsigned int parity, unsigned int stop_bits) {
         reg(TXCTRL) = 1 << 16 | stop_bits | TXEN; // TXCNT = 1, STOP = (stop_bits - 1) << 1
-        reg(RXCTRL) = 1 << 16 | RXEN; // RXCNT = 1
+        reg(RXCTRL) = RXEN; // RXCNT = 0 (RXWM as soon as a character arrives)
         reg(DIV) = ((CLOCK / baud_rate) - 1) & 0xffff;
     }
 
@@ -74,7 +77,7 @@ public:
     bool txd_ok() { return !(reg(TXDATA) & FULL); }
 
     void int_enable(bool receive = true, bool transmit = true, bool line = true, bool modem = true) {
-         reg(IE) = (receive << 1) | transmit;
+         reg(IE) = reg(IE) | (receive << 1) | transmit;
     }
     void int_disable(bool receive = true, bool transmit = true, bool line = true, bool modem = true) {
          reg(IE) = reg(IE) & ~((receive << 1) | transmit);
@@ -185,7 +188,7 @@ public:
     bool txd_ok() {  return (reg(LSR) & THOLD_REG); }
 
     void int_enable(bool receive = true, bool transmit = true, bool line = true, bool modem = true) {
-        reg(IER) = receive | (transmit << 1) | (line << 2) | (modem << 3);
+        reg(IER) = reg(IER) | receive | (transmit << 1) | (line << 2) | (modem << 3);
     }
     void int_disable(bool receive = true, bool transmit = true, bool line = true, bool modem = true) {
         reg(IER) = reg(IER) & ~(receive | (transmit << 1) | (line << 2) | (modem << 3));
@@ -221,9 +224,20 @@ private:
     static const unsigned int DATA_BITS = Traits<UART>::DEF_DATA_BITS;
     static const unsigned int PARITY = Traits<UART>::DEF_PARITY;
     static const unsigned int STOP_BITS = Traits<UART>::DEF_STOP_BITS;
+    static const unsigned int BUFFER_SIZE = Traits<UART>::BUFFER_SIZE;
 
     typedef IF<(Traits<Build>::MODEL == Traits<Build>::SiFive_E) || (Traits<Build>::MODEL == Traits<Build>::SiFive_U), SiFive_UART, NS16500A>::Result Engine;
 
+    // Interrupt-driven mode: RX and TX rings filled and drained by the UART's interrupt handler, which also moves
+    // characters between them and the IO_Requests pending on the device (reads take what arrives, oldest first, and
+    // writes and flushes go out in submission order)
+    struct Buffers {
+        Ring_Buffer<char, BUFFER_SIZE> rx;
+        Ring_Buffer<char, BUFFER_SIZE> tx;
+        IO_Request::List reads;
+        IO_Request::List writes;
+    };
+
 public:
     using UART_Common::NONE;
     using UART_Common::EVEN;
@@ -231,32 +245,81 @@ public:
 
 public:
     UART(unsigned int unit = UNIT, unsigned int baud_rate = BAUD_RATE, unsigned int data_bits = DATA_BITS, unsigned int parity = PARITY, unsigned int stop_bits = STOP_BITS)
-    : Engine(unit, baud_rate, data_bits, parity, stop_bits) {}
+    : Engine(unit, baud_rate, data_bits, parity, stop_bits), _buffers(0) {}
+    ~UART() { if(_buffers) interrupt_driven(false); }
 
     using Engine::config;
 
-    char get() { while(!rxd_ok()); return rxd(); }
-    void put(char c) { while(!txd_ok()); txd(c); }
+    char get() {
+        if(_buffers) {
+            char c;
+            read(&c, 1);
+            return c;
+        }
+        while(!rxd_ok());
+        return rxd();
+    }
+    void put(char c) {
+        if(_buffers)
+            write(&c, 1);
+        else {
+            while(!txd_ok());
+            txd(c);
+        }
+    }
 
     int read(char * data, unsigned int max_size) {
+        if(_buffers)
+            return buffered_read(data, max_size);
         for(unsigned int i = 0; i < max_size; i++)
             data[i] = get();
-        return 0;
+        return max_size;
     }
     int write(const char * data, unsigned int size) {
+        if(_buffers)
+            return buffered_write(data, size);
         for(unsigned int i = 0; i < size; i++)
             put(data[i]);
-        return 0;
+        return size;
     }
 
-    bool ready_to_get() { return rxd_ok(); }
-    bool ready_to_put() { return txd_ok(); }
+    bool ready_to_get() { return _buffers ? !_buffers->rx.empty() : rxd_ok(); }
+    bool ready_to_put() { return _buffers ? !_buffers->tx.full() : txd_ok(); }
 
     using Engine::int_enable;
     using Engine::int_disable;
-    using Engine::flush;
+
+    void flush() {
+        if(_buffers)
+            buffered_flush();
+        Engine::flush();
+    }
+
+    // Switches between polling and interrupt-driven I/O
+    // The engine always drives UART0, so only one UART object can be interrupt-driven at a time
+    void interrupt_driven(bool enable);
+    bool interrupt_driven() const { return _buffers; }
+
+    // Asynchronous READ, WRITE and FLUSH requests (interrupt-driven mode only); a READ finishes once size characters
+    // have arrived, a WRITE once they all are on their way out, and a FLUSH once everything before it is
+    bool submit(IO_Request * request);
 
     void power(const Power_Mode & mode);
+
+private:
+    int buffered_read(char * data, unsigned int max_size);
+    int buffered_write(const char * data, unsigned int size);
+    void buffered_flush();
+    int buffered(IO_Request * request);
+
+    void pump(IO_Request::List * finished);
+
+    static void int_handler(IC::Interrupt_Id i);
+
+private:
+    Buffers * _buffers;
+
+    static UART * _interrupt_driven;
 };
 
 __END_SYS
@@ -0,0 +1,146 @@
+// EPOS RISC-V VirtIO Block Device Mediator Declarations
+
+#ifndef __riscv_virtio_block_h
+#define __riscv_virtio_block_h
+
+#include <architecture/cpu.h>
+#include <architecture/mmu.h>
+#include <machine/ic.h>
+#include <machine/block.h>
+#include <machine/engine/virtio.h>
+
+__BEGIN_SYS
+
+// VirtIO block device (virtio-blk), as attached to QEMU's virt with "-device virtio-blk-device"
+// Each device request is a chain of three descriptors: a header (read by the device), the data, and a status byte (both
+// written by the device on reads). IO_Requests are kept in a backlog, from which they are issued, split into device
+// requests of at most MAX_TRANSFER bytes, as long as the queue has room for them; the device is notified (at most) once
+// for all that could be issued at a time. Completions are taken by the interrupt handler, which finishes IO_Requests
+// whose pieces have all completed and then issues more of the backlog, so requests finish in the order the device
+// completes them, not in the order they were submitted. In library mode, the device moves data straight to and from
+// the caller's memory; with multitasking, whose logical addresses aren't physical ones (or whenever
+// Traits<System>::bounce is set), read() and write() stage data through a bounce buffer, one piece at a time, copying
+// them from the caller's own thread (and thus address space). With multitasking, submit() only takes data that are
+// already there. A FLUSH waits for everything before it to complete before it is issued.
+class VirtIO_Block: public Block
+{
+    friend class Machine_Common;
+
+private:
+    typedef CPU::Reg Reg;
+    typedef MMU::DMA_Buffer DMA_Buffer;
+    typedef VirtIO::Segment Segment;
+
+    static const unsigned int UNITS = Traits<VirtIO_Block>::UNITS;
+    static const unsigned int QUEUE_SIZE = Traits<VirtIO_Block>::QUEUE_SIZE;
+    static const unsigned int MAX_SECTORS = Traits<VirtIO_Block>::MAX_TRANSFER / SECTOR_SIZE;
+    static const unsigned int REQUESTS = QUEUE_SIZE / 3;
+    static const bool zero_copy = !Traits<System>::bounce;
+
+    typedef VirtIO::Queue<QUEUE_SIZE> Queue;
+
+    // Device features
+    enum : VirtIO::Features {
+        F_SIZE_MAX      = 1ULL << 1,    // maximum size of any single segment is in size_max
+        F_SEG_MAX       = 1ULL << 2,    // maximum number of segments in a request is in seg_max
+        F_RO            = 1ULL << 5,    // the device is read-only
+        F_BLK_SIZE      = 1ULL << 6,    // the block size is in blk_size
+        F_FLUSH         = 1ULL << 9     // the device has a write cache that can be flushed
+    };
+
+    // Configuration space
+    enum {
+        CONFIG_CAPACITY = 0,            // in 512-byte sectors (64 bits)
+        CONFIG_SIZE_MAX = 8,
+        CONFIG_SEG_MAX  = 12
+    };
+
+    // Request header, followed by the data (if any) and then by a status byte
+    struct Header
+    {
+        enum { IN = 0, OUT = 1, FLUSH = 4 };
+
+        volatile CPU::Reg32 type;
+        volatile CPU::Reg32 reserved;
+        volatile CPU::Reg64 sector;
+    };
+
+    enum { OK = 0, IOERR = 1, UNSUPP = 2 };
+
+    // A piece of an IO_Request, as issued to the device
+    struct Request
+    {
+        Header header;
+        volatile unsigned char status;
+        IO_Request * io;
+        unsigned int offset;            // of this piece in the IO_Request's data
+        unsigned int bytes;
+        unsigned int next;              // free list link
+    };
+
+    // The queue, then the requests, then the bounce buffer (if any)
+    static const unsigned int QUEUE = 0;
+    static const unsigned int REQUEST = (QUEUE + Queue::MEMORY + 63) & ~63U;
+    static const unsigned int BOUNCE = (REQUEST + REQUESTS * sizeof(Request) + 4095) & ~4095U;
+    static const unsigned int DMA_SIZE = BOUNCE + (zero_copy ? 0 : MAX_SECTORS * SECTOR_SIZE);
+
+protected:
+    VirtIO_Block(unsigned int unit, unsigned int transport, DMA_Buffer * dma);
+
+public:
+    ~VirtIO_Block();
+
+    bool submit(IO_Request * request);
+
+    int read(const Sector & from, void * data, unsigned int sectors);
+    int write(const Sector & to, const void * data, unsigned int sectors);
+    int flush();
+
+    Sector sectors() { return _sectors; }
+    bool read_only() { return _features & F_RO; }
+
+    const Statistics & statistics() { return _statistics; }
+
+    static VirtIO_Block * get(unsigned int unit = 0) { return _devices[unit]; }
+
+private:
+    bool reset();
+
+    Reg phy(const volatile void * log) const { return _dma_phy + (reinterpret_cast<Reg>(log) - _dma_log); }
+    bool staged(const volatile void * log) const { return (reinterpret_cast<Reg>(log) >= _dma_log + BOUNCE) && (reinterpret_cast<Reg>(log) < _dma_log + DMA_SIZE); }
+
+    int transfer(const IO_Request::Operation & operation, const Sector & sector, void * data, unsigned int sectors);
+    void pump();
+    bool issue(IO_Request * io);
+    void kick();
+    void account(IO_Request * io);
+
+    static void int_handler(IC::Interrupt_Id interrupt);
+
+    static void init(unsigned int unit);
+
+private:
+    unsigned int _unit;
+    VirtIO _transport;
+    IC::Interrupt_Id _interrupt;
+    VirtIO::Features _features;
+    Sector _sectors;
+    Statistics _statistics;
+
+    DMA_Buffer * _dma;
+    Reg _dma_phy;
+    Reg _dma_log;
+
+    Queue * _queue;
+    Request * _requests;
+    unsigned int _free;                 // head of the list of free requests
+    unsigned int _in_flight;
+    Semaphore * _bounce;                // the bounce buffer, held by one read() or write() at a time
+    IO_Request::List _backlog;          // IO_Requests not yet completely issued
+
+    static VirtIO_Block * _devices[UNITS];
+};
+
+__END_SYS
+
+#endif
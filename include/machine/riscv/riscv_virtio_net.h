@@ -0,0 +1,140 @@
+// EPOS RISC-V VirtIO Network Device Mediator Declarations
+
+#ifndef __riscv_virtio_net_h
+#define __riscv_virtio_net_h
+
+#include <architecture/cpu.h>
+#include <architecture/mmu.h>
+#include <machine/ic.h>
+#include <machine/engine/virtio.h>
+#include <utility/handler.h>
+#include <utility/spin.h>
+#include <network/ethernet.h>
+
+__BEGIN_SYS
+
+class Tasklet;
+
+// VirtIO network device (virtio-net), as attached to QEMU's virt with "-device virtio-net-device"
+// Like GEM, each descriptor chain points straight at the Frame inside an Ethernet::Buffer (after a virtio-net header
+// of its own), so frames go up and down without being copied, and received frames are taken by a Tasklet, in batches
+// of at most RX_BUDGET frames, with the receive interrupt suppressed meanwhile. Transmit interrupts are never enabled:
+// sent buffers are reclaimed by alloc() itself, when it runs out of them.
+class VirtIO_Net: public NIC<Ethernet>
+{
+    friend class Machine_Common;
+
+private:
+    typedef CPU::Reg Reg;
+    typedef MMU::DMA_Buffer DMA_Buffer;
+    typedef VirtIO::Segment Segment;
+
+    static const unsigned int UNITS = Traits<VirtIO_Net>::UNITS;
+    static const unsigned int TX_BUFS = Traits<VirtIO_Net>::SEND_BUFFERS;
+    static const unsigned int RX_BUFS = Traits<VirtIO_Net>::RECEIVE_BUFFERS;
+    static const unsigned int RX_BUDGET = Traits<VirtIO_Net>::RECEIVE_BUDGET;
+    static const unsigned int RX_UNCLAIMED = RX_BUFS / 2; // frames kept for receive() before the oldest gets dropped
+
+    // Each frame takes two descriptors: one for the virtio-net header and one for the frame itself
+    typedef VirtIO::Queue<RX_BUFS * 2> Rx_Queue;
+    typedef VirtIO::Queue<TX_BUFS * 2> Tx_Queue;
+
+    // Queues, headers and buffers are cache-line aligned inside the DMA_Buffer
+    static const unsigned int RX_QUEUE = 0;
+    static const unsigned int TX_QUEUE = (RX_QUEUE + Rx_Queue::MEMORY + 63) & ~63U;
+    static const unsigned int HEADERS = (TX_QUEUE + Tx_Queue::MEMORY + 63) & ~63U;
+    static const unsigned int BUFFERS = (HEADERS + (RX_BUFS + TX_BUFS) * 16 + 63) & ~63U;
+    static const unsigned int BUFFER_STRIDE = (sizeof(Buffer) + 63) & ~63U;
+
+    // Queue indexes
+    enum { RECEIVEQ = 0, TRANSMITQ = 1 };
+
+    // Device features
+    enum : VirtIO::Features {
+        F_MAC           = 1ULL << 5,    // the device has a MAC address (in its configuration space)
+        F_STATUS        = 1ULL << 16    // the device reports the link status
+    };
+
+    // Configuration space
+    enum {
+        CONFIG_MAC      = 0,
+        CONFIG_STATUS   = 6
+    };
+
+    // Header preceding every frame (no offloads are negotiated, so it stays zeroed)
+    struct Net_Header
+    {
+        unsigned char flags;
+        unsigned char gso_type;
+        unsigned short hdr_len;
+        unsigned short gso_size;
+        unsigned short csum_start;
+        unsigned short csum_offset;
+        unsigned short num_buffers;
+    } __attribute__((packed));
+
+protected:
+    VirtIO_Net(unsigned int unit, unsigned int transport, DMA_Buffer * dma);
+
+public:
+    ~VirtIO_Net();
+
+    int send(const Address & dst, const Protocol & prot, const void * data, unsigned int size);
+    int receive(Address * src, Protocol * prot, void * data, unsigned int size);
+
+    Buffer * alloc(const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload);
+    int send(Buffer * buf);
+    void free(Buffer * buf);
+
+    const Address & address() { return _address; }
+    void address(const Address & address);
+
+    const Statistics & statistics() { return _statistics; }
+
+    static VirtIO_Net * get(unsigned int unit = 0) { return _devices[unit]; }
+
+private:
+    bool reset();
+
+    Reg phy(const volatile void * log) const { return _dma_phy + (reinterpret_cast<Reg>(log) - _dma_log); }
+
+    bool rx_mine(Buffer * buf) const { return (buf >= _rx_buffer[0]) && (buf <= _rx_buffer[RX_BUFS - 1]); }
+    void rx_rearm(Buffer * buf);
+    void tx_reclaim();
+
+    Buffer * take();
+
+    static void poll(VirtIO_Net * nic);
+    static void int_handler(IC::Interrupt_Id interrupt);
+
+    static void init(unsigned int unit);
+
+private:
+    unsigned int _unit;
+    VirtIO _transport;
+    IC::Interrupt_Id _interrupt;
+    Address _address;
+    Statistics _statistics;
+
+    DMA_Buffer * _dma;
+    Reg _dma_phy;
+    Reg _dma_log;
+
+    Rx_Queue * _rx_queue;
+    Buffer * _rx_buffer[RX_BUFS];
+    Buffer::List _rx_unclaimed;
+    Simple_Spin _rx_lock;               // for _rx_unclaimed, shared by threads and the Tasklet on any CPU
+    Semaphore * _rx_ready;
+    Functor_Handler<VirtIO_Net> * _rx_handler;
+    Tasklet * _rx_tasklet;
+
+    Tx_Queue * _tx_queue;
+    Buffer * _tx_buffer[TX_BUFS];
+    volatile unsigned long _tx_cur;
+
+    static VirtIO_Net * _devices[UNITS];
+};
+
+__END_SYS
+
+#endif
@@ -54,6 +54,9 @@ public:
 template <> struct Traits<IC>: public Traits<Machine_Common>
 {
     static const bool debugged = hysterically_debugged;
+
+    // Let higher priority PLIC sources preempt the handlers of lower priority ones
+    static const bool nesting = true;
 };
 
 template <> struct Traits<Timer>: public Traits<Machine_Common>
@@ -80,6 +83,8 @@ template <> struct Traits<UART>: public Traits<Machine_Common>
     static const unsigned int DEF_DATA_BITS = 8;
     static const unsigned int DEF_PARITY = 0; // none
     static const unsigned int DEF_STOP_BITS = 1;
+
+    static const unsigned int BUFFER_SIZE = 256; // RX and TX rings, in interrupt-driven mode (must be a power of 2)
 };
 
 template<> struct Traits<Serial_Display>: public Traits<Machine_Common>
@@ -90,6 +95,8 @@ template<> struct Traits<Serial_Display>: public Traits<Machine_Common>
     static const int COLUMNS = 80;
     static const int LINES = 24;
     static const int TAB_SIZE = 8;
+    static const bool buffered = false;
+    static const unsigned int BUFFER_SIZE = 0;
 };
 
 template<> struct Traits<Scratchpad>: public Traits<Machine_Common>
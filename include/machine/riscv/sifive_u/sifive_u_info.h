@@ -9,9 +9,18 @@ __BEGIN_SYS
 
 struct System_Info: public System_Info_Common
 {
+public:
+    // Timer facts probed by SETUP in machine mode, which supervisor mode cannot find out by itself
+    struct Time_Map
+    {
+        bool sstc;              // stimecmp is enabled (see Timer)
+    };
+
+public:
     Boot_Map bm;
     Physical_Memory_Map pmm;
     Kernel_Load_Map lm;
+    Time_Map tm;
 };
 
 __END_SYS
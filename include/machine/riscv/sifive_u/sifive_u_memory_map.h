@@ -36,11 +36,12 @@ public:
         CLINT_BASE      = 0x02000000,   // SiFive CLINT
         TIMER_BASE      = 0x02004000,   // CLINT Timer
         PLIIC_CPU_BASE  = 0x0c000000,   // SiFive PLIC
+        PDMA_BASE       = 0x03000000,   // SiFive-U Platform DMA Engine
         PRCI_BASE       = 0x10000000,   // SiFive-U Power, Reset, Clock, Interrupt
         GPIO_BASE       = 0x10060000,   // SiFive-U GPIO
         OTP_BASE        = 0x10070000,   // SiFive-U OTP
         ETH_BASE        = 0x10090000,   // SiFive-U Ethernet
-        FLASH_BASE      = 0x20000000,   // Virt / SiFive-U Flash
+        FLASH_BASE      = 0x20000000,   // Virt / SiFive-U Flash (SiFive-U QSPI 0 memory-mapped flash)
         SPI0_BASE       = 0x10040000,   // SiFive-U QSPI 0
         SPI1_BASE       = 0x10041000,   // SiFive-U QSPI 1
         SPI2_BASE       = 0x10050000,   // SiFive-U QSPI 2
@@ -69,6 +69,9 @@ public:
 template <> struct Traits<IC>: public Traits<Machine_Common>
 {
     static const bool debugged = hysterically_debugged;
+
+    // Let higher priority PLIC sources preempt the handlers of lower priority ones
+    static const bool nesting = true;
 };
 
 template <> struct Traits<Timer>: public Traits<Machine_Common>
@@ -82,6 +85,10 @@ template <> struct Traits<Timer>: public Traits<Machine_Common>
     // choice must respect the scheduler time-slice, i. e., it must be higher
     // than the scheduler invocation frequency.
     static const int FREQUENCY = 1000; // Hz
+
+    // With multitasking, let supervisor mode program its own deadlines through Sstc's stimecmp if the harts support it
+    // (e.g. QEMU >= 7.0), instead of going through the machine mode forwarder twice per tick
+    static const bool sstc = true;
 };
 
 template <> struct Traits<UART>: public Traits<Machine_Common>
@@ -95,6 +102,8 @@ template <> struct Traits<UART>: public Traits<Machine_Common>
     static const unsigned int DEF_DATA_BITS = 8;
     static const unsigned int DEF_PARITY = 0; // none
     static const unsigned int DEF_STOP_BITS = 1;
+
+    static const unsigned int BUFFER_SIZE = 256; // RX and TX rings, in interrupt-driven mode (must be a power of 2)
 };
 
 template <> struct Traits<SPI>: public Traits<Machine_Common>
@@ -108,6 +117,17 @@ template <> struct Traits<SPI>: public Traits<Machine_Common>
     static const unsigned int DEF_MODE = 0;
     static const unsigned int DEF_DATA_BITS = 8;
     static const unsigned int DEF_BIT_RATE = 250000;
+
+    // Memory-mapped (XIP) flash reads on QSPI0 are copied by this PDMA channel (in library mode, where buffers'
+    // logical addresses are physical ones), leaving the CPU free meanwhile
+    static const unsigned int DMA_CHANNEL = 0;
+};
+
+template <> struct Traits<PDMA>: public Traits<Machine_Common>
+{
+    static const bool enabled = library;
+
+    static const unsigned int CHANNELS = 4;
 };
 
 template<> struct Traits<Serial_Display>: public Traits<Machine_Common>
@@ -118,6 +138,8 @@ template<> struct Traits<Serial_Display>: public Traits<Machine_Common>
     static const int COLUMNS = 80;
     static const int LINES = 24;
     static const int TAB_SIZE = 8;
+    static const bool buffered = true; // output goes through per-CPU rings drained by the UART TX interrupt
+    static const unsigned int BUFFER_SIZE = 4096; // per CPU, must be a power of 2
 };
 
 template<> struct Traits<Scratchpad>: public Traits<Machine_Common>
@@ -125,6 +147,28 @@ template<> struct Traits<Scratchpad>: public Traits<Machine_Common>
     static const bool enabled = false;
 };
 
+template<> struct Traits<Ethernet>: public Traits<Machine_Common>
+{
+    typedef LIST<GEM> DEVICES;
+    static const unsigned int UNITS = DEVICES::Length;
+
+    static const bool enabled = (Traits<Build>::NODES > 1) && (UNITS > 0);
+    static const bool promiscuous = false;
+};
+
+template<> struct Traits<GEM>: public Traits<Machine_Common>
+{
+    static const unsigned int UNITS = Traits<Ethernet>::UNITS;
+
+    static const unsigned int SEND_BUFFERS = 16;
+    static const unsigned int RECEIVE_BUFFERS = 32;
+
+    // Interrupt coalescing: frames handed up per Tasklet run before the rest of the system gets to run, and the
+    // hardware hold-off (in us) between receive interrupts, where the MAC supports it
+    static const unsigned int RECEIVE_BUDGET = 16;
+    static const unsigned int RECEIVE_MODERATION = 100;
+};
+
 __END_SYS
 
 #endif
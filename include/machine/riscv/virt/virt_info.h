@@ -0,0 +1,28 @@
+// EPOS QEMU Virt (RISC-V) Run-Time System Information
+
+#ifndef __riscv_virt_info_h
+#define __riscv_virt_info_h
+
+#include <system/info.h>
+
+__BEGIN_SYS
+
+struct System_Info: public System_Info_Common
+{
+public:
+    // Timer facts probed by SETUP in machine mode, which supervisor mode cannot find out by itself
+    struct Time_Map
+    {
+        bool sstc;              // stimecmp is enabled (see Timer)
+    };
+
+public:
+    Boot_Map bm;
+    Physical_Memory_Map pmm;
+    Kernel_Load_Map lm;
+    Time_Map tm;
+};
+
+__END_SYS
+
+#endif
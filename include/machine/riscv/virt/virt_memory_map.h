@@ -0,0 +1,73 @@
+// EPOS QEMU Virt (RISC-V) Memory Map
+
+#ifndef __riscv_virt_memory_map_h
+#define __riscv_virt_memory_map_h
+
+#include <system/memory_map.h>
+
+__BEGIN_SYS
+
+struct Memory_Map
+{
+private:
+    static const bool multitask = Traits<System>::multitask;
+
+public:
+    enum : unsigned long {
+        NOT_USED        = Traits<Machine>::NOT_USED,
+
+        // Physical Memory
+        RAM_BASE        = Traits<Machine>::RAM_BASE,
+        RAM_TOP         = Traits<Machine>::RAM_TOP,
+        MIO_BASE        = Traits<Machine>::MIO_BASE,
+        MIO_TOP         = Traits<Machine>::MIO_TOP,
+        LAST_PAGE       = RAM_TOP + 1 - 4096,
+        INT_M2S         = LAST_PAGE,   		// with multitasking, the last page is used by the _int_m2s() machine mode interrupt forwarder installed by SETUP before going into supervisor mode; code and stack share the same page, with code at the bottom and the stack at the top
+        FLAT_MEM_MAP    = LAST_PAGE,       	// in LIBRARY mode, the last page is used for a single-level mapping of the whole memory space
+        BOOT_STACK      = LAST_PAGE - Traits<Machine>::STACK_SIZE, // will be used as the stack's base, not the stack pointer
+        FREE_BASE       = RAM_BASE,
+        FREE_TOP        = BOOT_STACK,
+
+        // Memory-mapped devices
+        BIOS_BASE       = 0x00001000,   // BIOS ROM
+        TEST_BASE       = 0x00100000,   // SiFive test engine (poweroff and reboot)
+        RTC_BASE        = 0x00101000,   // Goldfish RTC
+        CLINT_BASE      = 0x02000000,   // SiFive CLINT
+        TIMER_BASE      = 0x02004000,   // CLINT Timer
+        PLIIC_CPU_BASE  = 0x0c000000,   // SiFive PLIC
+        UART0_BASE      = 0x10000000,   // NS16550A UART
+        VIRTIO_BASE     = 0x10001000,   // virtio-mmio transports, one every VIRTIO_STRIDE bytes
+        VIRTIO_STRIDE   = 0x00001000,
+        FLASH_BASE      = 0x20000000,   // Virt / SiFive-U Flash
+
+        // Physical Memory at Boot
+        BOOT            = Traits<Machine>::BOOT,
+        IMAGE           = Traits<Machine>::IMAGE,
+        SETUP           = Traits<Machine>::SETUP,
+
+        // Logical Address Space
+        APP_LOW         = Traits<Machine>::APP_LOW,
+        APP_HIGH        = Traits<Machine>::APP_HIGH,
+        APP_CODE        = Traits<Machine>::APP_CODE,
+        APP_DATA        = Traits<Machine>::APP_DATA,
+
+        PHY_MEM         = Traits<Machine>::PHY_MEM,
+
+        IO              = Traits<Machine>::IO,
+
+        SYS             = Traits<Machine>::SYS,
+        SYS_CODE        = multitask ? SYS + 0x00000000 : NOT_USED,
+        SYS_INFO        = multitask ? SYS + 0x00100000 : NOT_USED,
+        SYS_PT          = multitask ? SYS + 0x00101000 : NOT_USED,
+        SYS_PD          = multitask ? SYS + 0x00102000 : NOT_USED,
+        SYS_DATA        = multitask ? SYS + 0x00103000 : NOT_USED,
+        SYS_STACK       = multitask ? SYS + 0x00200000 : NOT_USED,
+        INIT            = multitask ? SYS_STACK        : NOT_USED,
+        SYS_HEAP        = multitask ? SYS + 0x00400000 : NOT_USED,
+        SYS_HIGH        = multitask ? SYS + 0x5fffffff : NOT_USED
+    };
+};
+
+__END_SYS
+
+#endif
@@ -0,0 +1,177 @@
+// EPOS QEMU Virt (RISC-V) Metainfo and Configuration
+
+#ifndef __riscv_virt_traits_h
+#define __riscv_virt_traits_h
+
+#include <system/config.h>
+
+__BEGIN_SYS
+
+class Machine_Common;
+template<> struct Traits<Machine_Common>: public Traits<Build>
+{
+protected:
+    static const bool library = (Traits<Build>::MODE == Traits<Build>::LIBRARY);
+};
+
+template<> struct Traits<Machine>: public Traits<Machine_Common>
+{
+public:
+    // Value to be used for undefined addresses
+    static const unsigned long NOT_USED         = -1UL;
+
+    // Clocks
+    static const unsigned long CLOCK            = 1000000000;                                   // Nominal (QEMU doesn't model it)
+    static const unsigned long RTCCLK           =   10000000;                                   // The CLINT's mtime (timebase-frequency in QEMU's device tree) runs at 10 MHz
+    static const unsigned long UARTCLK          =    3686400;                                   // NS16550A reference clock
+
+    // Physical Memory
+    static const unsigned long RAM_BASE         = 0x80000000;                                   // 2 GB
+    static const unsigned long RAM_TOP          = 0x87ffffff;                                   // 2 GB + 128 MB (max 256 GB of RAM + MIO)
+    static const unsigned long MIO_BASE         = 0x00000000;
+    static const unsigned long MIO_TOP          = 0x1fffffff;                                   // 512 MB (PCIe, from 0x30000000 on, is not used)
+
+    // Physical Memory at Boot
+    static const unsigned long BOOT             = NOT_USED;
+    static const unsigned long SETUP            = library ? NOT_USED : RAM_BASE;                // RAM_BASE (will be part of the free memory at INIT, using a logical address identical to physical eliminate SETUP relocation)
+    static const unsigned long IMAGE            = 0x80100000;                                   // RAM_BASE + 1 MB (will be part of the free memory at INIT, defines the maximum image size; if larger than 3 MB then adjust at SETUP)
+
+    // Logical Memory
+#ifdef __rv32__
+    static const unsigned long APP_LOW          = library ? RAM_BASE : 0x20000000;              // 512 MB
+    static const unsigned long APP_HIGH         = library ? RAM_TOP  : RAM_BASE - 1;            // 2GB
+
+    static const unsigned long APP_CODE         = APP_LOW;
+    static const unsigned long APP_DATA         = APP_CODE + 4 * 1024 * 1024;                   // APP_CODE + 4 MB
+
+    static const unsigned long PHY_MEM          = RAM_BASE;                                     // 2 GB (max 1536 MB of RAM)
+    static const unsigned long IO               = 0x00000000;                                   // 0 (max 512 MB of IO = MIO_TOP - MIO_BASE)
+    static const unsigned long SYS              = 0xff800000;                                   // 4 GB - 16 MB
+#else
+    static const unsigned long APP_LOW          = library ? RAM_BASE : 0xffffffc000000000;      // 256 GB ((highest address + 1) / 2 [RV64 uses sign-extended addresses, so this is 0x0000004000000000])
+    static const unsigned long APP_HIGH         = 0xffffffffffffffff;                           // 512 GB (highest address)
+
+    static const unsigned long APP_CODE         = APP_LOW;
+    static const unsigned long APP_DATA         = APP_CODE + 4 * 1024 * 1024;                   // APP_CODE + 4 MB
+
+    static const unsigned long PHY_MEM          = RAM_BASE;                                     // 2 GB (max 256 GB of RAM)
+    static const unsigned long IO               = 0x0000000000000000;                           // 0 (max 512 MB of IO = MIO_TOP - MIO_BASE)
+    static const unsigned long SYS              = 0x0000000020000000;                           // 128 GB
+#endif
+
+    // Default Sizes and Quantities
+    static const unsigned int MAX_THREADS       = 15;
+    static const unsigned int STACK_SIZE        = 256 * 1024;
+    static const unsigned int HEAP_SIZE         = 4 * 1024 * 1024;
+};
+
+template <> struct Traits<IC>: public Traits<Machine_Common>
+{
+    static const bool debugged = hysterically_debugged;
+
+    // Let higher priority PLIC sources preempt the handlers of lower priority ones
+    static const bool nesting = true;
+};
+
+template <> struct Traits<Timer>: public Traits<Machine_Common>
+{
+    static const bool debugged = hysterically_debugged;
+
+    static const unsigned int UNITS = 1;
+    static const unsigned int CLOCK = Traits<Machine>::RTCCLK;
+
+    // Meaningful values for the timer frequency range from 100 to 10000 Hz. The
+    // choice must respect the scheduler time-slice, i. e., it must be higher
+    // than the scheduler invocation frequency.
+    static const int FREQUENCY = 1000; // Hz
+
+    // With multitasking, let supervisor mode program its own deadlines through Sstc's stimecmp if the harts support it
+    // (e.g. QEMU >= 7.0), instead of going through the machine mode forwarder twice per tick
+    static const bool sstc = true;
+};
+
+template <> struct Traits<UART>: public Traits<Machine_Common>
+{
+    static const unsigned int UNITS = 1;
+
+    static const unsigned int CLOCK = Traits<Machine>::UARTCLK;
+
+    static const unsigned int DEF_UNIT = 0;
+    static const unsigned int DEF_BAUD_RATE = 115200;
+    static const unsigned int DEF_DATA_BITS = 8;
+    static const unsigned int DEF_PARITY = 0; // none
+    static const unsigned int DEF_STOP_BITS = 1;
+
+    static const unsigned int BUFFER_SIZE = 256; // RX and TX rings, in interrupt-driven mode (must be a power of 2)
+};
+
+template<> struct Traits<Serial_Display>: public Traits<Machine_Common>
+{
+    static const bool enabled = (Traits<Build>::EXPECTED_SIMULATION_TIME != 0);
+    static const int ENGINE = UART;
+    static const int UNIT = 0;
+    static const int COLUMNS = 80;
+    static const int LINES = 24;
+    static const int TAB_SIZE = 8;
+    static const bool buffered = true; // output goes through per-CPU rings drained by the UART TX interrupt
+    static const unsigned int BUFFER_SIZE = 4096; // per CPU, must be a power of 2
+};
+
+template<> struct Traits<Scratchpad>: public Traits<Machine_Common>
+{
+    static const bool enabled = false;
+};
+
+// Virt has no built-in NIC nor storage, but up to eight virtio-mmio transports, which QEMU fills with "-device virtio-*-device"
+template<> struct Traits<VirtIO>: public Traits<Machine_Common>
+{
+    static const unsigned int TRANSPORTS = 8;
+
+    // Ring layout: packed virtqueues (VirtIO 1.1) need QEMU's "packed=on" on the device, while split ones (VirtIO 1.0)
+    // work with any modern device; either way, notifications are suppressed with event indexes (VIRTIO_F_EVENT_IDX)
+    static const bool packed = true;
+};
+
+template<> struct Traits<Ethernet>: public Traits<Machine_Common>
+{
+    typedef LIST<VirtIO_Net> DEVICES;
+    static const unsigned int UNITS = DEVICES::Length;
+
+    static const bool enabled = (Traits<Build>::NODES > 1) && (UNITS > 0);
+    static const bool promiscuous = false;
+};
+
+template<> struct Traits<VirtIO_Net>: public Traits<Machine_Common>
+{
+    static const unsigned int UNITS = Traits<Ethernet>::UNITS;
+
+    static const unsigned int SEND_BUFFERS = 16;
+    static const unsigned int RECEIVE_BUFFERS = 32;
+
+    // Frames handed up per Tasklet run before the rest of the system gets to run
+    static const unsigned int RECEIVE_BUDGET = 16;
+};
+
+template<> struct Traits<Block>: public Traits<Machine_Common>
+{
+    typedef LIST<VirtIO_Block> DEVICES;
+    static const unsigned int UNITS = DEVICES::Length;
+
+    static const bool enabled = (UNITS > 0);
+};
+
+template<> struct Traits<VirtIO_Block>: public Traits<Machine_Common>
+{
+    static const unsigned int UNITS = Traits<Block>::UNITS;
+
+    // Requests in flight (each one takes three descriptors: header, data and status)
+    static const unsigned int QUEUE_SIZE = 64;
+
+    // Largest single transfer; larger reads and writes are split into as many requests as needed, all of them
+    // submitted at once, with a single notification to the device
+    static const unsigned int MAX_TRANSFER = 64 * 1024;
+};
+
+__END_SYS
+
+#endif
@@ -4,6 +4,7 @@
 #define __spi_h
 
 #include <system/config.h>
+#include <machine/io_request.h>
 
 __BEGIN_SYS
 
@@ -42,6 +43,8 @@ public:
     int read(char * data, unsigned int max_size);
     int write(const char * data, unsigned int size);
 
+    bool submit(IO_Request * request);
+
     void flush();
     bool ready_to_get();
     bool ready_to_put();
@@ -0,0 +1,48 @@
+// EPOS Network Declarations
+
+#ifndef __network_h
+#define __network_h
+
+#include <machine/nic.h>
+#include <network/ip.h>
+#include <network/icmp.h>
+#include <network/udp.h>
+
+__BEGIN_SYS
+
+// The network stack is brought up by System::init() when there is more than one node (and unless Traits<Network> is
+// declared disabled), with one IP per Ethernet NIC; Traits<IP> and Traits<UDP> come from system/traits.h
+class Network
+{
+    friend class System;
+
+private:
+    template<unsigned int unit = 0>
+    struct Initializer
+    {
+        typedef typename Traits<Ethernet>::DEVICES::template Get<unit>::Result DEV;
+
+        static void init() {
+            NIC<Ethernet> * nic = DEV::get(unit);
+            if(nic)
+                new (SYSTEM) IP(nic, unit);
+
+            Initializer<unit + 1>::init();
+        };
+    };
+
+private:
+    Network() {}
+
+    static void init();
+};
+
+template<>
+struct Network::Initializer<Traits<Ethernet>::DEVICES::Length>
+{
+    static void init() {};
+};
+
+__END_SYS
+
+#endif
@@ -0,0 +1,223 @@
+// EPOS ARP Protocol Declarations
+
+#ifndef __arp_h
+#define __arp_h
+
+#include <synchronizer.h>
+#include <time.h>
+#include <utility/spin.h>
+
+__BEGIN_SYS
+
+// Address Resolution Protocol (RFC 826), mapping Network addresses into NIC addresses
+// Replies (and requests addressed to us) are cached in a small table, with the oldest entries replaced first.
+// Resolution blocks the calling thread for up to TRIES timeouts, so it must not be used from interrupt handlers.
+template<typename NIC, typename Network, unsigned int HTYPE>
+class ARP: private NIC::Observer
+{
+private:
+    static const unsigned int ENTRIES = Traits<Network>::ARP_ENTRIES;
+    static const unsigned int TRIES = Traits<Network>::ARP_TRIES;
+    static const unsigned int TIMEOUT = Traits<Network>::ARP_TIMEOUT;
+
+    typedef typename NIC::Buffer Buffer;
+
+public:
+    typedef typename NIC::Address MAC;
+    typedef typename Network::Address Address;
+
+    enum {
+        REQUEST = 1,
+        REPLY   = 2
+    };
+
+    class Packet
+    {
+    public:
+        Packet(unsigned short oper, const MAC & sha, const Address & spa, const MAC & tha, const Address & tpa)
+        : _htype(CPU::htons(HTYPE)), _ptype(CPU::htons(Network::PROTOCOL)), _hlen(sizeof(MAC)), _plen(sizeof(Address)),
+          _oper(CPU::htons(oper)), _sha(sha), _spa(spa), _tha(tha), _tpa(tpa) {}
+
+        bool valid() const { return (CPU::ntohs(_htype) == HTYPE) && (CPU::ntohs(_ptype) == Network::PROTOCOL) && (_hlen == sizeof(MAC)) && (_plen == sizeof(Address)); }
+        unsigned short oper() const { return CPU::ntohs(_oper); }
+        const MAC & sha() const { return _sha; }
+        const Address & spa() const { return _spa; }
+        const Address & tpa() const { return _tpa; }
+
+        friend OStream & operator<<(OStream & os, const Packet & p) {
+            os << "{op=" << p.oper() << ",sha=" << p._sha << ",spa=" << p._spa << ",tha=" << p._tha << ",tpa=" << p._tpa << "}";
+            return os;
+        }
+
+    private:
+        unsigned short _htype;
+        unsigned short _ptype;
+        unsigned char _hlen;
+        unsigned char _plen;
+        unsigned short _oper;
+        MAC _sha;
+        Address _spa;
+        MAC _tha;
+        Address _tpa;
+    } __attribute__((packed));
+
+private:
+    struct Entry
+    {
+        Address address;
+        MAC mac;
+    };
+
+    // Threads waiting for an address to be resolved
+    struct Waiter
+    {
+        Waiter(const Address & a, Waiter * n): address(a), semaphore(0), next(n) {}
+
+        Address address;
+        Semaphore semaphore;
+        Waiter * next;
+    };
+
+public:
+    ARP(NIC * nic, Network * network): _nic(nic), _network(network), _victim(0), _waiters(0) {
+        db<Network>(TRC) << "ARP(nic=" << nic << ",net=" << network << ")" << endl;
+
+        for(unsigned int i = 0; i < ENTRIES; i++) {
+            _table[i].address = Address::NULL;
+            _table[i].mac = MAC::NULL;
+        }
+        _nic->attach(this, NIC::ARP);
+    }
+
+    ~ARP() {
+        db<Network>(TRC) << "~ARP(this=" << this << ")" << endl;
+
+        _nic->detach(this, NIC::ARP);
+    }
+
+    MAC resolve(const Address & address) {
+        db<Network>(TRC) << "ARP::resolve(a=" << address << ")" << endl;
+
+        for(unsigned int i = 0; i < TRIES; i++) {
+            MAC mac = lookup(address);
+            if(mac)
+                return mac;
+
+            Waiter waiter(address, 0);
+            link(&waiter);
+            send(REQUEST, MAC::BROADCAST, MAC::NULL, address);
+            Semaphore_Handler handler(&waiter.semaphore);
+            Alarm timeout(TIMEOUT, &handler);
+            waiter.semaphore.p();
+            unlink(&waiter);
+        }
+
+        MAC mac = lookup(address);
+        if(!mac)
+            db<Network>(WRN) << "ARP::resolve(a=" << address << ") failed!" << endl;
+
+        return mac;
+    }
+
+    MAC lookup(const Address & address) {
+        MAC mac = MAC::NULL;
+        bool disabled = lock();
+        for(unsigned int i = 0; i < ENTRIES; i++)
+            if(_table[i].address == address) {
+                mac = _table[i].mac;
+                break;
+            }
+        unlock(disabled);
+        return mac;
+    }
+
+    void insert(const Address & address, const MAC & mac) {
+        db<Network>(TRC) << "ARP::insert(a=" << address << ",mac=" << mac << ")" << endl;
+
+        bool disabled = lock();
+        unsigned int i = 0;
+        for(; (i < ENTRIES) && (_table[i].address != address); i++);
+        if(i == ENTRIES) {
+            i = _victim;
+            _victim = (_victim + 1) % ENTRIES;
+        }
+        _table[i].address = address;
+        _table[i].mac = mac;
+
+        // Semaphore::v() may reschedule, so waiters are only woken up after the table has been released
+        Waiter * ready = 0;
+        for(Waiter * w = _waiters; w; w = w->next)
+            if(w->address == address) {
+                ready = w;
+                break;
+            }
+        unlock(disabled);
+
+        if(ready)
+            ready->semaphore.v();
+    }
+
+private:
+    void send(unsigned short oper, const MAC & dst, const MAC & tha, const Address & tpa) {
+        Buffer * buf = _nic->alloc(dst, NIC::ARP, 0, 0, sizeof(Packet));
+        if(!buf)
+            return;
+        *buf->frame()->template data<Packet>() = Packet(oper, _nic->address(), _network->address(), tha, tpa);
+        _nic->send(buf);
+    }
+
+    // Runs in the NIC's receive Tasklet
+    void update(typename NIC::Observed * obs, const typename NIC::Protocol & prot, Buffer * buf) {
+        Packet * packet = buf->frame()->template data<Packet>();
+        db<Network>(INF) << "ARP::update(buf=" << buf << ") => " << *packet << endl;
+
+        if(packet->valid() && (packet->tpa() == _network->address())) {
+            insert(packet->spa(), packet->sha());
+            if(packet->oper() == REQUEST)
+                send(REPLY, packet->sha(), packet->sha(), packet->spa());
+        }
+
+        _nic->free(buf);
+    }
+
+    void link(Waiter * w) {
+        bool disabled = lock();
+        w->next = _waiters;
+        _waiters = w;
+        unlock(disabled);
+    }
+
+    void unlink(Waiter * w) {
+        bool disabled = lock();
+        Waiter ** p = &_waiters;
+        for(; *p && (*p != w); p = &(*p)->next);
+        if(*p)
+            *p = w->next;
+        unlock(disabled);
+    }
+
+    // The table is shared by threads and the NIC's receive Tasklet, on any CPU; the interrupt state is the caller's
+    bool lock() {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        _lock.acquire();
+        return disabled;
+    }
+    void unlock(bool disabled) {
+        _lock.release();
+        if(!disabled)
+            CPU::int_enable();
+    }
+
+private:
+    NIC * _nic;
+    Network * _network;
+    Entry _table[ENTRIES];
+    unsigned int _victim;
+    Waiter * _waiters;
+    Simple_Spin _lock;
+};
+
+__END_SYS
+
+#endif
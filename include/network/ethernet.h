@@ -0,0 +1,83 @@
+// EPOS Ethernet Mediator Common Package
+
+#ifndef __ethernet_h
+#define __ethernet_h
+
+#define __nic_common_only__
+#include <machine/nic.h>
+
+__BEGIN_SYS
+
+class Ethernet: public NIC_Common
+{
+public:
+    static const unsigned int MTU = 1500;
+    static const unsigned int HEADER_SIZE = 14;
+    static const unsigned int HTYPE = 1; // ARP hardware type
+
+    typedef NIC_Common::Address<6> Address;
+    typedef NIC_Common::CRC32 CRC;
+
+    // Protocol numbers (EtherType)
+    enum : Protocol {
+        IP      = 0x0800,
+        ARP     = 0x0806,
+        RARP    = 0x8035,
+        ELP     = 0x8888
+    };
+
+    // The Ethernet Header (RFC 894)
+    class Header
+    {
+    public:
+        Header() {}
+        Header(const Address & src, const Address & dst, const Protocol & prot): _dst(dst), _src(src), _prot(CPU::htons(prot)) {}
+
+        const Address & src() const { return _src; }
+        const Address & dst() const { return _dst; }
+        Protocol prot() const { return CPU::ntohs(_prot); }
+
+        friend OStream & operator<<(OStream & os, const Header & h) {
+            os << "{dst=" << h._dst << ",src=" << h._src << ",prot=" << hex << h.prot() << dec << "}";
+            return os;
+        }
+
+    protected:
+        Address _dst;
+        Address _src;
+        Protocol _prot;
+    } __attribute__((packed));
+
+    typedef unsigned char Data[MTU];
+
+    // The Ethernet Frame (RFC 894)
+    // The trailing CRC leaves room for the 4 extra bytes of a VLAN tag when the NIC strips the FCS.
+    class Frame: public Header
+    {
+    public:
+        Frame() {}
+        Frame(const Address & src, const Address & dst, const Protocol & prot): Header(src, dst, prot) {}
+        Frame(const Address & src, const Address & dst, const Protocol & prot, const void * data, unsigned int size): Header(src, dst, prot) { memcpy(_data, data, size); }
+
+        Header * header() { return this; }
+
+        template<typename T>
+        T * data() { return reinterpret_cast<T *>(&_data); }
+
+    protected:
+        Data _data;
+        CRC _crc;
+    } __attribute__((packed));
+
+    typedef _UTIL::Buffer<NIC<Ethernet>, Frame> Buffer;
+
+    typedef Data_Observer<Buffer, Protocol> Observer;
+    typedef Data_Observed<Buffer, Protocol> Observed;
+
+protected:
+    Ethernet() {}
+};
+
+__END_SYS
+
+#endif
@@ -0,0 +1,65 @@
+// EPOS ICMP Protocol Declarations
+
+#ifndef __icmp_h
+#define __icmp_h
+
+#include <network/ip.h>
+
+__BEGIN_SYS
+
+// Internet Control Message Protocol (RFC 792)
+// Only echo requests are handled: they are answered from the NIC's receive Tasklet, straight back to the MAC address
+// they came from, so pinging EPOS never blocks on ARP
+class ICMP: private IP::Observer
+{
+    friend class Network;
+
+public:
+    typedef unsigned char Type;
+    enum : Type {
+        ECHO_REPLY      = 0,
+        UNREACHABLE     = 3,
+        ECHO            = 8,
+        TIME_EXCEEDED   = 11
+    };
+
+    class Header
+    {
+        friend class ICMP;
+
+    public:
+        Header() {}
+        Header(const Type & type, unsigned char code, unsigned short id, unsigned short seq)
+        : _type(type), _code(code), _checksum(0), _id(CPU::htons(id)), _seq(CPU::htons(seq)) {}
+
+        Type type() const { return _type; }
+        unsigned char code() const { return _code; }
+        unsigned short id() const { return CPU::ntohs(_id); }
+        unsigned short seq() const { return CPU::ntohs(_seq); }
+
+        friend OStream & operator<<(OStream & os, const Header & h) {
+            os << "{t=" << static_cast<unsigned int>(h._type) << ",c=" << static_cast<unsigned int>(h._code) << ",id=" << h.id() << ",seq=" << h.seq() << "}";
+            return os;
+        }
+
+    protected:
+        Type _type;
+        unsigned char _code;
+        unsigned short _checksum;
+        unsigned short _id;
+        unsigned short _seq;
+    } __attribute__((packed));
+
+protected:
+    ICMP();
+
+public:
+    ~ICMP();
+
+private:
+    void update(IP::Observed * obs, const IP::Protocol & prot, IP::Buffer * buf);
+};
+
+__END_SYS
+
+#endif
@@ -0,0 +1,176 @@
+// EPOS IP Protocol Declarations
+
+#ifndef __ip_h
+#define __ip_h
+
+#include <network/ethernet.h>
+#include <network/arp.h>
+
+__BEGIN_SYS
+
+// Internet Protocol (RFC 791), version 4, over Ethernet
+// Packets travel inside the Ethernet::Buffers of the NIC they came from (or are to go through), so transport protocols
+// get references to the very frames in the NIC's DMA rings. Neither fragmentation nor options are supported on the
+// way out, and fragments are dropped on the way in. There is one IP object per NIC, with a static address.
+class IP: private Ethernet::Observer, public Data_Observed<Ethernet::Buffer, unsigned char>
+{
+    friend class Network;
+
+public:
+    typedef NIC<Ethernet> NIC_Family;
+    typedef Ethernet::Buffer Buffer;
+    typedef Ethernet::Address MAC_Address;
+
+    static const unsigned int UNITS = Traits<Ethernet>::UNITS;
+    static const Ethernet::Protocol PROTOCOL = Ethernet::IP;
+
+    // IP address (stored in network order)
+    class Address: public NIC_Common::Address<4>
+    {
+    private:
+        typedef NIC_Common::Address<4> Base;
+
+    public:
+        Address() {}
+        Address(const Null & n): Base(n) {}
+        Address(const Broadcast & b): Base(b) {}
+        Address(unsigned char a0, unsigned char a1, unsigned char a2, unsigned char a3) {
+            (*this)[0] = a0; (*this)[1] = a1; (*this)[2] = a2; (*this)[3] = a3;
+        }
+        Address(unsigned long a) { for(unsigned int i = 0; i < 4; i++) (*this)[i] = a >> (24 - i * 8); } // host order
+
+        unsigned long value() const { return (((*this)[0] << 24) | ((*this)[1] << 16) | ((*this)[2] << 8) | (*this)[3]) & 0xffffffffUL; }
+
+        Address operator&(const Address & mask) const { return Address(value() & mask.value()); }
+        Address operator|(const Address & mask) const { return Address(value() | mask.value()); }
+        Address operator~() const { return Address(~value()); }
+
+        friend OStream & operator<<(OStream & os, const Address & a) {
+            os << dec << static_cast<unsigned int>(a[0]) << "." << static_cast<unsigned int>(a[1]) << "." << static_cast<unsigned int>(a[2]) << "." << static_cast<unsigned int>(a[3]);
+            return os;
+        }
+    } __attribute__((packed));
+
+    // Transport protocol numbers
+    typedef unsigned char Protocol;
+    enum : Protocol {
+        ICMP    = 0x01,
+        TCP     = 0x06,
+        UDP     = 0x11
+    };
+
+    typedef Data_Observer<Buffer, Protocol> Observer;
+    typedef Data_Observed<Buffer, Protocol> Observed;
+
+    class Header
+    {
+    public:
+        static const unsigned int VERSION = 4;
+        static const unsigned short DF = 0x4000;   // don't fragment
+        static const unsigned short MF = 0x2000;   // more fragments
+        static const unsigned short OFFSET = 0x1fff;
+
+    public:
+        Header() {}
+        Header(const Address & from, const Address & to, const Protocol & prot, unsigned int size)
+        : _vhl((VERSION << 4) | (sizeof(Header) / 4)), _tos(0), _length(CPU::htons(sizeof(Header) + size)), _id(CPU::htons(CPU::finc(_next_id))),
+          _offset(CPU::htons(DF)), _ttl(Traits<IP>::TTL), _protocol(prot), _checksum(0), _from(from), _to(to) {}
+
+        unsigned int version() const { return _vhl >> 4; }
+        unsigned int hlength() const { return (_vhl & 0x0f) * 4; }
+        unsigned int length() const { return CPU::ntohs(_length); }
+        unsigned int ttl() const { return _ttl; }
+        Protocol protocol() const { return _protocol; }
+        bool fragmented() const { return CPU::ntohs(_offset) & (MF | OFFSET); }
+        const Address & from() const { return _from; }
+        const Address & to() const { return _to; }
+
+        void sign() { _checksum = 0; _checksum = checksum(this, hlength()); }
+
+        friend OStream & operator<<(OStream & os, const Header & h) {
+            os << "{v=" << h.version() << ",hl=" << h.hlength() << ",len=" << h.length() << ",id=" << CPU::ntohs(h._id) << ",ttl=" << h.ttl() << ",p=" << static_cast<unsigned int>(h._protocol) << ",from=" << h._from << ",to=" << h._to << "}";
+            return os;
+        }
+
+    protected:
+        unsigned char _vhl;
+        unsigned char _tos;
+        unsigned short _length;
+        unsigned short _id;
+        unsigned short _offset;
+        unsigned char _ttl;
+        Protocol _protocol;
+        unsigned short _checksum;
+        Address _from;
+        Address _to;
+
+        static volatile unsigned long _next_id;
+    } __attribute__((packed));
+
+    static const unsigned int MTU = Ethernet::MTU - sizeof(Header);
+
+    class Packet: public Header
+    {
+    public:
+        Header * header() { return this; }
+
+        template<typename T>
+        T * data() { return reinterpret_cast<T *>(reinterpret_cast<unsigned char *>(this) + hlength()); }
+    } __attribute__((packed));
+
+protected:
+    IP(NIC_Family * nic, unsigned int unit);
+
+public:
+    ~IP();
+
+    NIC_Family * nic() const { return _nic; }
+    const Address & address() const { return _address; }
+    const Address & netmask() const { return _netmask; }
+    const Address & gateway() const { return _gateway; }
+
+    bool local(const Address & a) const { return (a & _netmask) == (_address & _netmask); }
+    bool broadcast(const Address & a) const { return (a == Address(Address::BROADCAST)) || (a == (_address | ~_netmask)); }
+
+    // Buffers carrying packets with room for size bytes of payload, to be filled in place and sent
+    // The destination is resolved through ARP (which may block the caller), unless its MAC address is given
+    Buffer * alloc(const Address & to, const Protocol & prot, unsigned int size);
+    Buffer * alloc(const Address & to, const MAC_Address & mac, const Protocol & prot, unsigned int size);
+    int send(Buffer * buf);
+    void free(Buffer * buf) { _nic->free(buf); }
+
+    static Packet * packet(Buffer * buf) { return buf->frame()->data<Packet>(); }
+
+    static IP * get(unsigned int unit = 0) { return _networks[unit]; }
+    static IP * get(NIC_Family * nic);
+    static IP * route(const Address & to);
+
+    // Internet checksum (RFC 1071)
+    // Partial sums are kept unfolded, so a checksum can span several (even sized) pieces, such as pseudo headers,
+    // and be computed while data is copied into or out of a packet, saving a pass over it
+    static unsigned long sum(const void * data, unsigned int size, unsigned long partial = 0);
+    static unsigned long copy_and_sum(void * dst, const void * src, unsigned int size, unsigned long partial = 0);
+    static unsigned short fold(unsigned long partial) {
+        while(partial >> 16)
+            partial = (partial & 0xffff) + (partial >> 16);
+        return partial;
+    }
+    static unsigned short checksum(const void * data, unsigned int size) { return ~fold(sum(data, size)); }
+
+private:
+    void update(Ethernet::Observed * obs, const Ethernet::Protocol & prot, Buffer * buf);
+
+private:
+    unsigned int _unit;
+    NIC_Family * _nic;
+    ARP<NIC_Family, IP, Ethernet::HTYPE> * _arp;
+    Address _address;
+    Address _netmask;
+    Address _gateway;
+
+    static IP * _networks[UNITS];
+};
+
+__END_SYS
+
+#endif
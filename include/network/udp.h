@@ -0,0 +1,125 @@
+// EPOS UDP Protocol Declarations
+
+#ifndef __udp_h
+#define __udp_h
+
+#include <network/ip.h>
+
+__BEGIN_SYS
+
+// User Datagram Protocol (RFC 768)
+// Datagrams are handed to observers (see Port<UDP>) still inside the NIC's receive buffers. Checksums can be verified
+// in place (check()) or while the payload is copied out (copy()), and are computed while it is copied in (send()).
+class UDP: private IP::Observer, public Data_Observed<IP::Buffer, unsigned short>
+{
+    friend class Network;
+
+public:
+    typedef IP::Buffer Buffer;
+    typedef unsigned short Port_Id;
+
+    static const bool connectionless = true;
+
+    // UDP endpoint (IP address and port)
+    class Address
+    {
+    public:
+        Address() {}
+        Address(const IP::Address & ip, const Port_Id & port): _ip(ip), _port(port) {}
+
+        const IP::Address & ip() const { return _ip; }
+        const Port_Id & port() const { return _port; }
+
+        bool operator==(const Address & a) const { return (_ip == a._ip) && (_port == a._port); }
+        bool operator!=(const Address & a) const { return !(*this == a); }
+
+        friend OStream & operator<<(OStream & os, const Address & a) {
+            os << a._ip << ":" << dec << a._port;
+            return os;
+        }
+
+    private:
+        IP::Address _ip;
+        Port_Id _port;
+    };
+
+    typedef Data_Observer<Buffer, Port_Id> Observer;
+    typedef Data_Observed<Buffer, Port_Id> Observed;
+
+    class Header
+    {
+    public:
+        Header() {}
+        Header(const Port_Id & from, const Port_Id & to, unsigned int size)
+        : _from(CPU::htons(from)), _to(CPU::htons(to)), _length(CPU::htons(sizeof(Header) + size)), _checksum(0) {}
+
+        Port_Id from() const { return CPU::ntohs(_from); }
+        Port_Id to() const { return CPU::ntohs(_to); }
+        unsigned int length() const { return CPU::ntohs(_length); }
+
+        friend OStream & operator<<(OStream & os, const Header & h) {
+            os << "{sp=" << h.from() << ",dp=" << h.to() << ",len=" << h.length() << ",chk=" << hex << h._checksum << dec << "}";
+            return os;
+        }
+
+    protected:
+        Port_Id _from;
+        Port_Id _to;
+        unsigned short _length;
+        unsigned short _checksum;
+    } __attribute__((packed));
+
+    static const unsigned int MTU = IP::MTU - sizeof(Header);
+
+    class Datagram: public Header
+    {
+        friend class UDP;
+
+    public:
+        Header * header() { return this; }
+
+        template<typename T>
+        T * data() { return reinterpret_cast<T *>(&_data); }
+
+    private:
+        unsigned char _data[MTU];
+    } __attribute__((packed));
+
+protected:
+    UDP();
+
+public:
+    ~UDP();
+
+    // Datagrams leave through the interface IP::route() picks, with its address as source
+    // Zero-copy: alloc() a Buffer, fill in datagram(buf)->data(), send() it; received buffers are given back with free()
+    Buffer * alloc(const Port_Id & from, const Address & to, unsigned int size);
+    int send(Buffer * buf);
+    void free(Buffer * buf) { buf->nic()->free(buf); }
+
+    // Copying, with checksums computed while data is copied
+    int send(const Port_Id & from, const Address & to, const void * data, unsigned int size);
+
+    // Size and source of a received datagram, whose payload is only checksummed by check() or copy(),
+    // which return -1 if the checksum fails
+    static unsigned int size(Buffer * buf) { return datagram(buf)->length() - sizeof(Header); }
+    static Address from(Buffer * buf) { return Address(IP::packet(buf)->from(), datagram(buf)->from()); }
+    static bool check(Buffer * buf);
+    static int copy(Buffer * buf, Address * from, void * data, unsigned int size);
+
+    static Datagram * datagram(Buffer * buf) { return IP::packet(buf)->data<Datagram>(); }
+
+    static UDP * get() { return _udp; }
+
+private:
+    void update(IP::Observed * obs, const IP::Protocol & prot, Buffer * buf);
+
+    static unsigned long pseudo_sum(IP::Packet * packet);
+
+private:
+    static UDP * _udp;
+};
+
+__END_SYS
+
+#endif
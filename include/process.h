@@ -7,6 +7,7 @@
 #include <machine.h>
 #include <utility/queue.h>
 #include <utility/handler.h>
+#include <utility/profiler.h>
 #include <memory.h>
 #include <scheduler.h>
 
@@ -23,11 +24,13 @@ class Thread
     friend class Alarm;                 // for lock()
     friend class System;                // for init()
     friend class IC;                    // for link() for priority ceiling
+    friend class IPI;                   // for reschedule()
 
 protected:
     static const bool preemptive = Traits<Thread>::Criterion::preemptive;
     static const bool multitask = Traits<System>::multitask;
     static const bool reboot = Traits<System>::reboot;
+    static const bool collecting = Traits<Thread>::collect_statistics;
 
     static const unsigned int QUANTUM = Traits<Thread>::QUANTUM;
     static const unsigned int STACK_SIZE = multitask ? Traits<System>::STACK_SIZE : Traits<Application>::STACK_SIZE;
@@ -81,7 +84,7 @@ public:
     ~Thread();
 
     const volatile State & state() const { return _state; }
-    const volatile Criterion::Statistics & statistics() { return criterion().statistics(); }
+    Criterion::Statistics statistics();
 
     const volatile Criterion & priority() const { return _link.rank(); }
     void priority(const Criterion & p);
@@ -119,6 +122,23 @@ protected:
 
     static void dispatch(Thread * prev, Thread * next, bool charge = true);
 
+    // Statistics accounting (only if collecting)
+    void account_ready(bool wakeup = false) {
+        if(collecting) {
+            criterion().statistics().last_thread_ready = TSC::time_stamp();
+            if(wakeup)
+                criterion().statistics().wakeups++;
+        }
+    }
+    static void account_dispatch(Thread * prev, Thread * next);
+
+    // Profiling (only if Traits<Profiler>::enabled)
+    static void sample(CPU::Reg pc) {
+        Thread * r = running();
+        if(r)
+            Profiler::sample(&r->_counters, pc);
+    }
+
     static int idle();
 
 private:
@@ -134,6 +154,7 @@ protected:
     Queue * _waiting;
     Thread * volatile _joining;
     Queue::Element _link;
+    Profiler::Counters _counters;
 
     static volatile unsigned int _thread_count;
     static Scheduler_Timer * _timer;
@@ -204,11 +225,14 @@ public:
         Log_Addr dst_data = _current->address_space()->attach(_ds);
         memcpy(dst_code, src_code, task->code_segment()->size());
         memcpy(dst_data, src_data, task->data_segment()->size());
-        _current->address_space()->detach(_cs);
-        _current->address_space()->detach(_ds);
-        if(task != _current) {
-            _current->address_space()->detach(task->code_segment());
-            _current->address_space()->detach(task->data_segment());
+        {
+            MMU::Shootdown batch; // all these detach()es cost a single TLB flush
+            _current->address_space()->detach(_cs);
+            _current->address_space()->detach(_ds);
+            if(task != _current) {
+                _current->address_space()->detach(task->code_segment());
+                _current->address_space()->detach(task->data_segment());
+            }
         }
 
         // Reflag and map segments
@@ -61,25 +61,35 @@ public:
     static const bool system_wide = false;
     static const unsigned int QUEUES = 1;
 
-    // Runtime Statistics (for policies that don't use any; that´s why its a union)
-    union Statistics {
+    // Runtime Statistics
+    // Time stamps are in TSC ticks. Execution and scheduling statistics are only collected if Traits<Thread>::collect_statistics
+    struct Statistics {
         // Thread Execution Time
         TSC::Time_Stamp thread_execution_time;  // accumulated thread execution time
         TSC::Time_Stamp last_thread_dispatch;   // time stamp of last dispatch
 
+        // Thread Scheduling Latency
+        TSC::Time_Stamp thread_waiting_time;    // accumulated time spent READY before being dispatched
+        TSC::Time_Stamp max_thread_waiting_time;// longest time spent READY before being dispatched
+        TSC::Time_Stamp last_thread_ready;      // time stamp of the last transition to READY
+        unsigned int dispatches;                // number of times the thread got the CPU
+        unsigned int voluntary_switches;        // number of times the thread released the CPU (waiting, suspending, yielding or finishing)
+        unsigned int involuntary_switches;      // number of times the thread was preempted
+        unsigned int wakeups;                   // number of times the thread was woken up from a synchronizer queue
+
         // Deadline Miss count - Used By Clerk
         Alarm * alarm_times;                    // pointer to RT_Thread private alarm (for monitoring purposes)
         unsigned int finished_jobs;             // number of finished jobs given by the number of times alarm->p() was called for this thread
         unsigned int missed_deadlines;          // number of missed deadlines given by the number of finished jobs (finished_jobs) minus the number of dispatched jobs (alarm_times->times)
 
         // CPU Execution Time (capture ts)
-        static TSC::Time_Stamp _cpu_time[Traits<Build>::CPUS];              // accumulated CPU time in the current hyperperiod for each CPU
+        static TSC::Time_Stamp _cpu_time[Traits<Build>::CPUS];              // accumulated CPU time (i.e. not running IDLE) for each CPU
         static TSC::Time_Stamp _last_dispatch_time[Traits<Build>::CPUS];    // time Stamp of last dispatch in each CPU
         static TSC::Time_Stamp _last_activation_time;                       // global time stamp of the last heuristic activation
     };
 
 protected:
-    Scheduling_Criterion_Common() {}
+    Scheduling_Criterion_Common(): _statistics() {}
 
 public:
     const Microsecond period() { return 0;}
@@ -94,7 +104,7 @@ public:
     bool charge(bool end = false) { return true; }
     bool award(bool end = false) { return true; }
 
-    volatile Statistics & statistics() { return _statistics; }
+    Statistics & statistics() { return _statistics; }
 
     static void init() {}
 
@@ -0,0 +1,215 @@
+// EPOS Storage Declarations
+
+#ifndef __storage_h
+#define __storage_h
+
+#include <machine/block.h>
+#include <synchronizer.h>
+#include <utility/crc.h>
+#include <utility/string.h>
+
+__BEGIN_SYS
+
+// Log-structured key-value store on a region of a Block device
+// The region is split into segments of SEGMENT_SECTORS, which are written only sequentially and reused only as a whole,
+// so the device is never asked to update anything in place and writes get spread (round-robin) over all segments. Each
+// segment starts with a header sector bearing the segment's sequence number and holds batches of records, each batch
+// sector-aligned and protected by a CRC. put() and remove() append a record to the open batch and return once that batch
+// is on stable storage: whoever gets to write the log first commits everything appended meanwhile (group commit), so
+// concurrent writers share device writes and flushes. An index of all keys, kept in RAM, is only updated by commits.
+// A background thread compacts the segment with the fewest live bytes whenever free segments run low, copying its live
+// records to the head of the log and erasing its header; the last RESERVE free segments are left for compaction.
+// On construction, valid segments are replayed in sequence order, each up to its first invalid batch (e.g. one torn by
+// a crash), which rebuilds the index; later records supersede earlier ones and removals are logged as tombstones, which
+// compaction only drops once no older segment is left.
+class Log_Store
+{
+private:
+    static const unsigned int SECTOR = Block::SECTOR_SIZE;
+    static const unsigned int SEGMENT_SECTORS = Traits<Log_Store>::SEGMENT_SECTORS;
+    static const unsigned int BATCH_SECTORS = Traits<Log_Store>::BATCH_SECTORS;
+    static const unsigned int RESERVE = Traits<Log_Store>::RESERVE;
+    static const unsigned int ENTRIES = Traits<Log_Store>::ENTRIES;
+    static_assert(ENTRIES && !(ENTRIES & (ENTRIES - 1)), "the index masks hashes with ENTRIES - 1, so it must be a power of 2");
+
+    static const unsigned int SEGMENT_MAGIC = 0x53474f4c; // "LOGS"
+    static const unsigned int BATCH_MAGIC = 0x42474f4c; // "LOGB"
+
+    static const unsigned int NONE = ~0U;
+
+    typedef Block::Sector Sector;
+
+    // The first sector of each segment
+    struct Segment_Header
+    {
+        unsigned int magic;
+        unsigned int crc; // of sequence
+        unsigned long long sequence;
+    };
+
+    // Records follow the header, 8-byte aligned, up to bytes
+    struct Batch_Header
+    {
+        unsigned int magic;
+        unsigned int crc; // of sequence, bytes, records and the records themselves
+        unsigned long long sequence; // the segment's
+        unsigned int bytes;
+        unsigned int records;
+    };
+
+    // Followed by key_size bytes of key and size bytes of value
+    struct Record
+    {
+        enum { TOMBSTONE = 1 << 0 };
+
+        unsigned short key_size;
+        unsigned short flags;
+        unsigned int size;
+
+        unsigned char * key() { return reinterpret_cast<unsigned char *>(this + 1); }
+        unsigned char * value() { return key() + key_size; }
+        unsigned int length() const { return align(sizeof(Record) + key_size + size); }
+    };
+
+    struct Segment
+    {
+        enum State { FREE, SEALED, HEAD };
+
+        State state;
+        unsigned long long sequence;
+        unsigned int used;          // sectors, the header included
+        unsigned int live;          // bytes of records the index still points to
+        unsigned int generation;    // times the segment has been reused, so readers can tell
+    };
+
+    // A batch under construction, with room for a segment header in front of it
+    struct Batch
+    {
+        unsigned char * buffer;
+        unsigned int bytes;
+        unsigned int records;
+
+        Batch_Header * header() { return reinterpret_cast<Batch_Header *>(buffer + SECTOR); }
+        unsigned char * records_base() { return buffer + SECTOR + sizeof(Batch_Header); }
+        unsigned int sectors() const { return (sizeof(Batch_Header) + bytes + SECTOR - 1) / SECTOR; }
+        bool fits(unsigned int length) const { return sizeof(Batch_Header) + bytes + length <= BATCH_SECTORS * SECTOR; }
+    };
+
+    // Index slots (open addressing, linear probing)
+    struct Entry
+    {
+        enum { USED = 1 << 0, TOMBSTONE = 1 << 1 };
+
+        unsigned short flags;
+        unsigned short key_size;
+        unsigned int segment;
+        unsigned int offset;        // bytes from the beginning of the segment
+        unsigned int size;
+        unsigned char key[Traits<Log_Store>::MAX_KEY];
+    };
+
+public:
+    static const unsigned int MAX_KEY = Traits<Log_Store>::MAX_KEY;
+    static const unsigned int MAX_VALUE = BATCH_SECTORS * SECTOR - sizeof(Batch_Header) - sizeof(Record) - MAX_KEY;
+
+    // Statistics
+    struct Statistics
+    {
+        Statistics(): puts(0), removes(0), gets(0), commits(0), compactions(0), copied_bytes(0), recovered_records(0), torn_batches(0) {}
+
+        friend OStream & operator<<(OStream & os, const Statistics & s) {
+            os << "{put=" << s.puts << ",rm=" << s.removes << ",get=" << s.gets << ",cmt=" << s.commits << ",cpt=" << s.compactions
+               << ",cp=" << s.copied_bytes << "B,rec=" << s.recovered_records << ",torn=" << s.torn_batches << "}";
+            return os;
+        }
+
+        unsigned int puts;
+        unsigned int removes;
+        unsigned int gets;
+        unsigned int commits;           // batches written (puts / commits is the group commit factor)
+        unsigned int compactions;
+        unsigned long long copied_bytes;
+        unsigned int recovered_records;
+        unsigned int torn_batches;      // batches found invalid at the end of a segment on recovery
+    };
+
+public:
+    // sectors = 0 takes the device from first on
+    Log_Store(Block * device, const Sector & first = 0, const Sector & sectors = 0);
+    ~Log_Store();
+
+    // Return once the change is on stable storage (true), or false if it can't be done (e.g. no space left)
+    bool put(const void * key, unsigned int key_size, const void * value, unsigned int size);
+    bool put(const char * key, const void * value, unsigned int size) { return put(key, strlen(key), value, size); }
+    bool remove(const void * key, unsigned int key_size);
+    bool remove(const char * key) { return remove(key, strlen(key)); }
+
+    // Returns the size of the value (copying at most max bytes of it), or -1 if the key isn't there
+    int get(const void * key, unsigned int key_size, void * value, unsigned int max);
+    int get(const char * key, void * value, unsigned int max) { return get(key, strlen(key), value, max); }
+
+    unsigned int size() const { return _keys; }
+    unsigned int segments() const { return _segments_count; }
+    unsigned int free_segments() const { return _free; }
+    bool broken() const { return _broken; }
+
+    const Statistics & statistics() const { return _statistics; }
+
+private:
+    bool append(const void * key, unsigned int key_size, const void * value, unsigned int size, bool tombstone);
+    bool sync(unsigned int generation);
+    bool commit(Batch * batch, bool compacting);
+    bool open(bool compacting);
+    bool compact();
+    void recover();
+    void apply(unsigned char * records, unsigned int bytes, unsigned int segment, unsigned int offset);
+
+    Entry * lookup(const void * key, unsigned int key_size);
+    Entry * insert(const void * key, unsigned int key_size);
+    void erase(Entry * entry);
+
+    Sector sector(unsigned int segment, unsigned int offset = 0) const { return _first + Sector(segment) * SEGMENT_SECTORS + offset; }
+
+    static unsigned int align(unsigned int n) { return (n + 7) & ~7U; }
+    static unsigned int hash(const void * key, unsigned int key_size);
+
+    static int compactor(Log_Store * store);
+
+private:
+    Block * _device;
+    Sector _first;
+    unsigned int _segments_count;
+    Segment * _segments;
+    unsigned int _head;
+    unsigned int _free;
+    unsigned long long _sequence;
+
+    Batch _batches[2];
+    Batch * _open;                  // where put() and remove() append, protected by _lock
+    Batch _copies;                  // compaction output
+    unsigned char * _scan;          // recovery and compaction input
+    unsigned char * _read;          // get() input, protected by _reading
+    unsigned int _opened;           // batches opened for appends so far
+    unsigned int _committed;        // batches committed so far
+    unsigned long long _failed;     // whether each of the last 64 batches failed to be committed
+
+    Entry * _index;
+    unsigned int _keys;             // live keys
+    unsigned int _entries;          // used slots (live keys and tombstones)
+    unsigned int _reserved;         // records appended but not yet in the index
+
+    Mutex _lock;                    // index, open batch and statistics
+    Mutex _writer;                  // the log itself (segments and the device), held while committing or compacting
+    Mutex _reading;
+
+    Thread * _compactor;
+    Semaphore _wake;
+    volatile bool _stopping;
+    volatile bool _broken;
+
+    Statistics _statistics;
+};
+
+__END_SYS
+
+#endif
@@ -183,6 +183,19 @@ namespace EPOS {
 
 #define __UART_H                __HEADER_MACH(uart)
 #define __SPI_H                 __HEADER_MACH(spi)
+#define __NIC_H                 __HEADER_MACH(nic)
+#define __ethernet__
+#endif
+
+#ifdef __virt__
+#define __riscv__
+#define __TSC_H                 __HEADER_ARCH(tsc)
+#define __PMU_H                 __HEADER_ARCH(pmu)
+
+#define __UART_H                __HEADER_MACH(uart)
+#define __NIC_H                 __HEADER_MACH(virtio_net)
+#define __ethernet__
+#define __BLOCK_H               __HEADER_MACH(virtio_block)
 #endif
 
 #include <system/meta.h>
@@ -54,7 +54,8 @@ public:
         PAddr sys_code;         // OS Code segment
         PAddr sys_data;         // OS Data segment
         PAddr sys_stack;        // OS Stack segment  (used only during init and for ukernels, with one stack per core)
-        PAddr app_code;         // First Application code segment
+        PAddr app_code;         // First Application code segment (except for the pages mapped from the boot image)
+        PAddr app_code_image;   // First Application code pages mapped straight from the boot image (zero if none)
         PAddr app_data;         // First Application data segment (including heap, stack, and extra)
         PAddr app_extra;        // APP EXTRA segment (copied from the boot image)
         PAddr usr_mem_base;     // User-visible memory base address
@@ -106,6 +107,7 @@ public:
         Size  app_segments;
         LAddr app_code;
         Size  app_code_size;
+        Size  app_code_mapped;  // Bytes at the beginning of the code segment mapped from the boot image instead of copied
         LAddr app_data;
         Size  app_data_size;
         LAddr app_stack;
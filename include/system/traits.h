@@ -17,10 +17,12 @@ class Heaps;
 class Observers;
 class OStream;
 class Predictors;
+class Profiler;
 class Queues;
 class Random;
 class Spin;
 class SREC;
+class Tracer;
 class Vectors;
 template<typename> class Scheduler;
 
@@ -50,6 +52,7 @@ class Timer;
 class RTC;
 class UART;
 class SPI;
+class PDMA;
 class RS485;
 class USB;
 class EEPROM;
@@ -73,8 +76,13 @@ class RTL8139;
 class C905;
 class E100;
 class M95;
+class GEM;
+class VirtIO;
+class VirtIO_Net;
 class IEEE802_15_4_NIC;
 class Ethernet_NIC;
+class Block;
+class VirtIO_Block;
 
 // Transducer Mediators (i.e. sensors and actuators)
 class Transducers;
@@ -128,6 +136,8 @@ class Chronometer;
 class Alarm;
 class Delay;
 
+class Log_Store;
+
 template<typename T> class Clerk;
 class Monitor;
 
@@ -456,7 +466,7 @@ struct Traits_Tokens: public Transducer_Event, public System_Event, public PMU_E
     enum {eMote1, eMote2, STK500, RCX, Cortex, PC, Leon, Virtex, RISCV};
 
     // Machine models
-    enum {Unique, Legacy_PC, eMote3, LM3S811, Zynq, Realview_PBX, Raspberry_Pi3, SiFive_E, SiFive_U};
+    enum {Unique, Legacy_PC, eMote3, LM3S811, Zynq, Realview_PBX, Raspberry_Pi3, SiFive_E, SiFive_U, Virt};
 
     // Architecture endianness
     enum {LITTLE, BIG};
@@ -474,9 +484,9 @@ struct Traits_Tokens: public Transducer_Event, public System_Event, public PMU_E
     enum :unsigned char {NONE, LVP, DBP};
 };
 
-template<typename T>
-struct Traits {
-    // Traits for components that do not declare any
+// Traits for components that do not declare any
+struct Traits_Defaults
+{
     static const bool enabled = true;
     static const bool monitored = false;
     static const bool debugged = true;
@@ -485,6 +495,41 @@ struct Traits {
     typedef ALIST<> ASPECTS;
 };
 
+template<typename T>
+struct Traits: public Traits_Defaults {};
+
+// Network stack (see network.h), which System::init() brings up when there is more than one node, unless the
+// application declares Traits<Network> with enabled = false
+template<> struct Traits<IP>: public Traits_Defaults
+{
+    // Static configuration (host order), matching QEMU's user-mode network
+    static const unsigned long ADDRESS = 0x0a00020f; // 10.0.2.15
+    static const unsigned long NETMASK = 0xffffff00;
+    static const unsigned long GATEWAY = 0x0a000202; // 10.0.2.2
+
+    static const unsigned int TTL = 64;
+
+    static const unsigned int ARP_ENTRIES = 16;
+    static const unsigned int ARP_TRIES = 3;
+    static const unsigned int ARP_TIMEOUT = 1000000; // us
+};
+
+template<> struct Traits<UDP>: public Traits_Defaults
+{
+    static const bool checksum = true;
+    static const unsigned int RECEIVE_QUEUE = 8; // datagrams held per Port
+};
+
+// Log-structured key-value store (see storage.h)
+template<> struct Traits<Log_Store>: public Traits_Defaults
+{
+    static const unsigned int SEGMENT_SECTORS = 64; // 32 KB, written sequentially and compacted as a whole
+    static const unsigned int BATCH_SECTORS = 16; // 8 KB, the most a group commit writes at once
+    static const unsigned int RESERVE = 2; // free segments left for compaction
+    static const unsigned int ENTRIES = 1024; // index slots (must be a power of 2)
+    static const unsigned int MAX_KEY = 32; // bytes
+};
+
 __END_SYS
 
 #endif
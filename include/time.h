@@ -6,6 +6,7 @@
 #include <machine/rtc.h>
 #include <machine/timer.h>
 #include <process.h>
+#include <interrupt.h>
 #include <utility/queue.h>
 #include <utility/handler.h>
 
@@ -72,6 +73,7 @@ private:
     unsigned int _times;
     Tick _ticks;
     Queue::Element _link;
+    Tasklet _tasklet;
 
     static Alarm_Timer * _timer;
     static volatile Tick _elapsed;
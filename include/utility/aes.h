@@ -11,112 +11,119 @@
 __BEGIN_UTIL
 
 // EPOS 128-bit Advanced Encryption Standard (AES) Software Implementation
-// Adapted from https://github.com/kokke/tiny-AES128-C
+// Rounds use 32-bit T-tables (SubBytes, ShiftRows and MixColumns folded into four lookups per column), which are generated
+// at compile time. Table lookups depend on the data, so this implementation is not hardened against cache-timing attacks.
+// The expanded encryption and decryption keys are cached in the object and only recomputed when the key changes.
+// Besides the block interface (encrypt()/decrypt(), which in CBC mode chain across calls only if iv() asks for it), CTR
+// and GCM are offered as streaming modes that accept any number of calls with arbitrary lengths:
+//   CTR: key(k); ctr(counter_block); crypt(in, out, n) ...
+//   GCM: key(k); gcm(iv, iv_len); aad(a, n) ...; encrypt(in, out, n) ... or decrypt(in, out, n) ...; tag(t) or check(t)
 template<>
 class SWAES<16>: public AES_Common
 {
 private:
-    static const unsigned int Nb = 4; // number of columns comprising a _state
+    static const unsigned int Nb = 4; // number of columns comprising a state
     static const unsigned int Nk = 4; // number of 32 bit words in a key
-    static const int Nr = 10; // number of rounds in AES cipher
+    static const unsigned int Nr = 10; // number of rounds in AES cipher
+    static const unsigned int BLOCK_SIZE = 16;
 
-    typedef unsigned char State[4][4]; // array holding the intermediate results during decryption
+    typedef unsigned int Word;
+    typedef unsigned long long Half; // half of a GHASH element
 
 public:
     static const unsigned int KEY_SIZE = 16;
 
+    struct Tables {
+        Word te[4][256];
+        Word td[4][256];
+    };
+
 public:
-    SWAES(const Mode & m = ECB): _mode(m) {
-        assert((m == ECB) || (m == CBC));
-        for(unsigned int i = 0; i < 23; i++)
-            iv[i] = 0;
+    SWAES(const Mode & m = ECB): _mode(m), _keyed(false), _chaining(false) {
+        memset(_chain, 0, BLOCK_SIZE);
+        _offset = BLOCK_SIZE;
     }
 
     Mode mode() { return _mode; }
 
+    // Block interface (one 16-byte block per call)
     void encrypt(const unsigned char * data, const unsigned char * key, unsigned char * result) { crypt(data, key, result, true); }
     void decrypt(const unsigned char * data, const unsigned char * key, unsigned char * result) { crypt(data, key, result, false); }
 
-private:
-    void mode(const Mode & m) {
-        assert((m == ECB) || (m == CBC));
-        _mode = m;
-    }
+    // Sets the key (and expands it only if it has changed)
+    void key(const unsigned char * k);
 
-    void crypt(const unsigned char * data, const unsigned char * key, unsigned char * result, bool encrypt) {
-        db<Ciphers>(TRC) << "AES::" << (encrypt ? "en" : "de") << "crypt(data=" << data << ",key=" << key << ",result=" << result << endl;
-        db<Ciphers>(INF) << "AES::" << (encrypt ? "en" : "de") << "crypt:data = {" << int(data[0]);
-        for(unsigned int i = 1; i < 16; i++)
-            db<Ciphers>(INF) << "," << int(data[i]);
-        db<Ciphers>(INF) << "}" << endl;
-        db<Ciphers>(INF) << "AES::" << (encrypt ? "en" : "de") << "crypt:key = {" << int(key[0]);
-        for(unsigned int i = 1; i < 16; i++)
-            db<Ciphers>(INF) << "," << int(key[i]);
-        db<Ciphers>(INF) << "}" << endl;
-
-        switch(_mode) {
-        case CBC:
-            if(encrypt)
-                cbc_encrypt_buffer(result, data, 16, key, iv);
-            else
-                cbc_decrypt_buffer(result, data, 16, key, iv);
-            break;
-        case ECB:
-            if(encrypt)
-                ebc_encrypt(data, key, result);
-            else
-                ebc_decrypt(data, key, result);
-            break;
-        }
-
-        db<Ciphers>(INF) << "AES::" << (encrypt ? "en" : "de") << "crypt:result = {" << int(result[0]);
-        for(unsigned int i = 1; i < 16; i++)
-            db<Ciphers>(INF) << "," << int(result[i]);
-        db<Ciphers>(INF) << "}" << endl;
+    // Sets the CBC IV (zero by default), which every block call uses unless chaining is on, in which case each call
+    // takes the previous ciphertext block instead, so a message can be passed one block per call
+    void iv(const unsigned char * v, bool chaining = false) {
+        memcpy(_chain, v, BLOCK_SIZE);
+        _chaining = chaining;
     }
 
-    void cbc_encrypt_buffer(unsigned char * output, const unsigned char * input, int length, const unsigned char * key, unsigned char * iv);
-    void cbc_decrypt_buffer(unsigned char * output, const unsigned char * input, int length, const unsigned char * key, unsigned char * iv);
-    void ebc_encrypt(const unsigned char * input, const unsigned char * key, unsigned char *output);
-    void ebc_decrypt(const unsigned char * input, const unsigned char * key, unsigned char *output);
-
-    void expand_key();
-    void add_round_key(int round);
-    void sub_bytes();
-    void shift_rows();
-    void mix_columns();
-    void inv_mix_columns();
-    void inv_sub_bytes();
-    void inv_shift_rows();
-
-    void cipher();
-    void inv_cipher();
-
-    void block_copy(unsigned char * output, const unsigned char * input) { memcpy(output, input, KEY_SIZE); }
-
-    unsigned char xtime(unsigned char x) { return ((x<<1) ^ (((x>>7) & 1) * 0x1b)); }
-    unsigned char multiply(unsigned char x, unsigned char y) {
-        return (((y & 1) * x) ^
-                ((y >> 1 & 1) * xtime(x)) ^
-                ((y >> 2 & 1) * xtime(xtime(x))) ^
-                ((y >> 3 & 1) * xtime(xtime(xtime(x)))) ^
-                ((y >> 4 & 1) * xtime(xtime(xtime(xtime(x))))));
+    // CTR: starts a stream at the given 16-byte counter block (whose last 32 bits are incremented big-endian)
+    void ctr(const unsigned char * counter) {
+        _mode = CTR;
+        memcpy(_counter, counter, BLOCK_SIZE);
+        _offset = BLOCK_SIZE;
     }
+    void crypt(const unsigned char * input, unsigned char * output, unsigned long length);
+
+    // GCM: starts a message with the given IV (96 bits is the fast and recommended size)
+    void gcm(const unsigned char * iv, unsigned int iv_length = 12);
+    void aad(const unsigned char * data, unsigned long length);
+    void encrypt(const unsigned char * input, unsigned char * output, unsigned long length) { gcm_crypt(input, output, length, true); }
+    void decrypt(const unsigned char * input, unsigned char * output, unsigned long length) { gcm_crypt(input, output, length, false); }
+    void tag(unsigned char * tag, unsigned int length = 16);
+    bool check(const unsigned char * tag, unsigned int length = 16);
+
+private:
+    void mode(const Mode & m) { _mode = m; }
 
-    void xor_with_iv(unsigned char * buf) { for(unsigned int i = 0; i < KEY_SIZE; ++i) buf[i] ^= _iv[i]; }
+    void crypt(const unsigned char * data, const unsigned char * key, unsigned char * result, bool encrypt);
+
+    void expand_key(const unsigned char * key);
+    void encrypt_block(const unsigned char * input, unsigned char * output) const;
+    void decrypt_block(const unsigned char * input, unsigned char * output) const;
+
+    void next_keystream();
+    void gcm_crypt(const unsigned char * input, unsigned char * output, unsigned long length, bool encrypt);
+    void ghash_tables(const unsigned char * h);
+    void ghash(const unsigned char * block);
+    void ghash_byte(unsigned char b);
+    void ghash_flush();
+
+    static Word get(const unsigned char * p) { return (Word(p[0]) << 24) | (Word(p[1]) << 16) | (Word(p[2]) << 8) | Word(p[3]); }
+    static void put(unsigned char * p, Word w) { p[0] = w >> 24; p[1] = w >> 16; p[2] = w >> 8; p[3] = w; }
 
 private:
     Mode _mode;
 
-    State * _state;
-    unsigned char _round_key[176];
-    const unsigned char * _key;
-    unsigned char * _iv; // initial Vector used only for CBC mode
-    unsigned char iv[23];
+    bool _keyed;
+    unsigned char _key[KEY_SIZE];
+    Word _ek[Nb * (Nr + 1)];    // encryption round keys
+    Word _dk[Nb * (Nr + 1)];    // decryption round keys (equivalent inverse cipher)
+
+    unsigned char _chain[BLOCK_SIZE];   // CBC
+    bool _chaining;
+
+    unsigned char _counter[BLOCK_SIZE]; // CTR and GCM
+    unsigned char _keystream[BLOCK_SIZE];
+    unsigned int _offset;               // keystream bytes already used
+
+    Half _hl[16];                       // GCM: multiples of H for 4-bit GHASH
+    Half _hh[16];
+    unsigned char _j0[BLOCK_SIZE];
+    unsigned char _x[BLOCK_SIZE];       // GHASH accumulator
+    unsigned char _block[BLOCK_SIZE];   // GHASH input not yet hashed
+    unsigned int _block_length;
+    unsigned long long _aad_length;
+    unsigned long long _text_length;
 
     static const unsigned char sbox[256];
     static const unsigned char rsbox[256];
     static const unsigned char rcon[255];
+    static const Tables _tables;
+    static const Half _last4[16];
 };
 
 __END_UTIL
@@ -10,14 +10,26 @@ __BEGIN_UTIL
 // This class implements a prime finite field (Fp or GF(p))
 // It basically consists of (possibly) big numbers between 0 and a prime modulo, with + - * / operators
 // Primarily meant to be used primarily by asymmetric cryptography (e.g. Diffie-Hellman)
+// Digits (limbs) have the width of the machine's registers: 64 bits (with 128-bit products) where the compiler offers
+// __int128 (e.g. RV64 and ARMv8), 32 bits otherwise. Modular multiplication uses Montgomery reduction (REDC), whose
+// constants are derived from the modulo at compile time. operator*= keeps numbers in the ordinary representation at the
+// cost of a second reduction, while montgomery_multiply() and montgomery_square() work on numbers converted with
+// to_montgomery(), which is what long chains of multiplications (e.g. elliptic curve arithmetic) should use; + and - are
+// the same in both representations. Except for comparisons and invert(), operations on numbers below the modulo take the
+// same time whatever their values.
 template<unsigned int SIZE>
 class Bignum
 {
     template<typename Cipher> friend class Poly1305;
 
 public:
+#ifdef __SIZEOF_INT128__
+    typedef unsigned long long Digit;
+    typedef unsigned __int128 Double_Digit;
+#else
     typedef unsigned int Digit;
     typedef unsigned long long Double_Digit;
+#endif
 
     static const unsigned int DIGITS = (SIZE + sizeof(Digit) - 1) / sizeof(Digit);
     static const unsigned int BITS_PER_DIGIT = sizeof(Digit) * 8;
@@ -26,13 +38,10 @@ public:
     typedef Double_Digit Double_Word[DIGITS];
 
 private:
-    union _Word {
-        unsigned char bytes[sizeof(Word)];
-        Digit data[sizeof(Word) / sizeof(Digit)];
-    };
-    union _Barrett {
-        unsigned char bytes[sizeof(Word) + sizeof(Digit)];
-        Digit data[sizeof(Word) / sizeof(Digit)];
+    struct Modulo {
+        Word p;
+        Word r2;        // R^2 % p, with R = 2^(DIGITS * BITS_PER_DIGIT)
+        Digit inverse;  // -p^-1 % 2^BITS_PER_DIGIT
     };
 
 public:
@@ -43,7 +52,7 @@ public:
         for(unsigned int i = 0, j = 0; i < DIGITS; i++) {
             _data[i] = 0;
             for(unsigned int k = 0; k < sizeof(Digit) && j < len; k++, j++)
-                _data[i] += (reinterpret_cast<const unsigned char *>(bytes)[j] << (8 * k));
+                _data[i] += (Digit(reinterpret_cast<const unsigned char *>(bytes)[j]) << (8 * k));
         }
     }
 
@@ -87,56 +96,75 @@ public:
     bool  operator>(const Bignum & b) const { return (cmp(_data, b._data, DIGITS) > 0); }
     bool  operator<(const Bignum & b) const { return (cmp(_data, b._data, DIGITS) < 0); }
 
-    void operator*=(const Bignum & b) __attribute__((noinline)) { // _data = (_data * b._data) % _mod
-        if(b == 1) return;
-
+    void operator*=(const Bignum & b) __attribute__((noinline)) { // _data = (_data * b._data) % p
         if(Traits<Bignum>::hysterically_debugged) {
             db<Bignum>(TRC) << "Bignum::operator*=(this=" << *this << ",other=" << b << ",mod=[";
             for(unsigned int i = 0; i < DIGITS - 1; i++)
-                db<Bignum>(TRC) << _mod.data[i] << ",";
-            db<Bignum>(TRC) << _mod.data[DIGITS - 1] << "]) => ";
+                db<Bignum>(TRC) << _modulo.p[i] << ",";
+            db<Bignum>(TRC) << _modulo.p[DIGITS - 1] << "]) => ";
         }
 
-        Digit mult_result[2 * DIGITS];
-        simple_mult(mult_result, _data, b._data, DIGITS);
-        barrett_reduction(_data, mult_result, DIGITS);
+        // (a * b / R) * R^2 / R
+        montgomery_multiply(b._data);
+        montgomery_multiply(_modulo.r2);
 
         if(Traits<Bignum>::hysterically_debugged)
             db<Bignum>(TRC) << *this << endl;
     }
 
-    void operator+=(const Bignum &b)__attribute__((noinline)) { // _data = (_data + b._data) % _mod
+    void operator+=(const Bignum &b)__attribute__((noinline)) { // _data = (_data + b._data) % p
         if(Traits<Bignum>::hysterically_debugged) {
             db<Bignum>(TRC) << "Bignum::operator+=(this=" << *this << ",other=" << b << ",mod=[";
             for(unsigned int i = 0; i < DIGITS - 1; i++)
-                db<Bignum>(TRC) << _mod.data[i] << ",";
-            db<Bignum>(TRC) << _mod.data[DIGITS - 1] << "]) => ";
+                db<Bignum>(TRC) << _modulo.p[i] << ",";
+            db<Bignum>(TRC) << _modulo.p[DIGITS - 1] << "]) => ";
         }
 
-        if(simple_add(_data, _data, b._data, DIGITS))
-            simple_sub(_data, _data, _mod.data, DIGITS);
-        if(cmp(_data, _mod.data, DIGITS) >= 0)
-            simple_sub(_data, _data, _mod.data, DIGITS);
+        Word reduced;
+        Digit carry = simple_add(_data, _data, b._data, DIGITS);
+        Digit borrow = simple_sub(reduced, _data, _modulo.p, DIGITS);
+        select(_data, reduced, carry | (borrow ^ 1), DIGITS);
 
         if(Traits<Bignum>::hysterically_debugged)
             db<Bignum>(TRC) << *this << endl;
     }
 
-    void operator-=(const Bignum &b)__attribute__((noinline)) { // _data = (_data - b._data) % _mod
+    void operator-=(const Bignum &b)__attribute__((noinline)) { // _data = (_data - b._data) % p
         if(Traits<Bignum>::hysterically_debugged) {
             db<Bignum>(TRC) << "Bignum::operator-=(this=" << *this << ",other=" << b << ",mod=[";
             for(unsigned int i = 0; i < DIGITS - 1; i++)
-                db<Bignum>(TRC) << _mod.data[i] << ",";
-            db<Bignum>(TRC) << _mod.data[DIGITS - 1] << "]) => ";
+                db<Bignum>(TRC) << _modulo.p[i] << ",";
+            db<Bignum>(TRC) << _modulo.p[DIGITS - 1] << "]) => ";
         }
 
-        if(simple_sub(_data, _data, b._data, DIGITS))
-            simple_add(_data, _data, _mod.data, DIGITS);
+        Word wrapped;
+        Digit borrow = simple_sub(_data, _data, b._data, DIGITS);
+        simple_add(wrapped, _data, _modulo.p, DIGITS);
+        select(_data, wrapped, borrow, DIGITS);
 
         if(Traits<Bignum>::hysterically_debugged)
             db<Bignum>(TRC) << *this << endl;
     }
 
+    // Montgomery representation (x * R % p)
+    void to_montgomery() { montgomery_multiply(_modulo.r2); }
+    void from_montgomery() {
+        Word one = { 1 };
+        montgomery_multiply(one);
+    }
+
+    // _data = (_data * b._data / R) % p, with both operands in Montgomery representation
+    void montgomery_multiply(const Bignum & b) __attribute__((noinline)) { montgomery_multiply(b._data); }
+
+    void montgomery_square() __attribute__((noinline)) {
+        Digit product[2 * DIGITS];
+        simple_square(product, _data, DIGITS);
+        montgomery_reduction(_data, product);
+    }
+
+    // _data = condition ? b._data : _data, without branching on condition
+    void select(const Bignum & b, bool condition) { select(_data, b._data, condition, DIGITS); }
+
     // Shift left (actually shift right, because of little endianness)
     // - Does not apply modulo
     // - Returns carry bit
@@ -145,8 +173,8 @@ public:
         if(Traits<Bignum>::hysterically_debugged && !carry) {
             db<Bignum>(TRC) << "Bignum::multiply_by_two(this=" << *this << ",mod=[";
             for(unsigned int i = 0; i < DIGITS - 1; i++)
-                db<Bignum>(TRC) << _mod.data[i] << ",";
-            db<Bignum>(TRC) << _mod.data[DIGITS-1] << "]) => ";
+                db<Bignum>(TRC) << _modulo.p[i] << ",";
+            db<Bignum>(TRC) << _modulo.p[DIGITS-1] << "]) => ";
         }
 
         bool next_carry;
@@ -171,8 +199,8 @@ public:
         if(Traits<Bignum>::hysterically_debugged && !carry) {
             db<Bignum>(TRC) << "Bignum::divide_by_two(this=" << *this << ",mod=[";
             for(unsigned int i = 0; i < DIGITS - 1; i++)
-                db<Bignum>(TRC) << _mod.data[i] << ",";
-            db<Bignum>(TRC) << _mod.data[DIGITS-1] << "]) => ";
+                db<Bignum>(TRC) << _modulo.p[i] << ",";
+            db<Bignum>(TRC) << _modulo.p[DIGITS-1] << "]) => ";
         }
 
         bool next_carry;
@@ -189,20 +217,20 @@ public:
         return carry;
     }
 
-    void randomize() __attribute__((noinline)) { // Sets _data to a random number smaller than _mod
+    void randomize() __attribute__((noinline)) { // Sets _data to a random number smaller than p
         int i;
-        for(i = DIGITS - 1; i >= 0 && (_mod.data[i] == 0); i--)
+        for(i = DIGITS - 1; i >= 0 && (_modulo.p[i] == 0); i--)
             _data[i]=0;
-        _data[i] = Random::random() % _mod.data[i];
+        _data[i] = random_digit() % _modulo.p[i];
         for(--i; i >= 0; i--)
-            _data[i] = Random::random();
+            _data[i] = random_digit();
     }
 
-    void invert() __attribute__((noinline)) { // _data = i, such that (_data * i) % _mod = 1
+    void invert() __attribute__((noinline)) { // _data = i, such that (_data * i) % p = 1
         Bignum A(1), u, v, zero(0);
         for(unsigned int i = 0; i < DIGITS; i++) {
             u._data[i] = _data[i];
-            v._data[i] = _mod.data[i];
+            v._data[i] = _modulo.p[i];
         }
         *this = 0;
         while(u != zero) {
@@ -211,7 +239,7 @@ public:
                 if(A.is_even())
                     A.divide_by_two();
                 else {
-                    bool carry = simple_add(A._data, A._data, _mod.data, DIGITS);
+                    bool carry = simple_add(A._data, A._data, _modulo.p, DIGITS);
                     A.divide_by_two(carry);
                 }
             }
@@ -220,7 +248,7 @@ public:
                 if(is_even())
                     divide_by_two();
                 else {
-                    bool carry = simple_add(_data, _data, _mod.data, DIGITS);
+                    bool carry = simple_add(_data, _data, _modulo.p, DIGITS);
                     divide_by_two(carry);
                 }
             }
@@ -238,7 +266,7 @@ public:
         unsigned int i;
         out << '[';
         for(i=0;i<DIGITS;i++) {
-            out << (unsigned int)b._data[i];
+            out << b._data[i];
             if(i < DIGITS-1)
                 out << ", ";
         }
@@ -250,7 +278,7 @@ public:
         unsigned int i;
         out << '[';
         for(i = 0; i < DIGITS; i++) {
-            out << (unsigned int)b._data[i];
+            out << b._data[i];
             if(i < DIGITS - 1)
                 out << ", ";
         }
@@ -272,14 +300,12 @@ private:
     // -No modulo applied
     // -a, b and res are assumed to have size 'size'
     // -a, b, res are allowed to point to the same place
-    static bool simple_sub(Digit * res, const Digit * a, const Digit * b, unsigned int size) __attribute__((noinline)) {
-        Double_Digit borrow = 0;
-        Double_Digit aux = Double_Digit(1) << BITS_PER_DIGIT;
+    static Digit simple_sub(Digit * res, const Digit * a, const Digit * b, unsigned int size) __attribute__((noinline)) {
+        Digit borrow = 0;
         for(unsigned int i = 0; i < size; i++) {
-            Double_Digit anow = a[i];
-            Double_Digit bnow = Double_Digit(b[i]) + borrow;
-            borrow = (anow < bnow);
-            res[i] = borrow ? (aux - bnow) + anow : anow - bnow;
+            Double_Digit tmp = Double_Digit(a[i]) - b[i] - borrow;
+            res[i] = tmp;
+            borrow = Digit(tmp >> BITS_PER_DIGIT) & 1;
         }
         return borrow;
     }
@@ -289,8 +315,8 @@ private:
     // -No modulo applied
     // -a, b and res are assumed to have size 'size'
     // -a, b, res are allowed to point to the same place
-    static bool simple_add(Digit * res, const Digit * a, const Digit * b, unsigned int size) __attribute__((noinline)) {
-        bool carry = 0;
+    static Digit simple_add(Digit * res, const Digit * a, const Digit * b, unsigned int size) __attribute__((noinline)) {
+        Digit carry = 0;
         for(unsigned int i = 0; i < size; i++) {
             Double_Digit tmp = Double_Digit(carry) + Double_Digit(a[i]) + Double_Digit(b[i]);
             res[i] = tmp;
@@ -328,80 +354,126 @@ private:
         res[i] = r0;
     }
 
-    // res = a % _mod
-    // - Intended to be used after a multiplication
-    // - res is assumed to be of size 'size'
-    // - a is assumed to be of size '2*size'
-    void barrett_reduction(Digit * res, const Digit * a, unsigned int size) {
-        Digit q[size + 1];
+    // res = a * a
+    // - Each cross product a[i] * a[j] (i < j) is computed once and doubled, then the squares a[i]^2 are added
+    // - a is assumed to be of size 'size' and res of size '2*size'
+    static void simple_square(Digit * res, const Digit * a, unsigned int size) {
+        for(unsigned int i = 0; i < 2 * size; i++)
+            res[i] = 0;
 
-        // q = floor( ( floor( a/base^(size-1) ) * barrett_u ) / base^(size+1))
-        Double_Digit r0 = 0, r1 = 0, r2 = 0;
-        unsigned int i;
-        for(i = 0; i < (2 * (size + 1)) - 1; i++) {
-            for(unsigned int j = 0; (j < size + 1) && (j <= i); j++) {
-                unsigned int k = i - j;
-                if(k < size + 1) {
-                    // shifting left (little endian) size-1 places
-                    // a is assumed to have size size*2
-                    Double_Digit aj = a[j + (size - 1)];
-                    Double_Digit bk = _barrett_u.data[k];
-                    Double_Digit prod = aj * bk;
-                    r0 += Digit(prod);
-                    r1 += (prod >> BITS_PER_DIGIT) + (r0 >> BITS_PER_DIGIT);
-                    r0 = Digit(r0);
-                    r2 += r1 >> BITS_PER_DIGIT;
-                    r1 = Digit(r1);
-                }
+        for(unsigned int i = 0; i < size; i++) {
+            Digit carry = 0;
+            for(unsigned int j = i + 1; j < size; j++) {
+                Double_Digit tmp = Double_Digit(a[i]) * a[j] + res[i + j] + carry;
+                res[i + j] = tmp;
+                carry = tmp >> BITS_PER_DIGIT;
             }
-            // shifting left (little endian) size+1 places
-            if(i >= size + 1)
-                q[i - (size + 1)] = r0;
-            r0 = r1;
-            r1 = r2;
-            r2 = 0;
+            res[i + size] = carry;
         }
-        q[i - (size + 1)] = r0;
 
-        Digit r[size + 1];
-        // r = (q * _mod) % base^(size+1)
-        r0 = 0, r1 = 0, r2 = 0;
-        for(i = 0; i < size + 1; i++) {
-            for(unsigned int j = 0; j <= i; j++) {
-                unsigned int k = i - j;
-                Double_Digit aj = q[j];
-                Double_Digit bk = (k == size ? 0 : _mod.data[k]);
-                Double_Digit prod = aj * bk;
-                r0 += Digit(prod);
-                r1 += (prod >> BITS_PER_DIGIT) + (r0 >> BITS_PER_DIGIT);
-                r0 = Digit(r0);
-                r2 += r1 >> BITS_PER_DIGIT;
-                r1 = Digit(r1);
+        Digit carry = 0;
+        for(unsigned int i = 0; i < 2 * size; i++) {
+            Digit d = res[i];
+            res[i] = (d << 1) | carry;
+            carry = d >> (BITS_PER_DIGIT - 1);
+        }
+
+        carry = 0;
+        for(unsigned int i = 0; i < size; i++) {
+            Double_Digit tmp = Double_Digit(a[i]) * a[i] + res[2 * i] + carry;
+            res[2 * i] = tmp;
+            tmp = Double_Digit(res[2 * i + 1]) + Digit(tmp >> BITS_PER_DIGIT);
+            res[2 * i + 1] = tmp;
+            carry = tmp >> BITS_PER_DIGIT;
+        }
+    }
+
+    // res = c ? a : res
+    static void select(Digit * res, const Digit * a, Digit c, unsigned int size) {
+        Digit mask = Digit(0) - c;
+        for(unsigned int i = 0; i < size; i++)
+            res[i] ^= (res[i] ^ a[i]) & mask;
+    }
+
+    void montgomery_multiply(const Digit * b) {
+        Digit product[2 * DIGITS];
+        simple_mult(product, _data, b, DIGITS);
+        montgomery_reduction(_data, product);
+    }
+
+    // res = (t / R) % p (Montgomery reduction, separated operand scanning)
+    // - t is assumed to be of size '2*DIGITS' and smaller than p * R (e.g. a product of two numbers smaller than p)
+    // - t is destroyed
+    static void montgomery_reduction(Digit * res, Digit * t) {
+        Digit overflow = 0;
+        for(unsigned int i = 0; i < DIGITS; i++) {
+            // t += m * p * base^i, with m chosen to zero t[i]
+            Digit m = t[i] * _modulo.inverse;
+            Digit carry = 0;
+            for(unsigned int j = 0; j < DIGITS; j++) {
+                Double_Digit tmp = Double_Digit(m) * _modulo.p[j] + t[i + j] + carry;
+                t[i + j] = tmp;
+                carry = tmp >> BITS_PER_DIGIT;
             }
-            r[i] = r0;
-            r0 = r1;
-            r1 = r2;
-            r2 = 0;
+            for(unsigned int j = i + DIGITS; j < 2 * DIGITS; j++) {
+                Double_Digit tmp = Double_Digit(t[j]) + carry;
+                t[j] = tmp;
+                carry = tmp >> BITS_PER_DIGIT;
+            }
+            overflow += carry;
         }
 
-        // r = ((a % base^(size+1)) - r) % base^(size+1)
-        simple_sub(r, a, r, size+1);
+        // t / R < 2p, so a single (conditional) subtraction is enough
+        Digit borrow = simple_sub(res, &t[DIGITS], _modulo.p, DIGITS);
+        select(res, &t[DIGITS], borrow & (overflow ^ 1), DIGITS);
+    }
+
+    static Digit random_digit() {
+        Digit d;
+        Random::fill(&d, sizeof(Digit));
+        return d;
+    }
+
+    // Derives the Montgomery constants from the modulo's (little-endian) bytes, meant to initialize _modulo at compile time
+    static constexpr Modulo modulo(const unsigned char * bytes) {
+        Modulo m{};
+        for(unsigned int i = 0; i < SIZE; i++)
+            m.p[i / sizeof(Digit)] |= Digit(bytes[i]) << (8 * (i % sizeof(Digit)));
+
+        // Newton's iteration doubles the number of correct bits of p^-1 % base at each step (p is odd, so p * 1 = 1 % 2)
+        Digit inverse = 1;
+        for(unsigned int i = 1; i < BITS_PER_DIGIT; i *= 2)
+            inverse *= 2 - m.p[0] * inverse;
+        m.inverse = Digit(0) - inverse;
+
+        // R^2 % p, by doubling 1 modulo p 2 * log2(R) times
+        m.r2[0] = 1;
+        for(unsigned int n = 0; n < 2 * DIGITS * BITS_PER_DIGIT; n++) {
+            Digit carry = 0;
+            for(unsigned int i = 0; i < DIGITS; i++) {
+                Digit d = m.r2[i];
+                m.r2[i] = (d << 1) | carry;
+                carry = d >> (BITS_PER_DIGIT - 1);
+            }
 
-        // _data = r % _mod
-        while((r[size] > 0) || (cmp(r, _mod.data, size) >= 0)) {
-            if(simple_sub(r, r, _mod.data, size))
-                r[size]--;
+            Word reduced{};
+            Digit borrow = 0;
+            for(unsigned int i = 0; i < DIGITS; i++) {
+                reduced[i] = m.r2[i] - m.p[i] - borrow;
+                borrow = (m.r2[i] < m.p[i]) || ((m.r2[i] == m.p[i]) && borrow);
+            }
+            if(carry || !borrow)
+                for(unsigned int i = 0; i < DIGITS; i++)
+                    m.r2[i] = reduced[i];
         }
 
-        for(unsigned int i = 0; i < size; i++)
-            res[i] = r[i];
+        return m;
     }
 
 private:
     Word _data;
 
-    static const _Word _mod;
-    static const _Barrett _barrett_u;
+    static const Modulo _modulo;
 };
 
 __END_UTIL
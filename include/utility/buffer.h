@@ -153,6 +153,66 @@ private:
     unsigned int _tail;
     T _data[N_ELEMENTS];
 };
+
+// Single-producer, single-consumer lock-free Ring Buffer
+// Head is only written by the producer and tail only by the consumer, so no locks are needed as long as each side is
+// serialized by its owner (e.g. by disabling interrupts on the producer's CPU). N_ELEMENTS must be a power of 2.
+template<typename T, unsigned int N_ELEMENTS>
+class Ring_Buffer
+{
+private:
+    static const unsigned int MASK = N_ELEMENTS - 1;
+
+public:
+    typedef T Object_Type;
+
+public:
+    Ring_Buffer(): _head(0), _tail(0) { assert(!(N_ELEMENTS & MASK)); }
+
+    unsigned int size() const { return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE); }
+    unsigned int room() const { return N_ELEMENTS - size(); }
+    bool empty() const { return (size() == 0); }
+    bool full() const { return (size() == N_ELEMENTS); }
+
+    // Producer side
+    bool insert(const Object_Type & o) {
+        unsigned int head = _head;
+        if(head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) == N_ELEMENTS)
+            return false;
+        _data[head & MASK] = o;
+        __atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Inserts either all n objects or none of them
+    bool insert(const Object_Type * o, unsigned int n) {
+        unsigned int head = _head;
+        if(N_ELEMENTS - (head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE)) < n)
+            return false;
+        unsigned int i = head & MASK;
+        unsigned int first = (n < N_ELEMENTS - i) ? n : N_ELEMENTS - i;
+        memcpy(&_data[i], o, first * sizeof(T));
+        memcpy(&_data[0], o + first, (n - first) * sizeof(T));
+        __atomic_store_n(&_head, head + n, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Consumer side
+    bool remove(Object_Type * o) {
+        unsigned int tail = _tail;
+        if(__atomic_load_n(&_head, __ATOMIC_ACQUIRE) == tail)
+            return false;
+        *o = _data[tail & MASK];
+        __atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    unsigned int _head;
+    unsigned int _tail;
+    T _data[N_ELEMENTS];
+};
+
 __END_UTIL
 
 #endif
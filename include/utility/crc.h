@@ -5,28 +5,209 @@
 
 #include <system/config.h>
 
+// Carry-less multiplication is used for 32-bit reflected CRCs whenever the compiler is told the ISA has it
+#if defined(__riscv_zbc) && (__riscv_xlen == 64)
+#define __crc_clmul_zbc__
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define __crc_clmul_pmull__
+#endif
+
 __BEGIN_UTIL
 
-class CRC
+// CRC Engine
+// T defines the width (8, 16 or 32 bits) and POLY is given in the usual (non-reflected) form, e.g. 0x04c11db7 for CRC-32.
+// Objects accumulate a CRC over any number of buffers through update(); compute() does it for a single buffer.
+// Bytes are processed 8 at a time (slice-by-8) with tables generated at compile time, which are only instantiated for
+// the CRCs actually used (8 KB for a 32-bit CRC). Reflected 32-bit CRCs fold 8 bytes with two carry-less multiplications
+// (Barrett reduction) instead when Zbc (RISC-V) or PMULL (ARMv8) is available.
+template<typename T, T POLY, T INIT, bool REFLECTED, T XOROUT>
+class CRC_Engine
 {
+private:
+    static const unsigned int WIDTH = sizeof(T) * 8;
+    static const unsigned int SLICES = 8;
+
+    typedef unsigned long long Word;
+
+    struct Tables {
+        T t[SLICES][256];
+    };
+
+public:
+    typedef T Value;
+
 public:
-    static unsigned short crc16(char * ptr, int size) {
-        unsigned short crc = 0;
-
-        while(--size >= 0) {
-            crc ^= (unsigned short)(*ptr++) << 8;
-            int i = 8;
-            do{
-        	if(crc & 0x8000)
-        	    crc = (crc << 1) ^ 0x1021;
-        	else
-        	    crc = crc << 1;
-            } while(--i);
+    CRC_Engine(): _crc(REFLECTED ? reflect(INIT) : INIT) {}
+
+    void reset() { _crc = REFLECTED ? reflect(INIT) : INIT; }
+
+    void update(const void * data, unsigned long size) { _crc = update(_crc, reinterpret_cast<const unsigned char *>(data), size); }
+
+    T value() const { return _crc ^ XOROUT; }
+
+    static T compute(const void * data, unsigned long size) {
+        CRC_Engine crc;
+        crc.update(data, size);
+        return crc.value();
+    }
+
+private:
+    static T update(T crc, const unsigned char * p, unsigned long n) {
+#if defined(__crc_clmul_zbc__) || defined(__crc_clmul_pmull__)
+        if(REFLECTED && (WIDTH == 32))
+            return update_clmul(crc, p, n);
+#endif
+
+        for(; n >= SLICES; n -= SLICES, p += SLICES) {
+            unsigned char b[SLICES];
+            for(unsigned int i = 0; i < SLICES; i++)
+                b[i] = p[i];
+            for(unsigned int i = 0; i < WIDTH / 8; i++)
+                b[i] ^= REFLECTED ? (crc >> (8 * i)) : (crc >> (WIDTH - 8 - 8 * i));
+
+            T c = 0;
+            for(unsigned int i = 0; i < SLICES; i++)
+                c ^= _tables.t[SLICES - 1 - i][b[i]];
+            crc = c;
+        }
+
+        for(; n; n--, p++)
+            crc = step(crc, *p);
+
+        return crc;
+    }
+
+    static T step(T crc, unsigned char b) {
+        if(REFLECTED)
+            return shr8(crc) ^ _tables.t[0][(crc ^ b) & 0xff];
+        else
+            return shl8(crc) ^ _tables.t[0][((crc >> (WIDTH - 8)) ^ b) & 0xff];
+    }
+
+    // Shifts that are defined for any width (shifting an 8-bit T by 8 would promote, not clear it)
+    static constexpr T shr8(T v) { return (WIDTH > 8) ? T(v >> 8) : 0; }
+    static constexpr T shl8(T v) { return (WIDTH > 8) ? T(v << 8) : 0; }
+
+    static constexpr T reflect(T v) {
+        T r = 0;
+        for(unsigned int i = 0; i < WIDTH; i++)
+            if(v & (T(1) << i))
+                r |= T(1) << (WIDTH - 1 - i);
+        return r;
+    }
+
+    static constexpr Tables tables() {
+        Tables tab{};
+        const T poly = REFLECTED ? reflect(POLY) : POLY;
+        const T top = T(1) << (WIDTH - 1);
+
+        for(unsigned int i = 0; i < 256; i++) {
+            T c = REFLECTED ? T(i) : T(T(i) << (WIDTH - 8));
+            for(unsigned int j = 0; j < 8; j++)
+                if(REFLECTED)
+                    c = (c & 1) ? T((c >> 1) ^ poly) : T(c >> 1);
+                else
+                    c = (c & top) ? T(T(c << 1) ^ poly) : T(c << 1);
+            tab.t[0][i] = c;
+        }
+
+        // Slice k holds the effect of a byte followed by k zero bytes
+        for(unsigned int k = 1; k < SLICES; k++)
+            for(unsigned int i = 0; i < 256; i++) {
+                T c = tab.t[k - 1][i];
+                if(REFLECTED)
+                    tab.t[k][i] = shr8(c) ^ tab.t[0][c & 0xff];
+                else
+                    tab.t[k][i] = shl8(c) ^ tab.t[0][(c >> (WIDTH - 8)) & 0xff];
+            }
+
+        return tab;
+    }
+
+#if defined(__crc_clmul_zbc__) || defined(__crc_clmul_pmull__)
+    // Quotient of x^96 / P, whose x^64 term is implicit, bit-reflected to match the data
+    static constexpr Word quotient() {
+        Word q = 0;
+        Word r = Word(1) << 32;
+        for(int i = 64; i >= 0; i--) {
+            if(r & (Word(1) << 32)) {
+                r ^= (Word(1) << 32) | Word(POLY);
+                if(i < 64)
+                    q |= Word(1) << i;
+            }
+            r <<= 1;
         }
 
+        Word rq = 0;
+        for(unsigned int i = 0; i < 64; i++)
+            if(q & (Word(1) << i))
+                rq |= Word(1) << (63 - i);
+        return rq;
+    }
+
+    // 64 x 64 -> 128-bit carry-less product
+    static Word clmul(Word a, Word b, Word * hi) {
+        Word lo;
+#if defined(__crc_clmul_zbc__)
+        ASM("clmul %0, %1, %2" : "=r"(lo) : "r"(a), "r"(b));
+        ASM("clmulh %0, %1, %2" : "=r"(*hi) : "r"(a), "r"(b));
+#else
+        ASM("fmov d0, %2            \n"
+            "fmov d1, %3            \n"
+            "pmull v0.1q, v0.1d, v1.1d \n"
+            "fmov %0, d0            \n"
+            "mov %1, v0.d[1]        \n" : "=r"(lo), "=r"(*hi) : "r"(a), "r"(b) : "v0", "v1");
+#endif
+        return lo;
+    }
+
+    // Reduces 8 bytes (already xored with the CRC) with two multiplications:
+    // crc = low 32 bits of ((S * QT) / x^64 + S) * P, all in the reflected domain
+    static T fold(Word s) {
+        static const Word QT = quotient();
+        static const Word P = Word(reflect(POLY)) << 32;
+
+        Word hi;
+        Word t = (clmul(s, QT, &hi) << 1) ^ s;
+        Word lo = clmul(t, P, &hi);
+        return ((hi << 1) | (lo >> 63)) >> 32;
+    }
+
+    static T update_clmul(T crc, const unsigned char * p, unsigned long n) {
+        for(; n && (reinterpret_cast<unsigned long>(p) & (sizeof(Word) - 1)); n--, p++)
+            crc = step(crc, *p);
+
+        for(; n >= sizeof(Word); n -= sizeof(Word), p += sizeof(Word))
+            crc = fold(crc ^ *reinterpret_cast<const Word *>(p)); // both ISAs are little-endian here
+
+        for(; n; n--, p++)
+            crc = step(crc, *p);
+
         return crc;
     }
+#endif
+
+private:
+    T _crc;
 
+    static constexpr Tables _tables = tables();
+};
+
+template<typename T, T POLY, T INIT, bool REFLECTED, T XOROUT>
+constexpr typename CRC_Engine<T, POLY, INIT, REFLECTED, XOROUT>::Tables CRC_Engine<T, POLY, INIT, REFLECTED, XOROUT>::_tables;
+
+typedef CRC_Engine<unsigned short, 0x1021, 0x0000, false, 0x0000> CRC16_XMODEM;
+typedef CRC_Engine<unsigned short, 0x1021, 0xffff, false, 0x0000> CRC16_CCITT;
+typedef CRC_Engine<unsigned int, 0x04c11db7, 0xffffffff, true, 0xffffffff> CRC32;
+typedef CRC_Engine<unsigned int, 0x1edc6f41, 0xffffffff, true, 0xffffffff> CRC32C;
+
+class CRC
+{
+public:
+    static unsigned short crc16(char * ptr, int size) { return (size > 0) ? CRC16_XMODEM::compute(ptr, size) : 0; }
+    static unsigned short crc16_ccitt(const void * ptr, unsigned long size) { return CRC16_CCITT::compute(ptr, size); }
+    static unsigned int crc32(const void * ptr, unsigned long size) { return CRC32::compute(ptr, size); }
+    static unsigned int crc32c(const void * ptr, unsigned long size) { return CRC32C::compute(ptr, size); }
 };
 
 __END_UTIL
@@ -38,9 +38,16 @@ private:
         }
 
     private:
+        // Window width of operator*=, whose table holds the ENTRIES odd multiples P, 3P, ..., (2^W - 1)P
+        static const unsigned int W = 4;
+        static const unsigned int ENTRIES = 1 << (W - 1);
+
         void jacobian_double();
         void add_jacobian_affine(const Elliptic_Curve_Point &b);
 
+        static void invert(Coordinate & a);
+        static void normalize(Elliptic_Curve_Point * points, unsigned int n);
+
     public:
         Coordinate x, y, z;
     };
@@ -115,62 +122,133 @@ const char Diffie_Hellman<Cipher>::_default_base_point_y[SECRET_SIZE] =
  '\x39', '\xC8', '\x5A', '\xCF'
 };
 
+// Scalar multiplication (this = b * this), for an affine (z = 1) point
+// Fixed W-bit windows over odd signed digits: b (made odd) = sum(d_i * 2^(W * i)), with every d_i odd and in
+// [-(2^W - 1), 2^W - 1]. Each window then costs exactly W doublings and one addition of a point selected by scanning a
+// table of P, 3P, ..., (2^W - 1)P, so neither the sequence of operations nor the memory accesses depend on the bits of b.
+// Coordinates stay in Montgomery representation until the result is converted back to affine coordinates.
 template<typename Cipher>
 void Diffie_Hellman<Cipher>::Elliptic_Curve_Point::operator*=(const Coordinate & b)
 {
-    // Finding last '1' bit of b
-    static const unsigned int bits_in_digit = sizeof(typename Coordinate::Digit) * 8;
+    typedef typename Coordinate::Digit Digit;
 
-    typename Coordinate::Digit now;
-    unsigned int b_len = sizeof(Coordinate) / sizeof(typename Coordinate::Digit);
-    for(; (b_len > 1) && (b[b_len - 1] == 0); b_len--);
-    if((b_len == 0) || (b[b_len - 1] == 0)) {
+    static const unsigned int WINDOWS = (SECRET_SIZE * 8 + W - 1) / W;
+    static const unsigned int LIMBS = Coordinate::DIGITS;
+    static const unsigned int BITS_PER_LIMB = Coordinate::BITS_PER_DIGIT;
+
+    if(b == Coordinate(0)) {
         x = 0;
         y = 0;
         z = 0;
         return;
     }
 
-    now = b[b_len - 1];
-
-    bool bin[bits_in_digit]; // Binary representation of 'now'
-    unsigned int current_bit = bits_in_digit;
-
-    Elliptic_Curve_Point pp(*this);
+    // Recoding: each step takes the low W + 1 bits of the (odd) scalar s as d = s % 2^(W + 1) - 2^W and then
+    // s = (s - d) / 2^W, which is odd again; since b < 2^(W * WINDOWS), the remaining s is 1 after WINDOWS steps
+    Digit s[LIMBS];
+    for(unsigned int i = 0; i < LIMBS; i++)
+        s[i] = b[i];
+    bool even = !(s[0] & 1);
+    s[0] |= 1; // b + 1 when b is even, corrected at the end
+
+    signed char digits[WINDOWS];
+    for(unsigned int i = 0; i < WINDOWS; i++) {
+        digits[i] = int(s[0] & ((1 << (W + 1)) - 1)) - (1 << W);
+        s[0] = (s[0] & ~Digit((1 << (W + 1)) - 1)) | (1 << W);
+        for(unsigned int j = 0; j < LIMBS; j++)
+            s[j] = (s[j] >> W) | ((j + 1 < LIMBS) ? (s[j + 1] << (BITS_PER_LIMB - W)) : 0);
+    }
 
-    for(int i = bits_in_digit - 1; i >= 0; i--) {
-        if(now % 2)
-            current_bit = i + 1;
-        bin[i] = now % 2;
-        now /= 2;
+    // table[i] = (2i + 1) * P, in affine coordinates
+    Elliptic_Curve_Point table[ENTRIES];
+    table[0] = *this;
+    table[0].x.to_montgomery();
+    table[0].y.to_montgomery();
+    table[0].z.to_montgomery();
+    Elliptic_Curve_Point twice(table[0]);
+    twice.jacobian_double();
+    normalize(&twice, 1);
+    for(unsigned int i = 1; i < ENTRIES; i++) {
+        table[i] = table[i - 1];
+        table[i].add_jacobian_affine(twice);
     }
+    normalize(&table[1], ENTRIES - 1);
 
-    for(int i = b_len - 1; i >= 0; i--) {
-        for(; current_bit < bits_in_digit; current_bit++) {
+    *this = table[0]; // the top digit
+    for(int i = WINDOWS - 1; i >= 0; i--) {
+        for(unsigned int j = 0; j < W; j++)
             jacobian_double();
-            if(bin[current_bit])
-                add_jacobian_affine(pp);
-        }
-        if(i > 0) {
-            now = b[i-1];
-            for(int j = bits_in_digit-1; j >= 0; j--) {
-                bin[j] = now % 2;
-                now /= 2;
-            }
-            current_bit = 0;
+
+        int mask = digits[i] >> 7;
+        unsigned int index = ((digits[i] ^ mask) - mask) >> 1;
+
+        Elliptic_Curve_Point q(table[0]);
+        for(unsigned int j = 1; j < ENTRIES; j++) {
+            q.x.select(table[j].x, j == index);
+            q.y.select(table[j].y, j == index);
         }
+        Coordinate negative(0);
+        negative -= q.y;
+        q.y.select(negative, mask);
+
+        add_jacobian_affine(q);
     }
 
-    Coordinate Z;
-    z.invert();
-    Z = z;
-    Z *= z;
+    Elliptic_Curve_Point corrected(*this);
+    Coordinate negative(0);
+    negative -= table[0].y;
+    table[0].y = negative;
+    corrected.add_jacobian_affine(table[0]);
+    x.select(corrected.x, even);
+    y.select(corrected.y, even);
+    z.select(corrected.z, even);
+
+    normalize(this, 1);
+    x.from_montgomery();
+    y.from_montgomery();
+    z = 1;
+}
 
-    x *= Z;
-    Z *= z;
+// Converts n points in Jacobian coordinates to affine ones (z = 1) with a single inversion (Montgomery's trick);
+// n is at most ENTRIES - 1, the rest of the window table
+template<typename Cipher>
+void Diffie_Hellman<Cipher>::Elliptic_Curve_Point::normalize(Elliptic_Curve_Point * points, unsigned int n)
+{
+    assert((n > 0) && (n < ENTRIES));
 
-    y *= Z;
-    z = 1;
+    Coordinate prefix[ENTRIES - 1];
+    prefix[0] = points[0].z;
+    for(unsigned int i = 1; i < n; i++) {
+        prefix[i] = prefix[i - 1];
+        prefix[i].montgomery_multiply(points[i].z);
+    }
+
+    Coordinate inverse(prefix[n - 1]);
+    invert(inverse);
+
+    for(int i = n - 1; i >= 0; i--) {
+        Coordinate zi(inverse); // 1 / points[i].z
+        if(i > 0) {
+            zi.montgomery_multiply(prefix[i - 1]);
+            inverse.montgomery_multiply(points[i].z);
+        }
+
+        Coordinate zi2(zi);
+        zi2.montgomery_square();
+        points[i].x.montgomery_multiply(zi2);
+        zi2.montgomery_multiply(zi);
+        points[i].y.montgomery_multiply(zi2);
+        points[i].z = 1;
+        points[i].z.to_montgomery();
+    }
+}
+
+template<typename Cipher>
+void Diffie_Hellman<Cipher>::Elliptic_Curve_Point::invert(Coordinate & a)
+{
+    a.from_montgomery();
+    a.invert();
+    a.to_montgomery();
 }
 
 template<typename Cipher>
@@ -178,23 +256,23 @@ void Diffie_Hellman<Cipher>::Elliptic_Curve_Point::jacobian_double()
 {
     Coordinate B, C(x), aux(z);
 
-    aux *= z; C -= aux;
-    aux += x; C *= aux;
-    C *= 3;
+    aux.montgomery_square(); C -= aux;
+    aux += x; C.montgomery_multiply(aux);
+    B = C; C += B; C += B;
 
-    z *= y; z *= 2;
+    z.montgomery_multiply(y); z += z;
 
-    y *= y; B = y;
+    y.montgomery_square(); B = y;
 
-    y *= x; y *= 4;
+    y.montgomery_multiply(x); y += y; y += y;
 
-    B *= B; B *= 8;
+    B.montgomery_square(); B += B; B += B; B += B;
 
-    x = C; x *= x;
-    aux = y; aux *= 2;
+    x = C; x.montgomery_square();
+    aux = y; aux += aux;
     x -= aux;
 
-    y -= x; y *= C;
+    y -= x; y.montgomery_multiply(C);
     y -= B;
 }
 
@@ -203,39 +281,37 @@ void Diffie_Hellman<Cipher>::Elliptic_Curve_Point::add_jacobian_affine(const Ell
 {
     Coordinate A(z), B, C, X, Y, aux, aux2;
 
-    A *= z;
+    A.montgomery_square();
 
     B = A;
 
-    A *= b.x;
+    A.montgomery_multiply(b.x);
 
-    B *= z; B *= b.y;
+    B.montgomery_multiply(z); B.montgomery_multiply(b.y);
 
     C = A; C -= x;
 
     B -= y;
 
-    X = B; X *= B;
-    aux = C; aux *= C;
+    X = B; X.montgomery_square();
+    aux = C; aux.montgomery_square();
 
     Y = aux;
 
-    aux2 = aux; aux *= C;
-    aux2 *= 2; aux2 *= x;
+    aux2 = aux; aux.montgomery_multiply(C);
+    aux2 += aux2; aux2.montgomery_multiply(x);
     aux += aux2; X -= aux;
 
-    aux = Y; Y *= x;
-    Y -= X; Y *= B;
-    aux *= y; aux *= C;
+    aux = Y; Y.montgomery_multiply(x);
+    Y -= X; Y.montgomery_multiply(B);
+    aux.montgomery_multiply(y); aux.montgomery_multiply(C);
     Y -= aux;
 
-    z *= C;
+    z.montgomery_multiply(C);
 
     x = X; y = Y;
 }
 
-
-
 __END_UTIL
 
 #endif
@@ -85,9 +85,16 @@ public:
         }
     }
 
-    long load_segment(unsigned int i, Elf_Addr addr = 0);
+    // Page-granular loading: returns how many bytes, starting at the page-aligned address addr, are backed by whole pages
+    // of the file whose offsets are congruent with their addresses, and can therefore be mapped straight from the image
+    // instead of being copied. *offset gets the offset of the first such page in the file.
+    unsigned long mappable(Elf_Addr addr, unsigned long page_size, unsigned long * offset);
 
-    void load(Loadable * obj);
+    long load_segment(unsigned int i, Elf_Addr addr = 0, unsigned long skip = 0);
+
+    // Pages in [mapped, mapped + mapped_size) are assumed to be already mapped from the image (see mappable()) and are
+    // not copied; only what is left of the segments is copied and their .bss zeroed
+    void load(Loadable * obj, Elf_Addr mapped = 0, unsigned long mapped_size = 0);
 
 private:
     Elf_Phdr * pht() { return (Elf_Phdr *)(((char *) this) + e_phoff); }
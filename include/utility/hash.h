@@ -4,6 +4,7 @@
 #define	__hash_h
 
 #include <system/config.h>
+#include "string.h"
 #include "list.h"
 #include "vector.h"
 
@@ -205,6 +206,249 @@ private:
     List _table[SIZE];
 };
 
+
+// Hash function for keys that fit in a machine word (integers and pointers)
+// FxHash-style multiplication by a large odd constant, whose high half is then folded into the low one, since the low
+// bits of a product depend only on the low bits of the key (which are all zero for aligned pointers) and the low bits
+// are the ones that select the bucket in power-of-two tables.
+class Fx_Hash
+{
+private:
+    static const unsigned long K = static_cast<unsigned long>(0x517cc1b727220a95ULL);
+
+public:
+    template<typename Key>
+    static unsigned long hash(const Key & key) {
+        unsigned long h = (unsigned long)(key) * K;
+        return h ^ (h >> (sizeof(unsigned long) * 4));
+    }
+};
+
+
+// Hash function for byte strings, and for keys of any other type through their object representation (wyhash)
+class Wy_Hash
+{
+private:
+    typedef unsigned long long Word;
+
+    static const Word S0 = 0xa0761d6478bd642fULL;
+    static const Word S1 = 0xe7037ed1a0b428dbULL;
+    static const Word S2 = 0x8ebc6af09c88c6dbULL;
+    static const Word S3 = 0x589965cc75374cc3ULL;
+
+public:
+    static unsigned long hash(const void * data, unsigned long size, Word seed = 0) {
+        const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+        Word a, b;
+
+        seed ^= mix(seed ^ S0, S1);
+        if(size <= 16) {
+            if(size >= 4) {
+                a = (read4(p) << 32) | read4(p + ((size >> 3) << 2));
+                b = (read4(p + size - 4) << 32) | read4(p + size - 4 - ((size >> 3) << 2));
+            } else if(size > 0) {
+                a = (Word(p[0]) << 16) | (Word(p[size >> 1]) << 8) | p[size - 1];
+                b = 0;
+            } else
+                a = b = 0;
+        } else {
+            unsigned long i = size;
+            if(i > 48) {
+                Word see1 = seed, see2 = seed;
+                do {
+                    seed = mix(read8(p) ^ S1, read8(p + 8) ^ seed);
+                    see1 = mix(read8(p + 16) ^ S2, read8(p + 24) ^ see1);
+                    see2 = mix(read8(p + 32) ^ S3, read8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while(i > 48);
+                seed ^= see1 ^ see2;
+            }
+            for(; i > 16; i -= 16, p += 16)
+                seed = mix(read8(p) ^ S1, read8(p + 8) ^ seed);
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+
+        a ^= S1;
+        b ^= seed;
+        mum(&a, &b);
+        return mix(a ^ S0 ^ size, b ^ S1);
+    }
+
+    template<typename Key>
+    static unsigned long hash(const Key & key) { return hash(&key, sizeof(Key)); }
+
+private:
+    // a, b = low and high halves of a * b
+    static void mum(Word * a, Word * b) {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 r = static_cast<unsigned __int128>(*a) * *b;
+        *a = r;
+        *b = r >> 64;
+#else
+        Word ha = *a >> 32, la = static_cast<unsigned int>(*a);
+        Word hb = *b >> 32, lb = static_cast<unsigned int>(*b);
+        Word hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+        Word t = ll + (hl << 32);
+        Word lo = t + (lh << 32);
+        Word carry = (t < ll) + (lo < t);
+        *a = lo;
+        *b = hh + (hl >> 32) + (lh >> 32) + carry;
+#endif
+    }
+
+    static Word mix(Word a, Word b) {
+        mum(&a, &b);
+        return a ^ b;
+    }
+
+    // All supported architectures are little-endian
+    static Word read8(const unsigned char * p) { Word w; memcpy(&w, p, sizeof(w)); return w; }
+    static Word read4(const unsigned char * p) { unsigned int w; memcpy(&w, p, sizeof(w)); return w; }
+};
+
+
+// Hash Map with open addressing and Robin Hood linear probing
+// Keys and objects are stored in place in a table of SIZE (a power of two) slots, indexed by masking H::hash(key). A
+// separate array keeps each slot's distance from its home slot, so probing scans bytes instead of entries. Insertion
+// makes an entry take the slot of any entry that is closer to its own home, which keeps the variance of the probe
+// lengths small and lets searches stop at the first slot whose entry is closer to home than the key would be. Removal
+// shifts the rest of the cluster one slot back, so no tombstones are left behind. There is no rehashing: SIZE bounds the
+// number of entries, and probes stay short below ~90% of it.
+template<typename Key, typename T, unsigned int SIZE, typename H = Fx_Hash>
+class Hash_Map
+{
+private:
+    static const unsigned int MASK = SIZE - 1;
+    static_assert(SIZE && !(SIZE & (SIZE - 1)), "slots are indexed and probed by masking with SIZE - 1, so SIZE must be a power of 2");
+
+    typedef unsigned short Distance; // probe length + 1, 0 for empty slots
+    static const Distance EMPTY = 0;
+
+public:
+    typedef Key Key_Type;
+    typedef T Object_Type;
+
+    class Entry
+    {
+        friend class Hash_Map;
+
+    public:
+        const Key & key() const { return _key; }
+        T & object() { return _object; }
+        const T & object() const { return _object; }
+
+    private:
+        Key _key;
+        T _object;
+    };
+
+    class Forward
+    {
+    public:
+        Forward(Hash_Map * map, unsigned int slot): _map(map), _slot(slot) { skip(); }
+
+        Entry & operator*() const { return _map->_entries[_slot]; }
+        Entry * operator->() const { return &_map->_entries[_slot]; }
+
+        Forward & operator++() { _slot++; skip(); return *this; }
+        Forward operator++(int) { Forward tmp = *this; ++*this; return tmp; }
+
+        bool operator==(const Forward & i) const { return _slot == i._slot; }
+        bool operator!=(const Forward & i) const { return _slot != i._slot; }
+
+    private:
+        void skip() { for(; (_slot < SIZE) && (_map->_distance[_slot] == EMPTY); _slot++); }
+
+    private:
+        Hash_Map * _map;
+        unsigned int _slot;
+    };
+
+    typedef Forward Iterator;
+
+public:
+    Hash_Map(): _size(0) { clear(); }
+
+    Iterator begin() { return Iterator(this, 0); }
+    Iterator end() { return Iterator(this, SIZE); }
+
+    bool empty() const { return !_size; }
+    unsigned int size() const { return _size; }
+
+    void clear() {
+        for(unsigned int i = 0; i < SIZE; i++)
+            _distance[i] = EMPTY;
+        _size = 0;
+    }
+
+    // Associates object with key, replacing any previous association; returns false if the table is full
+    bool insert(const Key & key, const T & object) {
+        T * o = search_key(key);
+        if(o) {
+            *o = object;
+            return true;
+        }
+        if(_size == SIZE)
+            return false;
+
+        Entry e;
+        e._key = key;
+        e._object = object;
+        Distance d = 1;
+        for(unsigned int i = H::hash(key) & MASK; ; i = (i + 1) & MASK, d++) {
+            if(_distance[i] == EMPTY) {
+                _entries[i] = e;
+                _distance[i] = d;
+                _size++;
+                return true;
+            }
+            if(_distance[i] < d) { // take the slot from the richer entry and go on inserting it instead
+                Entry te = _entries[i];
+                _entries[i] = e;
+                e = te;
+                Distance td = _distance[i];
+                _distance[i] = d;
+                d = td;
+            }
+        }
+    }
+
+    T * search_key(const Key & key) {
+        int i = find(key);
+        return (i >= 0) ? &_entries[i]._object : 0;
+    }
+
+    bool remove_key(const Key & key) {
+        int i = find(key);
+        if(i < 0)
+            return false;
+
+        for(unsigned int j = (i + 1) & MASK; _distance[j] > 1; i = j, j = (j + 1) & MASK) {
+            _entries[i] = _entries[j];
+            _distance[i] = _distance[j] - 1;
+        }
+        _distance[i] = EMPTY;
+        _size--;
+        return true;
+    }
+
+private:
+    int find(const Key & key) const {
+        unsigned int i = H::hash(key) & MASK;
+        for(Distance d = 1; d <= _distance[i]; i = (i + 1) & MASK, d++)
+            if((_distance[i] == d) && (_entries[i]._key == key))
+                return i;
+        return -1;
+    }
+
+private:
+    unsigned int _size;
+    Distance _distance[SIZE];
+    Entry _entries[SIZE];
+};
+
 __END_UTIL
 
 #endif
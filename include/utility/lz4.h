@@ -0,0 +1,216 @@
+// EPOS LZ4 Compression Utility Declarations
+
+#ifndef __lz4_h
+#define __lz4_h
+
+#include <system/config.h>
+
+__BEGIN_UTIL
+
+// LZ4 block format (sequences of literals and matches with 16-bit offsets, no frame)
+// compress() is a greedy single-pass compressor with a hash table supplied by the caller, good enough for boot images.
+// decompress() checks every bound against both buffers and can run in place, as long as the input occupies the last
+// bytes of a buffer with size + margin(compressed size) bytes whose beginning receives the output.
+// Both depend on nothing but the compiler's builtins, so eposmkbi uses this very code to build compressed images.
+class LZ4
+{
+private:
+    static const unsigned int MIN_MATCH = 4;
+    static const unsigned int LAST_LITERALS = 5;        // the last 5 bytes are always literals
+    static const unsigned int MF_LIMIT = 12;            // and the last match must start at least 12 bytes before the end
+    static const unsigned int MAX_DISTANCE = 65535;
+    static const unsigned int HASH_BITS = 12;
+
+public:
+    static const unsigned int TABLE_SIZE = 1 << HASH_BITS;
+    typedef unsigned int Table[TABLE_SIZE];
+
+    // Header that precedes each compressed part of a boot image (see Setup)
+    struct Header {
+        static const unsigned int MAGIC = 0x345a5045;   // "EPZ4"
+
+        unsigned int magic;
+        unsigned int size;                  // uncompressed
+        unsigned int compressed_size;
+
+        bool valid() const { return magic == MAGIC; }
+    };
+
+public:
+    static constexpr unsigned long bound(unsigned long size) { return size + size / 255 + 16; }
+    static constexpr unsigned long margin(unsigned long compressed_size) { return (compressed_size >> 8) + 32; }
+
+    // Returns the compressed size, or zero if it doesn't fit in capacity
+    static unsigned long compress(void * dst, unsigned long capacity, const void * src, unsigned long size, Table & table) {
+        const unsigned char * const base = reinterpret_cast<const unsigned char *>(src);
+        const unsigned char * const end = base + size;
+        const unsigned char * ip = base;
+        const unsigned char * anchor = base;
+        unsigned char * op = reinterpret_cast<unsigned char *>(dst);
+        unsigned char * const oend = op + capacity;
+
+        for(unsigned int i = 0; i < TABLE_SIZE; i++)
+            table[i] = 0;
+
+        if(size > MF_LIMIT) {
+            const unsigned char * const limit = end - MF_LIMIT;
+            for(ip++; ip < limit; ) {
+                unsigned int h = hash(read32(ip));
+                const unsigned char * ref = base + table[h];
+                table[h] = ip - base;
+
+                if((ref >= ip) || (static_cast<unsigned long>(ip - ref) > MAX_DISTANCE) || (read32(ref) != read32(ip))) {
+                    ip++;
+                    continue;
+                }
+
+                // Extend the match backwards over pending literals and forward up to the last literals
+                while((ip > anchor) && (ref > base) && (ip[-1] == ref[-1])) {
+                    ip--;
+                    ref--;
+                }
+                const unsigned char * mp = ip + MIN_MATCH;
+                const unsigned char * mr = ref + MIN_MATCH;
+                while((mp < end - LAST_LITERALS) && (*mp == *mr)) {
+                    mp++;
+                    mr++;
+                }
+
+                op = sequence(op, oend, anchor, ip - anchor, ip - ref, mp - ip - MIN_MATCH);
+                if(!op)
+                    return 0;
+                ip = anchor = mp;
+            }
+        }
+
+        op = sequence(op, oend, anchor, end - anchor, 0, 0);
+        return op ? op - reinterpret_cast<unsigned char *>(dst) : 0;
+    }
+
+    // Returns the decompressed size, or -1 if the input is malformed or the output doesn't fit in capacity
+    static long decompress(void * dst, unsigned long capacity, const void * src, unsigned long size) {
+        const unsigned char * ip = reinterpret_cast<const unsigned char *>(src);
+        const unsigned char * const iend = ip + size;
+        unsigned char * const base = reinterpret_cast<unsigned char *>(dst);
+        unsigned char * op = base;
+        unsigned char * const oend = op + capacity;
+
+        while(ip < iend) {
+            unsigned int token = *ip++;
+
+            unsigned long length = token >> 4;
+            if((length == 15) && !extend(ip, iend, length))
+                return -1;
+            if((length > static_cast<unsigned long>(iend - ip)) || (length > static_cast<unsigned long>(oend - op)))
+                return -1;
+            if((length + 8 <= static_cast<unsigned long>(iend - ip)) && (length + 8 <= static_cast<unsigned long>(oend - op)))
+                wild_copy(op, ip, length);
+            else
+                for(unsigned long i = 0; i < length; i++)
+                    op[i] = ip[i];
+            ip += length;
+            op += length;
+
+            if(ip == iend) // the last sequence has no match
+                break;
+
+            if(iend - ip < 2)
+                return -1;
+            unsigned long offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            if((offset == 0) || (offset > static_cast<unsigned long>(op - base)))
+                return -1;
+
+            length = token & 15;
+            if((length == 15) && !extend(ip, iend, length))
+                return -1;
+            length += MIN_MATCH;
+            if(length > static_cast<unsigned long>(oend - op))
+                return -1;
+
+            const unsigned char * match = op - offset;
+            if((offset >= 8) && (length + 8 <= static_cast<unsigned long>(oend - op)))
+                wild_copy(op, match, length);
+            else
+                for(unsigned long i = 0; i < length; i++) // overlapping matches replicate the last offset bytes
+                    op[i] = match[i];
+            op += length;
+        }
+
+        return op - base;
+    }
+
+private:
+    static unsigned int read32(const unsigned char * p) {
+        unsigned int v;
+        __builtin_memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static unsigned int hash(unsigned int v) { return (v * 2654435761U) >> (32 - HASH_BITS); }
+
+    // Copies in 8-byte steps, possibly writing up to 7 bytes past dst + n
+    static void wild_copy(unsigned char * dst, const unsigned char * src, unsigned long n) {
+        unsigned char * const end = dst + n;
+        do {
+            __builtin_memcpy(dst, src, 8);
+            dst += 8;
+            src += 8;
+        } while(dst < end);
+    }
+
+    static bool extend(const unsigned char * & ip, const unsigned char * iend, unsigned long & length) {
+        unsigned int s;
+        do {
+            if(ip == iend)
+                return false;
+            s = *ip++;
+            length += s;
+        } while(s == 255);
+        return true;
+    }
+
+    static unsigned char * put_length(unsigned char * op, unsigned char * oend, unsigned long length) {
+        for(; length >= 255; length -= 255) {
+            if(op == oend)
+                return 0;
+            *op++ = 255;
+        }
+        if(op == oend)
+            return 0;
+        *op++ = length;
+        return op;
+    }
+
+    // Emits literals followed by a match of match_length + MIN_MATCH bytes (none if offset is zero)
+    static unsigned char * sequence(unsigned char * op, unsigned char * oend, const unsigned char * literals, unsigned long literal_length, unsigned long offset, unsigned long match_length) {
+        if(op == oend)
+            return 0;
+        unsigned char * token = op++;
+        *token = ((literal_length < 15) ? literal_length : 15) << 4;
+        if((literal_length >= 15) && !(op = put_length(op, oend, literal_length - 15)))
+            return 0;
+
+        if(literal_length > static_cast<unsigned long>(oend - op))
+            return 0;
+        for(unsigned long i = 0; i < literal_length; i++)
+            op[i] = literals[i];
+        op += literal_length;
+
+        if(offset) {
+            if(oend - op < 2)
+                return 0;
+            *op++ = offset;
+            *op++ = offset >> 8;
+            *token |= (match_length < 15) ? match_length : 15;
+            if((match_length >= 15) && !(op = put_length(op, oend, match_length - 15)))
+                return 0;
+        }
+
+        return op;
+    }
+};
+
+__END_UTIL
+
+#endif
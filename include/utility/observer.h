@@ -11,18 +11,53 @@
 #define	__observer_h
 
 #include <utility/list.h>
+#include <utility/handler.h>
 
 __BEGIN_UTIL
 
+// Deferred Notification
+// post() defers a notification to whoever calls dispatch(), usually a worker thread blocked on a semaphore that is
+// signaled by the Handler registered with dispatcher(), e.g.:
+//     Semaphore posted(0); Semaphore_Handler handler(&posted); Deferred_Notification::dispatcher(&handler);
+//     and the worker: for(;;) { posted.p(); Deferred_Notification::dispatch(); }
+// post() is O(1), lock-free and allocation-free (objects are linked into a system-wide stack through an embedded
+// pointer), so it can be called from interrupt handlers. Objects posted again before being dispatched are not queued
+// twice, so their notifications are coalesced, and the handler only runs when the stack goes from empty to non-empty.
+class Deferred_Notification
+{
+protected:
+    Deferred_Notification(): _next(0), _posts(0) {}
+
+public:
+    bool post();
+
+    unsigned long pending() const { return _posts; }
+
+    static void dispatch();
+    static void dispatcher(Handler * h) { _dispatcher = h; }
+
+protected:
+    virtual void deliver() = 0;
+
+private:
+    Deferred_Notification * volatile _next;
+    volatile unsigned long _posts;
+
+    static Deferred_Notification * volatile _posted;
+    static Handler * _dispatcher;
+};
+
+
 // Observer x Observed
+// Observers are notified in ascending order of priority, and in order of attachment for equal priorities
 class Observer;
 
-class Observed
+class Observed: public Deferred_Notification
 {
     friend class Observer;
 
 private:
-    typedef Simple_List<Observer>::Element Element;
+    typedef Simple_Ordered_List<Observer>::Element Element;
 
 public:
     Observed() {
@@ -38,8 +73,11 @@ public:
 
     virtual unsigned int observers() const { return _observers.size(); }
 
+protected:
+    void deliver() { notify(); }
+
 private:
-    Simple_List<Observer> _observers;
+    Simple_Ordered_List<Observer> _observers;
 };
 
 class Observer
@@ -47,8 +85,8 @@ class Observer
     friend class Observed;
 
 protected:
-    Observer(): _link(this) {
-        db<Observers>(TRC) << "Observer() => " << this << endl;
+    Observer(int priority = 0): _link(this, priority) {
+        db<Observers>(TRC) << "Observer(p=" << priority << ") => " << this << endl;
     }
 
 public:
@@ -278,20 +316,22 @@ private:
 
 
 // (Unconditional) Observer x (Unconditionally) Observed with Data
+// Observers are ordered by priority as for Observed. Posted notifications are coalesced, so only the data passed to
+// the last post() before the dispatch reaches the observers.
 template<typename D>
-class Data_Observed<D, void>
+class Data_Observed<D, void>: public Deferred_Notification
 {
     friend class Data_Observer<D, void>;
 
 private:
     typedef Data_Observer<D, void> _Observer;
-    typedef typename Simple_List<Data_Observer<D, void>>::Element Element;
+    typedef typename Simple_Ordered_List<Data_Observer<D, void>>::Element Element;
 
 public:
     typedef D Observed_Data;
 
 public:
-    Data_Observed() {
+    Data_Observed(): _data(0) {
         db<Observers>(TRC) << "Data_Observed() => " << this << endl;
     }
 
@@ -302,7 +342,6 @@ public:
     virtual void attach(Data_Observer<D, void> * o) {
         db<Observers>(TRC) << "Data_Observed::attach(obs=" << o << ")" << endl;
 
-        o->_link = Element(o);
         _observers.insert(&o->_link);
     }
 
@@ -337,10 +376,19 @@ public:
         return o;
     }
 
+    bool post(D * d) {
+        _data = d;
+        return Deferred_Notification::post();
+    }
+
     virtual unsigned int observers() const { return _observers.size(); }
 
+protected:
+    void deliver() { notify(_data); }
+
 private:
-    Simple_List<Data_Observer<D, void>> _observers;
+    Simple_Ordered_List<Data_Observer<D, void>> _observers;
+    D * volatile _data;
 };
 
 template<typename D>
@@ -352,8 +400,8 @@ public:
     typedef D Observed_Data;
 
 protected:
-    Data_Observer(): _link(this) {
-        db<Observers>(TRC) << "Data_Observer() => " << this << endl;
+    Data_Observer(int priority = 0): _link(this, priority) {
+        db<Observers>(TRC) << "Data_Observer(p=" << priority << ") => " << this << endl;
     }
 
 public:
@@ -9,12 +9,23 @@ extern "C" {
     void _print_preamble();
     void _print(const char * s);
     void _print_trailler(bool error);
+
+    // Enter (nesting) and leave a section in which no one else can touch the returned line buffer
+    unsigned int _print_lock();
+    void _print_unlock();
 }
 
 __BEGIN_UTIL
 
 class OStream
 {
+private:
+    // Output is accumulated into whole lines before reaching _print(), which may be a system call or a UART. Each CPU
+    // has a line of its own (user-level tasks share one under a lock), only touched between _print_lock() and
+    // _print_unlock(), which in the kernel also disable interrupts, so lines from different CPUs never mix
+    static const unsigned int LINE_SIZE = 128;
+    static const unsigned int LINES = Traits<Build>::CPUS;
+
 public:
     struct Begl {};
     struct Endl {};
@@ -25,17 +36,23 @@ public:
     struct Err {};
 
 public:
-    OStream(): _base(10), _error(false) {}
+    OStream(): _base(10), _error(false) {
+        for(unsigned int i = 0; i < LINES; i++)
+            _length[i] = 0;
+    }
+    ~OStream() { flush(); } // output without a trailing endl must not be lost when the program exits
 
     OStream & operator<<(const Begl & begl) {
+        flush();
         _error = false;
         _print_preamble();
         return *this;
     }
 
     OStream & operator<<(const Endl & endl) {
-        _print_trailler(_error);
         print("\n");
+        flush();
+        _print_trailler(_error);
         _base = 10;
         return *this;
     }
@@ -147,8 +164,36 @@ public:
         return operator<<(static_cast<float>(d));
     }
 
+    // Prints what the calling CPU has accumulated so far
+    void flush() {
+        unsigned int line = _print_lock();
+        flush(line);
+        _print_unlock();
+    }
+
 private:
-    void print(const char * s) { _print(s); }
+    // The line is copied out and emptied before _print(), which may print on its own (e.g. the display's traces)
+    void flush(unsigned int line) {
+        unsigned int length = _length[line];
+        if(length) {
+            char buffer[LINE_SIZE];
+            for(unsigned int i = 0; i < length; i++)
+                buffer[i] = _line[line][i];
+            buffer[length] = '\0';
+            _length[line] = 0;
+            _print(buffer);
+        }
+    }
+
+    void print(const char * s) {
+        unsigned int line = _print_lock();
+        while(*s != '\0') {
+            if(_length[line] >= LINE_SIZE - 1)
+                flush(line);
+            _line[line][_length[line]++] = *s++;
+        }
+        _print_unlock();
+    }
 
     int itoa(int v, char * s);
     int utoa(unsigned int v, char * s, unsigned int i = 0);
@@ -159,6 +204,8 @@ private:
 private:
     int _base;
     volatile bool _error;
+    volatile unsigned int _length[LINES];
+    char _line[LINES][LINE_SIZE];
 
     static const char _digits[];
 };
@@ -28,8 +28,25 @@ public:
         LINEAR           = 2,
         SPATIAL_CONSTANT = 3,
         SPATIAL_LINEAR   = 4,
+        FIXED_LINEAR     = 5,
     };
 
+    // Integral Values are handled in fixed point, without any floating-point operation, for cores without an FPU
+    template<typename Value>
+    struct Fixed_Point { static const bool Result = (Value(1) / Value(2) == Value(0)); };
+
+    // Samples are tested in blocks of this many before being fed one by one (see LVP::trickle(t, v, n))
+    static const unsigned int BLOCK = 16;
+
+    // Whether a prediction p for a sample v is within max(|v * r| / 100, a), with integral Values widened to avoid overflows
+    template<typename Value>
+    static bool acceptable(const Value & v, const Value & p, const Value & r, const Value & a) {
+        typedef typename IF<Fixed_Point<Value>::Result, long long, Value>::Result Wide;
+        Wide error = Wide(v) - Wide(p);
+        Wide relative = Wide(v) * Wide(r) / 100;
+        return Math::abs(error) <= Math::max(Math::abs(relative), Wide(a));
+    }
+
     // History Types
     enum History_Type { TEMPORAL, ATEMPORAL };
 
@@ -40,7 +57,12 @@ public:
     public:
         Constant(const Value & v = 0) : _value(v) {}
 
-        Value operator()(const Time & t) { return _value; }
+        Value operator()(const Time & t) const { return _value; }
+
+        void operator()(const Time * t, Value * v, unsigned int n) const {
+            for(unsigned int i = 0; i < n; i++)
+                v[i] = _value;
+        }
 
         Value value() const { return _value; }
         void value(const Value & v)  { _value = v; }
@@ -55,7 +77,12 @@ public:
     public:
         Linear(const Value & a = 0, const Value & b = 0, const Time & t0 = 0): _a(a), _b(b), _t0(t0) {}
 
-        Value operator()(const Time & t1) { return (_a * (t1 - _t0) + _b); }
+        Value operator()(const Time & t1) const { return (_a * (t1 - _t0) + _b); }
+
+        void operator()(const Time * t, Value * v, unsigned int n) const {
+            for(unsigned int i = 0; i < n; i++)
+                v[i] = _a * (t[i] - _t0) + _b;
+        }
 
         Value a() const { return _a; }
         void a(const Value & a)  { _a = a; }
@@ -70,6 +97,39 @@ public:
         Time _t0;
     } __attribute__((packed));
 
+    // Linear model with the slope in fixed point (FRACTION bits), for integral Values
+    template<typename Time, typename Value, unsigned int FRACTION = 16>
+    class Fixed_Linear
+    {
+    public:
+        typedef long Slope;
+
+    public:
+        Fixed_Linear(const Slope & a = 0, const Value & b = 0, const Time & t0 = 0): _a(a), _b(b), _t0(t0) {}
+
+        Value operator()(const Time & t1) const { return ((static_cast<long long>(_a) * (t1 - _t0)) >> FRACTION) + _b; }
+
+        void operator()(const Time * t, Value * v, unsigned int n) const {
+            for(unsigned int i = 0; i < n; i++)
+                v[i] = ((static_cast<long long>(_a) * (t[i] - _t0)) >> FRACTION) + _b;
+        }
+
+        Slope a() const { return _a; }
+        void a(const Slope & a)  { _a = a; }
+        Value b() const { return _b; }
+        void b(const Value & b) { _b = b; }
+        Time t0() const { return _t0; }
+        void t0(const Time & t0) { _t0 = t0; }
+
+        // The slope dv/dt in fixed point
+        static Slope slope(long long dv, long long dt) { return dt ? (dv << FRACTION) / dt : 0; }
+
+    private:
+        Slope _a;
+        Value _b;
+        Time _t0;
+    } __attribute__((packed));
+
     template<typename Space, typename Model>
     class Spatial: public Model
     {
@@ -117,6 +177,9 @@ public:
     template<typename Time, typename Value>
     using Linear_Model = Model<LINEAR, Linear<Time, Value>>;
 
+    template<typename Time, typename Value>
+    using Fixed_Linear_Model = Model<FIXED_LINEAR, Fixed_Linear<Time, Value>>;
+
     template<typename Space, typename Time, typename Value>
     using Spatial_Constant_Model = Model<SPATIAL_CONSTANT, Spatial<Space, Constant<Time, Value>>>;
 
@@ -249,14 +312,14 @@ public:
     } __attribute__((packed));
 
 public:
-    LVP(Value r = 0, Value a = 0, Time t = 0): _config(r, a, t), _miss_predicted(0) {
+    LVP(Value r = 0, Value a = 0, Time t = 0): _config(r, a, t), _model(TYPE), _miss_predicted(0) {
         db<Predictors>(TRC) << "LVP(r=" << r << ",a=" << a << ",t=" << t << ")" << endl;
-        db<Predictors>(INF) << "LVP:config=" << _config << ",model=" << _model << ")" << endl;
+        db<Predictors>(INF) << "LVP:config=" << _config << ",model=" << _model.value() << ")" << endl;
     }
 
-    LVP(const Configuration & c, bool r = false): _config(c), _miss_predicted(0) {
+    LVP(const Configuration & c, bool r = false): _config(c), _model(TYPE), _miss_predicted(0) {
         db<Predictors>(TRC) << "LVP(c=" << c << ",r=" << r << ")" << endl;
-        db<Predictors>(INF) << "LVP:config=" << _config << ",model=" << _model << ")" << endl;
+        db<Predictors>(INF) << "LVP:config=" << _config << ",model=" << _model.value() << ")" << endl;
     }
 
     template<typename ... Tn>
@@ -264,31 +327,42 @@ public:
         return _model(t, an...);
     }
 
-    bool trickle(const Time & time, const Value & value) {
-        db<Predictors>(TRC) << "LVP::trickle(t=" << time << ",v=" << value << ",t=" << time << ")" << endl;
+    void predict_n(const Time * t, Value * v, unsigned int n) const { _model(t, v, n); }
 
-        float predicted = predict(time);
-        float max_acceptable_error = Math::max(Math::abs(((float)value * (float)_config.relative_error)/100.0f), (float)_config.absolute_error);
-        float error = Math::abs((float)value - predicted);
+    bool trickle(const Time & time, const Value & value) {
+        db<Predictors>(TRC) << "LVP::trickle(t=" << time << ",v=" << value << ",pred=" << _model.value() << ",miss=" << _miss_predicted << ")" << endl;
 
-        db<Predictors>(TRC) << "LVP::trickle:real=" << value << ",pred=" << predicted << ",err=" << error << ",max=" << max_acceptable_error << ",t_err:" << _config.time_error << ",miss:" << _miss_predicted << ")" << endl;
+        return feed(value);
+    }
 
-        if(error > max_acceptable_error) {
-            if(++_miss_predicted > _config.time_error) {
-                _model->value(value);
+    // Batch version of trickle(): feeds samples until one of them changes the model (which then has to be sent) and returns
+    // its index, or n if the model holds for all of them. Samples after the one returned are not consumed.
+    // Blocks of samples are first tested together in a branch-free loop that compilers can vectorize; only blocks with
+    // misses are then fed one by one.
+    unsigned int trickle(const Time * t, const Value * v, unsigned int n) {
+        db<Predictors>(TRC) << "LVP::trickle(n=" << n << ",pred=" << _model.value() << ")" << endl;
+
+        const Value predicted = _model.value();
+        unsigned int i = 0;
+        while(i < n) {
+            unsigned int block = Math::min(n - i, BLOCK);
+            unsigned int misses = 0;
+            for(unsigned int j = 0; j < block; j++)
+                misses += !acceptable(v[i + j], predicted, _config.relative_error, _config.absolute_error);
+
+            if(!misses) {
                 _miss_predicted = 0;
-                return false;
+                i += block;
+                continue;
             }
-        } else {
-            _miss_predicted = 0;
+
+            for(unsigned int j = 0; j < block; j++)
+                if(!feed(v[i + j]))
+                    return i + j;
+            i += block;
         }
 
-//            Value predicted = (*_model)(time);
-//            if(predicted != value){
-//                _model->value(value);
-//                return false;
-//            }
-        return true;
+        return n;
     }
 
     const Model & model() const { return _model; }
@@ -303,6 +377,20 @@ public:
         _config.time_error = c.time_error;
     }
 
+private:
+    bool feed(const Value & value) {
+        if(!acceptable(value, _model.value(), _config.relative_error, _config.absolute_error)) {
+            if(++_miss_predicted > static_cast<unsigned int>(_config.time_error)) {
+                _model.value(value);
+                _miss_predicted = 0;
+                return false;
+            }
+        } else
+            _miss_predicted = 0;
+
+        return true;
+    }
+
 private:
     Configuration _config;
     Model _model;
@@ -311,15 +399,18 @@ private:
 
 
 // Derivative-based Predictor (DBP)
+// The history window is kept as separate arrays of times and values, so averages and batch updates are plain loops over
+// contiguous memory. Integral Values use a Fixed_Linear model and never touch floating point.
 template<typename Time, typename Value>
 class DBP: public Predictor_Common
 {
 private:
     static const Predictor_Type TYPE = Predictor_Common::DBP;
     static const unsigned int MAX_WINDOW = 100;
+    static const bool FIXED = Fixed_Point<Value>::Result;
 
 public:
-    typedef Linear_Model<Time, Value> Model;
+    typedef typename IF<FIXED, Fixed_Linear_Model<Time, Value>, Linear_Model<Time, Value>>::Result Model;
 
     struct Configuration
     {
@@ -343,56 +434,85 @@ public:
     } __attribute__((packed));
 
 public:
-    DBP(unsigned int w, unsigned int p, Value r = 0, Value a = 0, Time t = 0): _ready(false), _config(w, p, r, a, t), _miss_predicted(0) {
-        db<Predictors>(TRC) << "DBP(r=" << r << ",a=" << a << ",t=" << t << ")" << endl;
-        db<Predictors>(INF) << "DBP:config=" << _config << ",model=" << _model << ")" << endl;
+    DBP(unsigned int w, unsigned int p, Value r = 0, Value a = 0, Time t = 0): _ready(false), _miss_predicted(0), _config(r, a, t, w, p), _model(TYPE), _count(0), _next(0) {
+        db<Predictors>(TRC) << "DBP(w=" << w << ",p=" << p << ",r=" << r << ",a=" << a << ",t=" << t << ")" << endl;
+        db<Predictors>(INF) << "DBP:config=" << _config << ")" << endl;
     }
 
-    DBP(const Configuration & c, bool r = false): _ready(false), _config(c), _miss_predicted(0) {
+    DBP(const Configuration & c, bool r = false): _ready(false), _miss_predicted(0), _config(c), _model(TYPE), _count(0), _next(0) {
         db<Predictors>(TRC) << "DBP(c=" << c << ",r=" << r << ")" << endl;
-        db<Predictors>(INF) << "DBP:config=" << _config << ",model=" << _model << ")" << endl;
+        db<Predictors>(INF) << "DBP:config=" << _config << ")" << endl;
     }
 
     template<typename ... Tn>
     Value predict(const Time & t, const Tn & ... an) const {
         if(_ready)
             return _model(t, an ...);
-        else if(!_history.empty())
-            return _history->tail().value();
+        else if(_count)
+            return _values[(_next + MAX_WINDOW - 1) % MAX_WINDOW];
         else
             return 0;
     }
 
-    void update(const Time & t, const Value & v) { _history.insert(t, v); }
+    void predict_n(const Time * t, Value * v, unsigned int n) const {
+        if(_ready)
+            _model(t, v, n);
+        else
+            for(unsigned int i = 0; i < n; i++)
+                v[i] = predict(t[i]);
+    }
+
+    void update(const Time & t, const Value & v) {
+        _times[_next] = t;
+        _values[_next] = v;
+        _next = (_next + 1) % MAX_WINDOW;
+        if(_count < window())
+            _count++;
+    }
 
     bool trickle(const Time & time, const Value & value) {
+        db<Predictors>(TRC) << "DBP::trickle(t=" << time << ",v=" << value << ",miss=" << _miss_predicted << ")" << endl;
+
         update(time, value);
+        return feed(time, value);
+    }
 
-        if(!_model) {
-            if(_history.full()){
-                build_model(time, value);
-                return false;
+    // Batch version of trickle(), with the same semantics as LVP's: returns the index of the sample that changed the
+    // model, or n if none did. Predictions for each block are computed in one pass (see predict_n())
+    // and tested together, and the samples of blocks that hold are appended to the history in bulk.
+    unsigned int trickle(const Time * t, const Value * v, unsigned int n) {
+        db<Predictors>(TRC) << "DBP::trickle(n=" << n << ",ready=" << _ready << ")" << endl;
+
+        unsigned int i = 0;
+        while(i < n) {
+            if(!_ready) {
+                if(!trickle(t[i], v[i]))
+                    return i;
+                i++;
+                continue;
             }
-        } else {
-            float predicted = predict(time);
-            OStream cout;
-            float max_acceptable_error = Math::max(Math::abs(((float)value * (float)_config.relative_error)/100.0f), (float)_config.absolute_error);
-            float error = Math::abs((float)value - predicted);
-
-            db<Predictors>(TRC) << "LVP::trickle:real=" << value << ",pred=" << predicted << ",err=" << error << ",max=" << max_acceptable_error << ",t_err:" << _config.time_error << ",miss:" << _miss_predicted << ")" << endl;
-
-            if(error > max_acceptable_error) {
-                if(++_miss_predicted > _config.time_error) {
-                    build_model(time, value);
-                    _miss_predicted = 0;
-                    return false;
-                }
-            } else {
+
+            Value predicted[BLOCK];
+            unsigned int block = Math::min(n - i, BLOCK);
+            _model(&t[i], predicted, block);
+            unsigned int misses = 0;
+            for(unsigned int j = 0; j < block; j++)
+                misses += !acceptable(v[i + j], predicted[j], _config.relative_error, _config.absolute_error);
+
+            if(!misses) {
+                append(&t[i], &v[i], block);
                 _miss_predicted = 0;
+                i += block;
+                continue;
             }
+
+            for(unsigned int j = 0; j < block; j++)
+                if(!trickle(t[i + j], v[i + j]))
+                    return i + j;
+            i += block;
         }
 
-        return true;
+        return n;
     }
 
     const Model & model() const { return _model; }
@@ -409,33 +529,72 @@ public:
     }
 
 protected:
-    void build_model(const Time & t, const Value & v){
-        assert(_history.full());
+    unsigned int window() const { return (_config.window_size && (_config.window_size < MAX_WINDOW)) ? _config.window_size : MAX_WINDOW; }
+    bool full() const { return _count == window(); }
 
-        float avg_oldest = 0;
-        float avg_recent = 0;
+    // i-th oldest sample in the window
+    unsigned int index(unsigned int i) const { return (_next + MAX_WINDOW - _count + i) % MAX_WINDOW; }
 
-        _model.t0(_history[0].time());
+    void append(const Time * t, const Value * v, unsigned int n) {
+        for(unsigned int i = 0; i < n; i++) {
+            _times[_next] = t[i];
+            _values[_next] = v[i];
+            _next = (_next + 1 == MAX_WINDOW) ? 0 : _next + 1;
+        }
+        _count = Math::min(_count + n, window());
+    }
+
+    bool feed(const Time & time, const Value & value) {
+        if(!_ready) {
+            if(full()) {
+                build_model(time, value);
+                return false;
+            }
+            return true;
+        }
+
+        if(!acceptable(value, predict(time), _config.relative_error, _config.absolute_error)) {
+            if(++_miss_predicted > static_cast<unsigned int>(_config.time_error)) {
+                build_model(time, value);
+                _miss_predicted = 0;
+                return false;
+            }
+        } else
+            _miss_predicted = 0;
+
+        return true;
+    }
+
+    // Fits a line through the averages of the oldest and of the most recent points of the window, then shifts it so it
+    // predicts the current sample exactly
+    void build_model(const Time & t, const Value & v) {
+        assert(full());
 
-        for(unsigned int i = 0; i < _config.points; i++)
-            avg_oldest += _history[i].value();
-        avg_oldest /= _config.points;
+        typedef typename IF<FIXED, long long, Value>::Result Sum;
+        unsigned int points = (_config.points && (_config.points <= _count)) ? _config.points : 1;
 
-        for(unsigned int i = 0; i < _config.point; i++)
-            avg_recent += _history[_history.size() -1 - i].value();
-        avg_recent /= _config.points;
+        Sum sum_oldest = 0, sum_recent = 0;
+        for(unsigned int i = 0; i < points; i++) {
+            sum_oldest += _values[index(i)];
+            sum_recent += _values[index(_count - 1 - i)];
+        }
+        Sum avg_oldest = sum_oldest / Sum(points);
+        Sum avg_recent = sum_recent / Sum(points);
 
-        float t_oldest = (_history[0].time() + _history[_config.points - 1].time()) / 2;
-        float t_recent = (_history[_history.size() - 1].time() + _history[_history.size() -1 - (_config.point - 1)].time()) / 2;
+        Time t_oldest = (_times[index(0)] + _times[index(points - 1)]) / 2;
+        Time t_recent = (_times[index(_count - 1)] + _times[index(_count - points)]) / 2;
 
-        _model.a((avg_recent - avg_oldest) / (t_recent - t_oldest));
+        if(FIXED)
+            _model.a(Fixed_Linear<Time, Value>::slope(avg_recent - avg_oldest, t_recent - t_oldest));
+        else
+            _model.a((t_recent != t_oldest) ? (avg_recent - avg_oldest) / Sum(t_recent - t_oldest) : 0);
         _model.b(avg_oldest);
         _model.t0(t_oldest);
 
-        float predicted = predict(t);
-        float error = v - predicted;
-        _model.b(avg_oldest + error);
+        _model.b(avg_oldest + (v - _model(t)));
         _ready = true;
+
+        db<Predictors>(INF) << "DBP::build_model:b=" << _model.b() << ",t0=" << _model.t0() << endl;
     }
 
 private:
@@ -444,7 +603,10 @@ private:
 
     Configuration _config;
     Model _model;
-    History<TEMPORAL, MAX_WINDOW, Time, Value> _history;
+    Time _times[MAX_WINDOW];
+    Value _values[MAX_WINDOW];
+    unsigned int _count;
+    unsigned int _next;
 };
 
 template<Predictor_Common::Predictor_Type TYPE>
@@ -0,0 +1,143 @@
+// EPOS PMU-based Profiler Utility Declarations
+
+#ifndef __profiler_h
+#define __profiler_h
+
+#include <architecture.h>
+
+__BEGIN_UTIL
+
+// Per-thread hardware event counters and statistical PC sampling
+// Each thread carries a Counters set holding the events selected by Traits<Profiler>::EVENT*. The PMU channels are shared
+// by all threads, so dispatch() charges the channels' progress since the last switch on the CPU to the thread leaving it,
+// which virtualizes the counters without having to write them back (fixed channels cannot be written on most PMUs).
+// Samples of the interrupted PC are taken at each system timer tick and aggregated in a per-CPU histogram (open addressing,
+// one bucket per distinct PC). The counters of exited threads (idle included, which is the last one to go, and
+// threads deleted before exiting) and the histograms are printed at shutdown, in a format meant to be symbolized on
+// the host (e.g. with addr2line). If Traits<Profiler>::enabled is false, everything compiles to nothing.
+class Profiler
+{
+private:
+    static const bool enabled = Traits<Profiler>::enabled;
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+    static const unsigned int SIZE = Traits<Profiler>::HISTOGRAM_SIZE;
+    static const unsigned int MASK = SIZE - 1;
+    static const unsigned int THREADS = Traits<Profiler>::THREADS;
+
+    typedef PMU::Count Count;
+    typedef PMU::Channel Channel;
+    typedef CPU::Reg Reg;
+
+public:
+    static const unsigned int EVENTS = enabled ? (Traits<Profiler>::EVENT0 != PMU::LAST_EVENT) + (Traits<Profiler>::EVENT1 != PMU::LAST_EVENT)
+                                               + (Traits<Profiler>::EVENT2 != PMU::LAST_EVENT) + (Traits<Profiler>::EVENT3 != PMU::LAST_EVENT) : 0;
+
+    // Counter set attached to each thread
+    struct Counters {
+        Counters(): samples(0) { for(unsigned int i = 0; i < EVENTS; i++) count[i] = 0; }
+
+        Count count[EVENTS];
+        unsigned long samples;
+    };
+
+private:
+    struct Bucket {
+        Reg pc;
+        unsigned long count;
+    };
+
+    struct Retired {
+        const void * thread;
+        Counters counters;
+    };
+
+public:
+    Profiler() {}
+
+    // Programs the PMU channels (i.e. mhpmevent on RISC-V), so it must be called in the most privileged mode, before INIT
+    static void config() {
+        if(!enabled)
+            return;
+
+        for(unsigned int i = 0; i < EVENTS; i++) {
+            PMU::config(channel(i), event(i));
+            PMU::reset(channel(i));
+        }
+    }
+
+    // Charges the events counted since the last dispatch on this CPU to prev
+    static void dispatch(Counters * prev, Counters * next) {
+        if(!enabled)
+            return;
+
+        unsigned int cpu = CPU::id() % CPUS; // CPU::id() is the hart id, which is not zero-based on every machine
+        for(unsigned int i = 0; i < EVENTS; i++) {
+            Count now = PMU::read(channel(i));
+            prev->count[i] += now - _last[cpu][i];
+            _last[cpu][i] = now;
+        }
+    }
+
+    // Accounts a sample of the interrupted pc to the running thread (called from the system timer ISR)
+    static void sample(Counters * running, Reg pc) {
+        if(!enabled || !_on)
+            return;
+
+        unsigned int cpu = CPU::id() % CPUS;
+        running->samples++;
+
+        unsigned int i = hash(pc);
+        for(unsigned int n = 0; n < SIZE; n++, i = (i + 1) & MASK) {
+            Bucket * b = &_histogram[cpu][i];
+            if(b->pc == pc) {
+                b->count++;
+                return;
+            }
+            if(!b->count) {
+                b->pc = pc;
+                b->count = 1;
+                return;
+            }
+        }
+        _lost[cpu]++;
+    }
+
+    // Charges the events counted since the last dispatch on this CPU to the running thread (e.g. before retiring it)
+    static void charge(Counters * running) { dispatch(running, running); }
+
+    // Keeps the final counters of a thread that has exited (or is being deleted before it did) for the report
+    static void retire(const void * thread, const Counters & counters);
+
+    static void start() { _on = true; }
+    static void stop() { _on = false; }
+
+    // Stops sampling and prints the counters and histograms
+    static void dump();
+
+private:
+    static Channel channel(unsigned int i) { return PMU::FIXED + i; }
+    static unsigned int event(unsigned int i) {
+        // Unused EVENT* traits are LAST_EVENT, so the used ones are compacted in order
+        const unsigned int events[] = { Traits<Profiler>::EVENT0, Traits<Profiler>::EVENT1, Traits<Profiler>::EVENT2, Traits<Profiler>::EVENT3 };
+        for(unsigned int j = 0, k = 0; j < sizeof(events) / sizeof(events[0]); j++)
+            if((events[j] != PMU::LAST_EVENT) && (k++ == i))
+                return events[j];
+        return PMU::LAST_EVENT;
+    }
+
+    // Instructions are at least 2-byte aligned, so the lowest bit carries no information
+    static unsigned int hash(Reg pc) { return ((pc >> 1) * 2654435761U) & MASK; }
+
+private:
+    static volatile bool _on;
+    static Count _last[][EVENTS];
+    static unsigned long _lost[];
+    static Bucket _histogram[][SIZE];
+    static unsigned int _retired_count;
+    static Retired _retired[];
+    static Counters _total;
+};
+
+__END_UTIL
+
+#endif
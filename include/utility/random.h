@@ -1,36 +1,212 @@
 // EPOS Pseudo Random Number Generator Utility Declarations
 
-// From http://en.wikipedia.org/wiki/Linear_congruential_generator
-// with A = 2 and variable C on a simplification of:
-// X1 = aX0 + c
-// as X1 = (X0 << 1) xor C
-
 #ifndef __random_h
 #define __random_h
 
 #include <system/config.h>
+#include <utility/string.h>
 
 __BEGIN_UTIL
 
-class Random
+// Operations common to all generators, built on the next() of each Engine
+// uniform(n) uses Lemire's multiply-and-reject method, which is unbiased and rarely needs more than one draw.
+template<typename Engine, typename V>
+class Random_Engine
+{
+public:
+    typedef V Value;
+
+public:
+    // Uniformly distributed in [0, n)
+    Value uniform(Value n) {
+        Value lo;
+        Value hi = multiply(engine()->next(), n, &lo);
+        if(lo < n) {
+            Value threshold = (Value(0) - n) % n;
+            while(lo < threshold)
+                hi = multiply(engine()->next(), n, &lo);
+        }
+        return hi;
+    }
+
+    void fill(void * buffer, unsigned long size) {
+        unsigned char * p = reinterpret_cast<unsigned char *>(buffer);
+        for(; size >= sizeof(Value); size -= sizeof(Value), p += sizeof(Value)) {
+            Value v = engine()->next();
+            memcpy(p, &v, sizeof(Value));
+        }
+        if(size) {
+            Value v = engine()->next();
+            memcpy(p, &v, size);
+        }
+    }
+
+private:
+    Engine * engine() { return static_cast<Engine *>(this); }
+
+    static unsigned int multiply(unsigned int a, unsigned int b, unsigned int * lo) {
+        unsigned long long r = static_cast<unsigned long long>(a) * b;
+        *lo = r;
+        return r >> 32;
+    }
+
+    static unsigned long long multiply(unsigned long long a, unsigned long long b, unsigned long long * lo) {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+        *lo = r;
+        return r >> 64;
+#else
+        unsigned long long ha = a >> 32, la = static_cast<unsigned int>(a);
+        unsigned long long hb = b >> 32, lb = static_cast<unsigned int>(b);
+        unsigned long long hl = ha * lb, lh = la * hb, ll = la * lb;
+        unsigned long long mid = (ll >> 32) + static_cast<unsigned int>(hl) + static_cast<unsigned int>(lh);
+        *lo = (mid << 32) | static_cast<unsigned int>(ll);
+        return ha * hb + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+    }
+};
+
+
+// xoshiro256** (Blackman and Vigna): 256 bits of state, 64-bit outputs, period 2^256 - 1
+// jump() advances the state by 2^128 outputs and long_jump() by 2^192, so copies of a generator can be turned into
+// non-overlapping streams for parallel use.
+class Xoshiro256: public Random_Engine<Xoshiro256, unsigned long long>
+{
+public:
+    Xoshiro256(unsigned long long s = 0) { seed(s); }
+
+    // The state is expanded from the seed with SplitMix64, which never yields the invalid all-zero state
+    void seed(unsigned long long s) {
+        for(unsigned int i = 0; i < 4; i++) {
+            s += 0x9e3779b97f4a7c15ULL;
+            _s[i] = mix(s);
+        }
+    }
+
+    Value next() {
+        Value result = rotl(_s[1] * 5, 7) * 9;
+        Value t = _s[1] << 17;
+        _s[2] ^= _s[0];
+        _s[3] ^= _s[1];
+        _s[1] ^= _s[2];
+        _s[0] ^= _s[3];
+        _s[2] ^= t;
+        _s[3] = rotl(_s[3], 45);
+        return result;
+    }
+
+    void jump() {
+        static const Value JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+        jump(JUMP);
+    }
+
+    void long_jump() {
+        static const Value JUMP[] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+        jump(JUMP);
+    }
+
+    // SplitMix64's output function
+    static Value mix(Value z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    static Value rotl(Value x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    void jump(const Value * polynomial) {
+        Value s[4] = { 0, 0, 0, 0 };
+        for(unsigned int i = 0; i < 4; i++)
+            for(unsigned int b = 0; b < 64; b++) {
+                if(polynomial[i] & (Value(1) << b))
+                    for(unsigned int j = 0; j < 4; j++)
+                        s[j] ^= _s[j];
+                next();
+            }
+        for(unsigned int j = 0; j < 4; j++)
+            _s[j] = s[j];
+    }
+
+private:
+    Value _s[4];
+};
+
+
+// PCG32 (O'Neill's PCG-XSH-RR): 64-bit LCG state, 32-bit outputs, period 2^64
+// Each (odd) increment selects one of 2^63 distinct streams, and advance() skips any number of outputs in O(log n).
+// Cheaper than Xoshiro256 on 32-bit machines.
+class PCG32: public Random_Engine<PCG32, unsigned int>
 {
 private:
-    static const unsigned long A = 1103515245;
-    static const unsigned long C = 12345;
-    static const unsigned long M = 4294967295U;
+    static const unsigned long long MULTIPLIER = 6364136223846793005ULL;
 
 public:
-    static int random() {
-        _seed = ((_seed * A) + C) % M; //_seed = (_seed << 1) ^ n;
-        return _seed;
+    PCG32(unsigned long long s = 0, unsigned long long stream = 0) { seed(s, stream); }
+
+    void seed(unsigned long long s, unsigned long long stream = 0) {
+        _increment = (stream << 1) | 1;
+        _state = 0;
+        next();
+        _state += s;
+        next();
+    }
+
+    Value next() {
+        unsigned long long old = _state;
+        _state = old * MULTIPLIER + _increment;
+        unsigned int xorshifted = ((old >> 18) ^ old) >> 27;
+        unsigned int rot = old >> 59;
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
     }
 
-    static void seed(int value) {
-        _seed = value;
+    // Brown's algorithm: composes the LCG step with itself for each bit of delta
+    void advance(unsigned long long delta) {
+        unsigned long long mult = MULTIPLIER, plus = _increment;
+        unsigned long long acc_mult = 1, acc_plus = 0;
+        for(; delta; delta >>= 1) {
+            if(delta & 1) {
+                acc_mult *= mult;
+                acc_plus = acc_plus * mult + plus;
+            }
+            plus = (mult + 1) * plus;
+            mult *= mult;
+        }
+        _state = acc_mult * _state + acc_plus;
     }
 
 private:
-    static int _seed;
+    unsigned long long _state;
+    unsigned long long _increment;
+};
+
+
+// System-wide Random Number Generator
+// The shared stream is counter-based: each call atomically takes a ticket from a word-sized counter and returns
+// SplitMix64's mix of seed + ticket * golden ratio. It is therefore reentrant and safe on multicores without locks, and
+// concurrent callers never corrupt each other's numbers. Threads that draw many numbers, or that need a reproducible
+// sequence, should rather keep their own Generator, e.g. Random::Generator g = Random::generator();
+// On 32-bit machines, the shared stream repeats itself after 2^32 calls.
+class Random
+{
+public:
+    typedef Xoshiro256 Generator;
+
+public:
+    static int random() { return next(); }
+    static unsigned long long next();
+
+    static unsigned int uniform(unsigned int n);
+    static void fill(void * buffer, unsigned long size);
+
+    static void seed(unsigned long long value) { _seed = value; }
+
+    // A new generator, seeded from the shared stream
+    static Generator generator() { return Generator(next()); }
+
+private:
+    static unsigned long long _seed;
+    static volatile unsigned long _ticket;
 };
 
 __END_UTIL
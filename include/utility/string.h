@@ -8,7 +8,9 @@
 extern "C" {
     int memcmp(const void * m1, const void * m2, size_t n);
     void * memcpy(void * d, const void * s, size_t n);
+    void * memmove(void * d, const void * s, size_t n);
     void * memset(void * m, int c, size_t n);
+    void * memzero(void * m, size_t n); // memset(m, 0, n), for clearing whole pages
     void * memchr(const void * m, int c, size_t n);
     int strcmp(const char * s1, const char * s2);
     int strncmp(const char * s1, const char * s2, size_t n);
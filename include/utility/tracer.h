@@ -0,0 +1,83 @@
+// EPOS Binary Event Tracer Utility Declarations
+
+#ifndef __tracer_h
+#define __tracer_h
+
+#include <architecture.h>
+
+__BEGIN_UTIL
+
+// Flight recorder for kernel events
+// Each CPU owns a ring of fixed-size records stamped with the TSC, which is always written with interrupts disabled on that
+// CPU, so no locks are needed. Older records are overwritten once the ring is full. The rings are dumped in hex at shutdown
+// (or on demand) and decoded on the host by tools/epostrace. If Traits<Tracer>::enabled is false, trace() compiles to nothing.
+class Tracer
+{
+private:
+    static const bool enabled = Traits<Tracer>::enabled;
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+    static const unsigned int SIZE = Traits<Tracer>::BUFFER_SIZE;
+    static const unsigned int MASK = SIZE - 1;
+
+    typedef TSC::Time_Stamp Time_Stamp;
+
+public:
+    // Events (keep in sync with tools/epostrace)
+    enum Event {
+        DISPATCH        = 1,    // a = prev, b = next
+        WAKEUP          = 2,    // a = thread, b = queue
+        SLEEP           = 3,    // a = thread, b = queue
+        ALARM           = 4,    // a = alarm, b = elapsed ticks
+        IRQ_ENTER       = 5,    // a = interrupt id
+        IRQ_EXIT        = 6,    // a = interrupt id
+        SYSCALL         = 7,    // a = component type, b = method
+        USER            = 128   // first event id free for applications
+    };
+
+    // Little-endian 32-byte record, regardless of the architecture's word size
+    struct Record {
+        unsigned long long time;
+        unsigned int event;
+        unsigned int cpu;
+        unsigned long long a;
+        unsigned long long b;
+    };
+
+public:
+    Tracer() {}
+
+    static void trace(unsigned int event, unsigned long long a = 0, unsigned long long b = 0) {
+        if(!enabled || !_on)
+            return;
+
+        bool disabled = CPU::int_disabled();
+        if(!disabled)
+            CPU::int_disable();
+
+        unsigned int cpu = CPU::id() % CPUS; // CPU::id() is the hart id, which is not zero-based on every machine
+        Record * r = &_ring[cpu][_count[cpu]++ & MASK];
+        r->time = TSC::time_stamp();
+        r->event = event;
+        r->cpu = cpu;
+        r->a = a;
+        r->b = b;
+
+        if(!disabled)
+            CPU::int_enable();
+    }
+
+    static void start() { _on = true; }
+    static void stop() { _on = false; }
+
+    // Stops tracing and prints the rings, oldest record first
+    static void dump();
+
+private:
+    static volatile bool _on;
+    static unsigned int _count[];
+    static Record _ring[][SIZE];
+};
+
+__END_UTIL
+
+#endif
@@ -4,15 +4,18 @@
 #include <synchronizer.h>
 #include <time.h>
 #include <process.h>
+#include <utility/tracer.h>
 
 __BEGIN_SYS
 
+static_assert(!Traits<Alarm>::deferred || (Traits<Build>::MACHINE == Traits<Build>::RISCV), "Tasklets are only run by the RISC-V IC");
+
 Alarm_Timer * Alarm::_timer;
 volatile Alarm::Tick Alarm::_elapsed;
 Alarm::Queue Alarm::_request;
 
 Alarm::Alarm(const Microsecond & time, Handler * handler, unsigned int times)
-: _time(time), _handler(handler), _times(times), _ticks(ticks(time)), _link(this, _ticks)
+: _time(time), _handler(handler), _times(times), _ticks(ticks(time)), _link(this, _ticks), _tasklet(handler)
 {
     lock();
 
@@ -119,8 +122,12 @@ void Alarm::handler(IC::Interrupt_Id i)
     unlock();
 
     if(alarm) {
+        Tracer::trace(Tracer::ALARM, reinterpret_cast<unsigned long>(alarm), _elapsed);
         db<Alarm>(TRC) << "Alarm::handler(this=" << alarm << ",e=" << _elapsed << ",h=" << reinterpret_cast<void*>(alarm->handler) << ")" << endl;
-        (*alarm->_handler)();
+        if(Traits<Alarm>::deferred)
+            alarm->_tasklet.schedule(); // the handler runs once the timer interrupt is over, with interrupts enabled
+        else
+            (*alarm->_handler)();
     }
 }
 
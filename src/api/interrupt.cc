@@ -0,0 +1,128 @@
+// EPOS Deferred Interrupt Processing Implementation
+
+#include <interrupt.h>
+
+__BEGIN_SYS
+
+// Class attributes
+Tasklet * volatile Tasklet::_scheduled;
+Interrupt_Thread * Interrupt_Thread::_threads[IC::INTS];
+
+
+// Methods
+Tasklet::~Tasklet()
+{
+    db<IC>(TRC) << "~Tasklet(this=" << this << ")" << endl;
+
+    // A pending (or running) Tasklet is still linked into the list that the next interrupt exit will run
+    while(_posts)
+        Thread::yield();
+}
+
+bool Tasklet::schedule()
+{
+    if(CPU::finc(_posts) != 0) // already scheduled and not yet run (or running)
+        return false;
+
+    link();
+
+    return true;
+}
+
+void Tasklet::link()
+{
+    Tasklet * head;
+    do {
+        head = _scheduled;
+        _next = head;
+    } while(CPU::cas(_scheduled, head, this) != head);
+}
+
+
+Interrupt_Thread::Interrupt_Thread(const Interrupt_Id & id, Handler * handler, const Criterion & c)
+: Thread(Configuration(SUSPENDED, c), &bottom_half, this), _id(id), _handler(handler), _semaphore(0), _finishing(false)
+{
+    db<Thread>(TRC) << "Interrupt_Thread(int=" << id << ",h=" << reinterpret_cast<void *>(handler) << ") => " << this << endl;
+
+    assert((id < IC::INTS) && !_threads[id]);
+    _threads[id] = this;
+    IC::int_vector(id, &top_half);
+    IC::enable(id);
+
+    resume();
+}
+
+Interrupt_Thread::~Interrupt_Thread()
+{
+    db<Thread>(TRC) << "~Interrupt_Thread(this=" << this << ",int=" << _id << ")" << endl;
+
+    IC::disable(_id);
+    _threads[_id] = 0;
+
+    _finishing = true;
+    _semaphore.v();
+    join();
+}
+
+
+// Class methods
+void Tasklet::run()
+{
+    Tasklet * list;
+    do
+        list = _scheduled;
+    while(list && (CPU::cas(_scheduled, list, static_cast<Tasklet *>(0)) != list));
+
+    // The list holds the most recently scheduled Tasklet first
+    Tasklet * fifo = 0;
+    while(list) {
+        Tasklet * next = list->_next;
+        list->_next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    while(fifo) {
+        // _posts stays non-zero while the handler runs, so schedule() doesn't relink the Tasklet and the destructor waits.
+        // Once it is cleared, the Tasklet may be scheduled (and relinked) or destroyed, so it must not be touched after.
+        Tasklet * next = fifo->_next;
+        unsigned long posts = fifo->_posts;
+
+        (*fifo->_handler)();
+
+        if(CPU::cas(fifo->_posts, posts, 0UL) != posts) {
+            // Scheduled again while running, so it runs once more at the next interrupt exit
+            fifo->_posts = 1;
+            fifo->link();
+        }
+
+        fifo = next;
+    }
+}
+
+
+void Interrupt_Thread::top_half(Interrupt_Id id)
+{
+    Interrupt_Thread * t = _threads[id];
+    if(!t)
+        return;
+
+    IC::disable(id); // level-triggered sources would interrupt again until the handler gets to run
+    t->_semaphore.v();
+}
+
+int Interrupt_Thread::bottom_half(Interrupt_Thread * t)
+{
+    while(true) {
+        t->_semaphore.p();
+        if(t->_finishing)
+            break;
+
+        (*t->_handler)();
+        IC::enable(t->_id);
+    }
+
+    return 0;
+}
+
+__END_SYS
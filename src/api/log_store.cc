@@ -0,0 +1,606 @@
+// EPOS Log-structured Key-Value Store Implementation
+
+#include <storage.h>
+
+__BEGIN_SYS
+
+Log_Store::Log_Store(Block * device, const Sector & first, const Sector & sectors)
+: _device(device), _first(first), _head(NONE), _free(0), _sequence(0), _opened(1), _committed(0), _failed(0),
+  _keys(0), _entries(0), _reserved(0), _wake(0), _stopping(false), _broken(false)
+{
+    db<Log_Store>(TRC) << "Log_Store(dev=" << device << ",f=" << first << ",s=" << sectors << ") => " << this << endl;
+
+    Sector total = sectors ? sectors : ((device->sectors() > first) ? device->sectors() - first : 0);
+    _segments_count = total / SEGMENT_SECTORS;
+    if(_segments_count <= RESERVE + 1) {
+        db<Log_Store>(WRN) << "Log_Store: the region must have more than " << RESERVE + 1 << " segments of " << SEGMENT_SECTORS << " sectors!" << endl;
+        _broken = true;
+    }
+
+    _segments = new (SYSTEM) Segment[_segments_count];
+    for(unsigned int i = 0; i < _segments_count; i++) {
+        _segments[i].state = Segment::FREE;
+        _segments[i].sequence = 0;
+        _segments[i].used = 0;
+        _segments[i].live = 0;
+        _segments[i].generation = 0;
+    }
+    _free = _segments_count;
+
+    for(unsigned int i = 0; i < 2; i++) {
+        _batches[i].buffer = new (SYSTEM) unsigned char[(BATCH_SECTORS + 1) * SECTOR];
+        _batches[i].bytes = _batches[i].records = 0;
+    }
+    _open = &_batches[0];
+    _copies.buffer = new (SYSTEM) unsigned char[(BATCH_SECTORS + 1) * SECTOR];
+    _copies.bytes = _copies.records = 0;
+    _scan = new (SYSTEM) unsigned char[BATCH_SECTORS * SECTOR];
+    _read = new (SYSTEM) unsigned char[BATCH_SECTORS * SECTOR];
+
+    _index = new (SYSTEM) Entry[ENTRIES];
+    memset(_index, 0, ENTRIES * sizeof(Entry));
+
+    if(!_broken)
+        recover();
+
+    db<Log_Store>(INF) << "Log_Store: " << _keys << " keys in " << _segments_count - _free << "/" << _segments_count << " segments" << endl;
+
+    _compactor = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, Thread::LOW), &compactor, this);
+}
+
+Log_Store::~Log_Store()
+{
+    db<Log_Store>(TRC) << "~Log_Store(this=" << this << ")" << endl;
+
+    _stopping = true;
+    _wake.v();
+    _compactor->join();
+    delete _compactor;
+
+    delete [] _index;
+    delete [] _read;
+    delete [] _scan;
+    delete [] _copies.buffer;
+    for(unsigned int i = 0; i < 2; i++)
+        delete [] _batches[i].buffer;
+    delete [] _segments;
+}
+
+bool Log_Store::put(const void * key, unsigned int key_size, const void * value, unsigned int size)
+{
+    db<Log_Store>(TRC) << "Log_Store::put(k=" << key << ",ks=" << key_size << ",v=" << value << ",s=" << size << ")" << endl;
+
+    if(!key_size || (key_size > MAX_KEY) || (size > MAX_VALUE)) {
+        db<Log_Store>(WRN) << "Log_Store::put: keys must have from 1 to " << MAX_KEY << " bytes and values up to " << MAX_VALUE << "!" << endl;
+        return false;
+    }
+
+    return append(key, key_size, value, size, false);
+}
+
+bool Log_Store::remove(const void * key, unsigned int key_size)
+{
+    db<Log_Store>(TRC) << "Log_Store::remove(k=" << key << ",ks=" << key_size << ")" << endl;
+
+    if(!key_size || (key_size > MAX_KEY))
+        return false;
+
+    return append(key, key_size, 0, 0, true);
+}
+
+int Log_Store::get(const void * key, unsigned int key_size, void * value, unsigned int max)
+{
+    db<Log_Store>(TRC) << "Log_Store::get(k=" << key << ",ks=" << key_size << ",v=" << value << ",m=" << max << ")" << endl;
+
+    if(!key_size || (key_size > MAX_KEY))
+        return -1;
+
+    int result = -1;
+
+    _reading.lock();
+    _lock.lock();
+    _statistics.gets++;
+    _lock.unlock();
+
+    // The record is read without holding the log, so it is only taken if the index still points to it afterwards
+    // and its segment hasn't been reused meanwhile; otherwise, it has just been moved by compaction and we try again
+    while(true) {
+        _lock.lock();
+        Entry * entry = lookup(key, key_size);
+        if(!entry || (entry->flags & Entry::TOMBSTONE)) {
+            _lock.unlock();
+            break;
+        }
+        unsigned int segment = entry->segment;
+        unsigned int offset = entry->offset;
+        unsigned int size = entry->size;
+        unsigned int generation = _segments[segment].generation;
+        _lock.unlock();
+
+        unsigned int first = offset / SECTOR;
+        unsigned int count = (offset + align(sizeof(Record) + key_size + size) - 1) / SECTOR - first + 1;
+        bool ok = (_device->read(sector(segment, first), _read, count) == int(count));
+
+        _lock.lock();
+        entry = lookup(key, key_size);
+        bool same = entry && !(entry->flags & Entry::TOMBSTONE) && (entry->segment == segment) && (entry->offset == offset)
+                    && (_segments[segment].generation == generation);
+        _lock.unlock();
+
+        if(!ok) {
+            db<Log_Store>(WRN) << "Log_Store::get: device error!" << endl;
+            break;
+        }
+
+        Record * record = reinterpret_cast<Record *>(_read + offset % SECTOR);
+        if(same && (record->key_size == key_size) && (record->size == size) && !memcmp(record->key(), key, key_size)) {
+            memcpy(value, record->value(), (size < max) ? size : max);
+            result = size;
+            break;
+        }
+    }
+
+    _reading.unlock();
+
+    return result;
+}
+
+// Appends a record to the open batch and waits for it to be committed
+bool Log_Store::append(const void * key, unsigned int key_size, const void * value, unsigned int size, bool tombstone)
+{
+    unsigned int length = align(sizeof(Record) + key_size + size);
+
+    _lock.lock();
+
+    while(!_open->fits(length)) {
+        unsigned int full = _opened;
+        _lock.unlock();
+        sync(full);
+        _lock.lock();
+    }
+
+    if(_broken) {
+        _lock.unlock();
+        return false;
+    }
+
+    Entry * entry = lookup(key, key_size);
+    if(tombstone && (!entry || (entry->flags & Entry::TOMBSTONE))) {
+        _lock.unlock();
+        return false;
+    }
+    if(!entry && (_entries + _reserved >= ENTRIES - ENTRIES / 8)) {
+        _lock.unlock();
+        db<Log_Store>(WRN) << "Log_Store::append: index full!" << endl;
+        return false;
+    }
+
+    Record * record = reinterpret_cast<Record *>(_open->records_base() + _open->bytes);
+    record->key_size = key_size;
+    record->flags = tombstone ? Record::TOMBSTONE : 0;
+    record->size = size;
+    memcpy(record->key(), key, key_size);
+    if(size)
+        memcpy(record->value(), value, size);
+    _open->bytes += length;
+    _open->records++;
+    _reserved++;
+
+    if(tombstone)
+        _statistics.removes++;
+    else
+        _statistics.puts++;
+
+    unsigned int generation = _opened;
+
+    _lock.unlock();
+
+    return sync(generation);
+}
+
+// Waits for the batch opened as generation to be committed, committing it (and whatever else got appended to it
+// meanwhile) if nobody else has done it by the time we get hold of the log
+bool Log_Store::sync(unsigned int generation)
+{
+    _writer.lock();
+
+    if(_committed < generation) {
+        _lock.lock();
+        Batch * batch = _open;
+        _open = (_open == &_batches[0]) ? &_batches[1] : &_batches[0];
+        generation = _opened++;
+        _lock.unlock();
+
+        unsigned int records = batch->records;
+        bool ok = commit(batch, false);
+
+        _lock.lock();
+        _reserved -= records;
+        _lock.unlock();
+
+        if(ok)
+            _failed &= ~(1ULL << (generation % 64));
+        else
+            _failed |= 1ULL << (generation % 64);
+        _committed = generation;
+    }
+
+    // Failures are remembered for the last 64 batches, which is as far as waiters can get behind
+    bool ok = !(_failed & (1ULL << (generation % 64)));
+
+    _writer.unlock();
+
+    return ok;
+}
+
+// Writes a batch at the head of the log (opening a new segment if it doesn't fit) and applies it to the index
+// Must be called with the log held; the batch is left empty either way
+bool Log_Store::commit(Batch * batch, bool compacting)
+{
+    if(!batch->records)
+        return true;
+
+    unsigned int sectors = batch->sectors();
+    bool fits = (_head != NONE) && ((_segments[_head].used ? _segments[_head].used : 1) + sectors <= SEGMENT_SECTORS);
+    bool ok = !_broken && (fits || open(compacting));
+
+    if(ok) {
+        Segment & segment = _segments[_head];
+
+        Batch_Header * header = batch->header();
+        header->magic = BATCH_MAGIC;
+        header->sequence = segment.sequence;
+        header->bytes = batch->bytes;
+        header->records = batch->records;
+        memset(batch->records_base() + batch->bytes, 0, sectors * SECTOR - sizeof(Batch_Header) - batch->bytes);
+        CRC32 crc;
+        crc.update(&header->sequence, sizeof(Batch_Header) - 2 * sizeof(unsigned int));
+        crc.update(batch->records_base(), batch->bytes);
+        header->crc = crc.value();
+
+        // The header of a segment just opened goes in the same write as its first batch
+        unsigned char * data = batch->buffer + SECTOR;
+        unsigned int at = segment.used;
+        unsigned int count = sectors;
+        if(!at) {
+            Segment_Header * sh = reinterpret_cast<Segment_Header *>(batch->buffer);
+            memset(batch->buffer, 0, SECTOR);
+            sh->magic = SEGMENT_MAGIC;
+            sh->sequence = segment.sequence;
+            sh->crc = CRC32::compute(&sh->sequence, sizeof(sh->sequence));
+            data = batch->buffer;
+            count++;
+        }
+
+        db<Log_Store>(INF) << "Log_Store::commit(seg=" << _head << ",at=" << at << ",n=" << count << ",r=" << batch->records << ")" << endl;
+
+        ok = (_device->write(sector(_head, at), data, count) == int(count)) && (_device->flush() == 0);
+        if(ok) {
+            unsigned int offset = (at ? at : 1) * SECTOR + sizeof(Batch_Header);
+            segment.used = (at ? at : 1) + sectors;
+
+            _lock.lock();
+            apply(batch->records_base(), batch->bytes, _head, offset);
+            _statistics.commits++;
+            _lock.unlock();
+        } else {
+            db<Log_Store>(WRN) << "Log_Store::commit: device error, the store is now read-only!" << endl;
+            _broken = true;
+        }
+    }
+
+    batch->bytes = batch->records = 0;
+
+    if(!compacting && (_free <= RESERVE + 1))
+        _wake.v();
+
+    return ok;
+}
+
+// Makes the next free segment (round-robin, to spread writes over the device) the head of the log, compacting
+// others first if only the reserve is left (which compaction itself can take)
+bool Log_Store::open(bool compacting)
+{
+    while(true) {
+        if((_free > RESERVE) || (compacting && _free)) {
+            unsigned int i = (_head == NONE) ? 0 : (_head + 1) % _segments_count;
+            while(_segments[i].state != Segment::FREE)
+                i = (i + 1) % _segments_count;
+
+            _lock.lock();
+            if(_head != NONE)
+                _segments[_head].state = Segment::SEALED;
+            _segments[i].state = Segment::HEAD;
+            _segments[i].sequence = ++_sequence;
+            _segments[i].used = 0;
+            _segments[i].live = 0;
+            _segments[i].generation++;
+            _head = i;
+            _free--;
+            _lock.unlock();
+
+            db<Log_Store>(INF) << "Log_Store::open(seg=" << i << ",seq=" << _sequence << ",free=" << _free << ")" << endl;
+
+            return true;
+        }
+
+        if(compacting || !compact()) {
+            db<Log_Store>(WRN) << "Log_Store::open: no space left!" << endl;
+            return false;
+        }
+    }
+}
+
+// Moves the live records of the sealed segment with the fewest of them to the head of the log and frees the segment,
+// returning false if there was no segment worth it (or on errors). Must be called with the log held.
+bool Log_Store::compact()
+{
+    unsigned int victim = NONE;
+    unsigned int oldest = NONE;
+    for(unsigned int i = 0; i < _segments_count; i++) {
+        if(_segments[i].state == Segment::FREE)
+            continue;
+        if((oldest == NONE) || (_segments[i].sequence < _segments[oldest].sequence))
+            oldest = i;
+        if((_segments[i].state == Segment::SEALED) && ((victim == NONE) || (_segments[i].live < _segments[victim].live)))
+            victim = i;
+    }
+
+    // Copies (with their batch headers and padding) must take clearly less than the segment they free
+    if((victim == NONE) || (_segments[victim].live > (SEGMENT_SECTORS - 1) * SECTOR * 3 / 4))
+        return false;
+
+    Segment & segment = _segments[victim];
+
+    // Nothing older than the victim could be brought back by dropping its tombstones
+    bool drop = (victim == oldest);
+
+    db<Log_Store>(TRC) << "Log_Store::compact(seg=" << victim << ",live=" << segment.live << ",drop=" << drop << ")" << endl;
+
+    for(unsigned int at = 1; at < segment.used; ) {
+        Batch_Header * header = reinterpret_cast<Batch_Header *>(_scan);
+        if(_device->read(sector(victim, at), _scan, 1) != 1) {
+            _broken = true;
+            return false;
+        }
+        unsigned int sectors = (sizeof(Batch_Header) + header->bytes + SECTOR - 1) / SECTOR;
+        if((header->magic != BATCH_MAGIC) || (header->sequence != segment.sequence) || (sectors > BATCH_SECTORS)
+           || ((sectors > 1) && (_device->read(sector(victim, at + 1), _scan + SECTOR, sectors - 1) != int(sectors - 1)))) {
+            db<Log_Store>(WRN) << "Log_Store::compact: can't read batch at " << at << " of segment " << victim << "!" << endl;
+            _broken = true;
+            return false;
+        }
+
+        unsigned char * records = _scan + sizeof(Batch_Header);
+        unsigned int offset = at * SECTOR + sizeof(Batch_Header);
+        for(unsigned int i = 0; i < header->bytes; ) {
+            Record * record = reinterpret_cast<Record *>(records + i);
+            unsigned int length = record->length();
+
+            _lock.lock();
+            Entry * entry = lookup(record->key(), record->key_size);
+            bool live = entry && (entry->segment == victim) && (entry->offset == offset + i);
+            if(live && drop && (entry->flags & Entry::TOMBSTONE)) {
+                segment.live -= length;
+                erase(entry);
+                live = false;
+            }
+            _lock.unlock();
+
+            if(live) {
+                if(!_copies.fits(length) && !commit(&_copies, true))
+                    return false;
+                memcpy(_copies.records_base() + _copies.bytes, record, length);
+                _copies.bytes += length;
+                _copies.records++;
+                _statistics.copied_bytes += length;
+            }
+
+            i += length;
+        }
+
+        at += sectors;
+    }
+
+    if(!commit(&_copies, true))
+        return false;
+
+    // Only once its live records are safe elsewhere, the segment loses its header, so it isn't replayed anymore
+    memset(_scan, 0, SECTOR);
+    if((_device->write(sector(victim), _scan, 1) != 1) || (_device->flush() != 0)) {
+        db<Log_Store>(WRN) << "Log_Store::compact: device error, the store is now read-only!" << endl;
+        _broken = true;
+        return false;
+    }
+
+    _lock.lock();
+    segment.state = Segment::FREE;
+    segment.used = 0;
+    segment.live = 0;
+    _free++;
+    _statistics.compactions++;
+    _lock.unlock();
+
+    return true;
+}
+
+// Rebuilds the index by replaying valid segments in sequence order, each up to its first invalid batch
+void Log_Store::recover()
+{
+    Segment_Header * header = reinterpret_cast<Segment_Header *>(_scan);
+    for(unsigned int i = 0; i < _segments_count; i++) {
+        if(_device->read(sector(i), _scan, 1) != 1) {
+            db<Log_Store>(WRN) << "Log_Store::recover: device error!" << endl;
+            _broken = true;
+            return;
+        }
+        if((header->magic == SEGMENT_MAGIC) && (header->crc == CRC32::compute(&header->sequence, sizeof(header->sequence)))) {
+            _segments[i].state = Segment::SEALED;
+            _segments[i].sequence = header->sequence;
+            _free--;
+        }
+    }
+
+    for(unsigned long long last = 0; ; ) {
+        unsigned int next = NONE;
+        for(unsigned int i = 0; i < _segments_count; i++)
+            if((_segments[i].state == Segment::SEALED) && (_segments[i].sequence > last) && ((next == NONE) || (_segments[i].sequence < _segments[next].sequence)))
+                next = i;
+        if(next == NONE)
+            break;
+
+        Segment & segment = _segments[next];
+        last = _sequence = segment.sequence;
+        _head = next;
+
+        unsigned int at = 1;
+        while(at < SEGMENT_SECTORS) {
+            Batch_Header * batch = reinterpret_cast<Batch_Header *>(_scan);
+            if(_device->read(sector(next, at), _scan, 1) != 1) {
+                _broken = true;
+                return;
+            }
+            if((batch->magic != BATCH_MAGIC) || (batch->sequence != segment.sequence))
+                break;
+
+            unsigned int sectors = (sizeof(Batch_Header) + batch->bytes + SECTOR - 1) / SECTOR;
+            bool valid = (sectors <= BATCH_SECTORS) && (at + sectors <= SEGMENT_SECTORS);
+            if(valid && (sectors > 1) && (_device->read(sector(next, at + 1), _scan + SECTOR, sectors - 1) != int(sectors - 1))) {
+                _broken = true;
+                return;
+            }
+            if(valid) {
+                CRC32 crc;
+                crc.update(&batch->sequence, sizeof(Batch_Header) - 2 * sizeof(unsigned int));
+                crc.update(_scan + sizeof(Batch_Header), batch->bytes);
+                valid = (crc.value() == batch->crc);
+            }
+            if(!valid) {
+                db<Log_Store>(WRN) << "Log_Store::recover: torn batch at " << at << " of segment " << next << "!" << endl;
+                _statistics.torn_batches++;
+                break;
+            }
+
+            apply(_scan + sizeof(Batch_Header), batch->bytes, next, at * SECTOR + sizeof(Batch_Header));
+            _statistics.recovered_records += batch->records;
+            at += sectors;
+        }
+        segment.used = at;
+    }
+
+    // Appends go on after the last valid batch of the newest segment, overwriting whatever was torn there
+    if(_head != NONE)
+        _segments[_head].state = Segment::HEAD;
+}
+
+// Points the index to the records of a batch that has just been committed (or replayed) at offset of segment, keeping
+// track of the live bytes of each segment. Tombstones for keys not in the index have nothing to hide and are left out.
+// Must be called with _lock held.
+void Log_Store::apply(unsigned char * records, unsigned int bytes, unsigned int segment, unsigned int offset)
+{
+    for(unsigned int i = 0; i < bytes; ) {
+        Record * record = reinterpret_cast<Record *>(records + i);
+        bool tombstone = record->flags & Record::TOMBSTONE;
+
+        Entry * entry = lookup(record->key(), record->key_size);
+        if(entry) {
+            _segments[entry->segment].live -= align(sizeof(Record) + entry->key_size + entry->size);
+            if(!(entry->flags & Entry::TOMBSTONE))
+                _keys--;
+        } else if(!tombstone) {
+            entry = insert(record->key(), record->key_size);
+            if(!entry) {
+                db<Log_Store>(WRN) << "Log_Store::apply: index full, the store is now read-only!" << endl;
+                _broken = true;
+                return;
+            }
+        }
+
+        if(entry) {
+            entry->flags = Entry::USED | (tombstone ? Entry::TOMBSTONE : 0);
+            entry->segment = segment;
+            entry->offset = offset + i;
+            entry->size = record->size;
+            _segments[segment].live += record->length();
+            if(!tombstone)
+                _keys++;
+        }
+
+        i += record->length();
+    }
+}
+
+Log_Store::Entry * Log_Store::lookup(const void * key, unsigned int key_size)
+{
+    for(unsigned int n = 0, i = hash(key, key_size) & (ENTRIES - 1); n < ENTRIES; n++, i = (i + 1) & (ENTRIES - 1)) {
+        Entry * entry = &_index[i];
+        if(!(entry->flags & Entry::USED))
+            break;
+        if((entry->key_size == key_size) && !memcmp(entry->key, key, key_size))
+            return entry;
+    }
+    return 0;
+}
+
+Log_Store::Entry * Log_Store::insert(const void * key, unsigned int key_size)
+{
+    if(_entries >= ENTRIES - 1)
+        return 0;
+
+    unsigned int i = hash(key, key_size) & (ENTRIES - 1);
+    while(_index[i].flags & Entry::USED)
+        i = (i + 1) & (ENTRIES - 1);
+
+    Entry * entry = &_index[i];
+    entry->flags = Entry::USED;
+    entry->key_size = key_size;
+    memcpy(entry->key, key, key_size);
+    _entries++;
+
+    return entry;
+}
+
+// Backward-shift deletion, so lookups never need markers for removed slots
+void Log_Store::erase(Entry * entry)
+{
+    unsigned int i = entry - _index;
+    _index[i].flags = 0;
+    _entries--;
+
+    for(unsigned int j = (i + 1) & (ENTRIES - 1); _index[j].flags & Entry::USED; j = (j + 1) & (ENTRIES - 1)) {
+        unsigned int home = hash(_index[j].key, _index[j].key_size) & (ENTRIES - 1);
+        // Move j to the hole at i unless its home slot lies cyclically in (i, j]
+        bool stays = (i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j));
+        if(!stays) {
+            _index[i] = _index[j];
+            _index[j].flags = 0;
+            i = j;
+        }
+    }
+}
+
+// FNV-1a
+unsigned int Log_Store::hash(const void * key, unsigned int key_size)
+{
+    const unsigned char * k = reinterpret_cast<const unsigned char *>(key);
+    unsigned int h = 2166136261U;
+    for(unsigned int i = 0; i < key_size; i++)
+        h = (h ^ k[i]) * 16777619U;
+    return h;
+}
+
+// Background compaction, woken by commits that leave free segments running low
+int Log_Store::compactor(Log_Store * store)
+{
+    while(true) {
+        store->_wake.p();
+        if(store->_stopping)
+            return 0;
+
+        store->_writer.lock();
+        while(!store->_broken && (store->_free <= RESERVE + 1) && store->compact());
+        store->_writer.unlock();
+    }
+}
+
+__END_SYS
@@ -5,6 +5,11 @@
 
 __BEGIN_SYS
 
+// Class attributes
+TSC::Time_Stamp Scheduling_Criterion_Common::Statistics::_cpu_time[Traits<Build>::CPUS];
+TSC::Time_Stamp Scheduling_Criterion_Common::Statistics::_last_dispatch_time[Traits<Build>::CPUS];
+TSC::Time_Stamp Scheduling_Criterion_Common::Statistics::_last_activation_time;
+
 // The following Scheduling Criteria depend on Alarm, which is not available at scheduler.h
 template <typename ... Tn>
 FCFS::FCFS(int p, Tn & ... an): Priority((p == IDLE) ? IDLE : Alarm::elapsed()) {}
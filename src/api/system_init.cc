@@ -3,6 +3,9 @@
 #include <system.h>
 #include <time.h>
 #include <process.h>
+#ifdef __NIC_H
+#include <network.h>
+#endif
 
 __BEGIN_SYS
 
@@ -13,6 +16,11 @@ void System::init()
 
     if(Traits<Thread>::enabled)
         Thread::init();
+
+#ifdef __NIC_H
+    if((Traits<Build>::NODES > 1) && Traits<Network>::enabled)
+        Network::init();
+#endif
 }
 
 __END_SYS
@@ -3,6 +3,7 @@
 #include <machine.h>
 #include <system.h>
 #include <process.h>
+#include <utility/tracer.h>
 
 // This_Thread class attributes
 __BEGIN_UTIL
@@ -11,6 +12,8 @@ __END_UTIL
 
 __BEGIN_SYS
 
+extern OStream kout;
+
 volatile unsigned int Thread::_thread_count;
 Scheduler_Timer * Thread::_timer;
 Scheduler<Thread> Thread::_scheduler;
@@ -46,6 +49,13 @@ void Thread::constructor_epilogue(Log_Addr entry, unsigned int stack_size)
     if((_state != READY) && (_state != RUNNING))
         _scheduler.suspend(this);
 
+    if(collecting) {
+        if(_state == RUNNING)
+            criterion().statistics().last_thread_dispatch = TSC::time_stamp();
+        else
+            account_ready();
+    }
+
     if(preemptive && (_state == READY) && (_link.rank() != IDLE))
         reschedule();
 
@@ -67,6 +77,10 @@ Thread::~Thread()
     // The running thread cannot delete itself!
     assert(_state != RUNNING);
 
+    // Threads that exited have already been accounted for
+    if(_state != FINISHING)
+        Profiler::retire(this, _counters);
+
     switch(_state) {
     case RUNNING:  // For switch completion only: the running thread would have deleted itself! Stack wouldn't have been released!
         exit(-1);
@@ -110,6 +124,8 @@ void Thread::priority(const Criterion & c)
 
     db<Thread>(TRC) << "Thread::priority(this=" << this << ",prio=" << c << ")" << endl;
 
+    Criterion::Statistics statistics = criterion().statistics(); // statistics live in the criterion, but must survive priority changes
+
     if(_state != RUNNING) { // reorder the scheduling queue
         _scheduler.remove(this);
         _link.rank(c);
@@ -117,6 +133,9 @@ void Thread::priority(const Criterion & c)
     } else
         _link.rank(c);
 
+    if(collecting)
+        criterion().statistics() = statistics;
+
     if(preemptive)
         reschedule();
 
@@ -200,6 +219,7 @@ void Thread::resume()
     if(_state == SUSPENDED) {
         _state = READY;
         _scheduler.resume(this);
+        account_ready();
 
         if(preemptive)
             reschedule();
@@ -210,6 +230,22 @@ void Thread::resume()
 }
 
 
+Thread::Criterion::Statistics Thread::statistics()
+{
+    lock();
+
+    Criterion::Statistics statistics = criterion().statistics();
+
+    // Account for the ongoing execution of the running thread
+    if(collecting && (this == running()))
+        statistics.thread_execution_time += TSC::time_stamp() - statistics.last_thread_dispatch;
+
+    unlock();
+
+    return statistics;
+}
+
+
 // Class methods
 void Thread::yield()
 {
@@ -220,6 +256,9 @@ void Thread::yield()
     Thread * prev = running();
     Thread * next = _scheduler.choose_another();
 
+    if(prev != next)
+        prev->_state = READY; // giving the CPU away is voluntary (see account_dispatch())
+
     dispatch(prev, next);
 
     unlock();
@@ -237,11 +276,16 @@ void Thread::exit(int status)
     prev->_state = FINISHING;
     *reinterpret_cast<int *>(prev->_stack) = status;
 
+    // Threads that are never deleted (e.g. main) must still make it to the profile
+    Profiler::charge(&prev->_counters);
+    Profiler::retire(prev, prev->_counters);
+
     _thread_count--;
 
     if(prev->_joining) {
         prev->_joining->_state = READY;
         _scheduler.resume(prev->_joining);
+        prev->_joining->account_ready();
         prev->_joining = 0;
     }
 
@@ -265,6 +309,8 @@ void Thread::sleep(Queue * q)
     prev->_waiting = q;
     q->insert(&prev->_link);
 
+    Tracer::trace(Tracer::SLEEP, reinterpret_cast<unsigned long>(prev), reinterpret_cast<unsigned long>(q));
+
     Thread * next = _scheduler.chosen();
 
     dispatch(prev, next);
@@ -282,6 +328,9 @@ void Thread::wakeup(Queue * q)
         t->_state = READY;
         t->_waiting = 0;
         _scheduler.resume(t);
+        t->account_ready(true);
+
+        Tracer::trace(Tracer::WAKEUP, reinterpret_cast<unsigned long>(t), reinterpret_cast<unsigned long>(q));
 
         if(preemptive)
             reschedule();
@@ -301,6 +350,9 @@ void Thread::wakeup_all(Queue * q)
             t->_state = READY;
             t->_waiting = 0;
             _scheduler.resume(t);
+            t->account_ready(true);
+
+            Tracer::trace(Tracer::WAKEUP, reinterpret_cast<unsigned long>(t), reinterpret_cast<unsigned long>(q));
         }
 
         if(preemptive)
@@ -341,10 +393,16 @@ void Thread::dispatch(Thread * prev, Thread * next, bool charge)
     }
 
     if(prev != next) {
+        if(collecting)
+            account_dispatch(prev, next);
+        Profiler::dispatch(&prev->_counters, &next->_counters);
+
         if(prev->_state == RUNNING)
             prev->_state = READY;
         next->_state = RUNNING;
 
+        Tracer::trace(Tracer::DISPATCH, reinterpret_cast<unsigned long>(prev), reinterpret_cast<unsigned long>(next));
+
         db<Thread>(TRC) << "Thread::dispatch(prev=" << prev << ",next=" << next << ")" << endl;
         if(Traits<Thread>::debugged && Traits<Debug>::info) {
             CPU::Context tmp;
@@ -363,11 +421,50 @@ void Thread::dispatch(Thread * prev, Thread * next, bool charge)
         // passing the volatile to switch_constext forces it to push prev onto the stack,
         // disrupting the context (it doesn't make a difference for Intel, which already saves
         // parameters on the stack anyway).
+        // A nested interrupt handler that reschedules leaves the IC masking lower priorities, but that masking level belongs
+        // to the thread it preempted, so it is dropped while other threads run and restored when prev gets resumed
+        unsigned int level = IC::level();
+        if(level)
+            IC::level(0);
+
         CPU::switch_context(const_cast<Context **>(&prev->_context), next->_context);
+
+        if(level)
+            IC::level(level);
     }
 }
 
 
+void Thread::account_dispatch(Thread * prev, Thread * next)
+{
+    TSC::Time_Stamp now = TSC::time_stamp();
+    unsigned int cpu = CPU::id() % Traits<Build>::CPUS; // CPU::id() is the hart id, which is not zero-based on every machine
+
+    Criterion::Statistics & p = prev->criterion().statistics();
+    p.thread_execution_time += now - p.last_thread_dispatch;
+    if(prev->criterion() != IDLE)
+        Criterion::Statistics::_cpu_time[cpu] += now - p.last_thread_dispatch;
+
+    // A thread still RUNNING at this point is being preempted, while in any other state it gave up the CPU by itself
+    if(prev->_state == RUNNING)
+        p.involuntary_switches++;
+    else
+        p.voluntary_switches++;
+    if((prev->_state == RUNNING) || (prev->_state == READY))
+        p.last_thread_ready = now;
+
+    Criterion::Statistics & n = next->criterion().statistics();
+    TSC::Time_Stamp waiting = now - n.last_thread_ready;
+    n.thread_waiting_time += waiting;
+    if(waiting > n.max_thread_waiting_time)
+        n.max_thread_waiting_time = waiting;
+    n.dispatches++;
+    n.last_thread_dispatch = now;
+
+    Criterion::Statistics::_last_dispatch_time[cpu] = now;
+}
+
+
 int Thread::idle()
 {
     db<Thread>(TRC) << "Thread::idle(this=" << running() << ")" << endl;
@@ -385,11 +482,18 @@ int Thread::idle()
 
     CPU::int_disable();
     db<Thread>(WRN) << "The last thread has exited!" << endl;
+    Tracer::dump();
+    Profiler::charge(&running()->_counters);
+    Profiler::retire(running(), running()->_counters);
+    Profiler::dump();
     if(reboot) {
         db<Thread>(WRN) << "Rebooting the machine ..." << endl;
         Machine::reboot();
     } else {
         db<Thread>(WRN) << "Halting the machine ..." << endl;
+        kout.flush();
+        kerr.flush();
+        Display::flush();
         CPU::halt();
     }
 
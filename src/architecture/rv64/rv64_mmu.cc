@@ -1,10 +1,28 @@
 // EPOS RV64 MMU Mediator Implementation
 
 #include <architecture/rv64/rv64_mmu.h>
+#include <machine/ic.h>
 
 __BEGIN_SYS
 
 SV39_MMU::List SV39_MMU::_free[colorful * COLORS + 1];
 SV39_MMU::Page_Directory * SV39_MMU::_master;
 
+SV39_MMU::Shootdown::Shootdown()
+{
+    IPI::begin_batch();
+}
+
+SV39_MMU::Shootdown::~Shootdown()
+{
+    IPI::end_batch();
+}
+
+// Detaching clears attacher (i.e. non-leaf) entries, which sfence.vma only drops when given no address, so whole TLBs
+// are flushed, here and on the other harts, which might have cached them as well
+void SV39_MMU::shootdown()
+{
+    IPI::shootdown();
+}
+
 __END_SYS
@@ -3,7 +3,7 @@
 #include <architecture/mmu.h>
 #include <system.h>
 
-#ifdef __sifive_u__
+#if defined(__sifive_u__) || defined(__virt__)
 
 __BEGIN_SYS
 
@@ -16,6 +16,8 @@ void SV39_MMU::init()
     db<Init, MMU>(INF) << "MMU::master page directory=" << _master << endl;
 
     free(System::info()->pmm.free1_base, pages(System::info()->pmm.free1_top - System::info()->pmm.free1_base));
+    if(System::info()->pmm.free2_top > System::info()->pmm.free2_base) // SETUP leaves a hole for application pages mapped from the boot image
+        free(System::info()->pmm.free2_base, pages(System::info()->pmm.free2_top - System::info()->pmm.free2_base));
 }
 
 __END_SYS
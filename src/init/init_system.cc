@@ -45,8 +45,17 @@ public:
         // Randomize the Random Numbers Generator's seed
         if(Traits<Random>::enabled) {
             db<Init>(INF) << "Randomizing the Random Numbers Generator's seed." << endl;
-            if(Traits<TSC>::enabled)
-                Random::seed(TSC::time_stamp());
+            if(Traits<TSC>::enabled) {
+                // The time taken by short loops jitters with caches, pipelines and buses, so the low bits of their
+                // durations are folded into the time stamp
+                unsigned long long entropy = TSC::time_stamp();
+                for(unsigned int i = 0; i < 64; i++) {
+                    TSC::Time_Stamp t0 = TSC::time_stamp();
+                    for(volatile unsigned int j = 0; j < (i & 7); j++);
+                    entropy = ((entropy << 5) | (entropy >> 59)) ^ (TSC::time_stamp() - t0);
+                }
+                Random::seed(entropy);
+            }
 
             if(!Traits<TSC>::enabled)
                 db<Init>(WRN) << "Due to lack of entropy, Random is a pseudo random numbers generator!" << endl;
@@ -24,7 +24,7 @@ OStream & operator<<(OStream & os, const System_Info & si)
        << ",extras_o="     << si.bm.extras_offset << dec
        << "}"
 
-#if defined(__pc__) || defined(__sifive_u__) || defined(__cortex_a53__)
+#if defined(__pc__) || defined(__sifive_u__) || defined(__virt__) || defined(__cortex_a53__)
        << "\nPhysical_Memory_Map={"
        << "sys_info="      << reinterpret_cast<void *>(si.pmm.sys_info)
 #ifdef __pc__
@@ -42,6 +42,7 @@ OStream & operator<<(OStream & os, const System_Info & si)
        << ",sys_data="     << reinterpret_cast<void *>(si.pmm.sys_data)
        << ",sys_stack="    << reinterpret_cast<void *>(si.pmm.sys_stack)
        << ",app_code="     << reinterpret_cast<void *>(si.pmm.app_code)
+       << ",app_code_image=" << reinterpret_cast<void *>(si.pmm.app_code_image)
        << ",app_data="     << reinterpret_cast<void *>(si.pmm.app_data)
        << ",app_extra="    << reinterpret_cast<void *>(si.pmm.app_extra)
        << ",free1_base="   << reinterpret_cast<void *>(si.pmm.free1_base)
@@ -54,7 +55,7 @@ OStream & operator<<(OStream & os, const System_Info & si)
 #endif
 
        << "\nLoad_Map={"
-#if defined(__pc__) || defined(__sifive_u__) || defined(__cortex_a53__)
+#if defined(__pc__) || defined(__sifive_u__) || defined(__virt__) || defined(__cortex_a53__)
        << "has_stp="       << si.lm.has_stp
        << ",has_ini="      << si.lm.has_ini
        << ",has_sys="      << si.lm.has_sys
@@ -75,13 +76,19 @@ OStream & operator<<(OStream & os, const System_Info & si)
        << ",sys_stack{b="  << reinterpret_cast<void *>(si.lm.sys_stack) << ",s=" << si.lm.sys_stack_size << "}"
        << ",app_entry="    << reinterpret_cast<void *>(si.lm.app_entry)
        << ",app_segments=" << si.lm.app_segments
-       << ",app_code={b="  << reinterpret_cast<void *>(si.lm.app_code) << ",s=" << si.lm.app_code_size << "}"
+       << ",app_code={b="  << reinterpret_cast<void *>(si.lm.app_code) << ",s=" << si.lm.app_code_size << ",m=" << si.lm.app_code_mapped << "}"
        << ",app_data={b="  << reinterpret_cast<void *>(si.lm.app_data) << ",s=" << si.lm.app_data_size << "}"
        << ",app_stack="    << reinterpret_cast<void *>(si.lm.app_stack)
        << ",app_heap="     << reinterpret_cast<void *>(si.lm.app_heap)
 #endif
        << ",app_extra={b=" << reinterpret_cast<void *>(si.lm.app_extra) << ",s=" << si.lm.app_extra_size << "}"
        << "}"
+
+#if defined(__sifive_u__) || defined(__virt__)
+       << "\nTime_Map={"
+       << "sstc="          << si.tm.sstc
+       << "}"
+#endif
        << "}";
 
     return os;
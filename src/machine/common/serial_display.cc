@@ -8,5 +8,84 @@ __BEGIN_SYS
 Serial_Display::Engine Serial_Display::_engine(UNIT);
 int Serial_Display::_line;
 int Serial_Display::_column;
+volatile bool Serial_Display::_buffering;
+volatile bool Serial_Display::_draining;
+unsigned int Serial_Display::_current;
+Serial_Display::Ring Serial_Display::_ring[buffered ? CPUS : 0];
+
+
+// Class methods
+void Serial_Display::enqueue(const char * s)
+{
+    unsigned int size = strlen(s);
+
+    // Producers on the same CPU are serialized by disabling interrupts, which also keeps the drainer away from this ring
+    bool disabled = CPU::int_disabled();
+    if(!disabled)
+        CPU::int_disable();
+
+    Ring & ring = _ring[CPU::id() % CPUS]; // CPU::id() is the hart id, which is not zero-based on every machine
+
+    // Strings are inserted whole, so lines from different CPUs never get interleaved
+    // If the ring is full (e.g. interrupts have been disabled for too long), then drain it synchronously
+    if(size > Traits<Serial_Display>::BUFFER_SIZE) {
+        drain(true);
+        while(*s != '\0')
+            putc(*s++);
+    } else
+        while(!ring.insert(s, size))
+            drain(true);
+
+    _engine.int_enable(false, true);
+
+    if(!disabled)
+        CPU::int_enable();
+}
+
+// Moves characters from the rings into the UART. Asynchronous drains only take what the UART can accept without
+// waiting and give up if another CPU is already draining. Returns true if characters were left behind.
+bool Serial_Display::drain(bool synchronous)
+{
+    if(synchronous) {
+        while(CPU::tsl(_draining));
+    } else if(CPU::tsl(_draining))
+        return false;
+
+    for(unsigned int i = 0; i < CPUS; i++, _current = (_current + 1) % CPUS) {
+        char c;
+        while((synchronous || _engine.ready_to_put()) && _ring[_current].remove(&c))
+            putc(c);
+
+        if(!_ring[_current].empty())
+            break; // the UART is full; keep on this ring so its current line is not interleaved with others
+    }
+
+    bool pending = false;
+    for(unsigned int i = 0; i < CPUS; i++)
+        pending |= !_ring[i].empty();
+
+    _draining = false;
+
+    return pending;
+}
+
+void Serial_Display::flush(bool panicking)
+{
+    if(buffered && _buffering) {
+        // Elsewhere (e.g. on reboots and halts), another CPU might be draining, so it must be waited for
+        if(panicking)
+            _draining = false;
+        drain(true);
+    }
+    _engine.flush();
+}
+
+void Serial_Display::int_handler(unsigned int i)
+{
+    _engine.int_disable(false, true);
+
+    if(drain(false))
+        _engine.int_enable(false, true);
+}
 
 __END_SYS
@@ -0,0 +1,109 @@
+// EPOS EPOSMoteIII (ARM Cortex-M3) SPI Mediator Implementation
+
+#include <machine/spi.h>
+
+#ifdef __SPI_H
+
+__BEGIN_SYS
+
+// Class attributes
+SPI_Engine * SPI_Engine::_engines[UNITS];
+
+
+// Methods
+bool SPI_Engine::submit(IO_Request * request)
+{
+    db<SPI>(TRC) << "SPI::submit(r=" << request << " => " << *request << ")" << endl;
+
+    switch(request->operation()) {
+    case IO_Request::READ:
+    case IO_Request::WRITE:
+    case IO_Request::TRANSFER:
+    case IO_Request::FLUSH:
+        break;
+    default:
+        db<SPI>(WRN) << "SPI::submit: unsupported operation (" << request->operation() << ")!" << endl;
+        return false;
+    }
+
+    request->start();
+
+    IO_Request::List finished;
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _requests.insert(request->link());
+    pump(&finished);
+    if(!disabled)
+        CPU::int_enable();
+
+    IO_Request::finish(&finished);
+
+    return true;
+}
+
+// Moves frames between the FIFOs and the request at the head of the queue, which is the only one with frames in them,
+// collecting the requests that got finished, so the caller can notify their owners once interrupts are enabled again
+void SPI_Engine::pump(IO_Request::List * finished)
+{
+    for(IO_Request::Element * e = _requests.head(); e; e = _requests.head()) {
+        IO_Request * request = e->object();
+
+        if(request->operation() != IO_Request::FLUSH) {
+            unsigned char * data = request->data();
+
+            Reg32 frame;
+            while((request->count() < request->issued()) && _pl022->try_get(&frame)) {
+                if(request->operation() != IO_Request::WRITE)
+                    data[request->count()] = frame;
+                request->progress(1);
+            }
+
+            while((request->issued() < request->size()) && (request->issued() - request->count() < FIFO_DEPTH)
+                  && _pl022->try_put((request->operation() == IO_Request::READ) ? FILLER : data[request->issued()]))
+                request->issue(1);
+
+            if(request->count() < request->size())
+                break;
+        }
+
+        _requests.remove_head();
+        finished->insert(e);
+    }
+
+    if(_requests.empty())
+        _pl022->int_disable(PL022::RXIM | PL022::RTIM | PL022::RORIM);
+    else
+        _pl022->int_enable(PL022::RXIM | PL022::RTIM | PL022::RORIM);
+}
+
+
+// Class methods
+void SPI_Engine::int_handler(IC::Interrupt_Id interrupt)
+{
+    for(unsigned int i = 0; i < UNITS; i++) {
+        SPI_Engine * engine = _engines[i];
+        if(!engine || (engine->_interrupt != interrupt))
+            continue;
+
+        Reg32 status = engine->_pl022->int_status();
+        engine->_pl022->int_clear(status);
+
+        db<SPI>(TRC) << "SPI::int_handler(int=" << interrupt << ",mis=" << hex << status << dec << ")" << endl;
+
+        if(status & PL022::ROMIS)
+            db<SPI>(WRN) << "SPI::int_handler: RX overrun!" << endl;
+
+        IO_Request::List finished;
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        engine->pump(&finished);
+        if(!disabled)
+            CPU::int_enable();
+
+        IO_Request::finish(&finished);
+    }
+}
+
+__END_SYS
+
+#endif
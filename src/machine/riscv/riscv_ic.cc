@@ -5,6 +5,8 @@
 #include <machine/ic.h>
 #include <machine/timer.h>
 #include <process.h>
+#include <interrupt.h>
+#include <utility/tracer.h>
 
 extern "C" { void _int_entry() __attribute__ ((nothrow, alias("_ZN4EPOS1S2IC5entryEv"))); }
 extern "C" { void __exit(); }
@@ -12,11 +14,14 @@ extern "C" { static void print_context(); }
 
 __BEGIN_SYS
 
-static CPU::Reg a0;
-static CPU::Reg a1;
-
 IC::Interrupt_Handler IC::_int_vector[IC::INTS];
 
+IPI::Mailbox IPI::_mailboxes[IPI::CPUS];
+IPI::Ranges IPI::_batches[IPI::CPUS];
+unsigned int IPI::_batching[IPI::CPUS];
+bool IPI::_batch_disabled[IPI::CPUS];
+volatile unsigned long IPI::_online;
+
 void IC::entry()
 {
     // Save context
@@ -41,29 +46,86 @@ void IC::dispatch()
 {
     Interrupt_Id id = int_id();
 
-    // Preserve handler's arguments
-    a0 = CPU::a0(); // exit passes status through a0
-    a1 = CPU::a1(); // syscalls pass messages through a1
+    // Preserve handler's arguments (on this stack, since nested interrupts and other harts come through here as well)
+    CPU::Reg a0 = CPU::a0(); // exit passes status through a0
+    CPU::Reg a1 = CPU::a1(); // syscalls pass messages through a1
+
+    // External interrupts are multiplexed by the PLIC, so claim the pending source and dispatch it by its own id
+    unsigned int irq = PLIC::IRQ_NONE;
+    if(id == INT_PLIC) {
+        irq = PLIC::claim();
+        if(irq == PLIC::IRQ_NONE) { // already claimed by another hart
+            CPU::fr(0);
+            return;
+        }
+        id = PLIC_INTS + irq;
+    }
+
+    Tracer::trace(Tracer::IRQ_ENTER, id);
 
     if(((id != INT_SYS_TIMER) && (id != INT_SYSCALL) && ((id == CPU::EXC_IPF) && (CPU::epc() != CPU::Log_Addr(&__exit)))) || Traits<IC>::hysterically_debugged)
         db<IC>(TRC) << "IC::dispatch(i=" << id << ") [sp=" << CPU::sp() << "]" << endl;
 
+    if((id == CPU::EXC_IPF) && (CPU::epc() == CPU::Log_Addr(&__exit))) { // a page fault on __exit is triggered by MAIN after returing to CRT0
+        db<IC, Thread>(TRC) << "IC::dispatch => Thread::exit()" << endl;
+        CPU::a0(a0);
+        __exit();
+    }
+
+    if(Traits<Profiler>::enabled && (id == INT_SYS_TIMER))
+        Thread::sample(CPU::epc());
+
     if(multitask) {
-        if(id == INT_SYS_TIMER)
-            CPU::ecall();  // we can't clear CPU::sipc(CPU::STI) in supervisor mode, so let's ecall int_m2s so it does it for us
+        if(id == INT_SYS_TIMER) {
+            if(Timer::_sstc)
+                Timer::rearm(); // writing stimecmp clears STI, so there is no need to trap into machine mode
+            else
+                CPU::ecall();   // we can't clear CPU::sipc(CPU::STI) in supervisor mode, so let's ecall int_m2s so it does it for us
+        }
     } else {
         // MIP.MTI is a direct logic on (MTIME == MTIMECMP) and reseting the Timer seems to be the only way to clear it
         if(id == INT_SYS_TIMER)
             Timer::reset();
     }
 
-    // Ensure the handler gets the correct arguments
-    CPU::a0(a0);
-    CPU::a1(a1);
-    _int_vector[id](id);
+    if(Traits<IC>::nesting && (irq != PLIC::IRQ_NONE)) {
+        // Let sources with higher priorities (and CLINT's interrupts) preempt this handler. Masks in [m|s]ie would follow a
+        // rescheduling triggered by the handler (e.g. through Semaphore::v()) into other threads, so only the PLIC's
+        // threshold is raised, and Thread::dispatch() lowers it while other threads run. Device handlers take no arguments
+        // in a0/a1.
+        unsigned int threshold = PLIC::threshold();
+        PLIC::threshold(PLIC::priority(irq));
+        CPU::int_enable();
+        _int_vector[id](id);
+        CPU::int_disable();
+        PLIC::threshold(threshold);
+    } else {
+        // Ensure the handler gets the correct arguments
+        CPU::a0(a0);
+        CPU::a1(a1);
+        _int_vector[id](id);
+    }
+
+    // Exception handlers (and syscalls) leave in a0 how much CPU::Context::pop(true) must advance PC, and a0 is
+    // caller-saved, so it must be taken before anything else (e.g. the tracer) is called
+    CPU::Reg fr = CPU::fr();
+
+    if(irq != PLIC::IRQ_NONE)
+        PLIC::complete(irq);
+
+    Tracer::trace(Tracer::IRQ_EXIT, id);
+
+    // Run the bottom halves deferred by this (or any preempted) handler with interrupts enabled
+    if((id >= EXCS) && Tasklet::scheduled()) {
+        CPU::int_enable();
+        Tasklet::run();
+        CPU::int_disable();
+    }
 
     if(id >= EXCS)
         CPU::fr(0); // tell CPU::Context::pop(true) not to increment PC since it is automatically incremented for hardware interrupts
+    else
+        CPU::fr(fr);
 }
 
 void IC::int_not(Interrupt_Id id)
@@ -82,64 +144,317 @@ void IC::exception(Interrupt_Id id)
     CPU::Log_Addr tval = CPU::tval();
     Thread * thread = Thread::self();
 
-    if((id == CPU::EXC_IPF) && (epc == CPU::Log_Addr(&__exit))) { // a page fault on __exit is triggered by MAIN after returing to CRT0
-        db<IC, Thread>(TRC) << " => Thread::exit()";
-        CPU::a0(a0);
-        __exit();
-    } else {
-        db<IC,System>(WRN) << "IC::Exception(" << id << ") => {" << hex << "thread=" << thread << ",epc=" << epc << ",sp=" << sp << ",status=" << status << ",cause=" << cause << ",tval=" << tval << "}" << dec;
-
-        switch(id) {
-        case CPU::EXC_IALIGN: // instruction address misaligned
-            db<IC, System>(WRN) << " => unaligned instruction";
-            break;
-        case CPU::EXC_IFAULT: // instruction access fault
-            db<IC, System>(WRN) << " => instruction protection violation";
-            break;
-        case CPU::EXC_IILLEGAL: // illegal instruction
-            db<IC, System>(WRN) << " => illegal instruction";
-            break;
-        case CPU::EXC_BREAK: // break point
-            db<IC, System>(WRN) << " => break point";
-            break;
-        case CPU::EXC_DRALIGN: // load address misaligned
-            db<IC, System>(WRN) << " => unaligned data read";
-            break;
-        case CPU::EXC_DRFAULT: // load access fault
-            db<IC, System>(WRN) << " => data protection violation (read)";
-            break;
-        case CPU::EXC_DWALIGN: // store/AMO address misaligned
-            db<IC, System>(WRN) << " => unaligned data write";
-            break;
-        case CPU::EXC_DWFAULT: // store/AMO access fault
-            db<IC, System>(WRN) << " => data protection violation (write)";
-            break;
-        case CPU::EXC_ENVU: // ecall from user-mode
-        case CPU::EXC_ENVS: // ecall from supervisor-mode
-        case CPU::EXC_ENVH: // reserved
-        case CPU::EXC_ENVM: // reserved
-            db<IC, System>(WRN) << " => bad ecall";
-            break;
-        case CPU::EXC_IPF: // Instruction page fault
-            db<IC, System>(WRN) << " => instruction page fault";
-            break;
-        case CPU::EXC_DRPF: // load page fault
-        case CPU::EXC_RES: // reserved
-        case CPU::EXC_DWPF: // store/AMO page fault
-            db<IC, System>(WRN) << " => data page fault";
-            break;
-        default:
-            int_not(id);
-            break;
+    db<IC,System>(WRN) << "IC::Exception(" << id << ") => {" << hex << "thread=" << thread << ",epc=" << epc << ",sp=" << sp << ",status=" << status << ",cause=" << cause << ",tval=" << tval << "}" << dec;
+
+    switch(id) {
+    case CPU::EXC_IALIGN: // instruction address misaligned
+        db<IC, System>(WRN) << " => unaligned instruction";
+        break;
+    case CPU::EXC_IFAULT: // instruction access fault
+        db<IC, System>(WRN) << " => instruction protection violation";
+        break;
+    case CPU::EXC_IILLEGAL: // illegal instruction
+        db<IC, System>(WRN) << " => illegal instruction";
+        break;
+    case CPU::EXC_BREAK: // break point
+        db<IC, System>(WRN) << " => break point";
+        break;
+    case CPU::EXC_DRALIGN: // load address misaligned
+        db<IC, System>(WRN) << " => unaligned data read";
+        break;
+    case CPU::EXC_DRFAULT: // load access fault
+        db<IC, System>(WRN) << " => data protection violation (read)";
+        break;
+    case CPU::EXC_DWALIGN: // store/AMO address misaligned
+        db<IC, System>(WRN) << " => unaligned data write";
+        break;
+    case CPU::EXC_DWFAULT: // store/AMO access fault
+        db<IC, System>(WRN) << " => data protection violation (write)";
+        break;
+    case CPU::EXC_ENVU: // ecall from user-mode
+    case CPU::EXC_ENVS: // ecall from supervisor-mode
+    case CPU::EXC_ENVH: // reserved
+    case CPU::EXC_ENVM: // reserved
+        db<IC, System>(WRN) << " => bad ecall";
+        break;
+    case CPU::EXC_IPF: // Instruction page fault
+        db<IC, System>(WRN) << " => instruction page fault";
+        break;
+    case CPU::EXC_DRPF: // load page fault
+    case CPU::EXC_RES: // reserved
+    case CPU::EXC_DWPF: // store/AMO page fault
+        db<IC, System>(WRN) << " => data page fault";
+        break;
+    default:
+        int_not(id);
+        break;
+    }
+
+    db<IC, System>(WRN) << endl;
+
+    if(Traits<Build>::hysterically_debugged)
+        db<IC, System>(ERR) << "Exception stopped execution due to hysterically debugging!" << endl;
+
+    CPU::fr(4); // since exceptions do not increment PC, tell CPU::Context::pop(true) to perform PC = PC + 4 on return
+}
+
+
+void IPI::Ranges::add(Log_Addr a, unsigned long s)
+{
+    if(full)
+        return;
+
+    // Overlapping and adjacent ranges are merged, so a batch of detach()es of neighboring segments takes a single slot
+    for(unsigned int i = 0; i < count; i++)
+        if((a <= addr[i] + size[i]) && (addr[i] <= a + s)) {
+            Log_Addr end = (a + s > addr[i] + size[i]) ? a + s : addr[i] + size[i];
+            if(a < addr[i])
+                addr[i] = a;
+            size[i] = end - addr[i];
+            return;
         }
 
-        db<IC, System>(WRN) << endl;
+    if(count == RANGES)
+        full = true;
+    else {
+        addr[count] = a;
+        size[count] = s;
+        count++;
+    }
+}
+
+void IPI::Ranges::add(const Ranges & ranges)
+{
+    if(ranges.full)
+        full = true;
+    else
+        for(unsigned int i = 0; i < ranges.count; i++)
+            add(ranges.addr[i], ranges.size[i]);
+}
 
-        if(Traits<Build>::hysterically_debugged)
-            db<IC, System>(ERR) << "Exception stopped execution due to hysterically debugging!" << endl;
+void IPI::Ranges::flush(Statistics & statistics) const
+{
+    if(full) {
+        CPU::flush_tlb();
+        statistics.full_flushes++;
+        return;
     }
 
-    CPU::fr(4); // since exceptions do not increment PC, tell CPU::Context::pop(true) to perform PC = PC + 4 on return
+    for(unsigned int i = 0; i < count; i++)
+        if((size[i] >> PAGE_SHIFT) > MAX_PAGES) {
+            CPU::flush_tlb();
+            statistics.full_flushes++;
+            return;
+        }
+
+    for(unsigned int i = 0; i < count; i++)
+        for(unsigned long page = addr[i] >> PAGE_SHIFT; page < (addr[i] + size[i] + (1UL << PAGE_SHIFT) - 1) >> PAGE_SHIFT; page++) {
+            CPU::flush_tlb(page << PAGE_SHIFT);
+            statistics.page_flushes++;
+        }
+}
+
+void IPI::reschedule(unsigned int cpu)
+{
+    db<IC>(TRC) << "IPI::reschedule(cpu=" << cpu << ")" << endl;
+
+    if(!online(cpu)) {
+        db<IC>(WRN) << "IPI::reschedule: hart " << cpu << " is not running EPOS!" << endl;
+        return;
+    }
+
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    post(cpu, RESCHEDULE);
+    if(!disabled)
+        CPU::int_enable();
+}
+
+bool IPI::call(unsigned int cpu, Function * function, void * argument)
+{
+    db<IC>(TRC) << "IPI::call(cpu=" << cpu << ",f=" << reinterpret_cast<void *>(function) << ",a=" << argument << ")" << endl;
+
+    if(!online(cpu)) {
+        db<IC>(WRN) << "IPI::call: hart " << cpu << " is not running EPOS!" << endl;
+        return false;
+    }
+
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    if(cpu == CPU::id())
+        function(argument);
+    else
+        wait(cpu, post(cpu, CALL, 0, function, argument));
+    if(!disabled)
+        CPU::int_enable();
+
+    return true;
+}
+
+void IPI::shootdown(Log_Addr addr, unsigned long size)
+{
+    db<IC>(TRC) << "IPI::shootdown(addr=" << addr << ",size=" << size << ")" << endl;
+
+    Ranges ranges;
+    ranges.add(addr, size);
+    shootdown(ranges);
+}
+
+void IPI::shootdown()
+{
+    db<IC>(TRC) << "IPI::shootdown()" << endl;
+
+    Ranges ranges;
+    ranges.full = true;
+    shootdown(ranges);
+}
+
+void IPI::shootdown(const Ranges & ranges)
+{
+    unsigned int self = CPU::id() % CPUS;
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    if(_batching[self])
+        _batches[self].add(ranges);
+    else
+        broadcast(ranges);
+    if(!disabled)
+        CPU::int_enable();
+}
+
+void IPI::begin_batch()
+{
+    unsigned int self = CPU::id() % CPUS;
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    if(!_batching[self]++)
+        _batch_disabled[self] = disabled;
+}
+
+void IPI::end_batch()
+{
+    unsigned int self = CPU::id() % CPUS;
+    assert(CPU::int_disabled() && _batching[self]);
+
+    if(--_batching[self])
+        return;
+
+    db<IC>(TRC) << "IPI::end_batch() => {n=" << _batches[self].count << ",full=" << _batches[self].full << "}" << endl;
+
+    if(!_batches[self].empty()) {
+        broadcast(_batches[self]);
+        _batches[self].clear();
+    }
+    if(!_batch_disabled[self])
+        CPU::int_enable();
+}
+
+// Flushes ranges locally, then has every other hart running EPOS do the same, waiting for them all (interrupts disabled)
+void IPI::broadcast(const Ranges & ranges)
+{
+    unsigned int self = CPU::id();
+    unsigned long tickets[CPUS];
+    Statistics & statistics = mailbox(self).statistics;
+
+    statistics.broadcasts++;
+    ranges.flush(statistics);
+
+    for(unsigned int cpu = 0; cpu < HARTS; cpu++)
+        if((cpu != self) && online(cpu))
+            tickets[cpu % CPUS] = post(cpu, SHOOTDOWN, &ranges);
+
+    for(unsigned int cpu = 0; cpu < HARTS; cpu++)
+        if((cpu != self) && online(cpu))
+            wait(cpu, tickets[cpu % CPUS]);
+}
+
+// Interrupts disabled; returns the message's ticket, which tells wait() when the target has handled it
+unsigned long IPI::post(unsigned int cpu, Message message, const Ranges * ranges, Function * function, void * argument)
+{
+    Mailbox & box = mailbox(cpu);
+
+    acquire(box);
+    while((message == CALL) && (box.count == CALLS)) {
+        release(box);
+        serve(SHOOTDOWN | CALL); // the target might be waiting for us to take its own calls
+        acquire(box);
+    }
+
+    box.messages = box.messages | message;
+    if(ranges)
+        box.ranges.add(*ranges);
+    if(function) {
+        box.calls[box.count].function = function;
+        box.calls[box.count].argument = argument;
+        box.count++;
+    }
+    unsigned long ticket = ++box.posted;
+    release(box);
+
+    IC::ipi(cpu, IC::INT_IPI);
+
+    return ticket;
+}
+
+// Interrupts disabled; handles the given messages that are in this hart's mailbox and returns which they were
+unsigned int IPI::serve(unsigned int messages)
+{
+    Mailbox & box = mailbox(CPU::id());
+    Ranges ranges;
+    Call calls[CALLS];
+    unsigned int count = 0;
+
+    acquire(box);
+    messages &= box.messages;
+    box.messages = box.messages & ~messages;
+    if(messages & SHOOTDOWN) {
+        ranges = box.ranges;
+        box.ranges.clear();
+    }
+    if(messages & CALL) {
+        count = box.count;
+        for(unsigned int i = 0; i < count; i++)
+            calls[i] = box.calls[i];
+        box.count = 0;
+    }
+    unsigned long ticket = box.posted;
+    release(box);
+
+    if(messages & SHOOTDOWN)
+        ranges.flush(box.statistics);
+    for(unsigned int i = 0; i < count; i++)
+        calls[i].function(calls[i].argument);
+
+    // A pending reschedule doesn't hold senders back, since none waits for it
+    box.served = ticket;
+
+    return messages;
+}
+
+// Interrupts disabled
+void IPI::wait(unsigned int cpu, unsigned long ticket)
+{
+    Mailbox & box = mailbox(cpu);
+    Mailbox & own = mailbox(CPU::id());
+
+    while(box.served < ticket)
+        if(own.messages & (SHOOTDOWN | CALL))
+            serve(SHOOTDOWN | CALL);
+}
+
+void IPI::int_handler(IC::Interrupt_Id i)
+{
+    IC::ipi_eoi(i); // before looking into the mailbox, so anything posted from now on raises it again
+
+    unsigned int messages = serve(RESCHEDULE | SHOOTDOWN | CALL);
+
+    db<IC>(TRC) << "IPI::int_handler(cpu=" << CPU::id() << ",m=" << hex << messages << dec << ")" << endl;
+
+    if(messages & RESCHEDULE) {
+        Thread::lock();
+        Thread::reschedule();
+        Thread::unlock();
+    }
 }
 
 __END_SYS
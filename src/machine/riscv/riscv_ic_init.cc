@@ -27,6 +27,23 @@ void IC::init()
     // Set all interrupt handlers to int_not()
     for(Interrupt_Id i = EXCS; i < INTS; i++)
         _int_vector[i] = &int_not;
+
+    // Take this hart in for inter-processor messages
+    IPI::init();
+
+    // Let all PLIC sources through this hart's context, but keep them individually disabled until a handler is registered
+    for(unsigned int i = 1; i < PLIC::IRQS; i++)
+        PLIC::disable(i);
+    PLIC::threshold(0);
+}
+
+void IPI::init()
+{
+    db<Init, IC>(TRC) << "IPI::init(cpu=" << CPU::id() << ")" << endl;
+
+    CLINT::msip(CPU::id(), false);
+    IC::int_vector(IC::INT_IPI, &int_handler);
+    _online = _online | (1UL << CPU::id());
 }
 
 __END_SYS
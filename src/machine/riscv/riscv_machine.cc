@@ -5,12 +5,24 @@
 
 __BEGIN_SYS
 
+extern OStream kout;
+
+// Output still held by the kernel's streams (i.e. without a trailing endl) goes out with the rest
+static void flush(bool panicking = false)
+{
+    kout.flush();
+    kerr.flush();
+    Display::flush(panicking);
+}
+
 void Machine::panic()
 {
     CPU::int_disable();
 
-    if(Traits<Display>::enabled)
+    if(Traits<Display>::enabled) {
+        flush(true);
         Display::puts("\nPANIC!\n");
+    }
 
     if(Traits<System>::reboot)
         reboot();
@@ -29,6 +41,13 @@ void Machine::reboot()
 #endif
 
         CPU::int_disable();
+        flush();
+
+#ifdef __virt__
+        volatile CPU::Reg32 * test = reinterpret_cast<volatile CPU::Reg32 *>(Memory_Map::TEST_BASE);
+        test[0] = 0x7777; // reset
+#endif
+
         CPU::halt();
     } else {
         poweroff();
@@ -45,6 +64,13 @@ void Machine::poweroff()
 #endif
 
         CPU::int_disable();
+        flush();
+
+#ifdef __virt__
+        volatile CPU::Reg32 * test = reinterpret_cast<volatile CPU::Reg32 *>(Memory_Map::TEST_BASE);
+        test[0] = 0x5555; // pass (i.e. power off with exit status 0)
+#endif
+
         CPU::halt();
 }
 
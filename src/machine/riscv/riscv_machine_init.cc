@@ -22,11 +22,31 @@ void Machine::init()
 {
     db<Init, Machine>(TRC) << "Machine::init()" << endl;
 
-    if(Traits<IC>::enabled)
+    if(Traits<IC>::enabled) {
         IC::init();
 
+        // From now on, the console is drained by the UART's TX interrupt (SiFive_UART always drives UART0)
+        if(Traits<Serial_Display>::enabled && Traits<Serial_Display>::buffered) {
+            IC::int_vector(IC::INT_UART0, &Display::int_handler);
+            IC::enable(IC::INT_UART0);
+            Display::buffering(true);
+        }
+    }
+
     if(Traits<Timer>::enabled)
         Timer::init();
+
+#ifdef __NIC_H
+#ifdef __ethernet__
+    if(Traits<Ethernet>::enabled)
+        Initializer<Ethernet>::init();
+#endif
+#endif
+
+#ifdef __BLOCK_H
+    if(Traits<Block>::enabled)
+        Initializer<Block>::init();
+#endif
 }
 
 __END_SYS
@@ -0,0 +1,359 @@
+// EPOS RISC-V Cadence GEM Ethernet NIC Mediator Implementation
+
+#include <machine/nic.h>
+#include <interrupt.h>
+
+#if defined(__NIC_H) && defined(__sifive_u__)
+
+__BEGIN_SYS
+
+// Class attributes
+GEM * GEM::_devices[UNITS];
+
+
+// Methods
+GEM::GEM(unsigned int unit, DMA_Buffer * dma): _unit(unit), _dma(dma), _rx_cur(0), _tx_cur(0)
+{
+    db<GEM>(TRC) << "GEM(unit=" << unit << ",dma=" << *dma << ")" << endl;
+
+    _dma_phy = dma->phy_address();
+    _dma_log = dma->log_address();
+
+    // Rings first, then the buffers, which the descriptors point to
+    Reg log = _dma_log;
+    _rx_ring = reinterpret_cast<Rx_Desc *>(log);
+    log += RX_BUFS * sizeof(Rx_Desc);
+    _tx_ring = reinterpret_cast<Tx_Desc *>(log);
+    log += TX_BUFS * sizeof(Tx_Desc);
+    log = (log + 63) & ~63UL;
+
+    for(unsigned int i = 0; i < RX_BUFS; i++, log += BUFFER_STRIDE)
+        _rx_buffer[i] = new (reinterpret_cast<void *>(log)) Buffer(this, &_rx_ring[i]);
+    for(unsigned int i = 0; i < TX_BUFS; i++, log += BUFFER_STRIDE)
+        _tx_buffer[i] = new (reinterpret_cast<void *>(log)) Buffer(this, &_tx_ring[i]);
+
+    _rx_ready = new (SYSTEM) Semaphore(0);
+    _rx_handler = new (SYSTEM) Functor_Handler<GEM>(&poll, this);
+    _rx_tasklet = new (SYSTEM) Tasklet(_rx_handler);
+
+    reset();
+}
+
+GEM::~GEM()
+{
+    db<GEM>(TRC) << "~GEM(unit=" << _unit << ")" << endl;
+
+    reg(NWCTRL) = 0;
+    reg(IDR) = ~0U;
+    IC::disable(IC::INT_ETH);
+    _devices[_unit] = 0;
+
+    delete _rx_tasklet;
+    delete _rx_handler;
+    delete _rx_ready;
+    delete _dma;
+}
+
+void GEM::reset()
+{
+    db<GEM>(TRC) << "GEM::reset()" << endl;
+
+    // Stop the MAC, mask and acknowledge all interrupts, and clear the statistics registers
+    reg(NWCTRL) = 0;
+    reg(IDR) = ~0U;
+    reg(ISR) = reg(ISR);
+    reg(TXSR) = ~0U;
+    reg(RXSR) = ~0U;
+    reg(NWCTRL) = STATCLR;
+
+    // All receive buffers belong to the MAC and all transmit buffers to software
+    for(unsigned int i = 0; i < RX_BUFS; i++) {
+        _rx_held[i] = false;
+        _rx_ring[i].ctrl = 0;
+        _rx_ring[i].addr = (phy(_rx_buffer[i]->frame()) & Rx_Desc::ADDR) | ((i == RX_BUFS - 1) ? Rx_Desc::WRAP : 0);
+    }
+    for(unsigned int i = 0; i < TX_BUFS; i++) {
+        _tx_ring[i].addr = phy(_tx_buffer[i]->frame());
+        _tx_ring[i].ctrl = Tx_Desc::USED | ((i == TX_BUFS - 1) ? Tx_Desc::WRAP : 0);
+        _tx_buffer[i]->unlock();
+    }
+    _rx_cur = 0;
+    _tx_cur = 0;
+    CPU::fence();
+
+    reg(NWCFG) = FDUP | GIGE | FCSREM | MDCDIV | (Traits<Ethernet>::promiscuous ? CAF : 0);
+    reg(DMACFG) = ((RX_BUFFER_SIZE / 64) << RXBUF) | BLENGTH;
+    reg(RXQBASE) = phy(_rx_ring);
+    reg(TXQBASE) = phy(_tx_ring);
+
+    // Keep the address the MAC was given (e.g. by QEMU's "-nic ...,mac="), or make up a locally administered one
+    Address a;
+    Reg32 lo = reg(SPADDR1LO);
+    Reg32 hi = reg(SPADDR1HI);
+    for(unsigned int i = 0; i < 4; i++)
+        a[i] = lo >> (i * 8);
+    a[4] = hi;
+    a[5] = hi >> 8;
+    if(!a) {
+        a = Address("02:45:50:4f:53:00");
+        a[5] = _unit + 1;
+    }
+    address(a);
+
+    // Hardware interrupt moderation, in 800 ns units (not emulated by QEMU, where the Tasklet alone batches frames)
+    reg(MODERATION) = (Traits<GEM>::RECEIVE_MODERATION * 1000 / 800) & 0xff;
+
+    reg(IER) = INT_RX | INT_HRESP;
+    reg(NWCTRL) = RXEN | TXEN;
+}
+
+void GEM::address(const Address & address)
+{
+    db<GEM>(TRC) << "GEM::address(a=" << address << ")" << endl;
+
+    _address = address;
+
+    // The filter is only enabled once the top half is written
+    reg(SPADDR1LO) = address[0] | (address[1] << 8) | (address[2] << 16) | (Reg32(address[3]) << 24);
+    reg(SPADDR1HI) = address[4] | (address[5] << 8);
+}
+
+int GEM::send(const Address & dst, const Protocol & prot, const void * data, unsigned int size)
+{
+    db<GEM>(TRC) << "GEM::send(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",d=" << data << ",s=" << size << ")" << endl;
+
+    Buffer * buf = alloc(dst, prot, 0, 0, size);
+    if(!buf)
+        return 0;
+
+    memcpy(buf->frame()->data<void>(), data, size);
+
+    return send(buf) ? size : 0;
+}
+
+int GEM::receive(Address * src, Protocol * prot, void * data, unsigned int size)
+{
+    db<GEM>(TRC) << "GEM::receive(s=" << src << ",p=" << prot << ",d=" << data << ",s=" << size << ")" << endl;
+
+    // The semaphore is signaled once per unclaimed frame, but some of them may have been dropped in the meantime
+    Buffer * buf;
+    while(!(buf = take()))
+        _rx_ready->p();
+
+    Frame * frame = buf->frame();
+    *src = frame->src();
+    *prot = frame->prot();
+
+    unsigned int length = buf->size() - HEADER_SIZE;
+    if(length > size)
+        length = size;
+    memcpy(data, frame->data<void>(), length);
+
+    free(buf);
+
+    return length;
+}
+
+GEM::Buffer * GEM::alloc(const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload)
+{
+    db<GEM>(TRC) << "GEM::alloc(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",on=" << once << ",al=" << always << ",ld=" << payload << ")" << endl;
+
+    unsigned int size = once + always + payload;
+    if(size > MTU) {
+        db<GEM>(WRN) << "GEM::alloc: frame too large (" << size << " > " << MTU << ")!" << endl;
+        return 0;
+    }
+
+    // Buffers are handed out in ring order, which is the order in which the MAC sends them, so a buffer whose frame
+    // is still to be sent (or that someone else is still filling) is waited for instead of skipped
+    unsigned int i = CPU::finc(_tx_cur) % TX_BUFS;
+    Buffer * buf = _tx_buffer[i];
+    Tx_Desc * desc = &_tx_ring[i];
+    while(!buf->lock()) {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        _tx_lock.acquire();
+        bool sent = (desc->ctrl & (Tx_Desc::USED | Tx_Desc::LAST)) == (Tx_Desc::USED | Tx_Desc::LAST);
+        if(sent)
+            desc->ctrl = Tx_Desc::USED | (desc->ctrl & Tx_Desc::WRAP); // the lock passes on to the new owner
+        _tx_lock.release();
+        if(!disabled)
+            CPU::int_enable();
+
+        if(sent)
+            break;
+
+        Thread::yield();
+    }
+
+    *buf->frame()->header() = Header(_address, dst, prot);
+    buf->size(HEADER_SIZE + size);
+
+    db<GEM>(INF) << "GEM::alloc:buf=" << buf << " => " << *buf << endl;
+
+    return buf;
+}
+
+int GEM::send(Buffer * buf)
+{
+    db<GEM>(TRC) << "GEM::send(buf=" << buf << ")" << endl;
+
+    Tx_Desc * desc = reinterpret_cast<Tx_Desc *>(buf->shadow());
+    unsigned int size = buf->size();
+
+    // The frame must reach memory before the MAC gets the descriptor, and the descriptor before the MAC is kicked
+    CPU::fence();
+    desc->ctrl = (desc->ctrl & Tx_Desc::WRAP) | Tx_Desc::LAST | (size & Tx_Desc::SIZE);
+    CPU::fence();
+    reg(NWCTRL) = (reg(NWCTRL) & (RXEN | TXEN)) | TXSTART;
+
+    _statistics.tx_packets++;
+    _statistics.tx_bytes += size;
+
+    return size;
+}
+
+void GEM::free(Buffer * buf)
+{
+    db<GEM>(TRC) << "GEM::free(buf=" << buf << ")" << endl;
+
+    if(rx_mine(buf))
+        rx_rearm(buf);
+    else {
+        // Allocated, but not sent
+        Tx_Desc * desc = reinterpret_cast<Tx_Desc *>(buf->shadow());
+        desc->ctrl = Tx_Desc::USED | (desc->ctrl & Tx_Desc::WRAP);
+        buf->unlock();
+    }
+}
+
+void GEM::rx_rearm(Buffer * buf)
+{
+    Rx_Desc * desc = reinterpret_cast<Rx_Desc *>(buf->shadow());
+    desc->ctrl = 0;
+    CPU::fence();
+    desc->addr = desc->addr & ~Rx_Desc::OWN;
+
+    // Only once the MAC owns the descriptor again may poll() go past it, or it would take the old frame once more
+    CPU::fence();
+    _rx_held[desc - _rx_ring] = false;
+
+    // The MAC stops at descriptors it doesn't own, so if it has hit this one, it must be told to look again
+    CPU::fence();
+    if(reg(RXSR) & RX_USED) {
+        reg(RXSR) = RX_USED;
+        reg(NWCTRL) = reg(NWCTRL) & (RXEN | TXEN);
+    }
+}
+
+GEM::Buffer * GEM::take()
+{
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _rx_lock.acquire();
+    Buffer::Element * e = _rx_unclaimed.remove();
+    _rx_lock.release();
+    if(!disabled)
+        CPU::int_enable();
+
+    return e ? e->object() : 0;
+}
+
+
+// Class methods
+void GEM::poll(GEM * nic)
+{
+    unsigned int n = 0;
+    for(; n < RX_BUDGET; n++) {
+        // A descriptor stays OWN while its buffer is up with an observer or in _rx_unclaimed, so once _rx_cur wraps
+        // around, the ring ends at the first one that is still held
+        Rx_Desc * desc = &nic->_rx_ring[nic->_rx_cur];
+        if(nic->_rx_held[nic->_rx_cur] || !(desc->addr & Rx_Desc::OWN))
+            break;
+        CPU::fence();
+
+        Buffer * buf = nic->_rx_buffer[nic->_rx_cur];
+        nic->_rx_held[nic->_rx_cur] = true;
+        nic->_rx_cur = (nic->_rx_cur + 1) % RX_BUFS;
+
+        // Frames never span buffers, since these are large enough for any frame the MAC accepts
+        Reg32 ctrl = desc->ctrl;
+        if((ctrl & (Rx_Desc::SOF | Rx_Desc::EOF)) != (Rx_Desc::SOF | Rx_Desc::EOF)) {
+            nic->_statistics.rx_drops++;
+            nic->rx_rearm(buf);
+            continue;
+        }
+
+        buf->size(ctrl & Rx_Desc::SIZE);
+        nic->_statistics.rx_packets++;
+        nic->_statistics.rx_bytes += buf->size();
+
+        Frame * frame = buf->frame();
+        db<GEM>(INF) << "GEM::poll:frame=" << *frame->header() << ",size=" << buf->size() << endl;
+
+        // Observers take the buffer and free it when they are done; frames no one claims are kept for receive()
+        if(nic->notify(frame->prot(), buf))
+            continue;
+
+        Buffer * dropped = 0;
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        nic->_rx_lock.acquire();
+        nic->_rx_unclaimed.insert(buf->link());
+        if(nic->_rx_unclaimed.size() > RX_UNCLAIMED)
+            dropped = nic->_rx_unclaimed.remove()->object();
+        nic->_rx_lock.release();
+        if(!disabled)
+            CPU::int_enable();
+
+        if(dropped) {
+            nic->_statistics.rx_drops++;
+            nic->rx_rearm(dropped);
+        }
+
+        nic->_rx_ready->v();
+    }
+
+    // With the budget exhausted, the ring is likely to have more frames, which will be taken by the next run, at the
+    // end of the next interrupt, so the rest of the system gets a chance to run in between
+    if(n == RX_BUDGET)
+        nic->_rx_tasklet->schedule();
+    else {
+        reg(IER) = INT_RX;
+
+        // Frames that arrive while the interrupt is masked may not raise it once unmasked (QEMU doesn't latch them)
+        CPU::fence();
+        if(!nic->_rx_held[nic->_rx_cur] && (nic->_rx_ring[nic->_rx_cur].addr & Rx_Desc::OWN)) {
+            reg(IDR) = INT_RX;
+            nic->_rx_tasklet->schedule();
+        }
+    }
+}
+
+void GEM::int_handler(IC::Interrupt_Id interrupt)
+{
+    GEM * nic = _devices[0];
+
+    Reg32 isr = reg(ISR);
+    db<GEM>(TRC) << "GEM::int_handler(int=" << interrupt << ",isr=" << hex << isr << dec << ")" << endl;
+
+    if(isr & (INT_RXUSED | INT_RXOVR)) {
+        Reg32 rsr = reg(RXSR);
+        if(rsr & RX_OVR)
+            nic->_statistics.rx_overruns++;
+        reg(RXSR) = rsr & RX_OVR; // RX_USED is left for rx_rearm() to find
+    }
+
+    if(isr & INT_HRESP)
+        db<GEM>(WRN) << "GEM::int_handler: DMA bus error!" << endl;
+
+    // Receive interrupts stay masked until the Tasklet catches up with the ring
+    if(isr & INT_RX) {
+        reg(IDR) = INT_RX;
+        nic->_rx_tasklet->schedule();
+    }
+}
+
+__END_SYS
+
+#endif
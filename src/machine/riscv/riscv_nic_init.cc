@@ -0,0 +1,30 @@
+// EPOS RISC-V Cadence GEM Ethernet NIC Mediator Initialization
+
+#include <machine/nic.h>
+#include <system.h>
+
+#if defined(__NIC_H) && defined(__sifive_u__)
+
+__BEGIN_SYS
+
+void GEM::init(unsigned int unit)
+{
+    db<Init, GEM>(TRC) << "GEM::init(unit=" << unit << ")" << endl;
+
+    assert(unit < UNITS);
+
+    // Descriptor rings and buffers share a single DMA_Buffer, with buffers aligned to cache lines
+    unsigned long rings = (RX_BUFS * sizeof(Rx_Desc) + TX_BUFS * sizeof(Tx_Desc) + 63) & ~63UL;
+    DMA_Buffer * dma = new (SYSTEM) DMA_Buffer(rings + (RX_BUFS + TX_BUFS) * BUFFER_STRIDE);
+
+    _devices[unit] = new (SYSTEM) GEM(unit, dma);
+
+    db<Init, GEM>(INF) << "GEM::init: " << _devices[unit]->address() << endl;
+
+    IC::int_vector(IC::INT_ETH, &int_handler);
+    IC::enable(IC::INT_ETH);
+}
+
+__END_SYS
+
+#endif
@@ -0,0 +1,134 @@
+// EPOS RISC-V SiFive-U Platform DMA Engine (PDMA) Mediator Implementation
+
+#include <machine/ic.h>
+
+#ifdef __sifive_u__
+
+#include <machine/riscv/riscv_pdma.h>
+
+__BEGIN_SYS
+
+// Class attributes
+PDMA * PDMA::_channels[CHANNELS];
+
+
+// Methods
+PDMA::PDMA(unsigned int channel, Phy_Addr window): _channel(channel), _window(window), _interrupt(IC::INT_PDMA0 + channel * 2)
+{
+    db<PDMA>(TRC) << "PDMA(ch=" << channel << ",w=" << window << ")" << endl;
+
+    assert((channel < CHANNELS) && !_channels[channel]);
+    _channels[channel] = this;
+
+    reg(CONTROL) = CLAIM;
+
+    IC::int_vector(_interrupt, &int_handler);
+    IC::int_vector(_interrupt + 1, &int_handler);
+    IC::enable(_interrupt);
+    IC::enable(_interrupt + 1);
+}
+
+PDMA::~PDMA()
+{
+    db<PDMA>(TRC) << "~PDMA(ch=" << _channel << ")" << endl;
+
+    IC::disable(_interrupt);
+    IC::disable(_interrupt + 1);
+    reg(CONTROL) = 0;
+    _channels[_channel] = 0;
+}
+
+bool PDMA::submit(IO_Request * request)
+{
+    db<PDMA>(TRC) << "PDMA::submit(r=" << request << " => " << *request << ")" << endl;
+
+    if(request->operation() != IO_Request::READ) {
+        db<PDMA>(WRN) << "PDMA::submit: unsupported operation (" << request->operation() << ")!" << endl;
+        return false;
+    }
+
+    request->start();
+    if(!request->size()) {
+        request->finish();
+        return true;
+    }
+
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _requests.insert(request->link());
+    if(_requests.size() == 1)
+        start(request);
+    if(!disabled)
+        CPU::int_enable();
+
+    return true;
+}
+
+void PDMA::start(IO_Request * request)
+{
+    Reg bytes = request->size();
+    Reg destination = reinterpret_cast<Reg>(request->data());
+    Reg source = Reg(_window) + request->position();
+
+    // Transactions as large as the alignment of both addresses and of the size allow
+    unsigned int size = MAX_TRANSACTION;
+    while(size && ((bytes | destination | source) & ((1UL << size) - 1)))
+        size--;
+
+    db<PDMA>(INF) << "PDMA::start(ch=" << _channel << ",dst=" << hex << destination << ",src=" << source << dec << ",n=" << bytes << ",t=" << (1 << size) << ")" << endl;
+
+    reg(NEXT_CONFIG) = (size << WSIZE) | (size << RSIZE);
+    reg64(NEXT_BYTES) = bytes;
+    reg64(NEXT_DESTINATION) = destination;
+    reg64(NEXT_SOURCE) = source;
+    request->issue(bytes);
+
+    reg(CONTROL) = CLAIM | DONE_IE | ERROR_IE | RUN;
+}
+
+
+// Class methods
+void PDMA::int_handler(IC::Interrupt_Id interrupt)
+{
+    for(unsigned int i = 0; i < CHANNELS; i++) {
+        PDMA * pdma = _channels[i];
+        if(!pdma || ((interrupt != pdma->_interrupt) && (interrupt != pdma->_interrupt + 1)))
+            continue;
+
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+
+        Reg32 control = pdma->reg(CONTROL);
+        IO_Request * request = 0;
+        if(control & (DONE | ERROR)) {
+            IO_Request::Element * e = pdma->_requests.remove_head();
+            if(e) {
+                request = e->object();
+                if(control & ERROR)
+                    request->fail();
+                else
+                    request->progress(request->size());
+            }
+
+            // Clearing DONE and ERROR also clears the interrupt
+            pdma->reg(CONTROL) = CLAIM;
+            if(!pdma->_requests.empty())
+                pdma->start(pdma->_requests.head()->object());
+        }
+
+        if(!disabled)
+            CPU::int_enable();
+
+        db<PDMA>(TRC) << "PDMA::int_handler(int=" << interrupt << ",ctrl=" << hex << control << dec << ")" << endl;
+
+        if(control & ERROR)
+            db<PDMA>(WRN) << "PDMA::int_handler: transfer failed (ch=" << i << ")!" << endl;
+
+        if(request)
+            request->finish();
+    }
+}
+
+__END_SYS
+
+#endif
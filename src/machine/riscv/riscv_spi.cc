@@ -0,0 +1,333 @@
+// EPOS RISC-V SPI Mediator Implementation
+
+#include <machine/spi.h>
+
+#ifdef __SPI_H
+
+#include <machine/machine.h>
+#include <utility/string.h>
+
+__BEGIN_SYS
+
+// Class attributes
+SPI * SPI::_units[UNITS];
+
+
+// Methods
+SPI::SPI(unsigned int unit, const Protocol & protocol, const Mode & mode, unsigned int bit_rate, unsigned int data_bits)
+: _unit(unit), _current(0), _xip(false), _pdma(0)
+{
+    db<SPI>(TRC) << "SPI(u=" << unit << ",p=" << protocol << ",m=" << mode << ",br=" << bit_rate << ",db=" << data_bits << ")" << endl;
+
+    assert((unit < UNITS) && !_units[unit]);
+    _units[unit] = this;
+
+    switch(unit) {
+    default:
+    case 0: _base = Memory_Map::SPI0_BASE; _interrupt = IC::INT_QSPI0; break;
+    case 1: _base = Memory_Map::SPI1_BASE; _interrupt = IC::INT_QSPI1; break;
+    case 2: _base = Memory_Map::SPI2_BASE; _interrupt = IC::INT_QSPI2; break;
+    }
+
+    // QSPI0 comes out of reset mapping the boot flash into memory, but programmed I/O is what we start with
+    if(unit < 2)
+        reg(FCTRL) = 0;
+    reg(IE) = 0;
+
+    config(protocol, mode, bit_rate, data_bits);
+
+    if(dma && (unit == 0))
+        _pdma = new (SYSTEM) PDMA(Traits<SPI>::DMA_CHANNEL, Memory_Map::FLASH_BASE);
+
+    IC::int_vector(_interrupt, &int_handler);
+    IC::enable(_interrupt);
+}
+
+SPI::~SPI()
+{
+    db<SPI>(TRC) << "~SPI(u=" << _unit << ")" << endl;
+
+    IC::disable(_interrupt);
+    reg(IE) = 0;
+    reg(CSMODE) = CS_AUTO;
+    if(_pdma)
+        delete _pdma;
+    _units[_unit] = 0;
+}
+
+void SPI::config(const Protocol & protocol, const Mode & mode, unsigned int bit_rate, unsigned int data_bits)
+{
+    db<SPI>(TRC) << "SPI::config(p=" << protocol << ",m=" << mode << ",br=" << bit_rate << ",db=" << data_bits << ")" << endl;
+
+    if(mode != MASTER)
+        db<SPI>(WRN) << "SPI::config: only master mode is supported!" << endl;
+    if((data_bits == 0) || (data_bits > 8)) {
+        db<SPI>(WRN) << "SPI::config: frames must have from 1 to 8 bits!" << endl;
+        data_bits = 8;
+    }
+
+    // The closest rate not above the requested one
+    unsigned int div = (CLOCK + 2 * bit_rate - 1) / (2 * bit_rate);
+    reg(SCKDIV) = div ? div - 1 : 0;
+    reg(SCKMODE) = 0;
+    reg(CSID) = 0;
+    reg(CSMODE) = CS_AUTO;
+    reg(FMT) = (protocol & PROTO) | (data_bits << 16);
+    reg(TXMARK) = 1;
+    reg(RXMARK) = 0;
+}
+
+void SPI::config(Protocol * protocol, Mode * mode, unsigned int * bit_rate, unsigned int * data_bits)
+{
+    Reg32 fmt = reg(FMT);
+
+    if(protocol)
+        *protocol = Protocol(fmt & PROTO);
+    if(mode)
+        *mode = MASTER;
+    if(bit_rate)
+        *bit_rate = CLOCK / (2 * ((reg(SCKDIV) & 0xfff) + 1));
+    if(data_bits)
+        *data_bits = (fmt & LEN) >> 16;
+
+    db<SPI>(TRC) << "SPI::config(p=" << (fmt & PROTO) << ",br=" << CLOCK / (2 * ((reg(SCKDIV) & 0xfff) + 1)) << ",db=" << ((fmt & LEN) >> 16) << ")" << endl;
+}
+
+// Keeps as many frames in flight as the RX FIFO can take, each of them a FILLER frame
+int SPI::read(char * data, unsigned int max_size)
+{
+    unsigned int sent = 0;
+    unsigned int received = 0;
+    int frame;
+    while(received < max_size) {
+        while((sent < max_size) && (sent - received < FIFO_DEPTH) && try_put(FILLER))
+            sent++;
+        if(try_get(&frame))
+            data[received++] = frame;
+    }
+    return max_size;
+}
+
+// With DIR set, the RX FIFO is left alone, so there is nothing to drain afterwards
+int SPI::write(const char * data, unsigned int size)
+{
+    reg(FMT) = reg(FMT) | DIR;
+    for(unsigned int i = 0; i < size; i++)
+        put(data[i]);
+    flush();
+    reg(FMT) = reg(FMT) & ~DIR;
+    return size;
+}
+
+bool SPI::submit(IO_Request * request)
+{
+    db<SPI>(TRC) << "SPI::submit(r=" << request << " => " << *request << ")" << endl;
+
+    switch(request->operation()) {
+    case IO_Request::READ:
+    case IO_Request::WRITE:
+    case IO_Request::TRANSFER:
+    case IO_Request::FLUSH:
+        break;
+    default:
+        db<SPI>(WRN) << "SPI::submit: unsupported operation (" << request->operation() << ")!" << endl;
+        return false;
+    }
+
+    // Dual and quad lanes only go one way at a time
+    if((request->operation() == IO_Request::TRANSFER) && ((reg(FMT) & PROTO) != Si5_SINGLE)) {
+        db<SPI>(WRN) << "SPI::submit: full-duplex transfers need a single lane!" << endl;
+        return false;
+    }
+
+    if(_xip) {
+        db<SPI>(WRN) << "SPI::submit: programmed I/O is off while the flash is mapped into memory!" << endl;
+        return false;
+    }
+
+    request->start();
+
+    IO_Request::List finished;
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _requests.insert(request->link());
+    pump(&finished);
+    if(!disabled)
+        CPU::int_enable();
+
+    IO_Request::finish(&finished);
+
+    return true;
+}
+
+bool SPI::xip(bool enable, unsigned char command, unsigned int address_bytes, unsigned int dummy_cycles, const Protocol & data)
+{
+    db<SPI>(TRC) << "SPI::xip(e=" << enable << ",cmd=" << hex << command << dec << ",a=" << address_bytes << ",d=" << dummy_cycles << ",p=" << data << ")" << endl;
+
+    if(_unit != 0) {
+        db<SPI>(WRN) << "SPI::xip: only QSPI0 maps its flash into memory!" << endl;
+        return false;
+    }
+
+    bool ok = false;
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    if(_requests.empty()) {
+        if(enable)
+            reg(FFMT) = CMD_EN | ((address_bytes & 7) << ADDR_LEN) | ((dummy_cycles & 15) << PAD_CNT) | (Si5_SINGLE << CMD_PROTO)
+                      | (Si5_SINGLE << ADDR_PROTO) | ((data & PROTO) << DATA_PROTO) | (command << CMD_CODE);
+        reg(FCTRL) = enable ? FCTRL_EN : 0;
+        _xip = enable;
+        ok = true;
+    }
+    if(!disabled)
+        CPU::int_enable();
+
+    if(!ok)
+        db<SPI>(WRN) << "SPI::xip: there are requests pending!" << endl;
+
+    return ok;
+}
+
+bool SPI::xip_read(IO_Request * request)
+{
+    db<SPI>(TRC) << "SPI::xip_read(r=" << request << " => " << *request << ")" << endl;
+
+    if((request->operation() != IO_Request::READ) || !_xip || !xip_mapped) {
+        db<SPI>(WRN) << "SPI::xip_read: not a READ or the flash is not mapped into memory!" << endl;
+        return false;
+    }
+
+    if(_pdma)
+        return _pdma->submit(request);
+
+    request->start();
+    memcpy(request->data(), reinterpret_cast<const char *>(xip_base()) + request->position(), request->size());
+    request->progress(request->size());
+    request->finish();
+
+    return true;
+}
+
+// Selects the slave for the whole request and sets the direction, which is TX only just for WRITEs on dual or quad
+// lanes, since these can't be sent and received at once
+void SPI::begin(IO_Request * request)
+{
+    _current = request;
+    if(simplex(request))
+        reg(FMT) = reg(FMT) | DIR;
+    else
+        reg(FMT) = reg(FMT) & ~DIR;
+    reg(CSMODE) = CS_HOLD;
+}
+
+// Deselects the slave and restores the watermarks the polled interface relies on
+void SPI::end()
+{
+    _current = 0;
+    reg(CSMODE) = CS_AUTO;
+    reg(FMT) = reg(FMT) & ~DIR;
+    reg(TXMARK) = 1;
+    reg(RXMARK) = 0;
+}
+
+// How long the shift register takes to get a frame out, in us
+unsigned int SPI::frame_time()
+{
+    Reg32 fmt = reg(FMT);
+    unsigned int rate = CLOCK / (2 * ((reg(SCKDIV) & 0xfff) + 1));
+    unsigned int cycles = (((fmt & LEN) >> 16) + (1 << (fmt & PROTO)) - 1) >> (fmt & PROTO);
+    return (cycles * 1000000 + rate - 1) / rate;
+}
+
+// Moves frames between the FIFOs and the request at the head of the queue, which is the only one with frames in them,
+// setting the watermark (and the interrupt) that tells when it is worth coming back, and collecting the requests that
+// got finished, so the caller can notify their owners once interrupts are enabled again
+void SPI::pump(IO_Request::List * finished)
+{
+    Reg32 ie = 0;
+
+    for(IO_Request::Element * e = _requests.head(); e; e = _requests.head()) {
+        IO_Request * request = e->object();
+
+        if(request->operation() != IO_Request::FLUSH) {
+            unsigned char * data = request->data();
+
+            if(request != _current)
+                begin(request);
+
+            if(simplex(request)) {
+                while((request->issued() < request->size()) && try_put(data[request->issued()])) {
+                    request->issue(1);
+                    request->progress(1);
+                }
+                if(request->issued() < request->size()) {
+                    reg(TXMARK) = FIFO_DEPTH / 2;
+                    ie = TXWM;
+                    break;
+                }
+
+                // The slave can only be deselected once the last frame is out, and an empty TX FIFO only means it
+                // has moved to the shift register, with no RX frame to tell when it is done there
+                reg(TXMARK) = 1;
+                if(!(reg(IP) & TXWM)) {
+                    ie = TXWM;
+                    break;
+                }
+                Machine::delay(frame_time());
+            } else {
+                // Single-lane WRITEs get what comes in discarded, which still tells when each frame is out
+                int frame;
+                while((request->count() < request->issued()) && try_get(&frame)) {
+                    if(request->operation() != IO_Request::WRITE)
+                        data[request->count()] = frame;
+                    request->progress(1);
+                }
+
+                while((request->issued() < request->size()) && (request->issued() - request->count() < FIFO_DEPTH)
+                      && try_put((request->operation() == IO_Request::READ) ? FILLER : data[request->issued()]))
+                    request->issue(1);
+
+                if(request->count() < request->size()) {
+                    reg(RXMARK) = request->issued() - request->count() - 1;
+                    ie = RXWM;
+                    break;
+                }
+            }
+
+            end();
+        }
+
+        _requests.remove_head();
+        finished->insert(e);
+    }
+
+    reg(IE) = ie;
+}
+
+
+// Class methods
+void SPI::int_handler(IC::Interrupt_Id interrupt)
+{
+    for(unsigned int i = 0; i < UNITS; i++) {
+        SPI * spi = _units[i];
+        if(!spi || (spi->_interrupt != interrupt))
+            continue;
+
+        db<SPI>(TRC) << "SPI::int_handler(int=" << interrupt << ",ip=" << hex << spi->reg(IP) << dec << ")" << endl;
+
+        // The watermarks are levels, cleared by moving frames or by pump() changing the marks or masking them
+        IO_Request::List finished;
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        spi->pump(&finished);
+        if(!disabled)
+            CPU::int_enable();
+
+        IO_Request::finish(&finished);
+    }
+}
+
+__END_SYS
+
+#endif
@@ -7,6 +7,7 @@ __BEGIN_SYS
 
 // Class attributes
 Timer * Timer::_channels[CHANNELS];
+bool Timer::_sstc;
 
 // Class methods
 void Timer::int_handler(Interrupt_Id i)
@@ -3,6 +3,7 @@
 #include <architecture/cpu.h>
 #include <machine/timer.h>
 #include <machine/ic.h>
+#include <system.h>
 
 __BEGIN_SYS
 
@@ -14,7 +15,12 @@ void Timer::init()
 
     IC::int_vector(IC::INT_SYS_TIMER, int_handler);
 
-    reset();
+#if defined(__sifive_u__) || defined(__virt__)
+    _sstc = Traits<System>::multitask && Traits<Timer>::sstc && System::info()->tm.sstc;
+    db<Init, Timer>(INF) << "Timer::init:sstc=" << _sstc << endl;
+#endif
+
+    rearm();
     IC::enable(IC::INT_SYS_TIMER);
 }
 
@@ -0,0 +1,191 @@
+// EPOS RISC-V UART Mediator Implementation
+
+#include <machine/uart.h>
+#include <machine/display.h>
+#include <synchronizer.h>
+
+__BEGIN_SYS
+
+// Class attributes
+UART * UART::_interrupt_driven;
+
+
+// Class methods
+void UART::interrupt_driven(bool enable)
+{
+    db<UART>(TRC) << "UART::interrupt_driven(e=" << enable << ")" << endl;
+
+    if(enable == bool(_buffers))
+        return;
+
+    if(enable) {
+        assert(!_interrupt_driven);
+
+        _buffers = new (SYSTEM) Buffers;
+        _interrupt_driven = this;
+
+        IC::int_vector(IC::INT_UART0, &int_handler);
+        IC::enable(IC::INT_UART0);
+        int_enable(true, false);
+    } else {
+        buffered_flush();
+        int_disable(true, true);
+
+        // Reads still waiting for characters won't get them anymore
+        IO_Request::List finished;
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        while(IO_Request::Element * e = _buffers->reads.remove()) {
+            e->object()->fail();
+            finished.insert(e);
+        }
+        if(!disabled)
+            CPU::int_enable();
+        IO_Request::finish(&finished);
+
+        // Give the interrupt back to the console, if it is buffered
+        if(Traits<Serial_Display>::enabled && Traits<Serial_Display>::buffered)
+            IC::int_vector(IC::INT_UART0, &Serial_Display::int_handler);
+        else
+            IC::disable(IC::INT_UART0);
+
+        _interrupt_driven = 0;
+        delete _buffers;
+        _buffers = 0;
+    }
+}
+
+bool UART::submit(IO_Request * request)
+{
+    db<UART>(TRC) << "UART::submit(r=" << request << " => " << *request << ")" << endl;
+
+    if(!_buffers) {
+        db<UART>(WRN) << "UART::submit: asynchronous requests need interrupt-driven I/O!" << endl;
+        return false;
+    }
+
+    IO_Request::List * queue;
+    switch(request->operation()) {
+    case IO_Request::READ: queue = &_buffers->reads; break;
+    case IO_Request::WRITE:
+    case IO_Request::FLUSH: queue = &_buffers->writes; break;
+    default:
+        db<UART>(WRN) << "UART::submit: unsupported operation (" << request->operation() << ")!" << endl;
+        return false;
+    }
+
+    request->start();
+
+    IO_Request::List finished;
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    queue->insert(request->link());
+    pump(&finished);
+    if(!disabled)
+        CPU::int_enable();
+
+    IO_Request::finish(&finished);
+
+    return true;
+}
+
+int UART::buffered_read(char * data, unsigned int max_size)
+{
+    IO_Request request(IO_Request::READ, data, max_size);
+    return buffered(&request);
+}
+
+int UART::buffered_write(const char * data, unsigned int size)
+{
+    IO_Request request(IO_Request::WRITE, const_cast<char *>(data), size);
+    return buffered(&request);
+}
+
+void UART::buffered_flush()
+{
+    IO_Request request(IO_Request::FLUSH, 0, 0);
+    buffered(&request);
+}
+
+int UART::buffered(IO_Request * request)
+{
+    Semaphore done(0);
+    Semaphore_Handler handler(&done);
+    request->handler(&handler);
+    submit(request);
+    done.p();
+
+    return request->count();
+}
+
+// Moves characters from the RX ring to pending reads and from pending writes to the TX ring, collecting the requests
+// that got finished, so the caller can notify their owners once interrupts are enabled again
+void UART::pump(IO_Request::List * finished)
+{
+    Buffers * buffers = _buffers;
+
+    for(IO_Request::Element * e = buffers->reads.head(); e; e = buffers->reads.head()) {
+        IO_Request * request = e->object();
+        char c;
+        while((request->count() < request->size()) && buffers->rx.remove(&c)) {
+            request->data()[request->count()] = c;
+            request->progress(1);
+        }
+        if(request->count() < request->size())
+            break;
+        buffers->reads.remove_head();
+        finished->insert(e);
+    }
+
+    for(IO_Request::Element * e = buffers->writes.head(); e; e = buffers->writes.head()) {
+        IO_Request * request = e->object();
+        if(request->operation() == IO_Request::FLUSH) {
+            if(!buffers->tx.empty())
+                break;
+        } else {
+            while((request->count() < request->size()) && buffers->tx.insert(request->data()[request->count()]))
+                request->progress(1);
+            if(request->count() < request->size())
+                break;
+        }
+        buffers->writes.remove_head();
+        finished->insert(e);
+    }
+
+    // Pending writes (and flushes) imply characters in the TX ring, which keep the TX interrupt on
+    if(!buffers->tx.empty())
+        int_enable(false, true);
+}
+
+void UART::int_handler(IC::Interrupt_Id i)
+{
+    UART * uart = _interrupt_driven;
+
+    uart->int_disable(false, true);
+
+    // The console shares the UART (and its TX interrupt) when it is buffered
+    if(Traits<Serial_Display>::enabled && Traits<Serial_Display>::buffered)
+        Serial_Display::int_handler(i);
+
+    Buffers * buffers = uart->_buffers;
+
+    // Handlers may nest, so the rings and the queues are only touched with interrupts disabled
+    IO_Request::List finished;
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    while(uart->rxd_ok())
+        if(!buffers->rx.insert(uart->rxd()))
+            db<UART>(WRN) << "UART::int_handler: RX overrun!" << endl;
+    uart->pump(&finished);
+    char c;
+    while(uart->txd_ok() && buffers->tx.remove(&c))
+        uart->txd(c);
+    uart->pump(&finished);
+    if(!disabled)
+        CPU::int_enable();
+
+    // Owners are notified only after the device has been serviced, since Semaphore::v() may reschedule
+    IO_Request::finish(&finished);
+}
+
+__END_SYS
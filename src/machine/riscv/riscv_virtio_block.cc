@@ -0,0 +1,374 @@
+// EPOS RISC-V VirtIO Block Device Mediator Implementation
+
+#include <machine/block.h>
+#include <synchronizer.h>
+#include <process.h>
+
+#if defined(__BLOCK_H) && defined(__virt__)
+
+__BEGIN_SYS
+
+// Class attributes
+VirtIO_Block * VirtIO_Block::_devices[UNITS];
+
+
+// Methods
+VirtIO_Block::VirtIO_Block(unsigned int unit, unsigned int transport, DMA_Buffer * dma)
+: _unit(unit), _transport(transport), _interrupt(IC::INT_VIRTIO0 + transport), _features(0), _sectors(0), _dma(dma), _queue(0), _in_flight(0), _bounce(zero_copy ? 0 : new (SYSTEM) Semaphore(1))
+{
+    db<VirtIO_Block>(TRC) << "VirtIO_Block(unit=" << unit << ",transport=" << transport << ",dma=" << *dma << ")" << endl;
+
+    _dma_phy = dma->phy_address();
+    _dma_log = dma->log_address();
+
+    _requests = reinterpret_cast<Request *>(_dma_log + REQUEST);
+}
+
+VirtIO_Block::~VirtIO_Block()
+{
+    db<VirtIO_Block>(TRC) << "~VirtIO_Block(unit=" << _unit << ")" << endl;
+
+    _transport.reset();
+    IC::disable(_interrupt);
+    _devices[_unit] = 0;
+
+    delete _bounce;
+    delete _queue;
+    delete _dma;
+}
+
+bool VirtIO_Block::reset()
+{
+    db<VirtIO_Block>(TRC) << "VirtIO_Block::reset()" << endl;
+
+    _features = _transport.negotiate(F_RO | F_FLUSH | VirtIO::F_EVENT_IDX, VirtIO::F_VERSION_1 | (Traits<VirtIO>::packed ? VirtIO::F_RING_PACKED : 0));
+    if(!_features)
+        return false;
+
+    delete _queue;
+    _queue = new (SYSTEM) Queue(_dma_log + QUEUE, _dma_phy + QUEUE, _features & VirtIO::F_EVENT_IDX);
+    if(!_transport.queue(0, _queue, QUEUE_SIZE)) {
+        db<VirtIO_Block>(WRN) << "VirtIO_Block::reset: device won't take a queue this large!" << endl;
+        return false;
+    }
+    _queue->enable();
+
+    for(unsigned int i = 0; i < REQUESTS; i++)
+        _requests[i].next = i + 1;
+    _free = 0;
+
+    _sectors = _transport.config<CPU::Reg64>(CONFIG_CAPACITY);
+
+    _transport.ready();
+
+    return true;
+}
+
+bool VirtIO_Block::submit(IO_Request * request)
+{
+    db<VirtIO_Block>(TRC) << "VirtIO_Block::submit(r=" << request << " => " << *request << ")" << endl;
+
+    switch(request->operation()) {
+    case IO_Request::WRITE:
+        if(read_only()) {
+            db<VirtIO_Block>(WRN) << "VirtIO_Block::submit: device is read-only!" << endl;
+            return false;
+        }
+    case IO_Request::READ: {
+        Sector sectors = request->size() / SECTOR_SIZE;
+        if(!sectors || (request->size() % SECTOR_SIZE)) {
+            db<VirtIO_Block>(WRN) << "VirtIO_Block::submit: size must be a (non-zero) multiple of " << SECTOR_SIZE << "!" << endl;
+            return false;
+        }
+        if((request->position() >= _sectors) || (sectors > _sectors - request->position())) {
+            db<VirtIO_Block>(WRN) << "VirtIO_Block::submit: sectors [" << request->position() << "," << request->position() + sectors << ") beyond the end of the device (" << _sectors << ")!" << endl;
+            return false;
+        }
+        // The interrupt handler may run within any address space, so it can't reach the caller's memory to bounce data
+        if(Traits<System>::multitask && !staged(request->data())) {
+            db<VirtIO_Block>(WRN) << "VirtIO_Block::submit: with multitasking, data must be staged by read() and write()!" << endl;
+            return false;
+        }
+    } break;
+    case IO_Request::FLUSH:
+        break;
+    default:
+        db<VirtIO_Block>(WRN) << "VirtIO_Block::submit: unsupported operation (" << request->operation() << ")!" << endl;
+        return false;
+    }
+
+    request->start();
+
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _backlog.insert(request->link());
+    if(!disabled)
+        CPU::int_enable();
+
+    pump();
+
+    return true;
+}
+
+int VirtIO_Block::read(const Sector & from, void * data, unsigned int sectors)
+{
+    db<VirtIO_Block>(TRC) << "VirtIO_Block::read(from=" << from << ",d=" << data << ",n=" << sectors << ")" << endl;
+
+    return transfer(IO_Request::READ, from, data, sectors);
+}
+
+int VirtIO_Block::write(const Sector & to, const void * data, unsigned int sectors)
+{
+    db<VirtIO_Block>(TRC) << "VirtIO_Block::write(to=" << to << ",d=" << data << ",n=" << sectors << ")" << endl;
+
+    return transfer(IO_Request::WRITE, to, const_cast<void *>(data), sectors);
+}
+
+int VirtIO_Block::flush()
+{
+    db<VirtIO_Block>(TRC) << "VirtIO_Block::flush()" << endl;
+
+    Semaphore done(0);
+    Semaphore_Handler handler(&done);
+    IO_Request request(IO_Request::FLUSH, 0, 0, &handler);
+    submit(&request);
+    done.p();
+
+    return (request.status() == IO_Request::DONE) ? 0 : -1;
+}
+
+int VirtIO_Block::transfer(const IO_Request::Operation & operation, const Sector & sector, void * data, unsigned int sectors)
+{
+    if(!sectors)
+        return 0;
+
+    Semaphore done(0);
+    Semaphore_Handler handler(&done);
+
+    if(zero_copy) {
+        IO_Request request(operation, data, sectors * SECTOR_SIZE, &handler, sector);
+        if(!submit(&request))
+            return -1;
+        done.p();
+
+        return (request.status() == IO_Request::DONE) ? int(sectors) : -1;
+    }
+
+    if((sector >= _sectors) || (sectors > _sectors - sector)) {
+        db<VirtIO_Block>(WRN) << "VirtIO_Block::transfer: sectors [" << sector << "," << sector + sectors << ") beyond the end of the device (" << _sectors << ")!" << endl;
+        return -1;
+    }
+
+    // Data are copied to and from the bounce buffer here, within the caller's address space, one piece at a time
+    unsigned char * bounce = reinterpret_cast<unsigned char *>(_dma_log + BOUNCE);
+    unsigned char * d = reinterpret_cast<unsigned char *>(data);
+    int result = sectors;
+
+    _bounce->p();
+    for(unsigned int moved = 0; moved < sectors; ) {
+        unsigned int n = sectors - moved;
+        if(n > MAX_SECTORS)
+            n = MAX_SECTORS;
+
+        if(operation == IO_Request::WRITE)
+            memcpy(bounce, d + moved * SECTOR_SIZE, n * SECTOR_SIZE);
+        IO_Request request(operation, bounce, n * SECTOR_SIZE, &handler, sector + moved);
+        if(!submit(&request)) {
+            result = -1;
+            break;
+        }
+        done.p();
+        if(request.status() != IO_Request::DONE) {
+            result = -1;
+            break;
+        }
+        if(operation == IO_Request::READ)
+            memcpy(d + moved * SECTOR_SIZE, bounce, n * SECTOR_SIZE);
+
+        moved += n;
+    }
+    _bounce->v();
+
+    return result;
+}
+
+void VirtIO_Block::pump()
+{
+    for(;;) {
+        IO_Request * done = 0;
+        bool added = false;
+
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        for(IO_Request::Element * e = _backlog.head(); e; e = _backlog.head()) {
+            IO_Request * io = e->object();
+
+            // Without a write cache, writes are already on stable storage once they complete
+            if((io->operation() == IO_Request::FLUSH) && !(_features & F_FLUSH)) {
+                if(_in_flight)
+                    break;
+                _backlog.remove_head();
+                account(io);
+                done = io;
+                break;
+            }
+
+            if(!issue(io))
+                break;
+            added = true;
+            if(io->issued() == io->size())
+                _backlog.remove_head();
+        }
+        if(!disabled)
+            CPU::int_enable();
+
+        // With EVENT_IDX, a device that is still working on earlier requests will find these by itself
+        if(added)
+            kick();
+
+        if(!done)
+            break;
+        done->finish();
+    }
+}
+
+bool VirtIO_Block::issue(IO_Request * io)
+{
+    if((_free >= REQUESTS) || (_queue->room() < 3))
+        return false;
+
+    unsigned int type;
+    switch(io->operation()) {
+    case IO_Request::READ: type = Header::IN; break;
+    case IO_Request::WRITE: type = Header::OUT; break;
+    default:
+        // A FLUSH only covers writes that have completed, so everything before it must have
+        if(_in_flight)
+            return false;
+        type = Header::FLUSH;
+    }
+
+    unsigned int offset = io->issued();
+    unsigned int bytes = io->size() - offset;
+    if(bytes > MAX_SECTORS * SECTOR_SIZE)
+        bytes = MAX_SECTORS * SECTOR_SIZE;
+
+    // Other than staged data, only the caller's memory in library mode, whose logical addresses are physical ones
+    Reg data = staged(io->data()) ? phy(io->data() + offset) : reinterpret_cast<Reg>(io->data() + offset);
+
+    Request * r = &_requests[_free];
+    _free = r->next;
+
+    r->header.type = type;
+    r->header.reserved = 0;
+    r->header.sector = io->position() + offset / SECTOR_SIZE;
+    r->status = 0xff;
+    r->io = io;
+    r->offset = offset;
+    r->bytes = bytes;
+
+    Segment chain[3];
+    unsigned int n = 0;
+    chain[n++] = Segment(phy(&r->header), sizeof(Header), Segment::OUT);
+    if(bytes)
+        chain[n++] = Segment(data, bytes, (type == Header::IN) ? Segment::IN : Segment::OUT);
+    chain[n++] = Segment(phy(&r->status), 1, Segment::IN);
+    _queue->add(chain, n, r);
+
+    io->issue(bytes);
+    _in_flight++;
+    _statistics.requests++;
+
+    db<VirtIO_Block>(INF) << "VirtIO_Block::issue:req=" << r - _requests << ",t=" << type << ",s=" << r->header.sector << ",b=" << bytes << endl;
+
+    return true;
+}
+
+void VirtIO_Block::kick()
+{
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    bool notify = _queue->kick();
+    if(!disabled)
+        CPU::int_enable();
+
+    if(notify) {
+        _statistics.notifications++;
+        _transport.notify(0);
+    }
+}
+
+void VirtIO_Block::account(IO_Request * io)
+{
+    switch(io->operation()) {
+    case IO_Request::READ:
+        _statistics.reads++;
+        _statistics.read_bytes += io->count();
+        break;
+    case IO_Request::WRITE:
+        _statistics.writes++;
+        _statistics.written_bytes += io->count();
+        break;
+    default:
+        _statistics.flushes++;
+    }
+}
+
+
+// Class methods
+void VirtIO_Block::int_handler(IC::Interrupt_Id interrupt)
+{
+    for(unsigned int i = 0; i < UNITS; i++) {
+        VirtIO_Block * dev = _devices[i];
+        if(!dev || (dev->_interrupt != interrupt))
+            continue;
+
+        VirtIO::Reg32 status = dev->_transport.ack();
+        db<VirtIO_Block>(TRC) << "VirtIO_Block::int_handler(int=" << interrupt << ",isr=" << hex << status << dec << ")" << endl;
+
+        // Completions are taken until there are no more, since a single interrupt may stand for many of them
+        for(;;) {
+            bool disabled = CPU::int_disabled();
+            CPU::int_disable();
+            Request * r = reinterpret_cast<Request *>(dev->_queue->get());
+            IO_Request * io = 0;
+            unsigned char code = OK;
+            bool last = false;
+            if(r) {
+                io = r->io;
+                code = r->status;
+                if(code == OK)
+                    io->progress(r->bytes);
+                else {
+                    dev->_statistics.errors++;
+                    io->fail();
+                }
+                last = io->retire() && (io->issued() == io->size());
+                if(last)
+                    dev->account(io);
+                r->next = dev->_free;
+                dev->_free = r - dev->_requests;
+                dev->_in_flight--;
+            }
+            if(!disabled)
+                CPU::int_enable();
+
+            if(!r)
+                break;
+
+            if(code != OK)
+                db<VirtIO_Block>(WRN) << "VirtIO_Block::int_handler: request failed (status=" << static_cast<unsigned int>(code) << ")!" << endl;
+
+            // The request's owner may reuse (or release) it as soon as it is finished
+            if(last)
+                io->finish();
+        }
+
+        // Completions make room for more of the backlog
+        dev->pump();
+    }
+}
+
+__END_SYS
+
+#endif
@@ -0,0 +1,41 @@
+// EPOS RISC-V VirtIO Block Device Mediator Initialization
+
+#include <machine/block.h>
+#include <system.h>
+
+#if defined(__BLOCK_H) && defined(__virt__)
+
+__BEGIN_SYS
+
+void VirtIO_Block::init(unsigned int unit)
+{
+    db<Init, VirtIO_Block>(TRC) << "VirtIO_Block::init(unit=" << unit << ")" << endl;
+
+    assert(unit < UNITS);
+
+    int transport = VirtIO::find(VirtIO::BLOCK, unit);
+    if(transport < 0) {
+        db<Init, VirtIO_Block>(INF) << "VirtIO_Block::init: no virtio-blk device found for unit " << unit << endl;
+        return;
+    }
+
+    // The queue, the requests and the bounce buffer (if any) share a single DMA_Buffer
+    DMA_Buffer * dma = new (SYSTEM) DMA_Buffer(DMA_SIZE);
+
+    VirtIO_Block * dev = new (SYSTEM) VirtIO_Block(unit, transport, dma);
+    if(!dev->reset()) {
+        db<Init, VirtIO_Block>(WRN) << "VirtIO_Block::init: device " << transport << " could not be set up!" << endl;
+        delete dev;
+        return;
+    }
+    _devices[unit] = dev;
+
+    db<Init, VirtIO_Block>(INF) << "VirtIO_Block::init: " << dev->sectors() << " sectors" << (dev->read_only() ? " (read-only)" : "") << " at transport " << transport << endl;
+
+    IC::int_vector(dev->_interrupt, &int_handler);
+    IC::enable(dev->_interrupt);
+}
+
+__END_SYS
+
+#endif
@@ -0,0 +1,343 @@
+// EPOS RISC-V VirtIO Network Device Mediator Implementation
+
+#include <machine/nic.h>
+#include <interrupt.h>
+
+#if defined(__NIC_H) && defined(__virt__)
+
+__BEGIN_SYS
+
+// Class attributes
+VirtIO_Net * VirtIO_Net::_devices[UNITS];
+
+
+// Methods
+VirtIO_Net::VirtIO_Net(unsigned int unit, unsigned int transport, DMA_Buffer * dma)
+: _unit(unit), _transport(transport), _interrupt(IC::INT_VIRTIO0 + transport), _dma(dma), _tx_cur(0)
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net(unit=" << unit << ",transport=" << transport << ",dma=" << *dma << ")" << endl;
+
+    _dma_phy = dma->phy_address();
+    _dma_log = dma->log_address();
+
+    Reg log = _dma_log + BUFFERS;
+    Net_Header * header = reinterpret_cast<Net_Header *>(_dma_log + HEADERS);
+    for(unsigned int i = 0; i < RX_BUFS; i++, log += BUFFER_STRIDE)
+        _rx_buffer[i] = new (reinterpret_cast<void *>(log)) Buffer(this, header++);
+    for(unsigned int i = 0; i < TX_BUFS; i++, log += BUFFER_STRIDE)
+        _tx_buffer[i] = new (reinterpret_cast<void *>(log)) Buffer(this, header++);
+
+    _rx_queue = 0;
+    _tx_queue = 0;
+
+    _rx_ready = new (SYSTEM) Semaphore(0);
+    _rx_handler = new (SYSTEM) Functor_Handler<VirtIO_Net>(&poll, this);
+    _rx_tasklet = new (SYSTEM) Tasklet(_rx_handler);
+}
+
+VirtIO_Net::~VirtIO_Net()
+{
+    db<VirtIO_Net>(TRC) << "~VirtIO_Net(unit=" << _unit << ")" << endl;
+
+    _transport.reset();
+    IC::disable(_interrupt);
+    _devices[_unit] = 0;
+
+    delete _rx_tasklet;
+    delete _rx_handler;
+    delete _rx_ready;
+    delete _rx_queue;
+    delete _tx_queue;
+    delete _dma;
+}
+
+bool VirtIO_Net::reset()
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net::reset()" << endl;
+
+    VirtIO::Features features = _transport.negotiate(F_MAC | F_STATUS | VirtIO::F_EVENT_IDX, VirtIO::F_VERSION_1 | (Traits<VirtIO>::packed ? VirtIO::F_RING_PACKED : 0));
+    if(!features)
+        return false;
+    bool event_idx = features & VirtIO::F_EVENT_IDX;
+
+    // Queues start empty after a reset, so they are rebuilt from scratch
+    delete _rx_queue;
+    delete _tx_queue;
+    _rx_queue = new (SYSTEM) Rx_Queue(_dma_log + RX_QUEUE, _dma_phy + RX_QUEUE, event_idx);
+    _tx_queue = new (SYSTEM) Tx_Queue(_dma_log + TX_QUEUE, _dma_phy + TX_QUEUE, event_idx);
+    if(!_transport.queue(RECEIVEQ, _rx_queue, RX_BUFS * 2) || !_transport.queue(TRANSMITQ, _tx_queue, TX_BUFS * 2)) {
+        db<VirtIO_Net>(WRN) << "VirtIO_Net::reset: device won't take queues this large!" << endl;
+        return false;
+    }
+    _rx_queue->enable();
+    _tx_queue->disable();
+
+    // Keep the address the device was given (e.g. by QEMU's "-device ...,mac="), or make up a locally administered one
+    Address a;
+    if(features & F_MAC)
+        for(unsigned int i = 0; i < 6; i++)
+            a[i] = _transport.config<unsigned char>(CONFIG_MAC + i);
+    if(!a) {
+        a = Address("02:45:50:4f:53:00");
+        a[5] = _unit + 1;
+    }
+    _address = a;
+
+    // All receive buffers are given to the device at once, with a single notification
+    for(unsigned int i = 0; i < TX_BUFS; i++)
+        _tx_buffer[i]->unlock();
+    for(unsigned int i = 0; i < RX_BUFS; i++) {
+        Segment chain[2] = { Segment(phy(_rx_buffer[i]->shadow()), sizeof(Net_Header), Segment::IN), Segment(phy(_rx_buffer[i]->frame()), sizeof(Frame), Segment::IN) };
+        _rx_queue->add(chain, 2, _rx_buffer[i]);
+    }
+    _rx_queue->kick();
+
+    _transport.ready();
+    _transport.notify(RECEIVEQ);
+
+    return true;
+}
+
+void VirtIO_Net::address(const Address & address)
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net::address(a=" << address << ")" << endl;
+
+    // Without VIRTIO_NET_F_CTRL_MAC_ADDR, the device keeps filtering by its own address, so this only changes the
+    // source of the frames sent
+    _address = address;
+}
+
+int VirtIO_Net::send(const Address & dst, const Protocol & prot, const void * data, unsigned int size)
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net::send(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",d=" << data << ",s=" << size << ")" << endl;
+
+    Buffer * buf = alloc(dst, prot, 0, 0, size);
+    if(!buf)
+        return 0;
+
+    memcpy(buf->frame()->data<void>(), data, size);
+
+    return send(buf) ? size : 0;
+}
+
+int VirtIO_Net::receive(Address * src, Protocol * prot, void * data, unsigned int size)
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net::receive(s=" << src << ",p=" << prot << ",d=" << data << ",s=" << size << ")" << endl;
+
+    // The semaphore is signaled once per unclaimed frame, but some of them may have been dropped in the meantime
+    Buffer * buf;
+    while(!(buf = take()))
+        _rx_ready->p();
+
+    Frame * frame = buf->frame();
+    *src = frame->src();
+    *prot = frame->prot();
+
+    unsigned int length = buf->size() - HEADER_SIZE;
+    if(length > size)
+        length = size;
+    memcpy(data, frame->data<void>(), length);
+
+    free(buf);
+
+    return length;
+}
+
+VirtIO_Net::Buffer * VirtIO_Net::alloc(const Address & dst, const Protocol & prot, unsigned int once, unsigned int always, unsigned int payload)
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net::alloc(s=" << _address << ",d=" << dst << ",p=" << hex << prot << dec << ",on=" << once << ",al=" << always << ",ld=" << payload << ")" << endl;
+
+    unsigned int size = once + always + payload;
+    if(size > MTU) {
+        db<VirtIO_Net>(WRN) << "VirtIO_Net::alloc: frame too large (" << size << " > " << MTU << ")!" << endl;
+        return 0;
+    }
+
+    // The device may finish sending frames in any order, so free buffers are searched for, starting from the one after
+    // the last taken, and sent ones are only reclaimed when none is left
+    Buffer * buf = 0;
+    for(unsigned int tries = 0; !buf; tries++) {
+        unsigned int i = CPU::finc(_tx_cur) % TX_BUFS;
+        if(_tx_buffer[i]->lock())
+            buf = _tx_buffer[i];
+        else if(tries && !(tries % TX_BUFS)) {
+            tx_reclaim();
+            if(tries >= 2 * TX_BUFS)
+                Thread::yield();
+        }
+    }
+
+    *buf->frame()->header() = Header(_address, dst, prot);
+    buf->size(HEADER_SIZE + size);
+
+    db<VirtIO_Net>(INF) << "VirtIO_Net::alloc:buf=" << buf << " => " << *buf << endl;
+
+    return buf;
+}
+
+int VirtIO_Net::send(Buffer * buf)
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net::send(buf=" << buf << ")" << endl;
+
+    unsigned int size = buf->size();
+    Segment chain[2] = { Segment(phy(buf->shadow()), sizeof(Net_Header), Segment::OUT), Segment(phy(buf->frame()), size, Segment::OUT) };
+
+    // There are as many descriptors as buffers, so there is always room for the chain
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _tx_queue->add(chain, 2, buf);
+    bool notify = _tx_queue->kick();
+    if(!disabled)
+        CPU::int_enable();
+
+    // With EVENT_IDX, the device only asks to be notified when it has gone idle, so back-to-back sends are batched
+    if(notify)
+        _transport.notify(TRANSMITQ);
+
+    _statistics.tx_packets++;
+    _statistics.tx_bytes += size;
+
+    return size;
+}
+
+void VirtIO_Net::free(Buffer * buf)
+{
+    db<VirtIO_Net>(TRC) << "VirtIO_Net::free(buf=" << buf << ")" << endl;
+
+    if(rx_mine(buf))
+        rx_rearm(buf);
+    else
+        buf->unlock(); // allocated, but not sent
+}
+
+void VirtIO_Net::rx_rearm(Buffer * buf)
+{
+    Segment chain[2] = { Segment(phy(buf->shadow()), sizeof(Net_Header), Segment::IN), Segment(phy(buf->frame()), sizeof(Frame), Segment::IN) };
+
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _rx_queue->add(chain, 2, buf);
+    bool notify = _rx_queue->kick();
+    if(!disabled)
+        CPU::int_enable();
+
+    // The device only asks for this when it has run out of receive buffers
+    if(notify)
+        _transport.notify(RECEIVEQ);
+}
+
+void VirtIO_Net::tx_reclaim()
+{
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    while(Buffer * buf = reinterpret_cast<Buffer *>(_tx_queue->get()))
+        buf->unlock();
+    if(!disabled)
+        CPU::int_enable();
+}
+
+VirtIO_Net::Buffer * VirtIO_Net::take()
+{
+    bool disabled = CPU::int_disabled();
+    CPU::int_disable();
+    _rx_lock.acquire();
+    Buffer::Element * e = _rx_unclaimed.remove();
+    _rx_lock.release();
+    if(!disabled)
+        CPU::int_enable();
+
+    return e ? e->object() : 0;
+}
+
+
+// Class methods
+void VirtIO_Net::poll(VirtIO_Net * nic)
+{
+    unsigned int n = 0;
+    for(; n < RX_BUDGET; n++) {
+        unsigned int length;
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        Buffer * buf = reinterpret_cast<Buffer *>(nic->_rx_queue->get(&length));
+        if(!disabled)
+            CPU::int_enable();
+        if(!buf)
+            break;
+
+        // Frames never span buffers, since these are large enough for any frame the device accepts
+        if(length < sizeof(Net_Header) + HEADER_SIZE) {
+            nic->_statistics.rx_drops++;
+            nic->rx_rearm(buf);
+            continue;
+        }
+
+        buf->size(length - sizeof(Net_Header));
+        nic->_statistics.rx_packets++;
+        nic->_statistics.rx_bytes += buf->size();
+
+        Frame * frame = buf->frame();
+        db<VirtIO_Net>(INF) << "VirtIO_Net::poll:frame=" << *frame->header() << ",size=" << buf->size() << endl;
+
+        // Observers take the buffer and free it when they are done; frames no one claims are kept for receive()
+        if(nic->notify(frame->prot(), buf))
+            continue;
+
+        Buffer * dropped = 0;
+        disabled = CPU::int_disabled();
+        CPU::int_disable();
+        nic->_rx_lock.acquire();
+        nic->_rx_unclaimed.insert(buf->link());
+        if(nic->_rx_unclaimed.size() > RX_UNCLAIMED)
+            dropped = nic->_rx_unclaimed.remove()->object();
+        nic->_rx_lock.release();
+        if(!disabled)
+            CPU::int_enable();
+
+        if(dropped) {
+            nic->_statistics.rx_drops++;
+            nic->rx_rearm(dropped);
+        }
+
+        nic->_rx_ready->v();
+    }
+
+    // With the budget exhausted, the ring is likely to have more frames, which will be taken by the next run, so the
+    // rest of the system gets a chance to run in between. Otherwise, interrupts are turned back on, and frames that
+    // arrived in the meantime, which might not raise one, are looked for once more.
+    if(n == RX_BUDGET)
+        nic->_rx_tasklet->schedule();
+    else {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        bool more = nic->_rx_queue->enable();
+        if(more)
+            nic->_rx_queue->disable();
+        if(!disabled)
+            CPU::int_enable();
+
+        if(more)
+            nic->_rx_tasklet->schedule();
+    }
+}
+
+void VirtIO_Net::int_handler(IC::Interrupt_Id interrupt)
+{
+    for(unsigned int i = 0; i < UNITS; i++) {
+        VirtIO_Net * nic = _devices[i];
+        if(!nic || (nic->_interrupt != interrupt))
+            continue;
+
+        VirtIO::Reg32 status = nic->_transport.ack();
+        db<VirtIO_Net>(TRC) << "VirtIO_Net::int_handler(int=" << interrupt << ",isr=" << hex << status << dec << ")" << endl;
+
+        // Receive interrupts stay suppressed until the Tasklet catches up with the queue
+        if(status & VirtIO::USED_BUFFER) {
+            nic->_rx_queue->disable();
+            nic->_rx_tasklet->schedule();
+        }
+    }
+}
+
+__END_SYS
+
+#endif
@@ -0,0 +1,41 @@
+// EPOS RISC-V VirtIO Network Device Mediator Initialization
+
+#include <machine/nic.h>
+#include <system.h>
+
+#if defined(__NIC_H) && defined(__virt__)
+
+__BEGIN_SYS
+
+void VirtIO_Net::init(unsigned int unit)
+{
+    db<Init, VirtIO_Net>(TRC) << "VirtIO_Net::init(unit=" << unit << ")" << endl;
+
+    assert(unit < UNITS);
+
+    int transport = VirtIO::find(VirtIO::NET, unit);
+    if(transport < 0) {
+        db<Init, VirtIO_Net>(WRN) << "VirtIO_Net::init: no virtio-net device found for unit " << unit << "!" << endl;
+        return;
+    }
+
+    // Queues, headers and buffers share a single DMA_Buffer
+    DMA_Buffer * dma = new (SYSTEM) DMA_Buffer(BUFFERS + (RX_BUFS + TX_BUFS) * BUFFER_STRIDE);
+
+    VirtIO_Net * nic = new (SYSTEM) VirtIO_Net(unit, transport, dma);
+    if(!nic->reset()) {
+        db<Init, VirtIO_Net>(WRN) << "VirtIO_Net::init: device " << transport << " could not be set up!" << endl;
+        delete nic;
+        return;
+    }
+    _devices[unit] = nic;
+
+    db<Init, VirtIO_Net>(INF) << "VirtIO_Net::init: " << nic->address() << " at transport " << transport << endl;
+
+    IC::int_vector(nic->_interrupt, &int_handler);
+    IC::enable(nic->_interrupt);
+}
+
+__END_SYS
+
+#endif
@@ -0,0 +1,60 @@
+// EPOS ICMP Protocol Implementation
+
+#include <network/icmp.h>
+
+#ifdef __NIC_H
+
+__BEGIN_SYS
+
+ICMP::ICMP()
+{
+    db<ICMP>(TRC) << "ICMP() => " << this << endl;
+
+    for(unsigned int i = 0; i < IP::UNITS; i++)
+        if(IP::get(i))
+            IP::get(i)->attach(this, IP::ICMP);
+}
+
+ICMP::~ICMP()
+{
+    db<ICMP>(TRC) << "~ICMP(this=" << this << ")" << endl;
+
+    for(unsigned int i = 0; i < IP::UNITS; i++)
+        if(IP::get(i))
+            IP::get(i)->detach(this, IP::ICMP);
+}
+
+// Runs in the NIC's receive Tasklet
+void ICMP::update(IP::Observed * obs, const IP::Protocol & prot, IP::Buffer * buf)
+{
+    IP * ip = static_cast<IP *>(obs);
+    IP::Packet * request = IP::packet(buf);
+    Header * header = request->data<Header>();
+    unsigned int size = request->length() - request->hlength();
+
+    db<ICMP>(TRC) << "ICMP::update(buf=" << buf << ") => " << *header << endl;
+
+    if((size < sizeof(Header)) || IP::checksum(header, size)) {
+        db<ICMP>(WRN) << "ICMP::update: malformed message dropped!" << endl;
+        ip->free(buf);
+        return;
+    }
+
+    if((header->type() == ECHO) && (request->to() == ip->address())) {
+        IP::Buffer * reply = ip->alloc(request->from(), buf->frame()->src(), IP::ICMP, size);
+        if(reply) {
+            Header * echo = IP::packet(reply)->data<Header>();
+            memcpy(echo, header, size);
+            echo->_type = ECHO_REPLY;
+            echo->_checksum = 0;
+            echo->_checksum = IP::checksum(echo, size);
+            ip->send(reply);
+        }
+    }
+
+    ip->free(buf);
+}
+
+__END_SYS
+
+#endif
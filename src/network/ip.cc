@@ -0,0 +1,186 @@
+// EPOS IP Protocol Implementation
+
+#include <network/ip.h>
+
+#ifdef __NIC_H
+
+__BEGIN_SYS
+
+volatile unsigned long IP::Header::_next_id;
+IP * IP::_networks[UNITS];
+
+IP::IP(NIC_Family * nic, unsigned int unit): _unit(unit), _nic(nic),
+    _address(Traits<IP>::ADDRESS), _netmask(Traits<IP>::NETMASK), _gateway(Traits<IP>::GATEWAY)
+{
+    db<IP>(TRC) << "IP(nic=" << nic << ",unit=" << unit << ") => " << this << endl;
+
+    _arp = new (SYSTEM) ARP<NIC_Family, IP, Ethernet::HTYPE>(_nic, this);
+    _nic->attach(this, Ethernet::IP);
+    _networks[unit] = this;
+
+    db<IP>(INF) << "IP::address=" << _address << ",netmask=" << _netmask << ",gateway=" << _gateway << endl;
+}
+
+IP::~IP()
+{
+    db<IP>(TRC) << "~IP(this=" << this << ")" << endl;
+
+    _nic->detach(this, Ethernet::IP);
+    delete _arp;
+    _networks[_unit] = 0;
+}
+
+IP::Buffer * IP::alloc(const Address & to, const Protocol & prot, unsigned int size)
+{
+    db<IP>(TRC) << "IP::alloc(to=" << to << ",p=" << static_cast<unsigned int>(prot) << ",s=" << size << ")" << endl;
+
+    MAC_Address mac = MAC_Address::BROADCAST;
+    if(!broadcast(to)) {
+        mac = _arp->resolve(local(to) ? to : _gateway);
+        if(!mac)
+            return 0;
+    }
+
+    return alloc(to, mac, prot, size);
+}
+
+IP::Buffer * IP::alloc(const Address & to, const MAC_Address & mac, const Protocol & prot, unsigned int size)
+{
+    if(size > MTU) {
+        db<IP>(WRN) << "IP::alloc: packet too large (" << size << " > " << MTU << ")!" << endl;
+        return 0;
+    }
+
+    Buffer * buf = _nic->alloc(mac, Ethernet::IP, 0, 0, sizeof(Header) + size);
+    if(buf)
+        *packet(buf)->header() = Header(_address, to, prot, size);
+
+    return buf;
+}
+
+int IP::send(Buffer * buf)
+{
+    Packet * packet = IP::packet(buf);
+    packet->sign();
+
+    db<IP>(TRC) << "IP::send(buf=" << buf << ") => " << *packet->header() << endl;
+
+    return _nic->send(buf);
+}
+
+IP * IP::get(NIC_Family * nic)
+{
+    for(unsigned int i = 0; i < UNITS; i++)
+        if(_networks[i] && (_networks[i]->_nic == nic))
+            return _networks[i];
+
+    return 0;
+}
+
+IP * IP::route(const Address & to)
+{
+    IP * gateway = 0;
+    for(unsigned int i = 0; i < UNITS; i++)
+        if(_networks[i]) {
+            if(_networks[i]->local(to) || _networks[i]->broadcast(to))
+                return _networks[i];
+            if(!gateway)
+                gateway = _networks[i];
+        }
+
+    return gateway;
+}
+
+// Runs in the NIC's receive Tasklet, with the packet still in the NIC's receive ring
+void IP::update(Ethernet::Observed * obs, const Ethernet::Protocol & prot, Buffer * buf)
+{
+    Packet * packet = IP::packet(buf);
+    unsigned int size = buf->size() - Ethernet::HEADER_SIZE;
+
+    db<IP>(TRC) << "IP::update(buf=" << buf << ") => " << *packet->header() << endl;
+
+    if((size < sizeof(Header)) || (packet->version() != Header::VERSION) || (packet->hlength() < sizeof(Header))
+        || (packet->length() > size) || (packet->length() < packet->hlength()) || checksum(packet, packet->hlength())) {
+        db<IP>(WRN) << "IP::update: malformed packet dropped!" << endl;
+        _nic->free(buf);
+        return;
+    }
+
+    if(((packet->to() != _address) && !broadcast(packet->to())) || packet->fragmented()) {
+        db<IP>(INF) << "IP::update: packet dropped (to=" << packet->to() << ",frag=" << packet->fragmented() << ")" << endl;
+        _nic->free(buf);
+        return;
+    }
+
+    if(!notify(packet->protocol(), buf)) {
+        db<IP>(INF) << "IP::update: no one listening to protocol " << static_cast<unsigned int>(packet->protocol()) << endl;
+        _nic->free(buf);
+    }
+}
+
+// 32-bit words are summed into a 64-bit accumulator and folded once, since the one's complement sum of 16-bit
+// words does not depend on how they are grouped, nor on byte order, as long as data is read in memory order
+unsigned long IP::sum(const void * data, unsigned int size, unsigned long partial)
+{
+    const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+    unsigned long long s = partial;
+
+    if(reinterpret_cast<unsigned long>(p) & 1) {
+        for(; size > 1; p += 2, size -= 2) {
+            unsigned short w;
+            memcpy(&w, p, sizeof(w));
+            s += w;
+        }
+    } else {
+        if((reinterpret_cast<unsigned long>(p) & 2) && (size > 1)) {
+            s += *reinterpret_cast<const unsigned short *>(p);
+            p += 2;
+            size -= 2;
+        }
+        for(; size > 3; p += 4, size -= 4)
+            s += *reinterpret_cast<const unsigned int *>(p);
+        if(size > 1) {
+            s += *reinterpret_cast<const unsigned short *>(p);
+            p += 2;
+            size -= 2;
+        }
+    }
+
+    // A trailing odd byte is summed as if padded with zero
+    if(size) {
+        unsigned short w = 0;
+        memcpy(&w, p, 1);
+        s += w;
+    }
+
+    while(s >> 32)
+        s = (s & 0xffffffff) + (s >> 32);
+
+    return s;
+}
+
+unsigned long IP::copy_and_sum(void * dst, const void * src, unsigned int size, unsigned long partial)
+{
+    if((reinterpret_cast<unsigned long>(dst) | reinterpret_cast<unsigned long>(src)) & 3) {
+        memcpy(dst, src, size);
+        return sum(dst, size, partial);
+    }
+
+    unsigned int * d = reinterpret_cast<unsigned int *>(dst);
+    const unsigned int * s = reinterpret_cast<const unsigned int *>(src);
+    unsigned long long acc = partial;
+    for(; size > 3; size -= 4) {
+        unsigned int w = *s++;
+        *d++ = w;
+        acc += w;
+    }
+    while(acc >> 32)
+        acc = (acc & 0xffffffff) + (acc >> 32);
+
+    memcpy(d, s, size);
+    return sum(d, size, acc);
+}
+
+__END_SYS
+
+#endif
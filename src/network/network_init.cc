@@ -0,0 +1,21 @@
+// EPOS Network Initialization
+
+#include <network.h>
+
+#ifdef __NIC_H
+
+__BEGIN_SYS
+
+void Network::init()
+{
+    db<Init, Network>(TRC) << "Network::init()" << endl;
+
+    Initializer<>::init();
+
+    new (SYSTEM) ICMP;
+    new (SYSTEM) UDP;
+}
+
+__END_SYS
+
+#endif
@@ -0,0 +1,168 @@
+// EPOS UDP Protocol Implementation
+
+#include <network/udp.h>
+
+#ifdef __NIC_H
+
+__BEGIN_SYS
+
+UDP * UDP::_udp;
+
+UDP::UDP()
+{
+    db<UDP>(TRC) << "UDP() => " << this << endl;
+
+    for(unsigned int i = 0; i < IP::UNITS; i++)
+        if(IP::get(i))
+            IP::get(i)->attach(this, IP::UDP);
+    _udp = this;
+}
+
+UDP::~UDP()
+{
+    db<UDP>(TRC) << "~UDP(this=" << this << ")" << endl;
+
+    for(unsigned int i = 0; i < IP::UNITS; i++)
+        if(IP::get(i))
+            IP::get(i)->detach(this, IP::UDP);
+    _udp = 0;
+}
+
+UDP::Buffer * UDP::alloc(const Port_Id & from, const Address & to, unsigned int size)
+{
+    db<UDP>(TRC) << "UDP::alloc(from=" << from << ",to=" << to << ",s=" << size << ")" << endl;
+
+    if(size > MTU) {
+        db<UDP>(WRN) << "UDP::alloc: datagram too large (" << size << " > " << MTU << ")!" << endl;
+        return 0;
+    }
+
+    IP * ip = IP::route(to.ip());
+    if(!ip)
+        return 0;
+
+    Buffer * buf = ip->alloc(to.ip(), IP::UDP, sizeof(Header) + size);
+    if(buf)
+        *datagram(buf)->header() = Header(from, to.port(), size);
+
+    return buf;
+}
+
+int UDP::send(Buffer * buf)
+{
+    Datagram * datagram = UDP::datagram(buf);
+
+    db<UDP>(TRC) << "UDP::send(buf=" << buf << ") => " << *datagram->header() << endl;
+
+    if(Traits<UDP>::checksum) {
+        datagram->_checksum = 0;
+        unsigned short checksum = ~IP::fold(IP::sum(datagram, datagram->length(), pseudo_sum(IP::packet(buf))));
+        datagram->_checksum = checksum ? checksum : 0xffff; // 0 means "no checksum"
+    }
+
+    return IP::get(buf->nic())->send(buf);
+}
+
+int UDP::send(const Port_Id & from, const Address & to, const void * data, unsigned int size)
+{
+    db<UDP>(TRC) << "UDP::send(from=" << from << ",to=" << to << ",d=" << data << ",s=" << size << ")" << endl;
+
+    Buffer * buf = alloc(from, to, size);
+    if(!buf)
+        return -1;
+
+    Datagram * datagram = UDP::datagram(buf);
+    if(Traits<UDP>::checksum) {
+        // The checksum covers the pseudo header, the header and the payload, which is summed on its way in
+        unsigned long partial = IP::sum(datagram->header(), sizeof(Header), pseudo_sum(IP::packet(buf)));
+        unsigned short checksum = ~IP::fold(IP::copy_and_sum(datagram->_data, data, size, partial));
+        datagram->_checksum = checksum ? checksum : 0xffff;
+    } else
+        memcpy(datagram->_data, data, size);
+
+    IP::get(buf->nic())->send(buf);
+
+    return size;
+}
+
+bool UDP::check(Buffer * buf)
+{
+    Datagram * datagram = UDP::datagram(buf);
+
+    if(!Traits<UDP>::checksum || !datagram->_checksum)
+        return true;
+
+    return IP::fold(IP::sum(datagram, datagram->length(), pseudo_sum(IP::packet(buf)))) == 0xffff;
+}
+
+int UDP::copy(Buffer * buf, Address * from, void * data, unsigned int size)
+{
+    Datagram * datagram = UDP::datagram(buf);
+    unsigned int length = UDP::size(buf);
+    if(size > length)
+        size = length;
+
+    if(from)
+        *from = UDP::from(buf);
+
+    if(!Traits<UDP>::checksum || !datagram->_checksum) {
+        memcpy(data, datagram->_data, size);
+        return size;
+    }
+
+    // Truncated datagrams must still be checked as a whole
+    if(size < length) {
+        if(!check(buf))
+            return -1;
+        memcpy(data, datagram->_data, size);
+        return size;
+    }
+
+    unsigned long partial = IP::sum(datagram->header(), sizeof(Header), pseudo_sum(IP::packet(buf)));
+    if(IP::fold(IP::copy_and_sum(data, datagram->_data, size, partial)) != 0xffff)
+        return -1;
+
+    return size;
+}
+
+// Runs in the NIC's receive Tasklet
+void UDP::update(IP::Observed * obs, const IP::Protocol & prot, Buffer * buf)
+{
+    IP::Packet * packet = IP::packet(buf);
+    Datagram * datagram = packet->data<Datagram>();
+    unsigned int size = packet->length() - packet->hlength();
+
+    db<UDP>(TRC) << "UDP::update(buf=" << buf << ") => " << *datagram->header() << endl;
+
+    if((size < sizeof(Header)) || (datagram->length() < sizeof(Header)) || (datagram->length() > size)) {
+        db<UDP>(WRN) << "UDP::update: malformed datagram dropped!" << endl;
+        free(buf);
+        return;
+    }
+
+    if(!notify(datagram->to(), buf)) {
+        db<UDP>(INF) << "UDP::update: no one listening to port " << datagram->to() << endl;
+        free(buf);
+    }
+}
+
+unsigned long UDP::pseudo_sum(IP::Packet * packet)
+{
+    struct Pseudo_Header
+    {
+        IP::Address from;
+        IP::Address to;
+        unsigned char zero;
+        IP::Protocol protocol;
+        unsigned short length;
+    } __attribute__((packed));
+
+    Datagram * datagram = packet->data<Datagram>();
+    Pseudo_Header pseudo = { packet->from(), packet->to(), 0, IP::UDP, CPU::htons(datagram->length()) };
+
+    return IP::sum(&pseudo, sizeof(Pseudo_Header));
+}
+
+__END_SYS
+
+#endif
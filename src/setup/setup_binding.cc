@@ -6,6 +6,10 @@ __BEGIN_SYS
 
 OStream kout, kerr;
 
+// OStream lines are per CPU, each only touched with interrupts disabled; the section nests, since _print() may print
+static unsigned int _print_nesting[Traits<Build>::CPUS];
+static bool _print_disabled[Traits<Build>::CPUS];
+
 __END_SYS
 
 extern "C" {
@@ -22,5 +26,18 @@ extern "C" {
     void _print(const char * s) { Display::puts(s); }
     void _print_preamble() {}
     void _print_trailler(bool error) { if(error) _panic(); }
+    unsigned int _print_lock() {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        unsigned int cpu = CPU::id() % Traits<Build>::CPUS; // CPU::id() is the hart id, which is not zero-based on every machine
+        if(!_print_nesting[cpu]++)
+            _print_disabled[cpu] = disabled;
+        return cpu;
+    }
+    void _print_unlock() {
+        unsigned int cpu = CPU::id() % Traits<Build>::CPUS;
+        if(!--_print_nesting[cpu] && !_print_disabled[cpu])
+            CPU::int_enable();
+    }
 }
 
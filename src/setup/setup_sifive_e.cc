@@ -4,6 +4,7 @@
 #include <machine.h>
 #include <utility/elf.h>
 #include <utility/string.h>
+#include <utility/profiler.h>
 
 extern "C" {
     void _start();
@@ -130,6 +131,8 @@ void _entry() // machine mode
 
     Machine::clear_bss();
 
+    Profiler::config();                                 // PMU event selectors are only writable in machine mode
+
     CPU::mstatus(CPU::MPP_M);                           // stay in machine mode at mret
 
     CPU::mepc(CPU::Reg(&_setup));                       // entry = _setup
@@ -1,4 +1,4 @@
-// EPOS SiFive-U (RISC-V) SETUP
+// EPOS SiFive-U and QEMU Virt (RISC-V) SETUP
 
 // If multitasking is enabled, configure the machine in supervisor mode and activate paging. Otherwise, keep the machine in machine mode.
 
@@ -7,13 +7,16 @@
 #include <architecture.h>
 #include <machine.h>
 #include <utility/elf.h>
+#include <utility/lz4.h>
 #include <utility/string.h>
+#include <utility/profiler.h>
 
 extern "C" {
     void _start();
 
     void _int_entry();
     void _int_m2s() __attribute((naked, aligned(4)));
+    void _int_skip() __attribute((naked, aligned(4)));
 
     // SETUP entry point is in .init (and not in .text), so it will be linked first and will be the first function after the ELF header in the image
     void _entry() __attribute__ ((used, naked, section(".init")));
@@ -80,6 +83,7 @@ public:
     Setup();
 
 private:
+    void expand_image();
     void build_lm();
     void build_pmm();
 
@@ -122,6 +126,9 @@ Setup::Setup()
 
     if(multitask) {
 
+        // Decompress the parts of the boot image compressed by eposmkbi -Z
+        expand_image();
+
         // Build the memory model
         build_lm();
         build_pmm();
@@ -187,6 +194,66 @@ void Setup::setup_flat_mem()
     si->pmm.free1_top = MMU::align_page(FREE_TOP);
 }
 
+void Setup::expand_image()
+{
+    db<Setup>(TRC) << "Setup::expand_image()" << endl;
+
+    // Parts that follow SETUP in the boot image, in this order (absent ones have offset -1)
+    unsigned long * offsets[] = { &si->bm.init_offset, &si->bm.system_offset, &si->bm.application_offset, &si->bm.extras_offset };
+    static const unsigned int PARTS = sizeof(offsets) / sizeof(offsets[0]);
+
+    unsigned int part[PARTS];
+    unsigned int n = 0;
+    for(unsigned int i = 0; i < PARTS; i++)
+        if(*offsets[i] != -1ul)
+            part[n++] = i;
+
+    // Find out what each part will look like once expanded
+    unsigned long old_offset[PARTS], length[PARTS], size[PARTS], compressed_size[PARTS];
+    bool compressed = false;
+    for(unsigned int k = 0; k < n; k++) {
+        old_offset[k] = *offsets[part[k]];
+        length[k] = ((k + 1 < n) ? *offsets[part[k + 1]] : si->bm.img_size) - old_offset[k];
+
+        // Parts are only byte-aligned in the image, so the header is copied out before being looked at
+        LZ4::Header header = { 0, 0, 0 };
+        if(length[k] >= sizeof(LZ4::Header))
+            memcpy(&header, &bi[old_offset[k]], sizeof(LZ4::Header));
+        if(header.valid() && (header.compressed_size <= length[k] - sizeof(LZ4::Header))) {
+            size[k] = header.size;
+            compressed_size[k] = header.compressed_size;
+            compressed = true;
+        } else {
+            size[k] = length[k];
+            compressed_size[k] = 0;
+        }
+    }
+    if(!compressed)
+        return;
+
+    // Expanded parts are laid out page-aligned, each followed by the margin needed to decompress it in place, so every
+    // part only moves upwards. Going from the last part to the first, each compressed part is moved to the end of its
+    // new room and decompressed from there into the beginning of that same room.
+    unsigned long new_offset[PARTS];
+    for(unsigned int k = 0; k < n; k++)
+        new_offset[k] = MMU::align_page((k == 0) ? old_offset[k] : new_offset[k - 1] + size[k - 1] + (compressed_size[k - 1] ? LZ4::margin(compressed_size[k - 1]) : 0));
+
+    for(int k = n - 1; k >= 0; k--) {
+        if(compressed_size[k]) {
+            unsigned long tail = new_offset[k] + size[k] + LZ4::margin(compressed_size[k]) - compressed_size[k];
+            memmove(&bi[tail], &bi[old_offset[k] + sizeof(LZ4::Header)], compressed_size[k]);
+            if(LZ4::decompress(&bi[new_offset[k]], size[k], &bi[tail], compressed_size[k]) != static_cast<long>(size[k]))
+                db<Setup>(ERR) << "Setup::expand_image: part " << part[k] << " of the boot image is corrupted!" << endl;
+            db<Setup>(INF) << "Setup::expand_image: part " << part[k] << ": " << compressed_size[k] << " => " << size[k] << " bytes" << endl;
+        } else
+            memmove(&bi[new_offset[k]], &bi[old_offset[k]], length[k]);
+
+        *offsets[part[k]] = new_offset[k];
+    }
+    si->bm.img_size = new_offset[n - 1] + size[n - 1];
+}
+
+
 void Setup::build_lm()
 {
     db<Setup>(TRC) << "Setup::build_lm()" << endl;
@@ -247,6 +314,15 @@ void Setup::build_lm()
 
         if(si->lm.app_code != MMU::align_segment(si->lm.app_code))
             db<Setup>(ERR) << "Unaligned APP code segment:" << hex << si->lm.app_code << endl;
+
+        // Whole pages of code backed by the ELF file are mapped straight from the boot image instead of being copied
+        // (see setup_app_pt()), which requires the image to keep them page-aligned (see eposmkbi)
+        unsigned long offset;
+        si->lm.app_code_mapped = app_elf->mappable(si->lm.app_code, sizeof(Page), &offset);
+        if(si->lm.app_code_mapped && ((IMAGE + si->bm.application_offset + offset) != MMU::align_page(IMAGE + si->bm.application_offset + offset))) {
+            db<Setup>(WRN) << "APP ELF image is not page-aligned in the boot image, its code will be copied!" << endl;
+            si->lm.app_code_mapped = 0;
+        }
         if(si->lm.app_data_size == 0) {
             db<Setup>(WRN) << "APP ELF image has no data segment!" << endl;
             si->lm.app_data = MMU::align_page(APP_DATA);
@@ -329,8 +405,15 @@ void Setup::build_pmm()
     si->pmm.usr_mem_base = si->bm.mem_base;
     si->pmm.usr_mem_top = si->bm.mem_base + MMU::allocable() * sizeof(Page);
 
-    // APPLICATION code segment
-    si->pmm.app_code = MMU::alloc(MMU::pages(si->lm.app_code_size));
+    // APPLICATION code segment (except for the pages mapped from the boot image, which must not be freed at INIT)
+    si->pmm.app_code = MMU::alloc(MMU::pages(si->lm.app_code_size - si->lm.app_code_mapped));
+    if(si->lm.app_code_mapped) {
+        unsigned long offset;
+        ELF * app_elf = reinterpret_cast<ELF *>(&bi[si->bm.application_offset]);
+        app_elf->mappable(si->lm.app_code, sizeof(Page), &offset);
+        si->pmm.app_code_image = IMAGE + si->bm.application_offset + offset;
+    } else
+        si->pmm.app_code_image = 0;
 
     // APPLICATION data segment (contains stack, heap and extra)
     si->pmm.app_data = MMU::alloc(MMU::pages(si->lm.app_data_size));
@@ -340,6 +423,8 @@ void Setup::build_pmm()
     // Test if we didn't overlap SETUP and the boot image
     if(si->pmm.usr_mem_top <= si->lm.stp_code + si->lm.stp_code_size + si->lm.stp_data_size)
         db<Setup>(ERR) << "SETUP would have been overwritten!" << endl;
+    if(si->bm.mem_base + MMU::allocable() * sizeof(Page) < IMAGE + si->bm.img_size)
+        db<Setup>(ERR) << "The boot image would have been overwritten!" << endl;
 }
 
 
@@ -351,8 +436,13 @@ void Setup::say_hi()
     kout << "This is EPOS!\n" << endl;
     kout << "Setting up this machine as follows: " << endl;
     kout << "  Mode:         " << ((Traits<Build>::MODE == Traits<Build>::LIBRARY) ? "library" : (Traits<Build>::MODE == Traits<Build>::BUILTIN) ? "built-in" : "kernel") << endl;
+#ifdef __virt__
+    kout << "  Processor:    " << Traits<Machine>::CPUS << " x RV" << Traits<CPU>::WORD_SIZE << " at " << Traits<CPU>::CLOCK / 1000000 << " MHz (timebase = " << Traits<Machine>::RTCCLK / 1000000 << " MHz)" << endl;
+    kout << "  Machine:      QEMU Virt" << endl;
+#else
     kout << "  Processor:    " << Traits<Machine>::CPUS << " x RV" << Traits<CPU>::WORD_SIZE << " at " << Traits<CPU>::CLOCK / 1000000 << " MHz (BUS clock = " << Traits<Machine>::HFCLK / 1000000 << " MHz)" << endl;
     kout << "  Machine:      SiFive-U" << endl;
+#endif
 #ifdef __library__
     kout << "  Memory:       " << (RAM_TOP + 1 - RAM_BASE) / 1024 << " KB [" << reinterpret_cast<void *>(RAM_BASE) << ":" << reinterpret_cast<void *>(RAM_TOP) << "]" << endl;
     kout << "  User memory:  " << (FREE_TOP - FREE_BASE) / 1024 << " KB [" << reinterpret_cast<void *>(FREE_BASE) << ":" << reinterpret_cast<void *>(FREE_TOP) << "]" << endl;
@@ -440,7 +530,10 @@ void Setup::setup_app_pt()
     // APPLICATION code
     // Since load_parts() will load the code into memory, the code segment can't be marked R/O yet
     // The correct flags (APPC and APPD) will be configured after the execution of load_parts(), by adjust_perms()
-    app_code_pt->remap(si->pmm.app_code, MMU::pti(si->lm.app_code), MMU::pti(si->lm.app_code) + MMU::pages(si->lm.app_code_size), Flags::APP);
+    // Pages backed by the ELF file are mapped in place from the boot image, the rest (e.g. .bss) gets private pages
+    unsigned long mapped = MMU::pages(si->lm.app_code_mapped);
+    app_code_pt->remap(si->pmm.app_code_image, MMU::pti(si->lm.app_code), MMU::pti(si->lm.app_code) + mapped, Flags::APP);
+    app_code_pt->remap(si->pmm.app_code, MMU::pti(si->lm.app_code) + mapped, MMU::pti(si->lm.app_code) + MMU::pages(si->lm.app_code_size), Flags::APP);
 
     // APPLICATION data (contains stack, heap and extra)
     app_data_pt->remap(si->pmm.app_data, MMU::pti(si->lm.app_data), MMU::pti(si->lm.app_data) + MMU::pages(si->lm.app_data_size), Flags::APP);
@@ -532,9 +625,21 @@ void Setup::setup_sys_pd()
     if(dir.attach(app_data, si->lm.app_data) != si->lm.app_data)
         db<Setup>(ERR) << "Setup::setup_sys_pd: cannot attach the application data at " << reinterpret_cast<void *>(si->lm.app_data) << "!" << endl;
 
-    // Save free chunks to be passed to MMU::init()
-    si->pmm.free1_base = si->bm.mem_base;
-    si->pmm.free1_top = si->bm.mem_base + MMU::allocable() * sizeof(Page);
+    // Save free chunks to be passed to MMU::init(), leaving out the APPLICATION code pages mapped from the boot image
+    Phy_Addr top = si->bm.mem_base + MMU::allocable() * sizeof(Page);
+    if(si->lm.app_code_mapped) {
+        if(si->pmm.app_code_image + si->lm.app_code_mapped > top)
+            db<Setup>(ERR) << "Setup::setup_sys_pd: the application code in the boot image would have been overwritten!" << endl;
+        si->pmm.free1_base = si->bm.mem_base;
+        si->pmm.free1_top = si->pmm.app_code_image;
+        si->pmm.free2_base = si->pmm.app_code_image + si->lm.app_code_mapped;
+        si->pmm.free2_top = top;
+    } else {
+        si->pmm.free1_base = si->bm.mem_base;
+        si->pmm.free1_top = top;
+        si->pmm.free2_base = 0;
+        si->pmm.free2_top = 0;
+    }
 
     db<Setup>(INF) << "SYS_PD[" << reinterpret_cast<Page_Directory *>(si->pmm.sys_pd) << "]=" << *reinterpret_cast<Page_Directory *>(si->pmm.sys_pd) << endl;
 }
@@ -636,7 +741,7 @@ void Setup::load_parts()
             db<Setup>(INF) << "Setup:app_elf[DATA]: " << MMU::Translation(app_loadable->data) << endl;
         }
 
-        app_elf->load(app_loadable);
+        app_elf->load(app_loadable, si->lm.app_code, si->lm.app_code_mapped);
     }
 
     // Load EXTRA
@@ -663,9 +768,9 @@ void Setup::adjust_perms()
     unsigned int i;
     PT_Entry aux;
 
-    // APPLICATION code
-    for(i = 0, aux = si->pmm.app_code; i < MMU::pages(si->lm.app_code_size); i++, aux = aux + sizeof(Page))
-        app_code_pt[MMU::pti(APP_CODE) + i] = MMU::phy2pte(aux, Flags::APPC);
+    // APPLICATION code (not physically contiguous if partially mapped from the boot image)
+    for(i = 0; i < MMU::pages(si->lm.app_code_size); i++)
+        app_code_pt[MMU::pti(APP_CODE) + i] = MMU::phy2pte(MMU::pte2phy(app_code_pt[MMU::pti(APP_CODE) + i]), Flags::APPC);
 
     // APPLICATION data (contains stack, heap and extra)
     for(i = 0, aux = si->pmm.app_data; i < MMU::pages(si->lm.app_data_size); i++, aux = aux + sizeof(Page))
@@ -722,7 +827,9 @@ using namespace EPOS::S;
 
 void _entry() // machine mode
 {
-    if(CPU::mhartid() == 0)                             // SiFive-U always has 2 cores, but core 0 does not feature an MMU, so we halt it and let core 1 run in a single-core configuration
+    // SiFive-U always has 2 cores, but core 0 does not feature an MMU, so we halt it and let core 1 run in a single-core
+    // configuration. All Virt harts start here at once, but EPOS runs on hart 0 only, so the others are parked.
+    if((Traits<Build>::MODEL == Traits<Build>::Virt) ? (CPU::mhartid() != 0) : (CPU::mhartid() == 0))
         CPU::halt();
 
     CPU::mstatusc(CPU::MIE);                            // disable interrupts (they will be reenabled at Init_End)
@@ -733,8 +840,18 @@ void _entry() // machine mode
 
     Machine::clear_bss();
 
+    Profiler::config();                                 // PMU event selectors are only writable in machine mode
+
     if(Traits<System>::multitask) {
-        CLINT::mtvec(CLINT::DIRECT, Memory_Map::INT_M2S); // setup a machine mode interrupt handler to forward timer interrupts (which cannot be delegated via mideleg)
+        reinterpret_cast<System_Info *>(&__boot_time_system_info)->tm.sstc = false; // MKBI leaves it undefined
+        if(Traits<Timer>::sstc) {
+            CLINT::mtvec(CLINT::DIRECT, CPU::Reg(&_int_skip)); // harts without menvcfg trap on the probe below, so just skip it
+            if(CPU::sstc_enable()) {                    // supervisor mode will program its own timer through stimecmp
+                reinterpret_cast<System_Info *>(&__boot_time_system_info)->tm.sstc = true;
+                CPU::miec(CPU::MTI);                    // and MTI (thus the forwarder) won't be used for ticks
+            }
+        }
+        CLINT::mtvec(CLINT::DIRECT, Memory_Map::INT_M2S); // setup a machine mode interrupt handler to forward timer and software interrupts (which cannot be delegated via mideleg)
         CPU::mideleg(CPU::SSI | CPU::STI | CPU::SEI);   // delegate supervisor interrupts to supervisor mode
         CPU::medeleg(0xf1ff);                           // delegate all exceptions to supervisor mode but ecalls
         CPU::mstatuss(CPU::MPP_S);                      // prepare jump into supervisor mode at mret
@@ -789,6 +906,10 @@ if(Traits<CPU>::WORD_SIZE == 32) {
         CPU::mips(CPU::STI);            // forward MTI as STI
         while(CPU::mip() & CPU::MTI);   // wait for MTI to go down (due to MTIMECMP adjustment) to avoid spurious interrupts
     }
+    if((id & CLINT::INT_MASK) == CLINT::IRQ_MAC_SOFT) {
+        CLINT::msip(CPU::mhartid(), false); // MSIP stays up until cleared
+        CPU::mips(CPU::SSI);            // forward MSI (an IPI) as SSI
+    }
     if(id == CPU::EXC_ENVS) {
         CPU::mipc(CPU::STI);            // STI was handled in supervisor mode, so clear the corresponding pending bit
         CPU::mepc(CPU::mepc() + 4);
@@ -813,3 +934,15 @@ if(Traits<CPU>::WORD_SIZE == 32) {
     ASM("       csrr     sp, mscratch           \n"
         "       mret                            \n");
 }
+
+// Machine mode trap handler used only while probing for optional CSRs at _entry: it resumes at the next instruction, so
+// accesses to CSRs the hart doesn't implement become no-ops
+void _int_skip()
+{
+    ASM("       csrw     mscratch, t0           \n"
+        "       csrr     t0, mepc               \n"
+        "       addi     t0, t0, 4              \n"
+        "       csrw     mepc, t0               \n"
+        "       csrr     t0, mscratch           \n"
+        "       mret                            \n");
+}
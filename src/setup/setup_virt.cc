@@ -0,0 +1,4 @@
+// EPOS QEMU Virt (RISC-V) SETUP
+
+// Virt boots like SiFive-U, so both share the same SETUP, which tells them apart by Traits<Build>::MODEL
+#include "setup_sifive_u.cc"
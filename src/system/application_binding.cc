@@ -25,6 +25,10 @@ extern "C" {
 }
 
 __USING_SYS;
+
+// The task's threads share a single OStream line, which can't be guarded by disabling interrupts at user level
+static Simple_Spin _print_spin;
+
 extern "C" {
     void _syscall(void * m) { CPU::syscall(m); }
     void _print(const char * s) {
@@ -33,4 +37,6 @@ extern "C" {
     }
     void _print_preamble() {}
     void _print_trailler(bool error) { if(error) _exit(-1); }
+    unsigned int _print_lock() { _print_spin.acquire(); return 0; }
+    void _print_unlock() { _print_spin.release(); }
 }
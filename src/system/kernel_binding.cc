@@ -3,6 +3,7 @@
 #include <architecture.h>
 #include <framework/main.h>
 #include <framework/agent.h>
+#include <utility/tracer.h>
 
 // Framework class attributes
 __BEGIN_SYS
@@ -27,4 +28,8 @@ __USING_SYS;
 #ifdef __ia32__
 extern "C" { void _exec(void *) __attribute__ ((thiscall)); }
 #endif
-extern "C" { void _exec(void * m) { reinterpret_cast<Agent *>(m)->exec(); }}
+extern "C" { void _exec(void * m) {
+    Agent * agent = reinterpret_cast<Agent *>(m);
+    Tracer::trace(Tracer::SYSCALL, agent->id().type(), agent->method());
+    agent->exec();
+}}
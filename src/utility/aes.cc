@@ -68,344 +68,408 @@ const unsigned char SWAES<16>::rcon[255] = {
 	   0xc6, 0x97, 0x35, 0x6a, 0xd4, 0xb3, 0x7d, 0xfa, 0xef, 0xc5, 0x91, 0x39, 0x72, 0xe4, 0xd3, 0xbd,
 	   0x61, 0xc2, 0x9f, 0x25, 0x4a, 0x94, 0x33, 0x66, 0xcc, 0x83, 0x1d, 0x3a, 0x74, 0xe8, 0xcb  };
 
-void SWAES<16>::ebc_encrypt(const unsigned char * input, const unsigned char * key, unsigned char * output)
+// Round tables: te[0][x] is column (2, 1, 1, 3) * sbox[x] and td[0][x] is column (e, 9, d, b) * rsbox[x]; te[i] and td[i]
+// are the same columns rotated right by 8 * i bits
+static constexpr unsigned char gmul(unsigned char a, unsigned char b)
 {
-    // Copy input to output, and work in-memory on output
-    block_copy(output, input);
-    _state = reinterpret_cast<State *>(output);
+    unsigned char p = 0;
+    for(unsigned int i = 0; i < 8; i++) {
+        if(b & 1)
+            p ^= a;
+        a = (a << 1) ^ ((a & 0x80) ? 0x1b : 0);
+        b >>= 1;
+    }
+    return p;
+}
 
-    _key = key;
-    expand_key();
+static constexpr unsigned int ror(unsigned int w, unsigned int n) { return n ? (w >> n) | (w << (32 - n)) : w; }
 
-    // The next function call encrypts the PlainText with the _key using AES algorithm.
-    cipher();
+static constexpr SWAES<16>::Tables tables(const unsigned char * sbox, const unsigned char * rsbox)
+{
+    SWAES<16>::Tables t{};
+    for(unsigned int x = 0; x < 256; x++) {
+        unsigned char s = sbox[x];
+        unsigned char r = rsbox[x];
+        unsigned int e = (gmul(s, 2) << 24) | (s << 16) | (s << 8) | gmul(s, 3);
+        unsigned int d = (gmul(r, 0x0e) << 24) | (gmul(r, 0x09) << 16) | (gmul(r, 0x0d) << 8) | gmul(r, 0x0b);
+        for(unsigned int i = 0; i < 4; i++) {
+            t.te[i][x] = ror(e, 8 * i);
+            t.td[i][x] = ror(d, 8 * i);
+        }
+    }
+    return t;
 }
 
-void SWAES<16>::ebc_decrypt(const unsigned char * input, const unsigned char * key, unsigned char *output)
-{
-    // Copy input to output, and work in-memory on output
-    block_copy(output, input);
-    _state = reinterpret_cast<State *>(output);
+const SWAES<16>::Tables SWAES<16>::_tables = tables(sbox, rsbox);
 
-    // The expand_key routine must be called before encryption.
-    _key = key;
-    expand_key();
+// Reduction of the 4 bits shifted out of a GHASH element, in the upper 16 bits of the high half
+const SWAES<16>::Half SWAES<16>::_last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0 };
 
-    inv_cipher();
+
+void SWAES<16>::crypt(const unsigned char * data, const unsigned char * k, unsigned char * result, bool encrypt)
+{
+    db<Ciphers>(TRC) << "AES::" << (encrypt ? "en" : "de") << "crypt(data=" << data << ",key=" << k << ",result=" << result << endl;
+    db<Ciphers>(INF) << "AES::" << (encrypt ? "en" : "de") << "crypt:data = {" << int(data[0]);
+    for(unsigned int i = 1; i < BLOCK_SIZE; i++)
+        db<Ciphers>(INF) << "," << int(data[i]);
+    db<Ciphers>(INF) << "}" << endl;
+
+    key(k);
+
+    unsigned char block[BLOCK_SIZE];
+    switch(_mode) {
+    case ECB:
+        if(encrypt)
+            encrypt_block(data, result);
+        else
+            decrypt_block(data, result);
+        break;
+    case CBC:
+        if(encrypt) {
+            for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+                block[i] = data[i] ^ _chain[i];
+            encrypt_block(block, result);
+            if(_chaining)
+                memcpy(_chain, result, BLOCK_SIZE);
+        } else {
+            memcpy(block, data, BLOCK_SIZE); // data and result might be the same buffer
+            decrypt_block(data, result);
+            for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+                result[i] ^= _chain[i];
+            if(_chaining)
+                memcpy(_chain, block, BLOCK_SIZE);
+        }
+        break;
+    case CTR:
+        crypt(data, result, BLOCK_SIZE);
+        break;
+    case GCM:
+        gcm_crypt(data, result, BLOCK_SIZE, encrypt);
+        break;
+    }
+
+    db<Ciphers>(INF) << "AES::" << (encrypt ? "en" : "de") << "crypt:result = {" << int(result[0]);
+    for(unsigned int i = 1; i < BLOCK_SIZE; i++)
+        db<Ciphers>(INF) << "," << int(result[i]);
+    db<Ciphers>(INF) << "}" << endl;
 }
 
-void SWAES<16>::cbc_encrypt_buffer(unsigned char * output, const unsigned char * _input, int length, const unsigned char * key, unsigned char * iv)
+void SWAES<16>::key(const unsigned char * k)
 {
-    unsigned char remainders = length % KEY_SIZE; /* Remaining bytes in the last non-full block */
+    if(_keyed && !memcmp(k, _key, KEY_SIZE))
+        return;
 
-    block_copy(output, _input);
-    _state = reinterpret_cast<State *>(output);
+    memcpy(_key, k, KEY_SIZE);
+    expand_key(k);
+    _keyed = true;
+}
 
-    // Skip the key expansion if key is passed as 0
-    if(0 != key) {
-        _key = key;
-        expand_key();
+// This function produces Nb(Nr+1) round keys for encryption and the matching ones for the equivalent inverse cipher,
+// whose inner round keys go through InvMixColumns
+void SWAES<16>::expand_key(const unsigned char * key)
+{
+    for(unsigned int i = 0; i < Nk; i++)
+        _ek[i] = get(key + 4 * i);
+
+    for(unsigned int i = Nk; i < Nb * (Nr + 1); i++) {
+        Word t = _ek[i - 1];
+        if(i % Nk == 0) // RotWord, SubWord and Rcon
+            t = ((Word(sbox[(t >> 16) & 0xff]) << 24) | (Word(sbox[(t >> 8) & 0xff]) << 16) | (Word(sbox[t & 0xff]) << 8) | Word(sbox[t >> 24])) ^ (Word(rcon[i / Nk]) << 24);
+        _ek[i] = _ek[i - Nk] ^ t;
     }
 
-    if(iv != 0)
-        _iv = iv;
-
-    int i;
-    for(i = 0; i < length; i += KEY_SIZE) {
-        unsigned char input[KEY_SIZE];
-        for(int j=0; (j<(int)KEY_SIZE) && (j+i < length); j++)
-            input[j] = _input[j+i];
-        xor_with_iv(input);
-        block_copy(output, input);
-        _state = reinterpret_cast<State *>(output);
-        cipher();
-        _iv = output;
-        output += KEY_SIZE;
-    }
+    for(unsigned int r = 0; r <= Nr; r++)
+        for(unsigned int c = 0; c < Nb; c++) {
+            Word w = _ek[Nb * (Nr - r) + c];
+            if((r > 0) && (r < Nr))
+                w = _tables.td[0][sbox[w >> 24]] ^ _tables.td[1][sbox[(w >> 16) & 0xff]] ^ _tables.td[2][sbox[(w >> 8) & 0xff]] ^ _tables.td[3][sbox[w & 0xff]];
+            _dk[Nb * r + c] = w;
+        }
+}
 
-    if(remainders) {
-        block_copy(output, _input+i);
-        memset(output + remainders, 0, KEY_SIZE - remainders); /* add 0-padding */
-        _state = reinterpret_cast<State *>(output);
-        cipher();
+void SWAES<16>::encrypt_block(const unsigned char * input, unsigned char * output) const
+{
+    const Word (* te)[256] = _tables.te;
+    const Word * rk = _ek;
+
+    Word s0 = get(input) ^ rk[0];
+    Word s1 = get(input + 4) ^ rk[1];
+    Word s2 = get(input + 8) ^ rk[2];
+    Word s3 = get(input + 12) ^ rk[3];
+
+    for(unsigned int r = 1; r < Nr; r++) {
+        rk += Nb;
+        Word t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xff] ^ te[2][(s2 >> 8) & 0xff] ^ te[3][s3 & 0xff] ^ rk[0];
+        Word t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xff] ^ te[2][(s3 >> 8) & 0xff] ^ te[3][s0 & 0xff] ^ rk[1];
+        Word t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xff] ^ te[2][(s0 >> 8) & 0xff] ^ te[3][s1 & 0xff] ^ rk[2];
+        Word t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xff] ^ te[2][(s1 >> 8) & 0xff] ^ te[3][s2 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
     }
+
+    // The last round has no MixColumns
+    rk += Nb;
+    put(output,      ((Word(sbox[s0 >> 24]) << 24) | (Word(sbox[(s1 >> 16) & 0xff]) << 16) | (Word(sbox[(s2 >> 8) & 0xff]) << 8) | sbox[s3 & 0xff]) ^ rk[0]);
+    put(output + 4,  ((Word(sbox[s1 >> 24]) << 24) | (Word(sbox[(s2 >> 16) & 0xff]) << 16) | (Word(sbox[(s3 >> 8) & 0xff]) << 8) | sbox[s0 & 0xff]) ^ rk[1]);
+    put(output + 8,  ((Word(sbox[s2 >> 24]) << 24) | (Word(sbox[(s3 >> 16) & 0xff]) << 16) | (Word(sbox[(s0 >> 8) & 0xff]) << 8) | sbox[s1 & 0xff]) ^ rk[2]);
+    put(output + 12, ((Word(sbox[s3 >> 24]) << 24) | (Word(sbox[(s0 >> 16) & 0xff]) << 16) | (Word(sbox[(s1 >> 8) & 0xff]) << 8) | sbox[s2 & 0xff]) ^ rk[3]);
 }
 
-void SWAES<16>::cbc_decrypt_buffer(unsigned char * output, const unsigned char * input, int length, const unsigned char * key, unsigned char * iv)
+void SWAES<16>::decrypt_block(const unsigned char * input, unsigned char * output) const
 {
-    int i;
-    unsigned char remainders = length % KEY_SIZE; /* Remaining bytes in the last non-full block */
+    const Word (* td)[256] = _tables.td;
+    const Word * rk = _dk;
+
+    Word s0 = get(input) ^ rk[0];
+    Word s1 = get(input + 4) ^ rk[1];
+    Word s2 = get(input + 8) ^ rk[2];
+    Word s3 = get(input + 12) ^ rk[3];
+
+    for(unsigned int r = 1; r < Nr; r++) {
+        rk += Nb;
+        Word t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xff] ^ td[2][(s2 >> 8) & 0xff] ^ td[3][s1 & 0xff] ^ rk[0];
+        Word t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xff] ^ td[2][(s3 >> 8) & 0xff] ^ td[3][s2 & 0xff] ^ rk[1];
+        Word t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xff] ^ td[2][(s0 >> 8) & 0xff] ^ td[3][s3 & 0xff] ^ rk[2];
+        Word t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xff] ^ td[2][(s1 >> 8) & 0xff] ^ td[3][s0 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
 
-    block_copy(output, input);
-    _state = reinterpret_cast<State *>(output);
+    rk += Nb;
+    put(output,      ((Word(rsbox[s0 >> 24]) << 24) | (Word(rsbox[(s3 >> 16) & 0xff]) << 16) | (Word(rsbox[(s2 >> 8) & 0xff]) << 8) | rsbox[s1 & 0xff]) ^ rk[0]);
+    put(output + 4,  ((Word(rsbox[s1 >> 24]) << 24) | (Word(rsbox[(s0 >> 16) & 0xff]) << 16) | (Word(rsbox[(s3 >> 8) & 0xff]) << 8) | rsbox[s2 & 0xff]) ^ rk[1]);
+    put(output + 8,  ((Word(rsbox[s2 >> 24]) << 24) | (Word(rsbox[(s1 >> 16) & 0xff]) << 16) | (Word(rsbox[(s0 >> 8) & 0xff]) << 8) | rsbox[s3 & 0xff]) ^ rk[2]);
+    put(output + 12, ((Word(rsbox[s3 >> 24]) << 24) | (Word(rsbox[(s2 >> 16) & 0xff]) << 16) | (Word(rsbox[(s1 >> 8) & 0xff]) << 8) | rsbox[s0 & 0xff]) ^ rk[3]);
+}
 
-    // Skip the key expansion if key is passed as 0
-    if(0 != key) {
-        _key = key;
-        expand_key();
-    }
+// Encrypts the counter block and increments it (as a 128-bit big-endian number in CTR and only its last 32 bits in GCM)
+void SWAES<16>::next_keystream()
+{
+    encrypt_block(_counter, _keystream);
+    _offset = 0;
 
-    // If iv is passed as 0, we continue to encrypt without re-setting the _iv
-    if(iv != 0)
-        _iv = iv;
-
-    for(i = 0; i < length; i += KEY_SIZE) {
-        block_copy(output, input);
-        _state = reinterpret_cast<State *>(output);
-        inv_cipher();
-        xor_with_iv(output);
-        _iv = const_cast<unsigned char *>(input);
-        input += KEY_SIZE;
-        output += KEY_SIZE;
+    unsigned int last = (_mode == GCM) ? BLOCK_SIZE - 4 : 0;
+    for(unsigned int i = BLOCK_SIZE; i > last; i--)
+        if(++_counter[i - 1])
+            break;
+}
+
+// Counter blocks are independent, so a stream can be split among several contexts at block boundaries
+void SWAES<16>::crypt(const unsigned char * input, unsigned char * output, unsigned long length)
+{
+    for(; length && (_offset < BLOCK_SIZE); length--)
+        *output++ = *input++ ^ _keystream[_offset++];
+
+    for(; length >= BLOCK_SIZE; length -= BLOCK_SIZE, input += BLOCK_SIZE, output += BLOCK_SIZE) {
+        next_keystream();
+        for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+            output[i] = input[i] ^ _keystream[i];
+        _offset = BLOCK_SIZE;
     }
 
-    if(remainders) {
-        block_copy(output, input);
-        memset(output+remainders, 0, KEY_SIZE - remainders); /* add 0-padding */
-        _state = reinterpret_cast<State *>(output);
-        inv_cipher();
+    if(length) {
+        next_keystream();
+        for(; length; length--)
+            *output++ = *input++ ^ _keystream[_offset++];
     }
 }
 
-// This function produces Nb(Nr+1) round keys. The round keys are used in each round to decrypt the states.
-void SWAES<16>::expand_key(void)
+void SWAES<16>::gcm(const unsigned char * iv, unsigned int iv_length)
 {
-    unsigned int i, j, k;
-    unsigned char tempa[4]; // Used for the column/row operations
-
-    // The first round key is the key itself.
-    for(i = 0; i < Nk; ++i) {
-        _round_key[(i * 4) + 0] = _key[(i * 4) + 0];
-        _round_key[(i * 4) + 1] = _key[(i * 4) + 1];
-        _round_key[(i * 4) + 2] = _key[(i * 4) + 2];
-        _round_key[(i * 4) + 3] = _key[(i * 4) + 3];
+    // H is derived from the key, so there must be one
+    if(!_keyed) {
+        db<Ciphers>(WRN) << "AES::gcm: no key was set!" << endl;
+        return;
     }
 
-    // All other round keys are found from the previous round keys.
-    for(; (i < (Nb * (Nr + 1))); ++i) {
-        for(j = 0; j < 4; ++j)
-            tempa[j]=_round_key[(i-1) * 4 + j];
-        if (i % Nk == 0) {
-            // This function rotates the 4 bytes in a word to the left once.
-            // [a0,a1,a2,a3] becomes [a1,a2,a3,a0]
-
-            // Function RotWord()
-            {
-                k = tempa[0];
-                tempa[0] = tempa[1];
-                tempa[1] = tempa[2];
-                tempa[2] = tempa[3];
-                tempa[3] = k;
-            }
-
-            // SubWord() is a function that takes a four-byte input word and
-            // applies the S-box to each of the four bytes to produce an output word.
-
-            // Function Subword()
-            {
-                tempa[0] = sbox[static_cast<int>(tempa[0])];
-                tempa[1] = sbox[static_cast<int>(tempa[1])];
-                tempa[2] = sbox[static_cast<int>(tempa[2])];
-                tempa[3] = sbox[static_cast<int>(tempa[3])];
-            }
-
-            tempa[0] =  tempa[0] ^ rcon[i/Nk];
-        }
-        else if (Nk > 6 && i % Nk == 4) {
-            // Function Subword()
-            {
-                tempa[0] = sbox[static_cast<int>(tempa[0])];
-                tempa[1] = sbox[static_cast<int>(tempa[1])];
-                tempa[2] = sbox[static_cast<int>(tempa[2])];
-                tempa[3] = sbox[static_cast<int>(tempa[3])];
-            }
-        }
-        _round_key[i * 4 + 0] = _round_key[(i - Nk) * 4 + 0] ^ tempa[0];
-        _round_key[i * 4 + 1] = _round_key[(i - Nk) * 4 + 1] ^ tempa[1];
-        _round_key[i * 4 + 2] = _round_key[(i - Nk) * 4 + 2] ^ tempa[2];
-        _round_key[i * 4 + 3] = _round_key[(i - Nk) * 4 + 3] ^ tempa[3];
+    _mode = GCM;
+
+    unsigned char h[BLOCK_SIZE];
+    memset(h, 0, BLOCK_SIZE);
+    encrypt_block(h, h);
+    ghash_tables(h);
+
+    memset(_x, 0, BLOCK_SIZE);
+    _block_length = 0;
+    _aad_length = 0;
+    _text_length = 0;
+
+    if(iv_length == 12) {
+        memcpy(_j0, iv, 12);
+        _j0[12] = 0; _j0[13] = 0; _j0[14] = 0; _j0[15] = 1;
+    } else { // J0 = GHASH(IV || 0-padding || [0]64 || [len(IV)]64)
+        for(unsigned int i = 0; i < iv_length; i++)
+            ghash_byte(iv[i]);
+        ghash_flush();
+        unsigned char lengths[BLOCK_SIZE];
+        memset(lengths, 0, BLOCK_SIZE);
+        put(lengths + 8, Word((iv_length * 8ULL) >> 32));
+        put(lengths + 12, Word(iv_length * 8ULL));
+        ghash(lengths);
+        memcpy(_j0, _x, BLOCK_SIZE);
+        memset(_x, 0, BLOCK_SIZE);
     }
+
+    memcpy(_counter, _j0, BLOCK_SIZE);
+    for(unsigned int i = BLOCK_SIZE; i > BLOCK_SIZE - 4; i--) // inc32
+        if(++_counter[i - 1])
+            break;
+    _offset = BLOCK_SIZE;
 }
 
-// This function adds the round key to _state.
-// The round key is added to the _state by an XOR function.
-void SWAES<16>::add_round_key(int round)
+void SWAES<16>::aad(const unsigned char * data, unsigned long length)
 {
-    int i,j;
-    for(i=0;i<4;++i) {
-        for(j = 0; j < 4; ++j) {
-            (*_state)[i][j] ^= _round_key[round * Nb * 4 + i * Nb + j];
-        }
-    }
+    _aad_length += length;
+    for(; length && _block_length; length--)
+        ghash_byte(*data++);
+    for(; length >= BLOCK_SIZE; length -= BLOCK_SIZE, data += BLOCK_SIZE)
+        ghash(data);
+    for(; length; length--)
+        ghash_byte(*data++);
 }
 
-// The sub_bytes Function Substitutes the values in the
-// _state matrix with values in an S-box.
-void SWAES<16>::sub_bytes(void)
+void SWAES<16>::gcm_crypt(const unsigned char * input, unsigned char * output, unsigned long length, bool encrypt)
 {
-    int i, j;
-    for(i = 0; i < 4; ++i) {
-        for(j = 0; j < 4; ++j) {
-            (*_state)[j][i] = sbox[static_cast<int>((*_state)[j][i])];
-        }
+    if(!_text_length) // the AAD is padded to a whole block before the text
+        ghash_flush();
+    _text_length += length;
+
+    // Bytes go one by one until both the keystream and the GHASH input are block-aligned again
+    for(; length && ((_offset < BLOCK_SIZE) || _block_length); length--) {
+        if(_offset == BLOCK_SIZE)
+            next_keystream();
+        unsigned char in = *input++;
+        unsigned char out = in ^ _keystream[_offset++];
+        ghash_byte(encrypt ? out : in);
+        *output++ = out;
+    }
+
+    for(; length >= BLOCK_SIZE; length -= BLOCK_SIZE, input += BLOCK_SIZE, output += BLOCK_SIZE) {
+        next_keystream();
+        if(!encrypt)
+            ghash(input); // before output overwrites it, in case they are the same buffer
+        for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+            output[i] = input[i] ^ _keystream[i];
+        if(encrypt)
+            ghash(output);
+        _offset = BLOCK_SIZE;
+    }
+
+    for(; length; length--) {
+        if(_offset == BLOCK_SIZE)
+            next_keystream();
+        unsigned char in = *input++;
+        unsigned char out = in ^ _keystream[_offset++];
+        ghash_byte(encrypt ? out : in);
+        *output++ = out;
     }
 }
 
-// The shift_rows() function shifts the rows in the _state to the left.
-// Each row is shifted with different offset.
-// Offset = Row number. So the first row is not shifted.
-void SWAES<16>::shift_rows(void)
+void SWAES<16>::tag(unsigned char * tag, unsigned int length)
 {
-    unsigned char temp;
-
-    // Rotate first row 1 columns to left
-    temp            = (*_state)[0][1];
-    (*_state)[0][1] = (*_state)[1][1];
-    (*_state)[1][1] = (*_state)[2][1];
-    (*_state)[2][1] = (*_state)[3][1];
-    (*_state)[3][1] = temp;
-
-    // Rotate second row 2 columns to left
-    temp            = (*_state)[0][2];
-    (*_state)[0][2] = (*_state)[2][2];
-    (*_state)[2][2] = temp;
-
-    temp            = (*_state)[1][2];
-    (*_state)[1][2] = (*_state)[3][2];
-    (*_state)[3][2] = temp;
-
-    // Rotate third row 3 columns to left
-    temp            = (*_state)[0][3];
-    (*_state)[0][3] = (*_state)[3][3];
-    (*_state)[3][3] = (*_state)[2][3];
-    (*_state)[2][3] = (*_state)[1][3];
-    (*_state)[1][3] = temp;
+    ghash_flush();
+
+    unsigned char lengths[BLOCK_SIZE];
+    put(lengths, Word((_aad_length * 8) >> 32));
+    put(lengths + 4, Word(_aad_length * 8));
+    put(lengths + 8, Word((_text_length * 8) >> 32));
+    put(lengths + 12, Word(_text_length * 8));
+    ghash(lengths);
+
+    unsigned char ej0[BLOCK_SIZE];
+    encrypt_block(_j0, ej0);
+    for(unsigned int i = 0; (i < length) && (i < BLOCK_SIZE); i++)
+        tag[i] = _x[i] ^ ej0[i];
 }
 
-// mix_columns function mixes the columns of the _state matrix
-void SWAES<16>::mix_columns(void)
+bool SWAES<16>::check(const unsigned char * t, unsigned int length)
 {
-    int i;
-    unsigned char Tmp,Tm,t;
-    for(i = 0; i < 4; ++i) {
-        t   = (*_state)[i][0];
-        Tmp = (*_state)[i][0] ^ (*_state)[i][1] ^ (*_state)[i][2] ^ (*_state)[i][3] ;
-        Tm  = (*_state)[i][0] ^ (*_state)[i][1] ; Tm = xtime(Tm);  (*_state)[i][0] ^= Tm ^ Tmp ;
-        Tm  = (*_state)[i][1] ^ (*_state)[i][2] ; Tm = xtime(Tm);  (*_state)[i][1] ^= Tm ^ Tmp ;
-        Tm  = (*_state)[i][2] ^ (*_state)[i][3] ; Tm = xtime(Tm);  (*_state)[i][2] ^= Tm ^ Tmp ;
-        Tm  = (*_state)[i][3] ^ t ;        Tm = xtime(Tm);  (*_state)[i][3] ^= Tm ^ Tmp ;
-    }
+    unsigned char computed[BLOCK_SIZE];
+    tag(computed);
+
+    // Compare all bytes so the time taken does not tell where the first mismatch is
+    unsigned char diff = 0;
+    for(unsigned int i = 0; (i < length) && (i < BLOCK_SIZE); i++)
+        diff |= computed[i] ^ t[i];
+    return (length > 0) && !diff;
 }
 
-// mix_columns function mixes the columns of the _state matrix.
-// The method used to multiply may be difficult to understand for the inexperienced.
-// Please use the references to gain more information.
-void SWAES<16>::inv_mix_columns(void)
+// Precomputes i * H for every 4-bit i (Shoup's method), with elements split in big-endian halves
+void SWAES<16>::ghash_tables(const unsigned char * h)
 {
-    int i;
-    unsigned char a,b,c,d;
-    for(i = 0; i < 4; ++i) {
-        a = (*_state)[i][0];
-        b = (*_state)[i][1];
-        c = (*_state)[i][2];
-        d = (*_state)[i][3];
-
-        (*_state)[i][0] = multiply(a, 0x0e) ^ multiply(b, 0x0b) ^ multiply(c, 0x0d) ^ multiply(d, 0x09);
-        (*_state)[i][1] = multiply(a, 0x09) ^ multiply(b, 0x0e) ^ multiply(c, 0x0b) ^ multiply(d, 0x0d);
-        (*_state)[i][2] = multiply(a, 0x0d) ^ multiply(b, 0x09) ^ multiply(c, 0x0e) ^ multiply(d, 0x0b);
-        (*_state)[i][3] = multiply(a, 0x0b) ^ multiply(b, 0x0d) ^ multiply(c, 0x09) ^ multiply(d, 0x0e);
+    Half vh = (Half(get(h)) << 32) | get(h + 4);
+    Half vl = (Half(get(h + 8)) << 32) | get(h + 12);
+
+    _hl[0] = 0;
+    _hh[0] = 0;
+    _hl[8] = vl;
+    _hh[8] = vh;
+
+    for(unsigned int i = 4; i > 0; i >>= 1) {
+        Half t = (vl & 1) * 0xe1000000ULL;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ (t << 32);
+        _hl[i] = vl;
+        _hh[i] = vh;
     }
-}
 
+    for(unsigned int i = 2; i <= 8; i *= 2)
+        for(unsigned int j = 1; j < i; j++) {
+            _hh[i + j] = _hh[i] ^ _hh[j];
+            _hl[i + j] = _hl[i] ^ _hl[j];
+        }
+}
 
-// The sub_bytes Function Substitutes the values in the
-// _state matrix with values in an S-box.
-void SWAES<16>::inv_sub_bytes(void)
+// X = (X ^ block) * H
+void SWAES<16>::ghash(const unsigned char * block)
 {
-    int i,j;
-    for(i=0;i<4;++i) {
-        for(j=0;j<4;++j) {
-            (*_state)[j][i] = rsbox[static_cast<int>((*_state)[j][i])];
+    unsigned char x[BLOCK_SIZE];
+    for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+        x[i] = _x[i] ^ block[i];
+
+    unsigned int lo = x[15] & 0xf;
+    Half zh = _hh[lo];
+    Half zl = _hl[lo];
+
+    for(int i = 15; i >= 0; i--) {
+        lo = x[i] & 0xf;
+        unsigned int hi = x[i] >> 4;
+
+        if(i != 15) {
+            unsigned int rem = zl & 0xf;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (_last4[rem] << 48) ^ _hh[lo];
+            zl ^= _hl[lo];
         }
+
+        unsigned int rem = zl & 0xf;
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (_last4[rem] << 48) ^ _hh[hi];
+        zl ^= _hl[hi];
     }
-}
 
-void SWAES<16>::inv_shift_rows(void)
-{
-    unsigned char temp;
-
-    // Rotate first row 1 columns to right
-    temp            = (*_state)[3][1];
-    (*_state)[3][1] = (*_state)[2][1];
-    (*_state)[2][1] = (*_state)[1][1];
-    (*_state)[1][1] = (*_state)[0][1];
-    (*_state)[0][1] = temp;
-
-    // Rotate second row 2 columns to right
-    temp            = (*_state)[0][2];
-    (*_state)[0][2] = (*_state)[2][2];
-    (*_state)[2][2] = temp;
-
-    temp            = (*_state)[1][2];
-    (*_state)[1][2] = (*_state)[3][2];
-    (*_state)[3][2] = temp;
-
-    // Rotate third row 3 columns to right
-    temp            = (*_state)[0][3];
-    (*_state)[0][3] = (*_state)[1][3];
-    (*_state)[1][3] = (*_state)[2][3];
-    (*_state)[2][3] = (*_state)[3][3];
-    (*_state)[3][3] = temp;
+    put(_x, zh >> 32);
+    put(_x + 4, zh);
+    put(_x + 8, zl >> 32);
+    put(_x + 12, zl);
 }
 
-
-// cipher is the main function that encrypts the PlainText.
-void SWAES<16>::cipher(void)
+void SWAES<16>::ghash_byte(unsigned char b)
 {
-    unsigned char round = 0;
-
-    // Add the First round key to the _state before starting the rounds.
-    add_round_key(0);
-
-    // There will be Nr rounds.
-    // The first Nr-1 rounds are identical.
-    // These Nr-1 rounds are executed in the loop below.
-    for(round = 1; round < Nr; ++round) {
-        sub_bytes();
-        shift_rows();
-        mix_columns();
-        add_round_key(round);
+    _block[_block_length++] = b;
+    if(_block_length == BLOCK_SIZE) {
+        ghash(_block);
+        _block_length = 0;
     }
-
-    // The last round is given below.
-    // The mix_columns function is not here in the last round.
-    sub_bytes();
-    shift_rows();
-    add_round_key(Nr);
 }
 
-void SWAES<16>::inv_cipher(void)
+void SWAES<16>::ghash_flush()
 {
-    unsigned char round=0;
-
-    // Add the First round key to the _state before starting the rounds.
-    add_round_key(Nr);
-
-    // There will be Nr rounds.
-    // The first Nr-1 rounds are identical.
-    // These Nr-1 rounds are executed in the loop below.
-    for(round = Nr - 1; round > 0; round--) {
-        inv_shift_rows();
-        inv_sub_bytes();
-        add_round_key(round);
-        inv_mix_columns();
+    if(_block_length) {
+        memset(_block + _block_length, 0, BLOCK_SIZE - _block_length);
+        ghash(_block);
+        _block_length = 0;
     }
-
-    // The last round is given below.
-    // The mix_columns function is not here in the last round.
-    inv_shift_rows();
-    inv_sub_bytes();
-    add_round_key(0);
 }
 
 __END_UTIL
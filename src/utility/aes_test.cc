@@ -0,0 +1,152 @@
+// EPOS AES Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/aes.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+typedef SWAES<16> Cipher;
+
+const unsigned int SIZE = 16 * 1024;
+
+unsigned char plain[SIZE];
+unsigned char cipher[SIZE];
+
+unsigned int unhex(const char * s, unsigned char * out)
+{
+    unsigned int n = 0;
+    for(; s[0] && s[1]; s += 2, n++) {
+        unsigned char hi = (s[0] <= '9') ? s[0] - '0' : s[0] - 'a' + 10;
+        unsigned char lo = (s[1] <= '9') ? s[1] - '0' : s[1] - 'a' + 10;
+        out[n] = (hi << 4) | lo;
+    }
+    return n;
+}
+
+bool equals(const unsigned char * data, const char * expected)
+{
+    unsigned char buf[128];
+    unsigned int n = unhex(expected, buf);
+    return !memcmp(data, buf, n);
+}
+
+void report(const char * name, bool ok)
+{
+    cout << name << "\t=> " << (ok ? "passed!" : "failed!") << endl;
+}
+
+// GCM test case 4 from the GCM specification (McGrew & Viega), fed in chunks of every size from 1 to 17 bytes
+bool gcm(unsigned int chunk)
+{
+    unsigned char k[16], iv[12], a[20], p[60], c[60], t[16];
+    unhex("feffe9928665731c6d6a8f9467308308", k);
+    unhex("cafebabefacedbaddecaf888", iv);
+    unhex("feedfacedeadbeeffeedfacedeadbeefabaddad2", a);
+    unhex("d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39", p);
+
+    Cipher aes;
+    aes.key(k);
+    aes.gcm(iv);
+    for(unsigned int i = 0; i < sizeof(a); i += chunk)
+        aes.aad(&a[i], (i + chunk > sizeof(a)) ? sizeof(a) - i : chunk);
+    for(unsigned int i = 0; i < sizeof(p); i += chunk)
+        aes.encrypt(&p[i], &c[i], (i + chunk > sizeof(p)) ? sizeof(p) - i : chunk);
+    aes.tag(t);
+
+    bool ok = equals(c, "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091");
+    ok &= equals(t, "5bc94fbc3221a5db94fae95ae7121a47");
+
+    unsigned char d[60];
+    aes.gcm(iv);
+    aes.aad(a, sizeof(a));
+    aes.decrypt(c, d, sizeof(c));
+    ok &= aes.check(t) && !memcmp(d, p, sizeof(p));
+
+    c[0] ^= 1;
+    aes.gcm(iv);
+    aes.aad(a, sizeof(a));
+    aes.decrypt(c, d, sizeof(c));
+    ok &= !aes.check(t);
+
+    return ok;
+}
+
+template<typename F>
+void bench(const char * name, F f)
+{
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    f();
+    TSC::Time_Stamp ticks = TSC::time_stamp() - t0;
+    cout << name << "(n=" << SIZE << ")\t=> " << ticks << " ticks";
+    if(ticks)
+        cout << ", " << static_cast<unsigned long long>(SIZE) * TSC::frequency() / ticks / 1024 << " KiB/s";
+    cout << endl;
+}
+
+int main()
+{
+    cout << "AES test" << endl;
+
+    unsigned char k[16], iv[16], p[32], c[32];
+
+    // FIPS-197, appendix C.1
+    unhex("000102030405060708090a0b0c0d0e0f", k);
+    unhex("00112233445566778899aabbccddeeff", p);
+    Cipher ecb;
+    ecb.encrypt(p, k, c);
+    bool ok = equals(c, "69c4e0d86a7b0430d8cdb78070b4c55a");
+    ecb.decrypt(c, k, c);
+    ok &= !memcmp(c, p, 16);
+    report("ECB", ok);
+
+    // SP 800-38A, F.2.1 and F.5.1 (two blocks each)
+    unhex("2b7e151628aed2a6abf7158809cf4f3c", k);
+    unhex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51", p);
+
+    unhex("000102030405060708090a0b0c0d0e0f", iv);
+    Cipher cbc(Cipher::CBC);
+    cbc.iv(iv, true);
+    cbc.encrypt(&p[0], k, &c[0]);
+    cbc.encrypt(&p[16], k, &c[16]);
+    ok = equals(c, "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2");
+    Cipher cbc_decrypt(Cipher::CBC);
+    cbc_decrypt.iv(iv, true);
+    cbc_decrypt.decrypt(&c[0], k, &c[0]);
+    cbc_decrypt.decrypt(&c[16], k, &c[16]);
+    ok &= !memcmp(c, p, sizeof(p));
+
+    // Without chaining, every call starts over from the IV
+    Cipher cbc_single(Cipher::CBC);
+    cbc_single.iv(iv);
+    cbc_single.encrypt(&p[0], k, &c[0]);
+    cbc_single.encrypt(&p[0], k, &c[16]);
+    ok &= equals(c, "7649abac8119b246cee98e9b12e9197d7649abac8119b246cee98e9b12e9197d");
+    report("CBC", ok);
+
+    unhex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", iv);
+    Cipher ctr;
+    ctr.key(k);
+    ctr.ctr(iv);
+    ctr.crypt(&p[0], &c[0], 5);
+    ctr.crypt(&p[5], &c[5], 20);
+    ctr.crypt(&p[25], &c[25], 7);
+    report("CTR", equals(c, "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"));
+
+    ok = true;
+    for(unsigned int chunk = 1; chunk <= 17; chunk++)
+        ok &= gcm(chunk);
+    report("GCM", ok);
+
+    for(unsigned int i = 0; i < SIZE; i++)
+        plain[i] = i * 31 + (i >> 8);
+
+    bench("CTR", [&]() { ctr.ctr(iv); ctr.crypt(plain, cipher, SIZE); });
+    bench("GCM", [&]() { ctr.gcm(iv); ctr.encrypt(plain, cipher, SIZE); ctr.tag(c); });
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
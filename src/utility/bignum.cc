@@ -5,34 +5,24 @@
 __BEGIN_UTIL
 
 // Class attributes
-template<>
-const Bignum<16>::_Word Bignum<16>::_mod = {{ 0xff, 0xff, 0xff, 0xff,
-                                              0xff, 0xff, 0xff, 0xff,
-                                              0xff, 0xff, 0xff, 0xff,
-                                              0xfd, 0xff, 0xff, 0xff }};
+// 2^128 - 2^97 - 1 (secp128r1): used by Diffie_Hellman
+static constexpr unsigned char p128[16] = { 0xff, 0xff, 0xff, 0xff,
+                                            0xff, 0xff, 0xff, 0xff,
+                                            0xff, 0xff, 0xff, 0xff,
+                                            0xfd, 0xff, 0xff, 0xff };
 
 template<>
-const Bignum<16>::_Barrett Bignum<16>::_barrett_u = {{ 17, 0, 0, 0,
-                                                        8, 0, 0, 0,
-                                                        4, 0, 0, 0,
-                                                        2, 0, 0, 0,
-                                                        1, 0, 0, 0}};
+const Bignum<16>::Modulo Bignum<16>::_modulo = Bignum<16>::modulo(p128);
 
 
 // 2^(130) - 5: used by Poly1305
-template<>
-const Bignum<17>::_Word Bignum<17>::_mod = {{ 0xfb, 0xff, 0xff, 0xff,
-                                              0xff, 0xff, 0xff, 0xff,
-                                              0xff, 0xff, 0xff, 0xff,
-                                              0xff, 0xff, 0xff, 0xff,
-                                              0x03, 0x00, 0x00, 0x00 }};
+static constexpr unsigned char p130[17] = { 0xfb, 0xff, 0xff, 0xff,
+                                            0xff, 0xff, 0xff, 0xff,
+                                            0xff, 0xff, 0xff, 0xff,
+                                            0xff, 0xff, 0xff, 0xff,
+                                            0x03 };
 
-// 0x400000000000000000000000000000005000000000000000
 template<>
-const Bignum<17>::_Barrett Bignum<17>::_barrett_u = {{ 0x00, 0x00, 0x00, 0x00,
-                                                       0x00, 0x00, 0x00, 0x50,
-                                                       0x00, 0x00, 0x00, 0x00,
-                                                       0x00, 0x00, 0x00, 0x00,
-                                                       0x00, 0x00, 0x00, 0x00,
-                                                       0x00, 0x00, 0x00, 0x40 }};
+const Bignum<17>::Modulo Bignum<17>::_modulo = Bignum<17>::modulo(p130);
+
 __END_UTIL
@@ -0,0 +1,54 @@
+// EPOS CRC Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/crc.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int SIZE = 64 * 1024;
+
+unsigned char data[SIZE];
+
+template<typename Engine>
+void test(const char * name, typename Engine::Value check)
+{
+    // Check value over "123456789" from the CRC catalogue, then the same CRC streamed over uneven chunks of a larger buffer
+    typename Engine::Value crc = Engine::compute("123456789", 9);
+    cout << name << "(\"123456789\")\t=> " << hex << crc << (crc == check ? " passed!" : " failed!") << endl;
+
+    Engine stream;
+    for(unsigned int i = 0, n = 1; i < SIZE; i += n, n = (n * 7 + 3) % 97)
+        stream.update(&data[i], (i + n > SIZE) ? SIZE - i : n);
+    cout << name << "(streamed)\t=> " << (stream.value() == Engine::compute(data, SIZE) ? "passed!" : "failed!") << endl;
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    Engine::compute(data, SIZE);
+    TSC::Time_Stamp ticks = TSC::time_stamp() - t0;
+    cout << name << "(n=" << dec << SIZE << ")\t=> " << ticks << " ticks";
+    if(ticks)
+        cout << ", " << static_cast<unsigned long long>(SIZE) * TSC::frequency() / ticks / 1024 << " KiB/s";
+    cout << endl;
+}
+
+int main()
+{
+    cout << "CRC test" << endl;
+
+    for(unsigned int i = 0; i < SIZE; i++)
+        data[i] = i * 31 + (i >> 8);
+
+    test<CRC16_XMODEM>("CRC16_XMODEM", 0x31c3);
+    test<CRC16_CCITT>("CRC16_CCITT", 0x29b1);
+    test<CRC32>("CRC32", 0xcbf43926);
+    test<CRC32C>("CRC32C", 0xe3069283);
+
+    char legacy[] = "123456789";
+    cout << "CRC::crc16()\t=> " << (CRC::crc16(legacy, 9) == 0x31c3 ? "passed!" : "failed!") << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
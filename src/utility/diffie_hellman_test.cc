@@ -0,0 +1,89 @@
+// EPOS Diffie-Hellman (and Bignum) Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/aes.h>
+#include <utility/diffie_hellman.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+typedef Diffie_Hellman<SWAES<16>> DH;
+
+const unsigned int PAIRS = 10;
+
+// Known answers on secp128r1 (bytes little-endian, as in DH): k * G for an even k and for k + 1
+const char G_X[16] = { '\x86', '\x5B', '\x2C', '\xA5', '\x7C', '\x60', '\x28', '\x0C', '\x2D', '\x9B', '\x89', '\x8B', '\x52', '\xF7', '\x1F', '\x16' };
+const char G_Y[16] = { '\x83', '\x7A', '\xED', '\xDD', '\x92', '\xA2', '\x2D', '\xC0', '\x13', '\xEB', '\xAF', '\x5B', '\x39', '\xC8', '\x5A', '\xCF' };
+const char K[2][16] = {
+    { '\x10', '\x32', '\x54', '\x76', '\x98', '\xBA', '\xDC', '\xFE', '\xEF', '\xCD', '\xAB', '\x89', '\x67', '\x45', '\x23', '\x01' },
+    { '\x11', '\x32', '\x54', '\x76', '\x98', '\xBA', '\xDC', '\xFE', '\xEF', '\xCD', '\xAB', '\x89', '\x67', '\x45', '\x23', '\x01' }
+};
+const char KG_X[2][16] = {
+    { '\x4D', '\xDA', '\xA3', '\x09', '\x58', '\x7D', '\x95', '\x49', '\x07', '\xC2', '\x4F', '\xB9', '\xA8', '\x1D', '\x69', '\x1D' },
+    { '\x04', '\x6F', '\x27', '\x5D', '\xAD', '\x68', '\x16', '\x72', '\x54', '\xC5', '\x5B', '\xB8', '\x25', '\x43', '\x1F', '\x53' }
+};
+const char KG_Y[2][16] = {
+    { '\xE3', '\x39', '\x3B', '\xD7', '\x8C', '\x4C', '\x11', '\xC3', '\x35', '\x09', '\x58', '\x0F', '\x39', '\x15', '\xFA', '\xE4' },
+    { '\x85', '\x44', '\x28', '\x30', '\x68', '\xFF', '\x2C', '\x42', '\x0B', '\x0B', '\x0B', '\x6E', '\xDA', '\xF6', '\xF7', '\xAB' }
+};
+
+int main()
+{
+    cout << "Diffie-Hellman test" << endl;
+
+    // Field arithmetic: (a * b) / b == a, in both representations
+    Bignum<16> a, b;
+    bool ok = true;
+    for(unsigned int i = 0; i < 100; i++) {
+        a.randomize();
+        b.randomize();
+        Bignum<16> c(a);
+        c *= b;
+        b.invert();
+        c *= b;
+        ok &= (c == a);
+
+        Bignum<16> m(a);
+        m.to_montgomery();
+        m.montgomery_square();
+        m.from_montgomery();
+        c = a;
+        c *= a;
+        ok &= (m == c);
+    }
+    cout << "Bignum\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    ok = true;
+    for(unsigned int i = 0; i < 2; i++) {
+        DH::Public_Key p(Bignum<16>(G_X, 16), Bignum<16>(G_Y, 16), Bignum<16>(1));
+        p *= Bignum<16>(K[i], 16);
+        ok &= (p.x == Bignum<16>(KG_X[i], 16)) && (p.y == Bignum<16>(KG_Y[i], 16));
+    }
+    cout << "Known answers\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    ok = true;
+    TSC::Time_Stamp ticks = 0;
+    for(unsigned int i = 0; i < PAIRS; i++) {
+        TSC::Time_Stamp t0 = TSC::time_stamp();
+        DH alice;
+        DH bob;
+        DH::Shared_Key k1 = alice.shared_key(bob.public_key());
+        DH::Shared_Key k2 = bob.shared_key(alice.public_key());
+        ticks += TSC::time_stamp() - t0;
+        ok &= (k1 == k2);
+    }
+    cout << "Shared keys\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Two key pairs and two shared keys make four scalar multiplications
+    ticks /= 4 * PAIRS;
+    cout << "Scalar multiplication\t=> " << ticks << " ticks";
+    if(TSC::frequency())
+        cout << ", " << static_cast<unsigned long long>(ticks) * 1000000 / TSC::frequency() << " us";
+    cout << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
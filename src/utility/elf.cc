@@ -6,7 +6,25 @@
 
 __BEGIN_UTIL
 
-long ELF::load_segment(unsigned int i, Elf_Addr addr)
+unsigned long ELF::mappable(Elf_Addr addr, unsigned long page_size, unsigned long * offset)
+{
+    for(unsigned int i = 0; i < segments(); i++) {
+        if((segment_type(i) != PT_LOAD) || ((seg(i)->p_vaddr & ~(page_size - 1)) != addr))
+            continue;
+
+        unsigned long head = seg(i)->p_vaddr % page_size;
+        if((seg(i)->p_offset % page_size) != head)
+            return 0;
+
+        *offset = seg(i)->p_offset - head;
+        return (head + seg(i)->p_filesz) & ~(page_size - 1);
+    }
+
+    return 0;
+}
+
+
+long ELF::load_segment(unsigned int i, Elf_Addr addr, unsigned long skip)
 {
     if((i > segments()) || (segment_type(i) != PT_LOAD))
         return 0;
@@ -14,14 +32,17 @@ long ELF::load_segment(unsigned int i, Elf_Addr addr)
     char * src = reinterpret_cast<char *>(CPU::Reg(this) + seg(i)->p_offset);
     char * dst = reinterpret_cast<char *>((addr) ? addr : segment_address(i));
 
-    memcpy(dst, src, seg(i)->p_filesz);
+    if(skip > seg(i)->p_filesz)
+        skip = seg(i)->p_filesz;
+
+    memcpy(dst + skip, src + skip, seg(i)->p_filesz - skip);
     memset(dst + seg(i)->p_filesz, 0, seg(i)->p_memsz - seg(i)->p_filesz);
 
     return seg(i)->p_memsz;
 }
 
 
-void ELF::load(Loadable * obj)
+void ELF::load(Loadable * obj, Elf_Addr mapped, unsigned long mapped_size)
 {
     for(unsigned int i = 0; i < segments(); i++) {
         if((segment_size(i) == 0) || (segment_type(i) != PT_LOAD))
@@ -29,9 +50,13 @@ void ELF::load(Loadable * obj)
 
         Elf_Addr addr = segment_address(i);
         if(((addr >= obj->code) && (addr <= (obj->code + obj->code_size))) || // CODE
-           ((addr >= obj->data) && (addr <= (obj->data + obj->data_size))))   // DATA
-            load_segment(i);
-        else
+           ((addr >= obj->data) && (addr <= (obj->data + obj->data_size)))) { // DATA
+            Elf_Addr mapped_top = mapped + mapped_size;
+            if((seg(i)->p_vaddr >= mapped) && (seg(i)->p_vaddr < mapped_top))
+                load_segment(i, 0, mapped_top - seg(i)->p_vaddr);
+            else
+                load_segment(i);
+        } else
             db<ELF>(WRN) << "Skipping unknown ELF segment " << i << " at " << hex << addr << "!"<< endl;
     }
 }
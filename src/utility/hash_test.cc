@@ -0,0 +1,65 @@
+// EPOS Hash Map Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/hash.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int SIZE = 1024;
+const unsigned int KEYS = SIZE * 7 / 8;
+
+template<typename H>
+void test(const char * name)
+{
+    typedef Hash_Map<unsigned long, unsigned int, SIZE, H> Map;
+    static Map map;
+
+    // Keys that look like aligned addresses, whose low bits are all zero
+    bool ok = true;
+    for(unsigned int i = 0; i < KEYS; i++)
+        ok &= map.insert(0x80000000UL + i * 64, i);
+    ok &= (map.size() == KEYS);
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    for(unsigned int i = 0; i < KEYS; i++) {
+        unsigned int * o = map.search_key(0x80000000UL + i * 64);
+        ok &= o && (*o == i);
+    }
+    TSC::Time_Stamp ticks = (TSC::time_stamp() - t0) / KEYS;
+
+    // Remove every other key (shifting clusters back) and check that the rest is still reachable
+    for(unsigned int i = 0; i < KEYS; i += 2)
+        ok &= map.remove_key(0x80000000UL + i * 64);
+    ok &= !map.remove_key(0x80000000UL) && !map.search_key(0x80000000UL);
+    for(unsigned int i = 1; i < KEYS; i += 2)
+        ok &= map.search_key(0x80000000UL + i * 64) != 0;
+
+    unsigned int n = 0;
+    for(typename Map::Iterator it = map.begin(); it != map.end(); it++, n++)
+        ok &= (it->object() & 1) && (it->key() == 0x80000000UL + it->object() * 64);
+    ok &= (n == map.size()) && (n == KEYS / 2);
+
+    map.clear();
+    ok &= map.empty() && (map.begin() == map.end());
+
+    cout << name << "\t=> " << (ok ? "passed!" : "failed!") << " (" << ticks << " ticks/search at 7/8 load)" << endl;
+}
+
+int main()
+{
+    cout << "Hash Map test" << endl;
+
+    test<Fx_Hash>("Fx_Hash");
+    test<Wy_Hash>("Wy_Hash");
+
+    const char text[] = "The quick brown fox jumps over the lazy dog";
+    bool ok = (Wy_Hash::hash(text, sizeof(text) - 1) != Wy_Hash::hash(text, sizeof(text) - 2));
+    cout << "Wy_Hash(bytes)\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
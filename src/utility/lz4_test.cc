@@ -0,0 +1,49 @@
+// EPOS LZ4 Compression Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/string.h>
+#include <utility/lz4.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int SIZE = 4096;
+
+// The input is this very program's code, which compresses about as well as the parts of a boot image
+unsigned char output[LZ4::bound(SIZE)];
+unsigned char buffer[SIZE + LZ4::margin(LZ4::bound(SIZE))];
+LZ4::Table table;
+
+int main()
+{
+    cout << "LZ4 test" << endl;
+
+    const unsigned char * input = reinterpret_cast<const unsigned char *>(&main);
+
+    unsigned long compressed = LZ4::compress(output, sizeof(output), input, SIZE, table);
+    bool ok = (compressed > 0) && (compressed < SIZE);
+    cout << "compress()\t=> " << (ok ? "passed!" : "failed!") << " (" << SIZE << " => " << compressed << " bytes)" << endl;
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    long size = LZ4::decompress(buffer, SIZE, output, compressed);
+    TSC::Time_Stamp ticks = TSC::time_stamp() - t0;
+    ok = (size == SIZE) && !memcmp(buffer, input, SIZE);
+    cout << "decompress()\t=> " << (ok ? "passed!" : "failed!") << " (" << ticks * 1000 / SIZE << " ticks/KB)" << endl;
+
+    // In place, with the input at the end of the output buffer, as SETUP does with compressed boot images
+    unsigned long margin = LZ4::margin(compressed);
+    memcpy(&buffer[SIZE + margin - compressed], output, compressed);
+    size = LZ4::decompress(buffer, SIZE, &buffer[SIZE + margin - compressed], compressed);
+    ok = (size == SIZE) && !memcmp(buffer, input, SIZE);
+    cout << "decompress() in place\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Truncated inputs and short output buffers must be refused without writing past the output buffer
+    ok = (LZ4::decompress(buffer, SIZE, output, compressed - 1) == -1) && (LZ4::decompress(buffer, SIZE / 2, output, compressed) == -1);
+    cout << "decompress() bounds\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
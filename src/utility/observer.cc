@@ -0,0 +1,66 @@
+// EPOS Observer Utility Implementation
+
+#include <architecture/cpu.h>
+#include <utility/observer.h>
+
+__BEGIN_UTIL
+
+// Class attributes
+Deferred_Notification * volatile Deferred_Notification::_posted;
+Handler * Deferred_Notification::_dispatcher;
+
+
+// Methods
+bool Deferred_Notification::post()
+{
+    db<Observers>(TRC) << "Deferred_Notification::post(this=" << this << ",posts=" << _posts << ")" << endl;
+
+    if(CPU::finc(_posts) != 0) // already posted and not yet dispatched
+        return false;
+
+    Deferred_Notification * head;
+    do {
+        head = _posted;
+        _next = head;
+    } while(CPU::cas(_posted, head, this) != head);
+
+    if(!head && _dispatcher)
+        (*_dispatcher)();
+
+    return true;
+}
+
+
+// Class methods
+void Deferred_Notification::dispatch()
+{
+    Deferred_Notification * list;
+    do
+        list = _posted;
+    while(list && (CPU::cas(_posted, list, static_cast<Deferred_Notification *>(0)) != list));
+
+    // The stack holds the most recent post first
+    Deferred_Notification * fifo = 0;
+    while(list) {
+        Deferred_Notification * next = list->_next;
+        list->_next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    while(fifo) {
+        // Once _posts is cleared the object may be posted (and relinked) again, so next must be read before
+        Deferred_Notification * next = fifo->_next;
+        unsigned long posts;
+        do
+            posts = fifo->_posts;
+        while(CPU::cas(fifo->_posts, posts, 0UL) != posts);
+
+        db<Observers>(INF) << "Deferred_Notification::dispatch(obj=" << fifo << ",posts=" << posts << ")" << endl;
+
+        fifo->deliver();
+        fifo = next;
+    }
+}
+
+__END_UTIL
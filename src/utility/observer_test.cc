@@ -0,0 +1,108 @@
+// EPOS Observer Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/string.h>
+#include <utility/observer.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+class Recorder: public Observer
+{
+public:
+    Recorder(char id, int priority = 0): Observer(priority), _id(id) {}
+
+    void update(Observed * o) {
+        _log[_length++] = _id;
+        _log[_length] = 0;
+    }
+
+    static const char * log() { return _log; }
+    static void reset() { _length = 0; _log[0] = 0; }
+
+private:
+    char _id;
+
+    static char _log[16];
+    static unsigned int _length;
+};
+
+char Recorder::_log[16];
+unsigned int Recorder::_length;
+
+class Sum: public Data_Observer<int>
+{
+public:
+    Sum(): _sum(0) {}
+
+    void update(Data_Observed<int> * o, int * d) { _sum += *d; }
+
+    int sum() const { return _sum; }
+
+private:
+    int _sum;
+};
+
+class Counter: public Handler
+{
+public:
+    Counter(): _count(0) {}
+
+    void operator()() { _count++; }
+
+    unsigned int count() const { return _count; }
+
+private:
+    unsigned int _count;
+};
+
+int main()
+{
+    cout << "Observer test" << endl;
+
+    // Priorities: lower values first, attachment order among equals
+    Observed observed;
+    Recorder a('a'), b('b', -1), c('c', 1), d('d');
+    observed.attach(&a);
+    observed.attach(&b);
+    observed.attach(&c);
+    observed.attach(&d);
+    observed.notify();
+    bool ok = !strcmp(Recorder::log(), "badc");
+    cout << "priorities\t=> " << (ok ? "passed!" : "failed!") << " (" << Recorder::log() << ")" << endl;
+
+    // Deferred notifications are coalesced and delivered in posting order, with a single wakeup of the dispatcher
+    Counter wakeups;
+    Deferred_Notification::dispatcher(&wakeups);
+
+    Observed other;
+    Recorder e('e');
+    other.attach(&e);
+
+    Recorder::reset();
+    ok = observed.post() && !observed.post() && other.post() && !observed.post();
+    ok &= (observed.pending() == 3) && (other.pending() == 1) && !strcmp(Recorder::log(), "");
+    Deferred_Notification::dispatch();
+    ok &= !strcmp(Recorder::log(), "badce") && (observed.pending() == 0) && (wakeups.count() == 1);
+    Deferred_Notification::dispatch();
+    ok &= !strcmp(Recorder::log(), "badce");
+    cout << "post()\t=> " << (ok ? "passed!" : "failed!") << " (" << Recorder::log() << ")" << endl;
+
+    // Coalesced data notifications deliver the last data posted
+    Data_Observed<int> data;
+    Sum sum;
+    data.attach(&sum);
+    int one = 1, two = 2;
+    data.post(&one);
+    data.post(&two);
+    Deferred_Notification::dispatch();
+    ok = (sum.sum() == 2) && (wakeups.count() == 2);
+    cout << "post(data)\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    Deferred_Notification::dispatcher(0);
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
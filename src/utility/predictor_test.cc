@@ -0,0 +1,105 @@
+// EPOS Predictor Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/predictor.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int SAMPLES = 1000;
+
+int times[SAMPLES];
+int int_values[SAMPLES];
+float float_values[SAMPLES];
+
+// A slow ramp with a step every 250 samples and some jitter, so models hold for long stretches but not forever
+void generate()
+{
+    for(unsigned int i = 0; i < SAMPLES; i++) {
+        times[i] = i * 10;
+        int_values[i] = 1000 + i / 4 + (i / 250) * 200 + ((i * 7) % 5) - 2;
+        float_values[i] = int_values[i];
+    }
+}
+
+// Feeds the samples one by one, recording which of them changed the model
+template<typename P, typename Value>
+unsigned int single(P & p, const Value * values, bool * sent)
+{
+    unsigned int updates = 0;
+    for(unsigned int i = 0; i < SAMPLES; i++) {
+        sent[i] = !p.trickle(times[i], values[i]);
+        updates += sent[i];
+    }
+    return updates;
+}
+
+// Same, in batches, resuming after each sample that changed the model
+template<typename P, typename Value>
+unsigned int batch(P & p, const Value * values, bool * sent)
+{
+    unsigned int updates = 0;
+    for(unsigned int i = 0; i < SAMPLES; i++)
+        sent[i] = false;
+    for(unsigned int i = 0; i < SAMPLES; ) {
+        i += p.trickle(&times[i], &values[i], SAMPLES - i);
+        if(i < SAMPLES) {
+            sent[i++] = true;
+            updates++;
+        }
+    }
+    return updates;
+}
+
+template<typename P, typename Value>
+void test(const char * name, P & a, P & b, const Value * values)
+{
+    bool sent_single[SAMPLES], sent_batch[SAMPLES];
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    unsigned int updates = single(a, values, sent_single);
+    TSC::Time_Stamp t1 = TSC::time_stamp();
+    batch(b, values, sent_batch);
+    TSC::Time_Stamp t2 = TSC::time_stamp();
+
+    bool ok = (updates > 0) && (updates < SAMPLES / 10);
+    for(unsigned int i = 0; i < SAMPLES; i++)
+        ok &= (sent_single[i] == sent_batch[i]);
+
+    Value predicted[SAMPLES];
+    b.predict_n(times, predicted, SAMPLES);
+    for(unsigned int i = 0; i < SAMPLES; i++)
+        ok &= (predicted[i] == a.predict(times[i]));
+
+    cout << name << "\t=> " << (ok ? "passed!" : "failed!") << " (" << updates << " updates, " << (t1 - t0) / SAMPLES << " ticks/sample single, " << (t2 - t1) / SAMPLES << " batch)" << endl;
+}
+
+int main()
+{
+    cout << "Predictor test" << endl;
+
+    generate();
+
+    LVP<int, int> lvp_int_a(5, 10, 0), lvp_int_b(5, 10, 0);
+    test("LVP<int, int>", lvp_int_a, lvp_int_b, int_values);
+
+    LVP<int, float> lvp_float_a(5, 10, 0), lvp_float_b(5, 10, 0);
+    test("LVP<int, float>", lvp_float_a, lvp_float_b, float_values);
+
+    DBP<int, int> dbp_int_a(10, 3, 0, 10, 1), dbp_int_b(10, 3, 0, 10, 1);
+    test("DBP<int, int>", dbp_int_a, dbp_int_b, int_values);
+
+    DBP<int, float> dbp_float_a(10, 3, 0, 10, 1), dbp_float_b(10, 3, 0, 10, 1);
+    test("DBP<int, float>", dbp_float_a, dbp_float_b, float_values);
+
+    // The fixed-point model follows the ramp (a quarter unit per 10 time units) without floating point
+    DBP<int, int>::Model model = dbp_int_a.model();
+    bool ok = (model.type() == Predictor_Common::DBP) && (model.a() > 0) && (model.a() < (1 << 16) / 10);
+    cout << "Fixed_Linear\t=> " << (ok ? "passed!" : "failed!") << " (a=" << model.a() << ")" << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
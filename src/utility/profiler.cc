@@ -0,0 +1,76 @@
+// EPOS PMU-based Profiler Utility Implementation
+
+#include <utility/profiler.h>
+
+__BEGIN_SYS
+extern OStream kout;
+__END_SYS
+
+__BEGIN_UTIL
+
+// Class attributes
+volatile bool Profiler::_on = true;
+PMU::Count Profiler::_last[enabled ? CPUS : 0][EVENTS];
+unsigned long Profiler::_lost[enabled ? CPUS : 0];
+Profiler::Bucket Profiler::_histogram[enabled ? CPUS : 0][SIZE];
+unsigned int Profiler::_retired_count;
+Profiler::Retired Profiler::_retired[enabled ? THREADS : 0];
+Profiler::Counters Profiler::_total;
+
+
+// Class methods
+void Profiler::retire(const void * thread, const Counters & counters)
+{
+    if(!enabled)
+        return;
+
+    for(unsigned int i = 0; i < EVENTS; i++)
+        _total.count[i] += counters.count[i];
+    _total.samples += counters.samples;
+
+    // Threads beyond THREADS still count for the totals
+    if(_retired_count < THREADS) {
+        _retired[_retired_count].thread = thread;
+        _retired[_retired_count].counters = counters;
+    }
+    _retired_count++;
+}
+
+void Profiler::dump()
+{
+    if(!enabled)
+        return;
+
+    stop();
+
+    kout << "<profile cpus=" << CPUS << " events=" << EVENTS << " threads=" << _retired_count << ">" << endl;
+
+    kout << "<events";
+    for(unsigned int i = 0; i < EVENTS; i++)
+        kout << " " << event(i);
+    kout << ">" << endl;
+
+    unsigned int retired = (_retired_count < THREADS) ? _retired_count : THREADS;
+    for(unsigned int t = 0; t < retired; t++) {
+        kout << "<thread " << _retired[t].thread << " samples=" << _retired[t].counters.samples;
+        for(unsigned int i = 0; i < EVENTS; i++)
+            kout << " " << _retired[t].counters.count[i];
+        kout << ">" << endl;
+    }
+
+    kout << "<total samples=" << _total.samples;
+    for(unsigned int i = 0; i < EVENTS; i++)
+        kout << " " << _total.count[i];
+    kout << ">" << endl;
+
+    for(unsigned int cpu = 0; cpu < CPUS; cpu++) {
+        kout << "<cpu " << cpu << " lost=" << _lost[cpu] << ">" << endl;
+        for(unsigned int i = 0; i < SIZE; i++)
+            if(_histogram[cpu][i].count)
+                kout << reinterpret_cast<void *>(_histogram[cpu][i].pc) << " " << _histogram[cpu][i].count << endl;
+    }
+
+    kout << "</profile>" << endl;
+}
+
+__END_UTIL
@@ -1,7 +1,45 @@
+// EPOS Pseudo Random Number Generator Utility Implementation
+
+#include <architecture/cpu.h>
 #include <utility/random.h>
 
 __BEGIN_UTIL
 
-int Random::_seed;
+// Class attributes
+unsigned long long Random::_seed;
+volatile unsigned long Random::_ticket;
+
+
+// Class methods
+unsigned long long Random::next()
+{
+    unsigned long ticket = CPU::finc(_ticket);
+    return Xoshiro256::mix(_seed + (ticket + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+unsigned int Random::uniform(unsigned int n)
+{
+    // Lemire's method, see Random_Engine::uniform()
+    unsigned long long r = (next() >> 32) * n;
+    if(static_cast<unsigned int>(r) < n) {
+        unsigned int threshold = (0U - n) % n;
+        while(static_cast<unsigned int>(r) < threshold)
+            r = (next() >> 32) * n;
+    }
+    return r >> 32;
+}
+
+void Random::fill(void * buffer, unsigned long size)
+{
+    unsigned char * p = reinterpret_cast<unsigned char *>(buffer);
+    for(; size >= sizeof(unsigned long long); size -= sizeof(unsigned long long), p += sizeof(unsigned long long)) {
+        unsigned long long v = next();
+        memcpy(p, &v, sizeof(v));
+    }
+    if(size) {
+        unsigned long long v = next();
+        memcpy(p, &v, size);
+    }
+}
 
 __END_UTIL
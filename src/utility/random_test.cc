@@ -0,0 +1,74 @@
+// EPOS Random Number Generators Utility Test Program
+
+#include <utility/ostream.h>
+#include <utility/random.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int ITERATIONS = 100000;
+const unsigned int BINS = 7;
+
+template<typename G>
+void bench(const char * name, G & g)
+{
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    for(unsigned int i = 0; i < ITERATIONS; i++)
+        g.next();
+    TSC::Time_Stamp ticks = TSC::time_stamp() - t0;
+    cout << name << "\t=> " << ticks / ITERATIONS << " ticks/number" << endl;
+}
+
+int main()
+{
+    cout << "Random test" << endl;
+
+    // First outputs of PCG32's reference implementation for seed 42 and stream 54
+    PCG32 pcg(42, 54);
+    const unsigned int reference[] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e };
+    bool ok = true;
+    for(unsigned int i = 0; i < sizeof(reference) / sizeof(reference[0]); i++)
+        ok &= (pcg.next() == reference[i]);
+    PCG32 skipped(42, 54);
+    skipped.advance(3);
+    ok &= (skipped.next() == reference[3]);
+    cout << "PCG32\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Streams split with jump() must not start on the same numbers
+    Xoshiro256 a(2024);
+    Xoshiro256 b(a);
+    b.jump();
+    ok = (a.next() != b.next());
+    Xoshiro256 c(2024);
+    c.next();
+    ok &= (a.next() == c.next());
+    cout << "Xoshiro256\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // uniform(): every bin within 5% of the expected count
+    unsigned int bins[BINS] = { 0 };
+    for(unsigned int i = 0; i < ITERATIONS; i++)
+        bins[Random::uniform(BINS)]++;
+    ok = true;
+    for(unsigned int i = 0; i < BINS; i++)
+        ok &= (bins[i] > ITERATIONS / BINS * 95 / 100) && (bins[i] < ITERATIONS / BINS * 105 / 100);
+    cout << "Random::uniform()\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    unsigned char buffer[37];
+    Random::fill(buffer, sizeof(buffer));
+    Random::Generator g = Random::generator();
+    g.fill(buffer, sizeof(buffer));
+
+    bench("Xoshiro256", g);
+    bench("PCG32", pcg);
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    for(unsigned int i = 0; i < ITERATIONS; i++)
+        Random::random();
+    cout << "Random::random()\t=> " << (TSC::time_stamp() - t0) / ITERATIONS << " ticks/number" << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
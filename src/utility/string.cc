@@ -3,12 +3,30 @@
 #include <system/config.h>
 #include <utility/string.h>
 
+// Word-wide helpers for the memory functions: Word may alias anything, so copies through it are safe under strict
+// aliasing. Blocks are 8 words (64 bytes on 64-bit architectures) to let the compiler keep a whole block in registers.
+typedef unsigned long __attribute__((may_alias)) Word;
+static const size_t WORD = sizeof(Word);
+static const size_t BLOCK = 8 * WORD;
+
+// Merges two consecutive aligned words into the unaligned word starting shift bits into lo
+static inline Word merge(Word lo, Word hi, unsigned int shift)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return (lo >> shift) | (hi << (WORD * 8 - shift));
+#else
+    return (lo << shift) | (hi >> (WORD * 8 - shift));
+#endif
+}
+
 extern "C"
 {
 
     int memcmp(const void * m1, const void * m2, size_t n) __attribute__ ((weak));
     void * memcpy(void * d, const void * s, size_t n) __attribute__ ((weak));
+    void * memmove(void * d, const void * s, size_t n) __attribute__ ((weak));
     void * memset(void * m, int c, size_t n) __attribute__ ((weak));
+    void * memzero(void * m, size_t n) __attribute__ ((weak));
     void * memchr(const void * m, int c, size_t n) __attribute__ ((weak));
     int strcmp(const char * s1, const char * s2) __attribute__ ((weak));
     int strncmp(const char * s1, const char * s2, size_t n) __attribute__ ((weak));
@@ -57,41 +75,114 @@ extern "C"
 
     }
 
-    void * memcpy(void * dst0, const void * src0, size_t len0)
+    void * memcpy(void * dst0, const void * src0, size_t len)
     {
-        char *dst = reinterpret_cast<char *> (dst0);
-        const char *src = reinterpret_cast<const char *> (src0);
-        long *aligned_dst;
-        const long *aligned_src;
-        size_t len = len0;
+        unsigned char * dst = reinterpret_cast<unsigned char *>(dst0);
+        const unsigned char * src = reinterpret_cast<const unsigned char *>(src0);
 
-        if(!((len) < (sizeof(long) << 2)) && !(((long) src & (sizeof(long) - 1))
-            | ((long) dst & (sizeof(long) - 1)))) {
-            aligned_dst = (long*) dst;
-            aligned_src = (long*) src;
-
-            while(len >= (sizeof(long) << 2)) {
-                *aligned_dst++ = *aligned_src++;
-                *aligned_dst++ = *aligned_src++;
-                *aligned_dst++ = *aligned_src++;
-                *aligned_dst++ = *aligned_src++;
-                len -= (sizeof(long) << 2);
+        if(len >= 2 * WORD) {
+            while(reinterpret_cast<unsigned long>(dst) & (WORD - 1)) {
+                *dst++ = *src++;
+                len--;
             }
 
-            while(len >= (sizeof(long))) {
-                *aligned_dst++ = *aligned_src++;
-                len -= (sizeof(long));
+            Word * d = reinterpret_cast<Word *>(dst);
+            unsigned int offset = reinterpret_cast<unsigned long>(src) & (WORD - 1);
+
+            if(!offset) {
+                const Word * s = reinterpret_cast<const Word *>(src);
+                for(; len >= BLOCK; len -= BLOCK, d += 8, s += 8) {
+                    d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3];
+                    d[4] = s[4]; d[5] = s[5]; d[6] = s[6]; d[7] = s[7];
+                }
+                for(; len >= WORD; len -= WORD)
+                    *d++ = *s++;
+                src = reinterpret_cast<const unsigned char *>(s);
+            } else {
+                // Each aligned source word is loaded once and merged with its neighbor; loads never cross the
+                // aligned word holding the last byte to be copied, so they cannot fault
+                unsigned int shift = offset * 8;
+                const Word * s = reinterpret_cast<const Word *>(src - offset);
+                Word w0 = *s++;
+                Word w1;
+                for(; len >= BLOCK; len -= BLOCK, d += 8, s += 8) {
+                    w1 = s[0]; d[0] = merge(w0, w1, shift);
+                    w0 = s[1]; d[1] = merge(w1, w0, shift);
+                    w1 = s[2]; d[2] = merge(w0, w1, shift);
+                    w0 = s[3]; d[3] = merge(w1, w0, shift);
+                    w1 = s[4]; d[4] = merge(w0, w1, shift);
+                    w0 = s[5]; d[5] = merge(w1, w0, shift);
+                    w1 = s[6]; d[6] = merge(w0, w1, shift);
+                    w0 = s[7]; d[7] = merge(w1, w0, shift);
+                }
+                for(; len >= WORD; len -= WORD) {
+                    w1 = *s++;
+                    *d++ = merge(w0, w1, shift);
+                    w0 = w1;
+                }
+                src = reinterpret_cast<const unsigned char *>(s) - WORD + offset;
             }
 
-            dst = (char*) aligned_dst;
-            src = (char*) aligned_src;
+            dst = reinterpret_cast<unsigned char *>(d);
         }
 
         while(len--)
             *dst++ = *src++;
 
         return dst0;
+    }
+
+    void * memmove(void * dst0, const void * src0, size_t len)
+    {
+        unsigned char * dst = reinterpret_cast<unsigned char *>(dst0);
+        const unsigned char * src = reinterpret_cast<const unsigned char *>(src0);
+
+        // memcpy() copies forward, reading each word before writing over it, so it is only unsafe if dst is ahead of src
+        if((dst <= src) || (dst >= src + len))
+            return memcpy(dst0, src0, len);
+
+        dst += len;
+        src += len;
+
+        if(len >= 2 * WORD) {
+            while(reinterpret_cast<unsigned long>(dst) & (WORD - 1)) {
+                *--dst = *--src;
+                len--;
+            }
 
+            Word * d = reinterpret_cast<Word *>(dst);
+            unsigned int offset = reinterpret_cast<unsigned long>(src) & (WORD - 1);
+
+            if(!offset) {
+                const Word * s = reinterpret_cast<const Word *>(src);
+                for(; len >= BLOCK; len -= BLOCK) {
+                    d -= 8; s -= 8;
+                    d[7] = s[7]; d[6] = s[6]; d[5] = s[5]; d[4] = s[4];
+                    d[3] = s[3]; d[2] = s[2]; d[1] = s[1]; d[0] = s[0];
+                }
+                for(; len >= WORD; len -= WORD)
+                    *--d = *--s;
+                src = reinterpret_cast<const unsigned char *>(s);
+            } else {
+                unsigned int shift = offset * 8;
+                const Word * s = reinterpret_cast<const Word *>(src - offset);
+                Word hi = *s;
+                Word lo;
+                for(; len >= WORD; len -= WORD) {
+                    lo = *--s;
+                    *--d = merge(lo, hi, shift);
+                    hi = lo;
+                }
+                src = reinterpret_cast<const unsigned char *>(s) + offset;
+            }
+
+            dst = reinterpret_cast<unsigned char *>(d);
+        }
+
+        while(len--)
+            *--dst = *--src;
+
+        return dst0;
     }
 
     void * memchr(const void * src_void, int c, size_t length)
@@ -139,47 +230,60 @@ extern "C"
 
     void * memset(void * m, int c, size_t n)
     {
-        char *s = (char *) m;
+        unsigned char * s = reinterpret_cast<unsigned char *>(m);
 
-        size_t i;
-        unsigned long buffer;
-        unsigned long *aligned_addr;
-        unsigned int d = c & 0xff;
+        if(n >= 2 * WORD) {
+            while(reinterpret_cast<unsigned long>(s) & (WORD - 1)) {
+                *s++ = c;
+                n--;
+            }
+
+            Word pattern = static_cast<unsigned char>(c);
+            pattern |= pattern << 8;
+            pattern |= pattern << 16;
+            for(unsigned int i = 32; i < WORD * 8; i <<= 1)
+                pattern |= pattern << i;
 
-        while(((long) s & ((sizeof(long)) - 1))) {
-            if(n--)
-                *s++ = (char) c;
-            else
-                return m;
+            Word * d = reinterpret_cast<Word *>(s);
+            for(; n >= BLOCK; n -= BLOCK, d += 8) {
+                d[0] = pattern; d[1] = pattern; d[2] = pattern; d[3] = pattern;
+                d[4] = pattern; d[5] = pattern; d[6] = pattern; d[7] = pattern;
+            }
+            for(; n >= WORD; n -= WORD)
+                *d++ = pattern;
+
+            s = reinterpret_cast<unsigned char *>(d);
         }
 
-        if(!((n) < (sizeof(long)))) {
+        while(n--)
+            *s++ = c;
 
-            aligned_addr = (unsigned long *) s;
+        return m;
+    }
 
-            buffer = (d << 8) | d;
-            buffer |= (buffer << 16);
-            for(i = 32; i < (sizeof(long)) * 8; i <<= 1)
-                buffer = (buffer << i) | buffer;
-
-            while(n >= (sizeof(long)) * 4) {
-                *aligned_addr++ = buffer;
-                *aligned_addr++ = buffer;
-                *aligned_addr++ = buffer;
-                *aligned_addr++ = buffer;
-                n -= 4 * (sizeof(long));
+    void * memzero(void * m, size_t n)
+    {
+        unsigned char * s = reinterpret_cast<unsigned char *>(m);
+
+        if(n >= 2 * WORD) {
+            while(reinterpret_cast<unsigned long>(s) & (WORD - 1)) {
+                *s++ = 0;
+                n--;
             }
 
-            while(n >= (sizeof(long))) {
-                *aligned_addr++ = buffer;
-                n -= (sizeof(long));
+            Word * d = reinterpret_cast<Word *>(s);
+            for(; n >= BLOCK; n -= BLOCK, d += 8) {
+                d[0] = 0; d[1] = 0; d[2] = 0; d[3] = 0;
+                d[4] = 0; d[5] = 0; d[6] = 0; d[7] = 0;
             }
+            for(; n >= WORD; n -= WORD)
+                *d++ = 0;
 
-            s = (char*) aligned_addr;
+            s = reinterpret_cast<unsigned char *>(d);
         }
 
         while(n--)
-            *s++ = (char) c;
+            *s++ = 0;
 
         return m;
     }
@@ -0,0 +1,121 @@
+// EPOS Memory Functions Test and Micro-benchmark Program
+
+#include <utility/ostream.h>
+#include <utility/string.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int MAX_SIZE = 1024 * 1024;
+const unsigned int SLACK = 64;
+
+unsigned char src[MAX_SIZE + SLACK] __attribute__ ((aligned (64)));
+unsigned char dst[MAX_SIZE + SLACK] __attribute__ ((aligned (64)));
+
+bool check(unsigned int n, unsigned int so, unsigned int doff)
+{
+    for(unsigned int i = 0; i < n; i++)
+        src[so + i] = i * 7 + so;
+    memset(dst, 0xa5, n + 2 * SLACK);
+
+    memcpy(dst + doff, src + so, n);
+
+    for(unsigned int i = 0; i < n; i++)
+        if(dst[doff + i] != static_cast<unsigned char>(i * 7 + so))
+            return false;
+    return (doff == 0 || dst[doff - 1] == 0xa5) && dst[doff + n] == 0xa5;
+}
+
+bool check_overlap(unsigned int n, int delta)
+{
+    for(unsigned int i = 0; i < n; i++)
+        src[SLACK / 2 + i] = i;
+
+    memmove(src + SLACK / 2 + delta, src + SLACK / 2, n);
+
+    for(unsigned int i = 0; i < n; i++)
+        if(src[SLACK / 2 + delta + i] != static_cast<unsigned char>(i))
+            return false;
+    return true;
+}
+
+// memset(), or memzero() if c is 0
+bool check_set(unsigned int n, unsigned int doff, unsigned char c)
+{
+    memset(dst, 0xa5, n + 2 * SLACK);
+
+    if(c)
+        memset(dst + doff, c, n);
+    else
+        memzero(dst + doff, n);
+
+    for(unsigned int i = 0; i < n; i++)
+        if(dst[doff + i] != c)
+            return false;
+    return (doff == 0 || dst[doff - 1] == 0xa5) && dst[doff + n] == 0xa5;
+}
+
+template<typename F>
+void bench(const char * name, unsigned int n, unsigned int offset, F f)
+{
+    unsigned int iterations = (MAX_SIZE / n > 1000) ? 1000 : (MAX_SIZE / n < 10) ? 10 : MAX_SIZE / n;
+
+    TSC::Time_Stamp t0 = TSC::time_stamp();
+    for(unsigned int i = 0; i < iterations; i++)
+        f(n, offset);
+    TSC::Time_Stamp ticks = (TSC::time_stamp() - t0) / iterations;
+
+    cout << name << "(n=" << n << ",off=" << offset << ")\t=> " << ticks << " ticks/call";
+    if(ticks)
+        cout << ", " << static_cast<unsigned long long>(n) * TSC::frequency() / ticks / 1024 << " KiB/s";
+    cout << endl;
+}
+
+int main()
+{
+    cout << "Memory functions test" << endl;
+
+    bool ok = true;
+    for(unsigned int n = 0; n < 300; n++)
+        for(unsigned int so = 0; so < 8; so++)
+            for(unsigned int doff = 0; doff < 8; doff++)
+                ok &= check(n, so, doff);
+    cout << "memcpy\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    ok = true;
+    for(unsigned int n = 0; n < 300; n++)
+        for(int delta = -9; delta <= 9; delta++)
+            ok &= check_overlap(n, delta);
+    cout << "memmove\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    ok = true;
+    for(unsigned int n = 0; n < 300; n++)
+        for(unsigned int doff = 0; doff < 8; doff++)
+            ok &= check_set(n, doff, 0x5a);
+    cout << "memset\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    ok = true;
+    for(unsigned int n = 0; n < 300; n++)
+        for(unsigned int doff = 0; doff < 8; doff++)
+            ok &= check_set(n, doff, 0);
+    ok &= check_set(4096, 0, 0) && check_set(4096 + 13, 5, 0);
+    cout << "memzero\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    cout << "TSC frequency: " << static_cast<unsigned long long>(TSC::frequency()) << " Hz" << endl;
+
+    for(unsigned int n = 1; n <= MAX_SIZE; n <<= 2) {
+        bench("memcpy", n, 0, [](unsigned int n, unsigned int o) { memcpy(dst, src, n); });
+        bench("memcpy", n, 3, [](unsigned int n, unsigned int o) { memcpy(dst, src + o, n); });
+        bench("memmove", n, 3, [](unsigned int n, unsigned int o) { memmove(src + o, src, n); });
+        bench("memset", n, 0, [](unsigned int n, unsigned int o) { memset(dst, 0x5a, n); });
+    }
+
+    for(unsigned int n = 4096; n <= MAX_SIZE; n <<= 4)
+        bench("memzero", n, 0, [](unsigned int n, unsigned int o) { memzero(dst, n); });
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
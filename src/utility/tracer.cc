@@ -0,0 +1,51 @@
+// EPOS Binary Event Tracer Utility Implementation
+
+#include <utility/tracer.h>
+
+__BEGIN_SYS
+extern OStream kout;
+__END_SYS
+
+__BEGIN_UTIL
+
+// Class attributes
+volatile bool Tracer::_on = true;
+unsigned int Tracer::_count[enabled ? CPUS : 0];
+Tracer::Record Tracer::_ring[enabled ? CPUS : 0][SIZE];
+
+
+// Class methods
+void Tracer::dump()
+{
+    if(!enabled)
+        return;
+
+    stop();
+
+    static const char digits[] = "0123456789abcdef";
+
+    kout << "<trace cpus=" << CPUS << " size=" << SIZE << " hz=" << static_cast<unsigned long long>(TSC::frequency()) << ">" << endl;
+
+    for(unsigned int cpu = 0; cpu < CPUS; cpu++) {
+        unsigned int count = _count[cpu];
+        unsigned int first = (count > SIZE) ? count - SIZE : 0;
+
+        kout << "<cpu " << cpu << " records=" << count - first << " lost=" << first << ">" << endl;
+
+        for(unsigned int i = first; i < count; i++) {
+            // Each record goes out as a line with its bytes in memory order
+            const unsigned char * b = reinterpret_cast<const unsigned char *>(&_ring[cpu][i & MASK]);
+            char line[2 * sizeof(Record) + 1];
+            for(unsigned int j = 0; j < sizeof(Record); j++) {
+                line[2 * j] = digits[b[j] >> 4];
+                line[2 * j + 1] = digits[b[j] & 0xf];
+            }
+            line[2 * sizeof(Record)] = '\0';
+            kout << line << endl;
+        }
+    }
+
+    kout << "</trace>" << endl;
+}
+
+__END_UTIL
@@ -0,0 +1,188 @@
+// EPOS Block Device Test Program
+// Run with a scratch raw image of at least 1 MB attached (e.g. "make DISK=disk.img APPLICATION=block_test run"),
+// since the test overwrites its first sectors
+
+#include <machine.h>
+#include <process.h>
+#include <synchronizer.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int SECTOR = Block::SECTOR_SIZE;
+const unsigned int SECTORS = 384; // 192 KB, so the transfer gets split into several requests
+const unsigned int WORKERS = 3;
+const unsigned int ROUNDS = 8;
+const unsigned int WORKER_SECTORS = 16;
+const unsigned int REQUESTS = 12;
+const unsigned int REQUEST_SECTORS = 8;
+const unsigned int FIRST_REQUEST_SECTOR = 1 + SECTORS + WORKERS * WORKER_SECTORS;
+const unsigned int MIN_SECTORS = FIRST_REQUEST_SECTOR + REQUESTS * REQUEST_SECTORS;
+
+Block * disk;
+unsigned char buffer[SECTORS * SECTOR];
+
+void fill(unsigned char * p, unsigned int size, unsigned int seed)
+{
+    for(unsigned int i = 0; i < size; i++)
+        p[i] = (i * 7 + seed * 13 + (i >> 9)) & 0xff;
+}
+
+bool check(const unsigned char * p, unsigned int size, unsigned int seed)
+{
+    for(unsigned int i = 0; i < size; i++)
+        if(p[i] != ((i * 7 + seed * 13 + (i >> 9)) & 0xff))
+            return false;
+    return true;
+}
+
+bool single()
+{
+    fill(buffer, sizeof(buffer), 1);
+    if(disk->write(0, buffer, 1) != 1)
+        return false;
+    memset(buffer, 0, sizeof(buffer));
+    return (disk->read(0, buffer, 1) == 1) && check(buffer, SECTOR, 1);
+}
+
+bool large()
+{
+    fill(buffer, sizeof(buffer), 2);
+    if(disk->write(1, buffer, SECTORS) != int(SECTORS))
+        return false;
+    if(disk->flush() != 0)
+        return false;
+    memset(buffer, 0, sizeof(buffer));
+    return (disk->read(1, buffer, SECTORS) == int(SECTORS)) && check(buffer, sizeof(buffer), 2);
+}
+
+bool bounds()
+{
+    // Transfers past the end of the device must fail without touching it
+    return (disk->read(disk->sectors(), buffer, 1) < 0) && (disk->read(disk->sectors() - 1, buffer, 2) < 0);
+}
+
+// Each worker has a region of its own, so their requests are in flight at the same time
+int worker(unsigned int id)
+{
+    static unsigned char data[WORKERS][WORKER_SECTORS * SECTOR];
+    Block::Sector base = 1 + SECTORS + id * WORKER_SECTORS;
+
+    for(unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int seed = id * ROUNDS + r;
+        fill(data[id], sizeof(data[id]), seed);
+        if(disk->write(base, data[id], WORKER_SECTORS) != int(WORKER_SECTORS))
+            return 1;
+        memset(data[id], 0, sizeof(data[id]));
+        if(disk->read(base, data[id], WORKER_SECTORS) != int(WORKER_SECTORS))
+            return 1;
+        if(!check(data[id], sizeof(data[id]), seed))
+            return 1;
+    }
+
+    return 0;
+}
+
+bool concurrent()
+{
+    Thread * workers[WORKERS];
+    for(unsigned int i = 0; i < WORKERS; i++)
+        workers[i] = new Thread(&worker, i);
+
+    int errors = 0;
+    for(unsigned int i = 0; i < WORKERS; i++) {
+        errors += workers[i]->join();
+        delete workers[i];
+    }
+
+    return !errors;
+}
+
+// Waits until the first n requests are finished (they point at the caller's semaphore) and then releases them
+void drain(Semaphore * finished, IO_Request * requests[], unsigned int n)
+{
+    for(unsigned int i = 0; i < n; i++)
+        finished->p();
+    for(unsigned int i = 0; i < n; i++)
+        delete requests[i];
+}
+
+// A single thread keeps REQUESTS requests in flight and sleeps until all of them are finished
+bool asynchronous()
+{
+    static unsigned char data[REQUESTS][REQUEST_SECTORS * SECTOR];
+
+    Semaphore finished(0);
+    Semaphore_Handler handler(&finished);
+    IO_Request * requests[REQUESTS];
+
+    for(unsigned int i = 0; i < REQUESTS; i++) {
+        fill(data[i], sizeof(data[i]), 100 + i);
+        requests[i] = new IO_Request(IO_Request::WRITE, data[i], sizeof(data[i]), &handler, FIRST_REQUEST_SECTOR + i * REQUEST_SECTORS);
+        if(!disk->submit(requests[i])) {
+            delete requests[i];
+            drain(&finished, requests, i);
+            return false;
+        }
+    }
+    IO_Request flush(IO_Request::FLUSH, 0, 0, &handler);
+    bool ok = disk->submit(&flush);
+    if(ok)
+        finished.p();
+    for(unsigned int i = 0; i < REQUESTS; i++)
+        finished.p();
+
+    ok &= (flush.status() == IO_Request::DONE);
+    for(unsigned int i = 0; i < REQUESTS; i++) {
+        ok &= (requests[i]->status() == IO_Request::DONE) && (requests[i]->count() == sizeof(data[i]));
+        delete requests[i];
+    }
+
+    for(unsigned int i = 0; i < REQUESTS; i++) {
+        memset(data[i], 0, sizeof(data[i]));
+        requests[i] = new IO_Request(IO_Request::READ, data[i], sizeof(data[i]), &handler, FIRST_REQUEST_SECTOR + i * REQUEST_SECTORS);
+        if(!disk->submit(requests[i])) {
+            delete requests[i];
+            drain(&finished, requests, i);
+            return false;
+        }
+    }
+    for(unsigned int i = 0; i < REQUESTS; i++)
+        finished.p();
+
+    for(unsigned int i = 0; i < REQUESTS; i++) {
+        ok &= (requests[i]->status() == IO_Request::DONE) && check(data[i], sizeof(data[i]), 100 + i);
+        delete requests[i];
+    }
+
+    return ok;
+}
+
+int main()
+{
+    cout << "Block device test" << endl;
+
+    disk = VirtIO_Block::get();
+    if(!disk) {
+        cout << "No block device (was DISK given?)" << endl;
+        return -1;
+    }
+    cout << "Device: " << disk->sectors() << " sectors (" << disk->sectors() * SECTOR / 1024 << " KB)" << (disk->read_only() ? ", read-only" : "") << endl;
+    if(disk->read_only() || (disk->sectors() < MIN_SECTORS)) {
+        cout << "The device must be writable and at least " << MIN_SECTORS * SECTOR / 1024 << " KB large!" << endl;
+        return -1;
+    }
+
+    cout << "write()/read() one sector\t=> " << (single() ? "passed!" : "failed!") << endl;
+    cout << "write()/flush()/read() " << SECTORS << " sectors\t=> " << (large() ? "passed!" : "failed!") << endl;
+    cout << "out-of-range transfers\t=> " << (bounds() ? "passed!" : "failed!") << endl;
+    cout << WORKERS << " threads at once\t=> " << (concurrent() ? "passed!" : "failed!") << endl;
+    cout << REQUESTS << " requests from one thread\t=> " << (asynchronous() ? "passed!" : "failed!") << endl;
+
+    cout << "Statistics: " << disk->statistics() << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
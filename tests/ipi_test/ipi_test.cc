@@ -0,0 +1,97 @@
+// EPOS IPI Test Program
+// EPOS brings up a single hart, so messages here go from the boot hart to its own mailbox, through the same CLINT
+// software interrupt other harts would raise
+
+#include <machine/ic.h>
+#include <process.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int RESCHEDULES = 10;
+const unsigned int RANGES = 16; // apart from each other and more than a mailbox holds, so the batch becomes a full flush
+
+volatile bool called;
+volatile bool called_disabled;
+volatile unsigned int switches;
+volatile bool stop;
+
+void function(void * argument)
+{
+    called = (argument == &called);
+    called_disabled = CPU::int_disabled();
+}
+
+// Gives the CPU back as soon as it gets it, counting how many times it did
+int yielder()
+{
+    while(!stop) {
+        switches++;
+        Thread::yield();
+    }
+    return 0;
+}
+
+int main()
+{
+    cout << "IPI test" << endl;
+
+    unsigned int self = CPU::id();
+    unsigned int other = self + 1;
+
+    bool ok = IPI::online(self) && !IPI::online(other);
+    cout << "Online harts\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Calls run with interrupts disabled and return once done, while harts not running EPOS are refused
+    ok = IPI::call(self, &function, const_cast<bool *>(&called));
+    ok &= called && called_disabled && !CPU::int_disabled();
+    called = false;
+    ok &= !IPI::call(other, &function, const_cast<bool *>(&called)) && !called;
+    cout << "Calls\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Each reschedule raises this hart's software interrupt, whose handler has the scheduler choose again, and the
+    // yielder gets to run (once) before we do
+    Thread * thread = new Thread(&yielder);
+    ok = true;
+    for(unsigned int i = 0; i < RESCHEDULES; i++) {
+        unsigned int before = switches;
+        IPI::reschedule(self);
+        ok &= (switches > before);
+    }
+    stop = true;
+    thread->join();
+    delete thread;
+    cout << "Reschedules\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Shootdowns flush this hart's TLB at once, page by page or as a whole
+    static char pages[2 * RANGES * 4096];
+    IPI::Statistics before = IPI::statistics(self);
+    IPI::shootdown(pages, RANGES * 4096);
+    IPI::shootdown();
+    IPI::Statistics after = IPI::statistics(self);
+    ok = (after.broadcasts == before.broadcasts + 2) && (after.full_flushes == before.full_flushes + 1);
+    ok &= (after.page_flushes == before.page_flushes + RANGES);
+    cout << "Shootdowns\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Or at the end of the outermost batch, which keeps interrupts disabled, in a single broadcast; ranges that don't
+    // touch take a slot each, so these overflow the batch into a single full flush
+    before = IPI::statistics(self);
+    IPI::begin_batch();
+    ok = CPU::int_disabled();
+    IPI::begin_batch();
+    for(unsigned int i = 0; i < RANGES; i++)
+        IPI::shootdown(&pages[2 * i * 4096], 4096);
+    IPI::end_batch();
+    ok &= CPU::int_disabled() && (IPI::statistics(self).broadcasts == before.broadcasts);
+    IPI::end_batch();
+    ok &= !CPU::int_disabled();
+    after = IPI::statistics(self);
+    ok &= (after.broadcasts == before.broadcasts + 1) && (after.full_flushes == before.full_flushes + 1);
+    ok &= (after.page_flushes == before.page_flushes);
+    cout << "Batched shootdowns\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    cout << "I'm done, bye!" << endl;
+
+    return 0;
+}
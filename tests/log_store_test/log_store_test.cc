@@ -0,0 +1,251 @@
+// EPOS Log-structured Key-Value Store Test Program
+// Run with a raw image of at least 768 KB attached (e.g. "make DISK=flash.img APPLICATION=log_store_test run"); running
+// it again on the same image checks that what the previous run left in its first 512 KB is recovered
+
+#include <machine.h>
+#include <process.h>
+#include <storage.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int SEGMENTS = 16;
+const unsigned int REGION = SEGMENTS * Traits<Log_Store>::SEGMENT_SECTORS; // 512 KB
+const unsigned int KEYS = 64;
+const unsigned int ROUNDS = 24; // enough to overwrite the region a couple of times, so compaction must run
+const unsigned int WRITERS = 4;
+const unsigned int WRITES = 16;
+const unsigned int TORN_SEGMENTS = 8; // a region of their own, right after the first one, erased on every run
+const unsigned int TORN_REGION = TORN_SEGMENTS * Traits<Log_Store>::SEGMENT_SECTORS; // 256 KB
+const unsigned int TORN_SIZE = 900; // so the batch spans two sectors and the mark is in the second one
+const char MARK[] = "torn batch mark";
+
+Block * disk;
+Log_Store * store;
+unsigned char value[1024];
+unsigned char result[1024];
+
+void key(char * k, const char * prefix, unsigned int i)
+{
+    strcpy(k, prefix);
+    utoa(i, k + strlen(k));
+}
+
+unsigned int size(unsigned int i) { return 100 + (i * 37) % 900; }
+
+void fill(unsigned char * p, unsigned int size, unsigned int seed)
+{
+    for(unsigned int i = 0; i < size; i++)
+        p[i] = (i * 7 + seed * 13 + (i >> 8)) & 0xff;
+}
+
+bool check(unsigned int i, unsigned int seed)
+{
+    char k[16];
+    key(k, "key-", i);
+    memset(result, 0, sizeof(result));
+    fill(value, size(i), seed);
+    return (store->get(k, result, sizeof(result)) == int(size(i))) && !memcmp(result, value, size(i));
+}
+
+// What every run leaves behind: the last round of values, with every fourth key removed
+bool final_state()
+{
+    char k[16];
+    for(unsigned int i = 0; i < KEYS; i++) {
+        key(k, "key-", i);
+        if((i % 4) ? !check(i, i * ROUNDS + ROUNDS - 1) : (store->get(k, result, sizeof(result)) >= 0))
+            return false;
+    }
+    return true;
+}
+
+bool basic()
+{
+    const char * v1 = "first";
+    const char * v2 = "second value";
+    char buf[32];
+
+    bool ok = store->put("basic", v1, strlen(v1)) && (store->get("basic", buf, sizeof(buf)) == int(strlen(v1))) && !memcmp(buf, v1, strlen(v1));
+    ok &= store->put("basic", v2, strlen(v2)) && (store->get("basic", buf, sizeof(buf)) == int(strlen(v2))) && !memcmp(buf, v2, strlen(v2));
+    ok &= store->remove("basic") && (store->get("basic", buf, sizeof(buf)) < 0) && !store->remove("basic");
+    ok &= !store->put("a key far too long to fit in the index of the store", v1, strlen(v1));
+
+    return ok;
+}
+
+// Each round overwrites every key, so most of what is written soon becomes garbage
+bool overwrite()
+{
+    char k[16];
+    for(unsigned int r = 0; r < ROUNDS; r++)
+        for(unsigned int i = 0; i < KEYS; i++) {
+            key(k, "key-", i);
+            fill(value, size(i), i * ROUNDS + r);
+            if(!store->put(k, value, size(i)))
+                return false;
+        }
+
+    for(unsigned int i = 0; i < KEYS; i++)
+        if(!check(i, i * ROUNDS + ROUNDS - 1))
+            return false;
+
+    for(unsigned int i = 0; i < KEYS; i += 4) {
+        key(k, "key-", i);
+        if(!store->remove(k))
+            return false;
+    }
+
+    return final_state();
+}
+
+int writer(unsigned int id)
+{
+    char k[16];
+    unsigned int v[4];
+    for(unsigned int n = 0; n < WRITES; n++) {
+        key(k, "w", id * WRITES + n);
+        v[0] = id; v[1] = n; v[2] = ~id; v[3] = ~n;
+        if(!store->put(k, v, sizeof(v)))
+            return 1;
+    }
+    return 0;
+}
+
+// Writers blocked while a batch goes to the device get their records committed together in the next one
+bool concurrent()
+{
+    unsigned int puts = store->statistics().puts;
+    unsigned int commits = store->statistics().commits;
+
+    Thread * writers[WRITERS];
+    for(unsigned int i = 0; i < WRITERS; i++)
+        writers[i] = new Thread(&writer, i);
+
+    int errors = 0;
+    for(unsigned int i = 0; i < WRITERS; i++) {
+        errors += writers[i]->join();
+        delete writers[i];
+    }
+
+    puts = store->statistics().puts - puts;
+    commits = store->statistics().commits - commits;
+    cout << "  " << puts << " puts in " << commits << " commits" << endl;
+
+    char k[16];
+    unsigned int v[4];
+    for(unsigned int id = 0; id < WRITERS; id++)
+        for(unsigned int n = 0; n < WRITES; n++) {
+            key(k, "w", id * WRITES + n);
+            if((store->get(k, v, sizeof(v)) != sizeof(v)) || (v[0] != id) || (v[1] != n) || (v[2] != ~id) || (v[3] != ~n))
+                errors++;
+        }
+
+    return !errors && (commits < puts);
+}
+
+// A new store on the same region must find everything the old one committed
+bool recovery()
+{
+    unsigned int keys = store->size();
+    delete store;
+    store = new Log_Store(disk, 0, REGION);
+    cout << "  " << store->size() << " keys recovered, " << store->free_segments() << "/" << store->segments() << " segments free" << endl;
+    return !store->broken() && (store->size() == keys) && final_state();
+}
+
+// A crash while a batch is being written leaves it torn: its first sector (and header) reaches the device, but not
+// all of its records do. Recovery must stop there, keeping every batch before it and dropping the torn one's records
+bool torn()
+{
+    static unsigned char segment[Traits<Log_Store>::SEGMENT_SECTORS * Block::SECTOR_SIZE];
+    const unsigned int SECTOR = Block::SECTOR_SIZE;
+
+    // Start from an empty region by erasing its segment headers
+    memset(segment, 0, SECTOR);
+    for(unsigned int i = 0; i < TORN_SEGMENTS; i++)
+        if(disk->write(REGION + i * Traits<Log_Store>::SEGMENT_SECTORS, segment, 1) != 1)
+            return false;
+
+    unsigned int kept = 0x600d;
+    Log_Store * log = new Log_Store(disk, REGION, TORN_REGION);
+    bool ok = !log->broken() && log->put("kept", &kept, sizeof(kept));
+    fill(value, TORN_SIZE, 0);
+    memcpy(value + TORN_SIZE - sizeof(MARK), MARK, sizeof(MARK));
+    ok &= log->put("torn", value, TORN_SIZE);
+    delete log;
+    if(!ok)
+        return false;
+
+    // Both batches went to the fresh region's first segment; damage the sector holding the mark, as a crash would
+    if(disk->read(REGION, segment, Traits<Log_Store>::SEGMENT_SECTORS) != int(Traits<Log_Store>::SEGMENT_SECTORS))
+        return false;
+    unsigned int at = sizeof(segment);
+    for(unsigned int i = 0; (at == sizeof(segment)) && (i + sizeof(MARK) <= sizeof(segment)); i++)
+        if(!memcmp(&segment[i], MARK, sizeof(MARK)))
+            at = i;
+    if(at == sizeof(segment))
+        return false;
+    segment[at] = ~segment[at];
+    if(disk->write(REGION + at / SECTOR, &segment[at / SECTOR * SECTOR], 1) != 1)
+        return false;
+
+    unsigned int v = 0;
+    log = new Log_Store(disk, REGION, TORN_REGION);
+    cout << "  " << log->statistics().torn_batches << " torn batches, " << log->size() << " keys recovered" << endl;
+    ok = !log->broken() && (log->statistics().torn_batches == 1) && (log->size() == 1);
+    ok &= (log->get("kept", &v, sizeof(v)) == sizeof(v)) && (v == kept) && (log->get("torn", result, sizeof(result)) < 0);
+
+    // The log goes on from where the torn batch was, and what follows survives another recovery
+    ok &= log->put("after", &kept, sizeof(kept));
+    delete log;
+    log = new Log_Store(disk, REGION, TORN_REGION);
+    ok &= !log->broken() && (log->size() == 2) && (log->get("after", &v, sizeof(v)) == sizeof(v)) && (v == kept);
+    delete log;
+
+    return ok;
+}
+
+int main()
+{
+    cout << "Log-structured Key-Value Store Test" << endl;
+
+    disk = VirtIO_Block::get();
+    if(!disk) {
+        cout << "No block device (was DISK given?)" << endl;
+        return -1;
+    }
+    if(disk->read_only() || (disk->sectors() < REGION + TORN_REGION)) {
+        cout << "The device must be writable and at least " << (REGION + TORN_REGION) * Block::SECTOR_SIZE / 1024 << " KB large!" << endl;
+        return -1;
+    }
+
+    store = new Log_Store(disk, 0, REGION);
+    if(store->broken()) {
+        cout << "Can't open the store!" << endl;
+        return -1;
+    }
+
+    unsigned int boots = 0;
+    store->get("boots", &boots, sizeof(boots));
+    cout << "Boot #" << boots << ": " << store->size() << " keys found, " << store->statistics().torn_batches << " torn batches" << endl;
+    if(boots)
+        cout << "state left by the previous run\t=> " << (final_state() ? "passed!" : "failed!") << endl;
+    boots++;
+    store->put("boots", &boots, sizeof(boots));
+
+    cout << "put()/get()/remove()\t=> " << (basic() ? "passed!" : "failed!") << endl;
+    cout << ROUNDS << " rounds over " << KEYS << " keys\t=> " << (overwrite() ? "passed!" : "failed!") << endl;
+    cout << WRITERS << " writers at once\t=> " << (concurrent() ? "passed!" : "failed!") << endl;
+    cout << "recovery\t=> " << (recovery() ? "passed!" : "failed!") << endl;
+    cout << "torn batch\t=> " << (torn() ? "passed!" : "failed!") << endl;
+
+    cout << "Statistics: " << store->statistics() << endl;
+
+    delete store;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
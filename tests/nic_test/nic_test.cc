@@ -0,0 +1,110 @@
+// EPOS NIC Test Program
+// Run with QEMU's user-mode network (the default for NODES > 1), whose gateway (10.0.2.2) answers ARP requests
+
+#include <machine.h>
+#include <time.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int TRIES = 10;
+
+struct ARP_Packet
+{
+    unsigned short htype;
+    unsigned short ptype;
+    unsigned char hlen;
+    unsigned char plen;
+    unsigned short oper;
+    Ethernet::Address sha;
+    unsigned char spa[4];
+    Ethernet::Address tha;
+    unsigned char tpa[4];
+} __attribute__((packed));
+
+const unsigned char GUEST[4] = { 10, 0, 2, 15 };
+const unsigned char GATEWAY[4] = { 10, 0, 2, 2 };
+
+void request(ARP_Packet * p, const Ethernet::Address & self)
+{
+    p->htype = CPU::htons(1);
+    p->ptype = CPU::htons(Ethernet::IP);
+    p->hlen = sizeof(Ethernet::Address);
+    p->plen = sizeof(GUEST);
+    p->oper = CPU::htons(1);
+    p->sha = self;
+    memcpy(p->spa, GUEST, sizeof(GUEST));
+    p->tha = Ethernet::Address::NULL;
+    memcpy(p->tpa, GATEWAY, sizeof(GATEWAY));
+}
+
+bool reply(const ARP_Packet * p) { return (CPU::ntohs(p->oper) == 2) && !memcmp(p->spa, GATEWAY, sizeof(GATEWAY)); }
+
+// Takes ARP frames straight from the NIC's receive ring and gives the buffers back once done
+class ARP_Observer: public Ethernet::Observer
+{
+public:
+    ARP_Observer(): _replies(0) {}
+
+    void update(Ethernet::Observed * o, const Ethernet::Protocol & p, Ethernet::Buffer * b) {
+        if(reply(b->frame()->data<ARP_Packet>())) {
+            _gateway = b->frame()->src();
+            _replies++;
+        }
+        b->nic()->free(b);
+    }
+
+    unsigned int replies() const { return _replies; }
+    const Ethernet::Address & gateway() const { return _gateway; }
+
+private:
+    volatile unsigned int _replies;
+    Ethernet::Address _gateway;
+};
+
+int main()
+{
+    cout << "NIC test" << endl;
+
+    GEM * nic = GEM::get();
+    if(!nic) {
+        cout << "No NIC (is Traits<Build>::NODES > 1?)" << endl;
+        return -1;
+    }
+    cout << "MAC address: " << nic->address() << endl;
+
+    // Zero-copy: the request is built in the transmit ring and the reply handed up in the receive ring
+    ARP_Observer observer;
+    nic->attach(&observer, Ethernet::ARP);
+
+    for(unsigned int i = 0; (i < TRIES) && !observer.replies(); i++) {
+        Ethernet::Buffer * buf = nic->alloc(Ethernet::Address::BROADCAST, Ethernet::ARP, 0, 0, sizeof(ARP_Packet));
+        request(buf->frame()->data<ARP_Packet>(), nic->address());
+        nic->send(buf);
+        Delay(100000);
+    }
+    bool ok = observer.replies();
+    cout << "alloc()/send()/notify()\t=> " << (ok ? "passed!" : "failed!") << " (gateway=" << observer.gateway() << ")" << endl;
+
+    nic->detach(&observer, Ethernet::ARP);
+
+    // Copying: frames no observer claims are kept for receive()
+    ARP_Packet packet;
+    request(&packet, nic->address());
+    nic->send(Ethernet::Address::BROADCAST, Ethernet::ARP, &packet, sizeof(packet));
+
+    Ethernet::Address src;
+    Ethernet::Protocol prot;
+    do
+        nic->receive(&src, &prot, &packet, sizeof(packet));
+    while(prot != Ethernet::ARP);
+    ok = reply(&packet) && (src == observer.gateway());
+    cout << "send()/receive()\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    cout << "Statistics: " << nic->statistics() << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+// EPOS SiFive QSPI and PDMA Test Program
+// Reads the boot flash on QSPI0 through submitted requests, through the memory-mapped (XIP) window and through the
+// PDMA, and checks that they all agree
+
+#include <machine.h>
+#include <machine/spi.h>
+#include <synchronizer.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int FLASH_OFFSET = 0;
+const unsigned int SIZE = 256;
+const unsigned int HEADER = 4; // command and 3-byte address
+const unsigned int DMA_CHANNEL = 1; // QSPI0 takes Traits<SPI>::DMA_CHANNEL
+
+unsigned char command[HEADER + SIZE];
+unsigned char xip[SIZE];
+unsigned char source[SIZE];
+unsigned char copy[SIZE];
+
+int main()
+{
+    cout << "QSPI and PDMA test" << endl;
+
+    SPI spi(0, SPI::Si5_SINGLE, SPI::MASTER, 1000000, 8);
+    Semaphore finished(0);
+    Semaphore_Handler handler(&finished);
+
+    // Submitted requests, each a transaction of its own: WRITE DISABLE (a single frame, whose end tells when the
+    // slave may be deselected), JEDEC ID and READ DATA, then a FLUSH after all of them
+    unsigned char disable[1] = { 0x04 };
+    unsigned char id[4] = { 0x9f, 0, 0, 0 };
+    command[0] = SPI::FLASH_READ;
+    command[1] = FLASH_OFFSET >> 16;
+    command[2] = FLASH_OFFSET >> 8;
+    command[3] = FLASH_OFFSET;
+    IO_Request write(IO_Request::WRITE, disable, sizeof(disable), &handler);
+    IO_Request identify(IO_Request::TRANSFER, id, sizeof(id), &handler);
+    IO_Request read(IO_Request::TRANSFER, command, sizeof(command), &handler);
+    IO_Request flush(IO_Request::FLUSH, 0, 0, &handler);
+    IO_Request * requests[] = { &write, &identify, &read, &flush };
+    unsigned int submitted = 0;
+    while((submitted < 4) && spi.submit(requests[submitted]))
+        submitted++;
+    for(unsigned int i = 0; i < submitted; i++)
+        finished.p();
+    bool ok = (submitted == 4);
+    ok &= (write.status() == IO_Request::DONE) && (write.count() == sizeof(disable));
+    ok &= (identify.status() == IO_Request::DONE) && (read.status() == IO_Request::DONE) && (read.count() == sizeof(command));
+    ok &= (flush.status() == IO_Request::DONE);
+    cout << "JEDEC ID: " << hex << id[1] << " " << id[2] << " " << id[3] << dec << endl;
+    ok &= (id[1] != 0x00) && (id[1] != 0xff);
+    cout << "Submitted requests\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // The same bytes through the memory-mapped window, with programmed I/O refused meanwhile
+    ok = spi.xip(true, SPI::FLASH_READ, 3, 0);
+    IO_Request refused(IO_Request::READ, id, sizeof(id), &handler);
+    ok &= !spi.submit(&refused);
+    ok &= !memcmp(reinterpret_cast<const unsigned char *>(SPI::xip_base()) + FLASH_OFFSET, &command[HEADER], SIZE);
+    cout << "XIP loads\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // And copied by the PDMA (in library mode) through xip_read()
+    IO_Request xip_request(IO_Request::READ, xip, sizeof(xip), &handler, FLASH_OFFSET);
+    ok = spi.xip_read(&xip_request);
+    if(ok)
+        finished.p();
+    ok &= (xip_request.status() == IO_Request::DONE) && (xip_request.count() == SIZE) && !memcmp(xip, &command[HEADER], SIZE);
+    cout << "xip_read()\t=> " << (ok ? "passed!" : "failed!") << endl;
+    ok = spi.xip(false) && !spi.xip();
+    cout << "XIP off\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // A plain memory-to-memory copy on another PDMA channel, whose window is the source buffer
+    for(unsigned int i = 0; i < SIZE; i++)
+        source[i] = i * 7;
+    PDMA pdma(DMA_CHANNEL, CPU::Phy_Addr(source));
+    IO_Request half(IO_Request::READ, copy, SIZE / 2, &handler, 0);
+    IO_Request rest(IO_Request::READ, copy + SIZE / 2, SIZE / 2, &handler, SIZE / 2);
+    submitted = pdma.submit(&half) ? (pdma.submit(&rest) ? 2 : 1) : 0;
+    for(unsigned int i = 0; i < submitted; i++)
+        finished.p();
+    ok = (submitted == 2);
+    ok &= (half.status() == IO_Request::DONE) && (rest.status() == IO_Request::DONE) && !memcmp(copy, source, SIZE);
+    cout << "PDMA copies\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    cout << "I'm done, bye!" << endl;
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+// EPOS Tasklet Test Program
+// Tasklets are run at interrupt exit by the RISC-V IC only
+
+#include <interrupt.h>
+#include <time.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+const unsigned int REPOSTS = 3;
+
+Tasklet * tasklet;
+volatile unsigned int runs;
+volatile unsigned int depth;
+volatile bool nested;
+volatile unsigned int reposts;
+
+void handler()
+{
+    if(depth++)
+        nested = true;
+    runs++;
+    if(reposts) {
+        reposts--;
+        tasklet->schedule();
+    }
+    depth--;
+}
+
+void reset(unsigned int r)
+{
+    runs = 0;
+    reposts = r;
+}
+
+bool wait(unsigned int n)
+{
+    for(unsigned int i = 0; (i < 100) && (runs < n); i++)
+        Delay(10000);
+    return runs == n;
+}
+
+int main()
+{
+    cout << "Tasklet test" << endl;
+
+    Function_Handler function(&handler);
+    Tasklet t(&function);
+    tasklet = &t;
+
+    // Posts made before the Tasklet runs coalesce into a single run
+    reset(0);
+    CPU::int_disable();
+    bool first = t.schedule();
+    bool second = t.schedule();
+    t.schedule();
+    bool ok = first && !second && (t.pending() == 3) && Tasklet::scheduled();
+    Tasklet::run();
+    ok &= (runs == 1) && (t.pending() == 0) && !Tasklet::scheduled();
+    CPU::int_enable();
+    cout << "Coalesced posts\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // A Tasklet that reposts itself from its handler runs again only on the next run, never nested within the current one
+    reset(REPOSTS);
+    CPU::int_disable();
+    t.schedule();
+    ok = true;
+    for(unsigned int i = 1; i <= REPOSTS; i++) {
+        Tasklet::run();
+        ok &= (runs == i) && (t.pending() == 1) && Tasklet::scheduled();
+    }
+    Tasklet::run();
+    ok &= (runs == REPOSTS + 1) && (t.pending() == 0) && !Tasklet::scheduled();
+    CPU::int_enable();
+    cout << "Reposting from the handler\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    // Both again, now left to the interrupt exits (the timer's, at least), with the Delay's own alarms deferred as well
+    reset(0);
+    CPU::int_disable();
+    t.schedule();
+    t.schedule();
+    CPU::int_enable();
+    ok = wait(1);
+    reset(REPOSTS);
+    t.schedule();
+    ok &= wait(REPOSTS + 1);
+    Delay(10000);
+    ok &= (runs == REPOSTS + 1) && (t.pending() == 0) && !nested;
+    cout << "At interrupt exit\t=> " << (ok ? "passed!" : "failed!") << endl;
+
+    cout << "I'm done, bye!" << endl;
+
+    return 0;
+}
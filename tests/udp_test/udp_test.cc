@@ -0,0 +1,111 @@
+// EPOS UDP/IP Test Program
+// Run with QEMU's user-mode network (the default for NODES > 1), whose DNS server (10.0.2.3) answers UDP queries
+
+#include <communicator.h>
+
+using namespace EPOS;
+
+OStream cout;
+
+// RFC 1071 example (checksum 0x220d) and an IPv4 header carrying its (valid) checksum
+const unsigned char RFC1071[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+const unsigned char HEADER[] = { 0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11, 0xb8, 0x61, 0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0xc7 };
+
+// DNS query for "epos.lisha.ufsc.br" (A, IN); any answer (even an error) will do
+const unsigned char QUERY[] = { 0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x04, 'e', 'p', 'o', 's', 0x05, 'l', 'i', 's', 'h', 'a', 0x04, 'u', 'f', 's', 'c', 0x02, 'b', 'r', 0x00,
+                                0x00, 0x01, 0x00, 0x01 };
+
+// Zero-copy Buffers are system objects, so this (library mode) test uses the system's Port rather than the framework's
+typedef _SYS::Port<UDP> UDP_Port;
+
+const UDP::Address DNS(IP::Address(10, 0, 2, 3), 53);
+
+bool checksums()
+{
+    bool ok = true;
+
+    unsigned short sum = IP::checksum(RFC1071, sizeof(RFC1071));
+    const unsigned char * bytes = reinterpret_cast<const unsigned char *>(&sum);
+    ok &= (bytes[0] == 0x22) && (bytes[1] == 0x0d);
+    cout << "RFC 1071 example\t=> " << hex << CPU::ntohs(sum) << dec << endl;
+
+    ok &= (IP::checksum(HEADER, sizeof(HEADER)) == 0);
+
+    // Alignment, odd sizes, split sums and copying must not change the result
+    unsigned char buffer[sizeof(HEADER) + 4];
+    for(unsigned int offset = 0; offset < 4; offset++) {
+        memcpy(&buffer[offset], HEADER, sizeof(HEADER));
+        ok &= (IP::checksum(&buffer[offset], sizeof(HEADER)) == 0);
+        ok &= (IP::fold(IP::sum(&buffer[offset], sizeof(HEADER) - 1)) == IP::fold(IP::sum(HEADER, sizeof(HEADER) - 1)));
+        ok &= (IP::fold(IP::sum(&buffer[offset + 6], sizeof(HEADER) - 6, IP::sum(&buffer[offset], 6))) == 0xffff);
+        ok &= (IP::fold(IP::copy_and_sum(&buffer[offset], RFC1071, sizeof(RFC1071))) == IP::fold(IP::sum(RFC1071, sizeof(RFC1071))));
+        ok &= !memcmp(&buffer[offset], RFC1071, sizeof(RFC1071));
+    }
+
+    return ok;
+}
+
+bool query(UDP_Port * port, unsigned short id)
+{
+    unsigned char query[sizeof(QUERY)];
+    memcpy(query, QUERY, sizeof(QUERY));
+    query[0] = id >> 8;
+    query[1] = id;
+
+    if(port->send(DNS, query, sizeof(query)) != sizeof(query))
+        return false;
+
+    unsigned char reply[512];
+    UDP::Address from;
+    int size = port->receive(&from, reply, sizeof(reply));
+    cout << "Reply from " << from << " (" << size << " bytes)" << endl;
+
+    return (from == DNS) && (size >= 12) && (reply[0] == (id >> 8)) && (reply[1] == (id & 0xff)) && (reply[2] & 0x80);
+}
+
+bool zero_copy_query(UDP_Port * port, unsigned short id)
+{
+    UDP::Buffer * buf = port->alloc(DNS, sizeof(QUERY));
+    if(!buf)
+        return false;
+    unsigned char * query = UDP::datagram(buf)->data<unsigned char>();
+    memcpy(query, QUERY, sizeof(QUERY));
+    query[0] = id >> 8;
+    query[1] = id;
+    port->send(buf);
+
+    buf = port->receive();
+    unsigned char * reply = UDP::datagram(buf)->data<unsigned char>();
+    bool ok = (UDP::from(buf) == DNS) && (UDP::size(buf) >= 12) && (reply[0] == (id >> 8)) && (reply[1] == (id & 0xff)) && (reply[2] & 0x80);
+    cout << "Reply from " << UDP::from(buf) << " (" << UDP::size(buf) << " bytes)" << endl;
+    port->free(buf);
+
+    return ok;
+}
+
+int main()
+{
+    cout << "UDP/IP test" << endl;
+
+    cout << "checksum()\t\t=> " << (checksums() ? "passed!" : "failed!") << endl;
+
+    IP * ip = IP::get();
+    if(!ip) {
+        cout << "No network (is Traits<Build>::NODES > 1?)" << endl;
+        return -1;
+    }
+    cout << "IP address: " << ip->address() << " (MAC " << ip->nic()->address() << ")" << endl;
+
+    UDP_Port port(5353);
+
+    // The first query also resolves the gateway through ARP
+    cout << "send()/receive()\t=> " << (query(&port, 0x1234) ? "passed!" : "failed!") << endl;
+    cout << "alloc()/send()/receive()\t=> " << (zero_copy_query(&port, 0x4321) ? "passed!" : "failed!") << endl;
+
+    cout << "Statistics: " << ip->nic()->statistics() << endl;
+
+    cout << "Done!" << endl;
+
+    return 0;
+}
@@ -18,10 +18,12 @@
 #include <ctype.h>
 
 #include <system/info.h>
+#include <utility/lz4.h>
 
 // CONSTANTS
 static const unsigned int MAX_SI_LEN = 512;
 static const char CFG_FILE[] = "etc/eposmkbi.conf";
+static const unsigned int APP_ALIGNMENT = 4096; // APPLICATION alignment in the image, so SETUP can map its pages instead of copying them
 
 // TYPES
 
@@ -53,6 +55,9 @@ struct Configuration
 // System_Info
 typedef _SYS::System_Info System_Info;
 
+// Compression of INIT, SYSTEM and APPLICATION (option -Z)
+typedef _UTIL::LZ4 LZ4;
+
 // PROTOTYPES
 bool parse_config(FILE * cfg_file, Configuration * cfg);
 void strtolower (char * dst,const char * src);
@@ -62,6 +67,7 @@ bool file_exist(char *file);
 
 int put_buf(int fd_out, void * buf, int size);
 int put_file(int fd_out, char * file);
+int put_compressed_file(int fd_out, char * file);
 int pad(int fd_out, int size);
 bool lil_endian();
 
@@ -73,6 +79,7 @@ template<typename T> bool add_boot_map(int fd_out, System_Info * si);
 FILE * out;
 FILE * err;
 Configuration CONFIG;
+bool compress = false;
 
 //=============================================================================
 // MAIN
@@ -95,11 +102,14 @@ int main(int argc, char **argv)
         error = true;
 
     int opt;
-    while((opt = getopt(argc, argv, "csx:y:z:")) != -1) {
+    while((opt = getopt(argc, argv, "cZsx:y:z:")) != -1) {
         switch(opt) {
         case 'c':
             print_si = true;
             break;
+        case 'Z':
+            compress = true;
+            break;
         case 's': {
             FILE * nul = fopen("/dev/null", "w");
             if(!nul) {
@@ -126,7 +136,7 @@ int main(int argc, char **argv)
         error = true;
 
     if(error) {
-        fprintf(err, "Usage: %s [-c] [-s] [-x X] [-y Y] [-z Z] <EPOS root> <boot image> <app1> <app2> ...\n", argv[0]);
+        fprintf(err, "Usage: %s [-c] [-Z] [-s] [-x X] [-y Y] [-z Z] <EPOS root> <boot image> <app1> <app2> ...\n", argv[0]);
         return 1;
     }
 
@@ -212,6 +222,10 @@ int main(int argc, char **argv)
 
     // Add INIT and OS (for mode != library only)
     if(!strcmp(CONFIG.mode, "library")) {
+        if(compress) {
+            fprintf(err, "Warning: compression is not supported in library mode!\n");
+            compress = false;
+        }
         si.bm.init_offset = -1;
         si.bm.system_offset = -1;
     } else {
@@ -219,19 +233,21 @@ int main(int argc, char **argv)
         si.bm.init_offset = image_size - boot_size;
         sprintf(file, "%s/img/init_%s", argv[optind], CONFIG.mmod);
         fprintf(out, "    Adding init \"%s\":", file);
-        image_size += put_file(fd_img, file);
+        image_size += compress ? put_compressed_file(fd_img, file) : put_file(fd_img, file);
 
         // Add SYSTEM
         si.bm.system_offset = image_size - boot_size;
         sprintf(file, "%s/img/system_%s", argv[optind], CONFIG.mmod);
         fprintf(out, "    Adding system \"%s\":", file);
-        image_size += put_file(fd_img, file);
+        image_size += compress ? put_compressed_file(fd_img, file) : put_file(fd_img, file);
     }
 
-    // Add application(s) and data
+    // Add application(s) and data (compressed parts are realigned by SETUP as they are expanded)
+    if(strcmp(CONFIG.mode, "library") && !compress && ((image_size - boot_size) % APP_ALIGNMENT))
+        image_size += pad(fd_img, APP_ALIGNMENT - (image_size - boot_size) % APP_ALIGNMENT);
     si.bm.application_offset = image_size - boot_size;
     fprintf(out, "    Adding application \"%s\":", argv[optind + 2]);
-    image_size += put_file(fd_img, argv[optind + 2]);
+    image_size += compress ? put_compressed_file(fd_img, argv[optind + 2]) : put_file(fd_img, argv[optind + 2]);
     if((argc - optind) == 3) // single APP
         si.bm.extras_offset = -1;
     else { // multiple APPs or data
@@ -686,6 +702,65 @@ int put_file(int fd_out, char * file)
     return stat.st_size;
 }
 
+//=============================================================================
+// PUT_COMPRESSED_FILE
+//=============================================================================
+int put_compressed_file(int fd_out, char * file)
+{
+    int fd_in;
+    struct stat stat;
+    char * buffer;
+    char * compressed;
+    static LZ4::Table table;
+
+    fd_in = open(file, O_RDONLY);
+    if(fd_in < 0) {
+        fprintf(out, " failed! (open)\n");
+        return 0;
+    }
+
+    if(fstat(fd_in, &stat) < 0)  {
+        fprintf(out, " failed! (stat)\n");
+        return 0;
+    }
+
+    buffer = (char *) malloc(stat.st_size);
+    compressed = (char *) malloc(LZ4::bound(stat.st_size));
+    if(!buffer || !compressed) {
+        fprintf(out, " failed! (malloc)\n");
+        free(buffer);
+        free(compressed);
+        return 0;
+    }
+
+    if(read(fd_in, buffer, stat.st_size) < 0) {
+        fprintf(out, " failed! (read)\n");
+        free(buffer);
+        free(compressed);
+        return 0;
+    }
+    close(fd_in);
+
+    // Parts that don't shrink by more than the header are stored as they are
+    unsigned long size = LZ4::compress(compressed, LZ4::bound(stat.st_size), buffer, stat.st_size, table);
+    int written = 0;
+    if(size && (size + sizeof(LZ4::Header) < (unsigned long)stat.st_size)) {
+        written += put_number(fd_out, LZ4::Header::MAGIC);
+        written += put_number(fd_out, static_cast<unsigned int>(stat.st_size));
+        written += put_number(fd_out, static_cast<unsigned int>(size));
+        written += put_buf(fd_out, compressed, size);
+        fprintf(out, " done (%ld => %d bytes, %.1f%%).\n", (long)stat.st_size, written, 100.0 * written / stat.st_size);
+    } else {
+        written += put_buf(fd_out, buffer, stat.st_size);
+        fprintf(out, " done (incompressible).\n");
+    }
+
+    free(buffer);
+    free(compressed);
+
+    return written;
+}
+
 //=============================================================================
 // PUT_BUF
 //=============================================================================
@@ -0,0 +1,186 @@
+/*=======================================================================*/
+/* epostrace.cc                                                          */
+/*                                                                       */
+/* Desc: Tool to decode the binary event trace dumped by EPOS' Tracer    */
+/*       at shutdown (see include/utility/tracer.h).                     */
+/*                                                                       */
+/* Parm: [console log] (defaults to stdin)                               */
+/*=======================================================================*/
+
+// Using only bare C to avoid conflicts with EPOS
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Constants
+const unsigned int RECORD_SIZE = 32;
+const unsigned int LINE_SIZE = 256;
+
+// Events (keep in sync with Tracer::Event)
+const char * events[] = {
+    "?",
+    "dispatch",
+    "wakeup",
+    "sleep",
+    "alarm",
+    "irq_enter",
+    "irq_exit",
+    "syscall"
+};
+const unsigned int EVENTS = sizeof(events) / sizeof(events[0]);
+const unsigned int USER = 128;
+
+// Decoded record
+struct Record {
+    unsigned long long time;
+    unsigned int event;
+    unsigned int cpu;
+    unsigned long long a;
+    unsigned long long b;
+    unsigned int seq; // to keep each CPU's order on timestamp ties
+};
+
+// Prototypes
+static bool decode(const char * line, Record * r);
+static unsigned long long le(const unsigned char * b, unsigned int n);
+static int compare(const void * a, const void * b);
+
+int main(int argc, char **argv)
+{
+    FILE * in = stdin;
+    if(argc > 2) {
+        fprintf(stderr, "Usage: %s [console log]\n", argv[0]);
+        return 1;
+    }
+    if(argc == 2) {
+        in = fopen(argv[1], "r");
+        if(!in) {
+            fprintf(stderr, "Error: can't open %s!\n", argv[1]);
+            return 1;
+        }
+    }
+
+    char line[LINE_SIZE];
+    unsigned long long hz = 0;
+    bool inside = false;
+    unsigned int lost = 0;
+    unsigned int count = 0;
+    unsigned int size = 1024;
+    Record * records = static_cast<Record *>(malloc(size * sizeof(Record)));
+
+    while(fgets(line, LINE_SIZE, in)) {
+        // Consoles may prepend garbage (e.g. a CR), so search for the markers instead of matching whole lines
+        char * p;
+        if((p = strstr(line, "<trace "))) {
+            char * h = strstr(p, "hz=");
+            hz = h ? strtoull(h + 3, 0, 10) : 0;
+            inside = true;
+            count = 0;
+            lost = 0;
+        } else if(strstr(line, "</trace>"))
+            inside = false;
+        else if(inside && (p = strstr(line, "<cpu "))) {
+            char * l = strstr(p, "lost=");
+            if(l)
+                lost += strtoul(l + 5, 0, 10);
+        } else if(inside) {
+            if(count == size) {
+                size *= 2;
+                records = static_cast<Record *>(realloc(records, size * sizeof(Record)));
+            }
+            if(decode(line, &records[count])) {
+                records[count].seq = count;
+                count++;
+            }
+        }
+    }
+
+    if(in != stdin)
+        fclose(in);
+
+    if(!hz) {
+        fprintf(stderr, "Error: no trace found!\n");
+        return 1;
+    }
+
+    // Each CPU's ring is in order, but CPUs must be merged
+    qsort(records, count, sizeof(Record), compare);
+
+    printf("# %u records (%u lost to ring overflow), TSC at %llu Hz\n", count, lost, hz);
+    printf("# %14s %14s %4s %-10s %-18s %-18s\n", "time (us)", "delta (us)", "cpu", "event", "a", "b");
+
+    unsigned long long start = count ? records[0].time : 0;
+    unsigned long long last = start;
+    for(unsigned int i = 0; i < count; i++) {
+        Record * r = &records[i];
+        double time = (r->time - start) * 1000000.0 / hz;
+        double delta = (r->time - last) * 1000000.0 / hz;
+        last = r->time;
+
+        char event[16];
+        if(r->event < EVENTS)
+            snprintf(event, sizeof(event), "%s", events[r->event]);
+        else if(r->event >= USER)
+            snprintf(event, sizeof(event), "user+%u", r->event - USER);
+        else
+            snprintf(event, sizeof(event), "%u", r->event);
+
+        printf("  %14.3f %14.3f %4u %-10s 0x%016llx 0x%016llx\n", time, delta, r->cpu, event, r->a, r->b);
+    }
+
+    free(records);
+
+    return 0;
+}
+
+static bool decode(const char * line, Record * r)
+{
+    unsigned char b[RECORD_SIZE];
+    unsigned int n = 0;
+
+    for(const char * p = line; *p && (n < 2 * RECORD_SIZE); p++) {
+        int v;
+        if((*p >= '0') && (*p <= '9'))
+            v = *p - '0';
+        else if((*p >= 'a') && (*p <= 'f'))
+            v = *p - 'a' + 10;
+        else if(n == 0)
+            continue; // skip leading garbage
+        else
+            return false;
+
+        if(n % 2)
+            b[n / 2] |= v;
+        else
+            b[n / 2] = v << 4;
+        n++;
+    }
+
+    if(n != 2 * RECORD_SIZE)
+        return false;
+
+    r->time = le(&b[0], 8);
+    r->event = le(&b[8], 4);
+    r->cpu = le(&b[12], 4);
+    r->a = le(&b[16], 8);
+    r->b = le(&b[24], 8);
+
+    return true;
+}
+
+static unsigned long long le(const unsigned char * b, unsigned int n)
+{
+    unsigned long long v = 0;
+    for(unsigned int i = n; i > 0; i--)
+        v = (v << 8) | b[i - 1];
+    return v;
+}
+
+static int compare(const void * a, const void * b)
+{
+    const Record * r1 = static_cast<const Record *>(a);
+    const Record * r2 = static_cast<const Record *>(b);
+    if(r1->time != r2->time)
+        return (r1->time > r2->time) ? 1 : -1;
+    return (r1->seq > r2->seq) - (r1->seq < r2->seq);
+}